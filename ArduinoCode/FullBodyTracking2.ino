@@ -2,6 +2,25 @@
 #include <SoftwareSerial.h>
 #include <MPU6050.h>
 
+// BINARY_MODE 1 sends packed frames on Serial as fast as the bus allows instead of text lines on
+// both ports, for host/build/imu_receive to turn into a log. Each frame is
+//
+//   0xA5 0x5A, u16 sequence, u32 micros() at its start, u8 mask of the sensors read, u8 sensors,
+//   6 x int16 per sensor (AX AY AZ GX GY GZ), u16 Fletcher-16 of everything after the sync bytes
+//
+// all little-endian (host/collect.h decodes it). FRAME_PERIOD_US paces the frames to a fixed
+// rate, e.g. the firmware's, 0 reads the next frame right away.
+#ifndef BINARY_MODE
+#define BINARY_MODE 0
+#endif
+#ifndef FRAME_PERIOD_US
+#define FRAME_PERIOD_US 0
+#endif
+#define BINARY_BAUD 500000
+#define I2C_CLOCK 400000
+#define NUM_SENSORS 6
+#define FRAME_BYTES (10 + NUM_SENSORS * 12 + 2)
+
 MPU6050 mpu[6];  // Array of 6 MPU6050 objects
 
 SoftwareSerial BTserial(2, 3); // RX | TX
@@ -15,7 +34,11 @@ int16_t AccX,AccY,AccZ,Temp,GyroX,GyroY,GyroZ;
 
 void setup() {
   BTserial.begin(57600);
+#if BINARY_MODE
+  Serial.begin(BINARY_BAUD);
+#else
   Serial.begin(115200);
+#endif
   Wire.begin(0x69);  // Initialize the I2C bus
 
   // Initialize each MPU6050 sensor with alternate addresses
@@ -50,8 +73,85 @@ void setup() {
 
     digitalWrite(AD0_pins[i], LOW);
   }
+
+#if BINARY_MODE
+  Wire.setClock(I2C_CLOCK);
+  Wire.setWireTimeout(10000, true);
+#endif
+}
+
+#if BINARY_MODE
+
+static void put16(uint8_t *p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
 }
 
+void loop(){
+  static uint16_t sequence = 0;
+  static uint32_t next_frame = micros();  // the pace starts with the first frame
+  uint8_t frame[FRAME_BYTES];
+  uint8_t mask = 0;
+
+  if (FRAME_PERIOD_US > 0) {
+    while ((int32_t) (micros() - next_frame) < 0) {
+    }
+    next_frame += FRAME_PERIOD_US;
+  }
+
+  uint32_t start = micros();
+
+  frame[0] = 0xA5;
+  frame[1] = 0x5A;
+  put16(frame + 2, sequence++);
+  put16(frame + 4, start & 0xFFFF);
+  put16(frame + 6, start >> 16);
+  frame[9] = NUM_SENSORS;
+
+  for (int i = 0; i < NUM_SENSORS; i++) {
+    uint8_t *out = frame + 10 + i * 12;
+    uint8_t regs[14];
+
+    digitalWrite(AD0_pins[i], HIGH);
+    Wire.beginTransmission(MPU6050_addr);
+    Wire.write(0x3B);
+    Wire.endTransmission(false);
+
+    // A sensor that doesn't answer is sent as zeros with its bit clear
+    if (Wire.requestFrom(MPU6050_addr, 14, true) == 14 && !Wire.getWireTimeoutFlag()) {
+      for (int b = 0; b < 14; b++) {
+        regs[b] = Wire.read();
+      }
+      mask |= 1 << i;
+    } else {
+      memset(regs, 0, sizeof(regs));
+    }
+    digitalWrite(AD0_pins[i], LOW);
+    Wire.clearWireTimeoutFlag();
+
+    // Registers are big-endian AX AY AZ TEMP GX GY GZ, the temperature isn't sent
+    for (int a = 0; a < 6; a++) {
+      int r = (a < 3) ? 2 * a : 2 * a + 2;
+      put16(out + 2 * a, ((uint16_t) regs[r] << 8) | regs[r + 1]);
+    }
+  }
+  frame[8] = mask;
+
+  // Fletcher-16, reduced by subtraction since the AVR has no divider
+  uint16_t sum1 = 0, sum2 = 0;
+  for (int b = 2; b < FRAME_BYTES - 2; b++) {
+    sum1 += frame[b];
+    sum1 -= (sum1 >= 255) ? 255 : 0;
+    sum2 += sum1;
+    sum2 -= (sum2 >= 255) ? 255 : 0;
+  }
+  put16(frame + FRAME_BYTES - 2, (sum2 << 8) | sum1);
+
+  Serial.write(frame, FRAME_BYTES);
+}
+
+#else
+
 void loop(){
   for(int i = 0; i < 6; i++)
   {
@@ -94,4 +194,6 @@ void loop(){
 
     delay(10);
   }
-}
\ No newline at end of file
+}
+
+#endif
\ No newline at end of file
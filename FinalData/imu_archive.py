@@ -0,0 +1,269 @@
+import io
+import os
+import sys
+import time
+import ctypes
+import struct
+import numpy as np
+
+# Reader of the compressed IMU log archives (.imz) written by host/build/imu_pack, whose format is
+# described in host/imu_archive.h. Archive(path).text() gives back the text of the log byte for
+# byte, so parse_data.py and index_data.py treat it like the log. The blocks are decoded with the
+# C++ decoder from `make -C host` (host/build/libimuarchive.so, or IMU_ARCHIVE_LIB) when it has
+# been built, otherwise with the same decoder in plain Python, which is a lot slower. With the C++
+# decoder Archive(path).parsed_lines() hands parse_data.py the samples already parsed, which is
+# what makes reading an archive faster than reading the log.
+
+MAGIC = b'IMUZ'
+VERSION = 2
+HEADER = struct.Struct('<4sBBHIIQQ')
+TABLE_ENTRY = struct.Struct('<QQQ')
+BLOCK = struct.Struct('<IIII')
+AXES = 6
+IMUS = 16
+DELTA_SYMBOLS = 18
+MAX_CODE_LEN = 15
+MODE_SHIFT_MASK = 3
+MODE_VALUES = 4
+EOL = ('', '\n', '\r\n', '\r')
+SAMPLE_FORMAT = '%d: AX %d AY %d AZ %d GX %d GY %d GZ %d'
+
+ARCHIVE_LIB = os.environ.get('IMU_ARCHIVE_LIB', os.path.join(
+    os.path.dirname(os.path.abspath(__file__)), '..', 'host', 'build', 'libimuarchive.so'))
+
+
+def load_archive_lib(path=ARCHIVE_LIB):
+    """Returns the native decoder, or None if it hasn't been built"""
+    try:
+        lib = ctypes.CDLL(path)
+    except OSError:
+        return None
+    lib.imu_archive_decode.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_size_t,
+                                       ctypes.c_size_t, ctypes.c_char_p, ctypes.c_size_t]
+    lib.imu_archive_decode.restype = ctypes.c_long
+    lib.imu_archive_decode_samples.argtypes = [ctypes.c_char_p, ctypes.c_size_t, ctypes.c_size_t,
+                                               ctypes.c_size_t, ctypes.c_void_p, ctypes.c_void_p,
+                                               ctypes.c_size_t]
+    lib.imu_archive_decode_samples.restype = ctypes.c_long
+    return lib
+
+
+_archive_lib = load_archive_lib()
+
+
+def is_archive(path):
+    """Whether a file is an archive rather than a text log"""
+    with open(path, 'rb') as f:
+        return f.read(len(MAGIC)) == MAGIC
+
+
+class BitReader:
+    """LSB-first bit stream of a block"""
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+        self.buf = 0
+        self.bits = 0
+
+    def get(self, n):
+        while self.bits < n:
+            if self.pos == len(self.data):
+                raise ValueError('archive block truncated')
+            self.buf |= self.data[self.pos] << self.bits
+            self.pos += 1
+            self.bits += 8
+        value = self.buf & ((1 << n) - 1)
+        self.buf >>= n
+        self.bits -= n
+        return value
+
+
+class HuffmanDecoder:
+    """Canonical Huffman decoding one bit at a time"""
+    def __init__(self, lengths):
+        self.count = [lengths.count(bits) for bits in range(MAX_CODE_LEN + 1)]
+        self.symbols = [s for bits in range(1, MAX_CODE_LEN + 1)
+                        for s, length in enumerate(lengths) if length == bits]
+
+    def decode(self, bits):
+        code = first = index = 0
+        for length in range(1, MAX_CODE_LEN + 1):
+            code |= bits.get(1)
+            count = self.count[length]
+            if code - first < count:
+                return self.symbols[index + code - first]
+            index += count
+            first = (first + count) << 1
+            code <<= 1
+        raise ValueError('bad code in archive block')
+
+
+class Archive:
+    def __init__(self, path):
+        """
+        Args:
+            path (str): Path of the archive.
+        """
+        with open(path, 'rb') as f:
+            self.data = f.read()
+        magic, version, self.eol, axes, self.block_lines, blocks, self.lines, self.size = \
+            HEADER.unpack_from(self.data)
+        if magic != MAGIC or version != VERSION or axes != AXES:
+            raise ValueError('%s is not an IMU archive of version %d' % (path, VERSION))
+        self.blocks = [TABLE_ENTRY.unpack_from(self.data, HEADER.size + b * TABLE_ENTRY.size)
+                       for b in range(blocks)]
+
+    def num_blocks(self):
+        return len(self.blocks)
+
+    def block_of_line(self, line):
+        """Block holding a line of the log"""
+        return line // self.block_lines
+
+    def block_count(self, first, count):
+        """count, or the blocks from first to the end if it is None"""
+        count = len(self.blocks) - first if count is None else count
+        if first < 0 or count < 0 or first + count > len(self.blocks):
+            raise IndexError('blocks %d+%d of %d' % (first, count, len(self.blocks)))
+        return count
+
+    def text(self, first=0, count=None):
+        """Returns the text of the log in blocks first ... first + count - 1"""
+        count = self.block_count(first, count)
+        size = sum(entry[2] for entry in self.blocks[first:first + count])
+
+        if _archive_lib is not None:
+            out = ctypes.create_string_buffer(size)
+            n = _archive_lib.imu_archive_decode(self.data, len(self.data), first, count, out, size)
+            if n != size:
+                raise ValueError('bad archive')
+            return out.raw.decode('latin-1')
+        return ''.join(self.decode_block(b) for b in range(first, first + count))
+
+    def verbatim(self, b):
+        """Lines of block b kept as text by their line in the block, with their line ends"""
+        offset = self.blocks[b][0]
+        verbatim = BLOCK.unpack_from(self.data, offset)[1]
+        pos = offset + BLOCK.size
+        texts = {}
+        for _ in range(verbatim):
+            i, eol, length = struct.unpack_from('<IBI', self.data, pos)
+            pos += 9
+            texts[i] = self.data[pos:pos + length].decode('latin-1') + EOL[eol]
+            pos += length
+        return texts
+
+    def decode_block(self, b):
+        """Text of block b, decoded in Python"""
+        offset = self.blocks[b][0]
+        count, verbatim, text_bytes, coded_bytes = BLOCK.unpack_from(self.data, offset)
+        texts = self.verbatim(b)
+        pos = offset + BLOCK.size + text_bytes
+
+        present, = struct.unpack_from('<H', self.data, pos)
+        pos += 2
+        imus = [imu for imu in range(IMUS) if present >> imu & 1]
+        nibbles = IMUS + len(imus) * AXES * (1 + DELTA_SYMBOLS)
+        packed = self.data[pos:pos + (nibbles + 1) // 2]
+        lengths = [packed[i // 2] >> (4 * (i % 2)) & 0xf for i in range(nibbles)]
+        pos += (nibbles + 1) // 2
+        imu_table = HuffmanDecoder(lengths[:IMUS])
+        tables = {}
+        modes = {}
+        for n, imu in enumerate(imus):
+            for a in range(AXES):
+                start = IMUS + (n * AXES + a) * (1 + DELTA_SYMBOLS)
+                modes[imu, a] = lengths[start]
+                if modes[imu, a] > MODE_VALUES | MODE_SHIFT_MASK:
+                    raise ValueError('bad column mode in archive block')
+                tables[imu, a] = HuffmanDecoder(lengths[start + 1:start + 1 + DELTA_SYMBOLS])
+
+        bits = BitReader(self.data[pos:pos + coded_bytes])
+        samples = count - verbatim
+        imu_column = []
+        prev_imu = 0
+        for _ in range(samples):
+            prev_imu = (prev_imu - imu_table.decode(bits)) & (IMUS - 1)
+            imu_column.append(prev_imu)
+
+        values = [[0] * AXES for _ in range(samples)]
+        prev = {}
+        for a in range(AXES):
+            for n, imu in enumerate(imu_column):
+                length = tables[imu, a].decode(bits)
+                z = (1 << (length - 1)) | bits.get(length - 1) if length > 1 else length
+                delta = -((z + 1) >> 1) if z & 1 else z >> 1
+                mode = modes[imu, a]
+                prev[imu, a] = delta if mode & MODE_VALUES else prev.get((imu, a), 0) + delta
+                values[n][a] = prev[imu, a] << (mode & MODE_SHIFT_MASK)
+
+        out = []
+        n = 0
+        for i in range(count):
+            if i in texts:
+                out.append(texts[i])
+            else:
+                out.append(SAMPLE_FORMAT % ((imu_column[n],) + tuple(values[n])) + EOL[self.eol])
+                n += 1
+        return ''.join(out)
+
+    def readlines(self, first=0, count=None):
+        """Lines of blocks first ... first + count - 1 as open(log, 'r').readlines() gives them"""
+        return io.StringIO(self.text(first, count), newline=None).readlines()
+
+    def parsed_lines(self, first=0, count=None):
+        """
+        Lines of blocks first ... first + count - 1 as readlines() gives them, except that with the
+        C++ decoder the sensor samples come as (imu, values) with the values in an int16 array
+        """
+        if _archive_lib is None:
+            return self.readlines(first, count)
+        count = self.block_count(first, count)
+        start = self.blocks[first][1] if count else 0
+        end = self.blocks[first + count][1] if first + count < len(self.blocks) else self.lines
+        end = max(start, end)
+        imus = np.empty(end - start, dtype=np.int16)
+        values = np.empty((end - start, AXES), dtype=np.int16)
+        n = _archive_lib.imu_archive_decode_samples(self.data, len(self.data), first, count,
+                                                    imus.ctypes.data, values.ctypes.data,
+                                                    end - start)
+        if n != end - start:
+            raise ValueError('bad archive')
+
+        # The text of the other lines, with the line end universal newlines make of it
+        texts = {}
+        for b in range(first, first + count):
+            for i, text in self.verbatim(b).items():
+                texts[self.blocks[b][1] - start + i] = text.rstrip('\r\n') + (
+                    '\n' if text.endswith(('\r', '\n')) else '')
+        return [(imu, values[i]) if imu >= 0 else texts[i] for i, imu in enumerate(imus.tolist())]
+
+
+def main():
+    """Decodes archives and compares them with the text logs next to them"""
+    import parse_data
+    for path in sys.argv[1:]:
+        begin = time.perf_counter()
+        archive = Archive(path)
+        text = archive.text()
+        decode_ms = (time.perf_counter() - begin) * 1000
+        print('%s: %d blocks, %d lines, %d -> %d bytes, decoded in %.1f ms (%s)'
+              % (path, archive.num_blocks(), archive.lines, len(archive.data), len(text),
+                 decode_ms, 'native' if _archive_lib is not None else 'python'))
+
+        log = os.path.splitext(path)[0] + '.txt'
+        if os.path.exists(log):
+            with open(log, 'rb') as f:
+                same = f.read() == text.encode('latin-1')
+            begin = time.perf_counter()
+            parse_data.parse_recordings(log)
+            parse_ms = (time.perf_counter() - begin) * 1000
+            begin = time.perf_counter()
+            parse_data.parse_recordings(path)
+            archive_ms = (time.perf_counter() - begin) * 1000
+            print('  %s %s, parse_recordings %.1f ms from the text, %.1f ms from the archive'
+                  % ('same as' if same else 'DIFFERS FROM', log, parse_ms, archive_ms))
+
+
+if __name__ == '__main__':
+    main()
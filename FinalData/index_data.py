@@ -0,0 +1,316 @@
+import io
+import os
+import sys
+import time
+import zlib
+import argparse
+import numpy as np
+
+import imu_archive
+from parse_data import NUM_IMUS, parse_sample, parse_lines, parse_recordings
+
+# Sidecar index of the byte offsets in a raw IMU log, so tools can seek straight to a session or
+# window instead of walking the whole log in reverse.
+#
+# The log is indexed in file order (newest first). A session is the stretch between two "MPU ..."
+# reset lines or class markers (UPSTAIRS, WALKING, ...) and carries the label of the marker above
+# it. A frame starts at a line of the last IMU and takes the lines up to the next one: reading the
+# log in reverse, the frame is emitted at that line and holds the samples of these lines plus the
+# latest older ones of the IMUs missing from it. The index keeps each frame's mask of IMUs that
+# reported in it (its completeness), so a window only reads as far back as its first frame needs.
+# Sessions and frames are numbered in file order, which appending to the log does not change.
+#
+# The index is saved next to the log as <log>.idx.npz together with the log size and a checksum of
+# the bytes before the last frame. When the log has grown and that checksum still matches, only
+# the last frame and the appended data are scanned again; otherwise the log is indexed anew.
+
+INDEX_VERSION = 1
+CHECK_BYTES = 4096
+WINDOW_LEN = 30
+
+
+def index_path(path):
+    """Returns the path of the sidecar index of a log"""
+    return os.path.splitext(path)[0] + '.idx.npz'
+
+
+def checksum(f, end):
+    """CRC32 of the CHECK_BYTES before end"""
+    start = max(0, end - CHECK_BYTES)
+    f.seek(start)
+    return zlib.crc32(f.read(end - start))
+
+
+def classify(line, num_imus):
+    """Returns ('reset' | 'marker' | 'sample' | None, IMU number) for a log line in bytes"""
+    text = line.decode('latin-1').rstrip('\r\n')
+
+    # The same tests as parse_lines, which sees the lines with '\n' endings
+    if len(text) + (len(text) < len(line)) <= 5:
+        return None, None
+    if text.startswith('MPU'):
+        return 'reset', None
+    if text[0] in 'SWUD':
+        return 'marker', None
+    parsed = parse_sample(text, num_imus)
+    return ('sample', parsed[0]) if parsed is not None else (None, None)
+
+
+def text_lines(data):
+    """Splits bytes of the log into lines the way parse_recordings reads them"""
+    return io.TextIOWrapper(io.BytesIO(data), encoding='latin-1').readlines()
+
+
+class LogIndex:
+    def __init__(self, path, num_imus=NUM_IMUS):
+        """
+        Args:
+            path (str): Path of the raw log.
+            num_imus (int): IMUs of the kit that wrote the log (default: 6).
+        """
+        self.path = path
+        self.num_imus = num_imus
+        self.size = 0
+        self.check = 0
+        self.scanned = 0            # bytes read by the last build or update
+        self.labels = []            # text of the class markers
+        self.markers = []           # offset of each class marker line
+        self.frame_start = []       # offset of the last IMU's line starting each frame
+        self.frame_end = []
+        self.fresh = []             # mask of the IMUs with a line in each frame
+        self.session_start = []     # offset after the reset line or marker opening each session
+        self.session_end = []
+        self.session_first = []     # first frame of each session
+        self.session_label = []     # marker of each session, -1 above the first one
+
+    def num_sessions(self):
+        return len(self.session_start)
+
+    def num_frames(self, session):
+        """Frames of a session"""
+        end = (self.session_first[session + 1] if session + 1 < self.num_sessions()
+               else len(self.frame_start))
+        return end - self.session_first[session]
+
+    def label(self, session):
+        """Text of the marker above a session, '' if there is none"""
+        n = self.session_label[session]
+        return self.labels[n] if n >= 0 else ''
+
+    def resume_offset(self):
+        """Offset from which a grown log has to be scanned again, the start of the last frame"""
+        if not self.session_start:
+            return 0
+        if self.num_frames(self.num_sessions() - 1):
+            return self.frame_start[-1]
+        return self.session_start[-1]
+
+    def scan(self, f, offset):
+        """Indexes the log from offset on, the frames and sessions before it being complete"""
+        session_open = bool(self.session_start)
+        frame_open = False
+        pos = offset
+
+        # Reopen the last session and drop its last frame, which is scanned again
+        if session_open and self.num_frames(self.num_sessions() - 1) and \
+                self.frame_start[-1] >= offset:
+            del self.frame_start[-1], self.frame_end[-1], self.fresh[-1]
+        if not session_open:
+            self.open_session(0)
+
+        f.seek(offset)
+        for line in f:
+            kind, imu = classify(line, self.num_imus)
+            if kind in ('reset', 'marker'):
+                if frame_open:
+                    self.frame_end[-1] = pos
+                    frame_open = False
+                self.session_end[-1] = pos
+                if not self.num_frames(self.num_sessions() - 1):
+                    self.drop_session()
+                if kind == 'marker':
+                    self.markers.append(pos)
+                    self.labels.append(line.decode('latin-1').strip())
+                self.open_session(pos + len(line))
+            elif kind == 'sample' and imu == self.num_imus - 1:
+                if frame_open:
+                    self.frame_end[-1] = pos
+                self.frame_start.append(pos)
+                self.frame_end.append(pos + len(line))
+                self.fresh.append(1 << imu)
+                frame_open = True
+            elif kind == 'sample' and frame_open:
+                self.fresh[-1] |= 1 << imu
+            pos += len(line)
+
+        if frame_open:
+            self.frame_end[-1] = pos
+        self.session_end[-1] = pos
+        self.scanned = pos - offset
+        self.size = pos
+        self.check = checksum(f, self.resume_offset())
+
+    def open_session(self, start):
+        self.session_start.append(start)
+        self.session_end.append(start)
+        self.session_first.append(len(self.frame_start))
+        self.session_label.append(len(self.labels) - 1)
+
+    def drop_session(self):
+        """Forgets the last session, which has no frames"""
+        del self.session_start[-1], self.session_end[-1], self.session_first[-1]
+        del self.session_label[-1]
+
+    def build(self):
+        """Indexes the whole log"""
+        self.__init__(self.path, self.num_imus)
+        with open(self.path, 'rb') as f:
+            self.scan(f, 0)
+
+    def update(self):
+        """Indexes the data appended since the index was built, or all of it if the log changed"""
+        size = os.path.getsize(self.path)
+        with open(self.path, 'rb') as f:
+            resume = self.resume_offset()
+            if size < self.size or checksum(f, resume) != self.check:
+                self.build()
+            elif size != self.size:
+                self.scan(f, resume)
+            else:
+                self.scanned = 0
+
+    def save(self):
+        np.savez(index_path(self.path), version=INDEX_VERSION, num_imus=self.num_imus,
+                 size=self.size, check=self.check, labels=np.array(self.labels, dtype=str),
+                 markers=np.array(self.markers, dtype=np.int64),
+                 frames=np.array([self.frame_start, self.frame_end], dtype=np.int64).reshape(2, -1),
+                 fresh=np.array(self.fresh, dtype=np.uint32),
+                 sessions=np.array([self.session_start, self.session_end, self.session_first,
+                                    self.session_label], dtype=np.int64).reshape(4, -1))
+
+    def load(self):
+        """Reads the saved index, returns False if there is none for this log and kit"""
+        try:
+            saved = np.load(index_path(self.path))
+        except OSError:
+            return False
+        with saved:
+            if saved['version'] != INDEX_VERSION or saved['num_imus'] != self.num_imus:
+                return False
+            self.size = int(saved['size'])
+            self.check = int(saved['check'])
+            self.labels = saved['labels'].tolist()
+            self.markers = saved['markers'].tolist()
+            self.frame_start, self.frame_end = saved['frames'].tolist()
+            self.fresh = saved['fresh'].tolist()
+            self.session_start, self.session_end, self.session_first, self.session_label = \
+                saved['sessions'].tolist()
+        return True
+
+    def read_frames(self, session, start=0, count=None, f=None):
+        """
+        Returns frames start ... start + count - 1 of a session, oldest first, as an int16 array of
+        shape [count, IMUs, 6], the same as those of its recording from parse_recordings. Reads
+        the bytes of these frames plus the older ones needed to fill in the IMUs missing from the
+        oldest of them.
+        """
+        frames = self.num_frames(session)
+        count = frames - start if count is None else count
+        if start < 0 or count < 1 or start + count > frames:
+            raise IndexError('frames %d+%d of session %d with %d' % (start, count, session, frames))
+
+        # Frames of the session in file order are newest first
+        last = self.session_first[session] + frames - 1
+        newest = last - (start + count - 1)
+        oldest = last - start
+        full = (1 << self.num_imus) - 1
+        seen = 0
+        while oldest < last and (seen | self.fresh[oldest]) != full:
+            seen |= self.fresh[oldest]
+            oldest += 1
+
+        begin, end = self.frame_start[newest], self.frame_end[oldest]
+        if f is None:
+            with open(self.path, 'rb') as f:
+                f.seek(begin)
+                data = f.read(end - begin)
+        else:
+            f.seek(begin)
+            data = f.read(end - begin)
+        return parse_lines(text_lines(data), self.num_imus)[0][-count:]
+
+    def recordings(self):
+        """Returns what parse_recordings returns: the sessions below the last marker, oldest first"""
+        label = len(self.labels) - 1
+        with open(self.path, 'rb') as f:
+            return [self.read_frames(s, f=f) for s in reversed(range(self.num_sessions()))
+                    if self.session_label[s] == label and self.num_frames(s)]
+
+    def completeness(self, session):
+        """Fraction of the frames of a session each IMU reported in"""
+        first = self.session_first[session]
+        fresh = np.array(self.fresh[first:first + self.num_frames(session)], dtype=np.uint32)
+        return [float(np.mean(fresh >> imu & 1)) if len(fresh) else 0.0
+                for imu in range(self.num_imus)]
+
+
+def load_index(path, num_imus=NUM_IMUS, rebuild=False):
+    """Returns the index of a log, updated for what was appended since it was saved"""
+    if imu_archive.is_archive(path):
+        raise ValueError('%s is an archive, which has its own seek table' % path)
+    index = LogIndex(path, num_imus)
+    if rebuild or not index.load():
+        index.build()
+    else:
+        index.update()
+    if index.scanned or rebuild:
+        index.save()
+    return index
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Index the sessions and frames of raw IMU logs')
+    parser.add_argument('logs', nargs='+')
+    parser.add_argument('-n', '--imus', type=int, default=NUM_IMUS, help='IMUs of the kit')
+    parser.add_argument('-r', '--rebuild', action='store_true', help='index the whole log again')
+    parser.add_argument('-c', '--check', action='store_true',
+                        help='compare the indexed recordings with a full parse of the log')
+    args = parser.parse_args()
+
+    for path in args.logs:
+        begin = time.perf_counter()
+        index = load_index(path, args.imus, args.rebuild)
+        ms = (time.perf_counter() - begin) * 1000
+        print('%s: %d sessions, %d frames, scanned %d of %d bytes in %.1f ms'
+              % (path, index.num_sessions(), len(index.frame_start), index.scanned, index.size, ms))
+
+        for s in range(index.num_sessions()):
+            print('  %3d %-12s %9d-%-9d %6d frames  %s' % (
+                s, index.label(s) or '-', index.session_start[s], index.session_end[s],
+                index.num_frames(s), ' '.join('%3.0f%%' % (100 * c)
+                                              for c in index.completeness(s))))
+
+        if args.check:
+            begin = time.perf_counter()
+            full = parse_recordings(path, args.imus)
+            parse_ms = (time.perf_counter() - begin) * 1000
+            begin = time.perf_counter()
+            indexed = index.recordings()
+            read_ms = (time.perf_counter() - begin) * 1000
+            same = len(full) == len(indexed) and all(np.array_equal(a, b)
+                                                       for a, b in zip(full, indexed))
+            begin = time.perf_counter()
+            with open(path, 'rb') as f:
+                for s in range(index.num_sessions()):
+                    for start in range(0, index.num_frames(s) - WINDOW_LEN + 1, WINDOW_LEN):
+                        index.read_frames(s, start, WINDOW_LEN, f)
+            windows = sum(index.num_frames(s) // WINDOW_LEN for s in range(index.num_sessions()))
+            window_us = (time.perf_counter() - begin) * 1e6 / max(windows, 1)
+            print('  %s: full parse %.1f ms, indexed read %.1f ms, %.0f us per %d-frame window'
+                  % ('match' if same else 'MISMATCH', parse_ms, read_ms, window_us, WINDOW_LEN))
+            if not same:
+                sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -1,93 +1,105 @@
+import sys
 import numpy as np
-import json
-
-full_data = []
-
-with open("IMUDATASTANDINGFINAL.txt", 'r') as f:
-    lines = f.readlines()
-    lines = lines [::-1]
-
-    total_lines = len(lines)
-
-    prev = [[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0]]
-    frame = [[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0]]
-
-    frame_queue = []
-    counter = 0
-
-    for i in lines:
-        if len(frame_queue) == 30:
-            frame_queue_copy = []
-            for j in range(0,len(frame_queue),1):
-                frame_queue_copy.append([])
-                frame_queue_copy[j].append(frame_queue[j][0][:])
-                frame_queue_copy[j].append(frame_queue[j][1][:])
-                frame_queue_copy[j].append(frame_queue[j][2][:])
-                frame_queue_copy[j].append(frame_queue[j][3][:])
-                frame_queue_copy[j].append(frame_queue[j][4][:])
-                frame_queue_copy[j].append(frame_queue[j][5][:])
-            full_data.append(frame_queue_copy)
-
-            frame_queue.pop(0)
-            frame_queue.pop(0)
-            frame_queue.pop(0)
-            frame_queue.pop(0)
-            frame_queue.pop(0)
-            frame_queue.pop(0)
-            frame_queue.pop(0)
-            frame_queue.pop(0)
-            frame_queue.pop(0)
-            frame_queue.pop(0)
-
-        if len(i) > 5:
+
+import imu_archive
+
+# Converts a raw IMU log into continuous recordings of raw sensor samples.
+#
+# The logs are written newest-first, so the lines are walked in reverse. An "MPU ..." line marks
+# a device reset and starts a new recording, and the class marker at the top of the file
+# (UPSTAIRS, WALKING, ...) ends the parse. A frame is emitted every time the last IMU reports,
+# holding the latest sample of all IMUs.
+#
+# Each recording is stored once as an int16 array of shape [frames, IMUs, 6]; windowing,
+# preprocessing and the choice of sensors and axes happen in the training Dataset, so they can be
+# changed without re-parsing the logs. Logs of kits with more than six IMUs take the IMU count as
+# a third argument.
+#
+# The script reads the log through its sidecar index (index_data.py, <log>.idx.npz), which is
+# built on the first run and afterwards only extended by what was appended to the log. Archives
+# from host/build/imu_pack (.imz, see imu_archive.py) are read like the logs they were made from.
+
+NUM_IMUS = 6
+AXIS_KEYS = ("AX", "AY", "AZ", "GX", "GY", "GZ")
+
+
+def parse_sample(line, num_imus=NUM_IMUS):
+    """Returns (imu_num, [ax, ay, az, gx, gy, gz]) for a sensor line, or None if malformed."""
+    tokens = line.replace(":", " ").split()
+    if len(tokens) != 1 + 2 * len(AXIS_KEYS) or not tokens[0].isdigit():
+        return None
+    imu_num = int(tokens[0])
+    if imu_num >= num_imus or tuple(tokens[1::2]) != AXIS_KEYS:
+        return None
+    return imu_num, [int(v) for v in tokens[2::2]]
+
+
+def parse_lines(lines, num_imus=NUM_IMUS):
+    """
+    Returns the list of continuous recordings in the lines of a log, oldest first. Sensor lines
+    can also be given already parsed as (imu_num, values), as Archive.parsed_lines() gives them.
+    """
+    recordings = []
+    frames = []
+    sample = np.zeros((num_imus, len(AXIS_KEYS)), dtype=np.int16)
+
+    for i in lines[::-1]:
+        if isinstance(i, tuple):
+            imu_num, values = i
+            if imu_num < num_imus:
+                sample[imu_num] = values
+                if imu_num == num_imus - 1:
+                    frames.append(sample.copy())
+
+        elif len(i) > 5:
             if i.startswith("MPU"):
-                frame_queue = []
-                prev = [[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0]]
-                frame = [[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0],[0,0,0,0,0,0]]
+                if frames:
+                    recordings.append(np.stack(frames))
+                frames = []
+                sample[:] = 0
 
             elif i.startswith("S") or i.startswith("W") or i.startswith("U") or i.startswith("D"):
                 break
 
             else:
-                imu_num = int(i[0])
-                print(counter)
-
-                ax = int(i[i.find("AX")+3:i.find("AY")-1])
-                frame[imu_num][0] = (abs(prev[imu_num][0] - ax)) / 32768
-                prev[imu_num][0] = ax
-
-                ay = int(i[i.find("AY")+3:i.find("AZ")-1])
-                frame[imu_num][1] = (abs(prev[imu_num][1] - ay)) / 32768
-                prev[imu_num][1] = ay
-
-                az = int(i[i.find("AZ")+3:i.find("GX")-1])
-                frame[imu_num][2] = (abs(prev[imu_num][2] - az)) / 32768
-                prev[imu_num][2] = az
-
-                gx = int(i[i.find("GX")+3:i.find("GY")-1])
-                frame[imu_num][3] = (abs(prev[imu_num][3] - gx)) / 32768
-                prev[imu_num][3] = gx
-
-                gy = int(i[i.find("GY")+3:i.find("GZ")-1])
-                frame[imu_num][4] = (abs(prev[imu_num][4] - gy)) / 32768
-                prev[imu_num][4] = gy
-
-                gz = int(i[i.find("GZ")+3:len(i)])
-                frame[imu_num][5] = (abs(prev[imu_num][5] - gz)) / 32768
-                prev[imu_num][5] = gz
-
-                counter = counter + 1
-                
-
-                if imu_num == 5:
-                    new_frame = []
-                    new_frame.append(frame[0][:])
-                    new_frame.append(frame[1][:])
-                    new_frame.append(frame[2][:])
-                    new_frame.append(frame[3][:])
-                    new_frame.append(frame[4][:])
-                    new_frame.append(frame[5][:])
-                    frame_queue.append(new_frame)
-
-with open("standing_data.json", "w") as file:
-    json.dump(full_data, file)
\ No newline at end of file
+                parsed = parse_sample(i, num_imus)
+                if parsed is None:
+                    continue
+                imu_num, values = parsed
+                sample[imu_num] = values
+
+                if imu_num == num_imus - 1:
+                    frames.append(sample.copy())
+
+    if frames:
+        recordings.append(np.stack(frames))
+
+    return recordings
+
+
+def parse_recordings(path, num_imus=NUM_IMUS):
+    """Returns the list of continuous recordings in a log or its archive, oldest first."""
+    if imu_archive.is_archive(path):
+        return parse_lines(imu_archive.Archive(path).parsed_lines(), num_imus)
+
+    with open(path, 'r') as f:
+        lines = f.readlines()
+
+    return parse_lines(lines, num_imus)
+
+
+if __name__ == "__main__":
+    in_path = sys.argv[1] if len(sys.argv) > 1 else "IMUDATASTANDINGFINAL.txt"
+    out_path = sys.argv[2] if len(sys.argv) > 2 else "standing_data.npz"
+    num_imus = int(sys.argv[3]) if len(sys.argv) > 3 else NUM_IMUS
+
+    # The sidecar index (index_data.py) finds the recordings without walking the whole log and
+    # only scans what was appended since the last run; archives have their own seek table
+    import index_data
+    if imu_archive.is_archive(in_path):
+        recordings = parse_recordings(in_path, num_imus)
+    else:
+        recordings = index_data.load_index(in_path, num_imus).recordings()
+    np.savez(out_path, **{"recording_%d" % n: r for n, r in enumerate(recordings)})
+
+    print("%s: %d recordings, %d frames" % (out_path, len(recordings), sum(len(r) for r in recordings)))
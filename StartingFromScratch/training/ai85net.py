@@ -11,6 +11,9 @@ Networks that fit into AI84
 
 Optionally quantize/clamp activations
 """
+import os
+import re
+
 from torch import nn
 
 import ai8x
@@ -89,35 +92,31 @@ class AI85NetExtraSmall(nn.Module):
                  fc_inputs=5, bias=False, **kwargs):
         super().__init__()
 
-        # AI84 Limits
-        assert dimensions[0] == dimensions[1]  # Only square supported
-
-        # Keep track of image dimensions so one constructor works for all image sizes
-        dim = dimensions[0]
+        # Keep track of image dimensions so one constructor works for all image sizes, the input
+        # is one row per sensor and one column per axis so it doesn't have to be square
+        rows, cols = dimensions
 
         self.trans_conv1 = ai8x.ConvTranspose2d(num_channels, 16, kernel_size=3, stride=2, padding=1, bias=bias)
 
         self.trans_conv2 = ai8x.ConvTranspose2d(16, 8, kernel_size=3, stride=2, padding=1, bias=bias)
+        rows, cols = rows * 4, cols * 4  # each transposed convolution doubles -> 8x24x24
 
         self.conv1 = ai8x.FusedConv2dReLU(8, 8, 3,
                                           padding=1, bias=bias, **kwargs)
         # padding 1 -> no change in dimensions -> 8x24x24
 
-        pad = 2 if dim == 28 else 1
+        pad = 2 if dimensions[0] == 28 else 1
         self.conv2 = ai8x.FusedMaxPoolConv2dReLU(8, 8, 3, pool_size=2, pool_stride=2,
                                                  padding=pad, bias=bias, **kwargs)
-
-        dim = dim  # pooling, padding 0
-        if pad == 2:
-            dim += 2  # padding 2
+        rows, cols = rows // 2 + 2 * (pad - 1), cols // 2 + 2 * (pad - 1)  # pooling -> 8x12x12
 
         self.conv3 = ai8x.FusedMaxPoolConv2dReLU(8, fc_inputs, 3,
                                                  pool_size=4, pool_stride=4, padding=1,
                                                  bias=bias, **kwargs)
-        dim //= 2  # pooling, padding 0
-        # padding 1
+        rows, cols = rows // 4, cols // 4  # pooling, padding 1 -> 5x3x3
+        assert rows > 0 and cols > 0, 'input too small for the pooling'
 
-        self.fc = ai8x.Linear(fc_inputs*dim*dim, num_classes, bias=True, wide=True, **kwargs)
+        self.fc = ai8x.Linear(fc_inputs*rows*cols, num_classes, bias=True, wide=True, **kwargs)
 
         for m in self.modules():
             if isinstance(m, nn.Conv2d):
@@ -144,6 +143,96 @@ def ai85netextrasmall(pretrained=False, **kwargs):
     return AI85NetExtraSmall(**kwargs)
 
 
+# Layers of AI85NetIMU, e.g. t16-t8-c8-c8p2-c5p4 for the same network as AI85NetExtraSmall:
+# tN is a 3x3 transposed convolution with stride 2 to N channels, cN a convolution to N channels
+# with ReLU, optionally with kK for a KxK kernel (1 or 3, default 3) and pP for a PxP max pool with
+# stride P in front of it. A linear layer to the classes follows the last one. model_search.py
+# sweeps these and sets IMU_NET for each candidate it trains.
+IMU_NET = os.environ.get('IMU_NET', 't16-t8-c8-c8p2-c5p4')
+
+# Layers of the larger network a student learns from in train_distill.sh, it only runs in floating
+# point during training and doesn't have to fit the accelerator
+IMU_TEACHER_NET = os.environ.get('IMU_TEACHER_NET', 't32-t16-c32-c32p2-c32p2-c16p2')
+
+
+def parse_net(spec):
+    """Returns the layers of an IMU_NET value as (op, channels, kernel, pool) tuples"""
+    layers = []
+    for token in spec.split('-'):
+        match = re.fullmatch(r'([tc])(\d+)(?:k([13]))?(?:p(\d+))?', token)
+        if match is None or (match.group(1) == 't' and (match.group(3) or match.group(4))):
+            raise ValueError('bad layer %r in IMU_NET %r' % (token, spec))
+        layers.append((match.group(1), int(match.group(2)), int(match.group(3) or 3),
+                       int(match.group(4) or 1)))
+    return layers
+
+
+class AI85NetIMU(nn.Module):
+    """
+    IMU CNN built from an IMU_NET layer list, for the architecture search
+
+    The layers are the attributes layer0, layer1, ... and fc, the names the overrides of a QAT
+    policy use to give single layers 1, 2 or 4-bit weights (model_search.py -q).
+    """
+    def __init__(self, num_classes=5, num_channels=3, dimensions=(6, 6),
+                 net=IMU_NET, bias=False, **kwargs):
+        super().__init__()
+
+        rows, cols = dimensions
+        channels = num_channels
+        self.names = []
+
+        for op, planes, kernel, pool in parse_net(net):
+            if op == 't':
+                layer = ai8x.ConvTranspose2d(channels, planes, kernel_size=3, stride=2,
+                                             padding=1, bias=bias)
+                rows, cols = rows * 2, cols * 2
+            elif pool > 1:
+                layer = ai8x.FusedMaxPoolConv2dReLU(channels, planes, kernel,
+                                                    pool_size=pool, pool_stride=pool,
+                                                    padding=kernel // 2, bias=bias, **kwargs)
+                rows, cols = rows // pool, cols // pool
+            else:
+                layer = ai8x.FusedConv2dReLU(channels, planes, kernel,
+                                             padding=kernel // 2, bias=bias, **kwargs)
+            channels = planes
+            assert rows > 0 and cols > 0, 'input too small for the pooling in %s' % net
+
+            self.names.append('layer%d' % len(self.names))
+            setattr(self, self.names[-1], layer)
+
+        self.fc = ai8x.Linear(channels*rows*cols, num_classes, bias=True, wide=True, **kwargs)
+
+        for m in self.modules():
+            if isinstance(m, nn.Conv2d):
+                nn.init.kaiming_normal_(m.weight, mode='fan_out', nonlinearity='relu')
+
+    def forward(self, x):  # pylint: disable=arguments-differ
+        """Forward prop"""
+        for name in self.names:
+            x = getattr(self, name)(x)
+        x = x.view(x.size(0), -1)
+        x = self.fc(x)
+
+        return x
+
+
+def ai85netimu(pretrained=False, **kwargs):
+    """
+    Constructs a AI85NetIMU model.
+    """
+    assert not pretrained
+    return AI85NetIMU(**kwargs)
+
+
+def ai85netimuteacher(pretrained=False, **kwargs):
+    """
+    Constructs the AI85NetIMU of IMU_TEACHER_NET for knowledge distillation.
+    """
+    assert not pretrained
+    return AI85NetIMU(net=IMU_TEACHER_NET, **kwargs)
+
+
 models = [
     {
         'name': 'ai85net5',
@@ -155,4 +244,14 @@ models = [
         'min_input': 1,
         'dim': 2,
     },
+    {
+        'name': 'ai85netimu',
+        'min_input': 1,
+        'dim': 2,
+    },
+    {
+        'name': 'ai85netimuteacher',
+        'min_input': 1,
+        'dim': 2,
+    },
 ]
@@ -1,94 +1,282 @@
 import os
-import json
+import argparse
+import ctypes
+import time
 import torch
 import numpy as np
 from torch.utils.data import Dataset
-from torchvision import transforms
-import ai8x  # Assuming you have this for normalization as in the original code
+
+WINDOW_LEN = 30
+WINDOW_HOP = 10
+
+# Sensors and axes of the input image, the same as SENSOR_KIT / SENSOR_AXES_MASK in the firmware's
+# sensor_config.h. IMU_SENSORS is a count (the first N IMUs of the logs) or a list of IMU numbers
+# such as 0,2,5; IMU_AXES masks accel x, y, z, gyro x, y, z from bit 0 up.
+ALL_AXES = 6
+
+
+def parse_sensors(spec):
+    """Returns the IMU numbers selected by an IMU_SENSORS value"""
+    if ',' in spec:
+        return [int(s) for s in spec.split(',')]
+    return list(range(int(spec)))
+
+
+SENSORS = parse_sensors(os.environ.get('IMU_SENSORS', '6'))
+AXES = [a for a in range(ALL_AXES) if int(os.environ.get('IMU_AXES', '0x3f'), 0) >> a & 1]
+
+# How a window is laid out as an image: 'channel' has one input channel per frame and the sensors
+# and axes as rows and columns, the way the firmware loads it; 'spatial' has one input channel per
+# axis, the frames as rows and the sensors as columns, for model_search.py to compare the two.
+LAYOUTS = ('channel', 'spatial')
+LAYOUT = os.environ.get('IMU_LAYOUT', 'channel')
+if LAYOUT not in LAYOUTS:
+    raise ValueError('IMU_LAYOUT is one of %s, not %r' % (', '.join(LAYOUTS), LAYOUT))
+
+# Shared with the firmware (imu_fixed_inputs_no_softmax/preprocess.c), built by `make -C host`
+PREPROCESS_LIB = os.environ.get('IMU_PREPROCESS_LIB', os.path.join(
+    os.path.dirname(os.path.abspath(__file__)), '..', '..', 'host', 'build', 'libimupreprocess.so'))
+
+
+def load_preprocess_lib(path=PREPROCESS_LIB):
+    """Returns the native preprocessing kernel, or None if it hasn't been built"""
+    try:
+        lib = ctypes.CDLL(path)
+    except OSError:
+        return None
+    lib.preprocess_recording.argtypes = [ctypes.c_void_p, ctypes.c_size_t, ctypes.c_void_p]
+    lib.preprocess_recording.restype = None
+    lib.channels = ctypes.c_int.in_dll(lib, 'preprocess_channels').value
+    lib.calib_estimate_recording.argtypes = [ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t]
+    lib.calib_estimate_recording.restype = ctypes.c_uint32
+    lib.calib_estimate_apply_recording.argtypes = [ctypes.c_void_p, ctypes.c_void_p,
+                                                   ctypes.c_size_t]
+    lib.calib_estimate_apply_recording.restype = None
+    lib.calib_estimate_init.argtypes = [ctypes.c_void_p]
+    lib.calib_estimate_init.restype = None
+    lib.calib_size = ctypes.c_size_t.in_dll(lib, 'calib_estimate_size').value
+    return lib
+
+
+_preprocess_lib = load_preprocess_lib()
+
+
+def preprocess_recording(raw):
+    """
+    Converts a recording of raw samples [T, sensors, axes] into the int8 values the firmware
+    loads into the CNN: (|prev - raw| / 128) - 128 clamped to 127 on the unsigned 16-bit register
+    contents, with the first frame compared against zero.
+    """
+    raw = np.ascontiguousarray(raw, dtype=np.int16).view(np.uint16)
+    values = np.empty(raw.shape, dtype=np.int8)
+
+    # The library is built for one frame size, the default six sensors with six axes
+    if _preprocess_lib is not None and _preprocess_lib.channels == raw[0].size:
+        _preprocess_lib.preprocess_recording(raw.ctypes.data, len(raw), values.ctypes.data)
+    else:
+        # Same arithmetic in numpy for machines without the host build
+        samples = raw.astype(np.int32)
+        level = np.abs(np.diff(samples, axis=0, prepend=np.zeros_like(samples[:1]))) >> 7
+        values[...] = np.minimum(level, 255) - 128
+
+    return values
+
+
+# Calibrate the recordings the way the device calibrates its sensors (calib_estimate.c in the
+# firmware), so the network is trained on the inputs the device sends. IMU_CALIBRATE=0 leaves them
+# as they were taken. Needs the host build for the default six sensors with six axes.
+CALIBRATE = os.environ.get('IMU_CALIBRATE', '1') != '0'
+
+
+def calibrate_recordings(raws):
+    """
+    Calibrates a list of recordings of raw samples [T, sensors, axes] in place like the device: each
+    sensor is estimated once, from its first 32 frames at rest in any of them, and applied to all of
+    them like a calibration stored in flash. Returns the mask of the calibrated sensors, or None if
+    the library can't calibrate recordings of this shape.
+    """
+    lib = _preprocess_lib
+    if lib is None or not raws or lib.channels != raws[0][0].size:
+        return None
+    est = ctypes.create_string_buffer(lib.calib_size)
+    calibrated = 0
+    lib.calib_estimate_init(est)
+    for raw in raws:
+        calibrated |= lib.calib_estimate_recording(est, raw.ctypes.data, len(raw))
+    for raw in raws:
+        lib.calib_estimate_apply_recording(est, raw.ctypes.data, len(raw))
+    return calibrated
+
+
+def parse_augment(spec):
+    """Returns (jitter, gain, warp) from an IMU_AUGMENT value, see AUGMENT"""
+    values = [float(v) for v in spec.split(',')]
+    if values == [0.0]:
+        return 0.0, 0.0, 0.0
+    if len(values) != 3 or min(values) < 0:
+        raise ValueError('IMU_AUGMENT is jitter,gain,warp or 0, not %r' % spec)
+    return tuple(values)
+
+
+# Augmentation of the training windows, applied to whole batches on the device values: Gaussian
+# jitter of every sensor axis in levels of the int8 input, Gaussian gain of each sensor relative to
+# 1 and a random speed of 1 +- warp for time warping. IMU_AUGMENT=0 turns it off.
+AUGMENT = parse_augment(os.environ.get('IMU_AUGMENT', '1,0.1,0.1'))
+
 
 class IMU_AI(Dataset):
-    def __init__(self, data_dir, mode, args, transform, truncate_testset=False):
+    def __init__(self, data_dir, mode, args, transform=None, truncate_testset=False,
+                 window_len=WINDOW_LEN, hop=WINDOW_HOP, sensors=SENSORS, axes=AXES,
+                 layout=LAYOUT, augment=AUGMENT):
         """
         Args:
-            data_dir (str): Path to the directory containing the text files.
+            data_dir (str): Path to the directory containing the parsed recordings (*.npz).
             mode (str): 'train' or 'test', determines which data to load.
             args (dict): Program arguments, including 'act_mode_8bit'.
+            transform (callable): Applied to every batch after normalization (default: None).
             truncate_testset (bool): Whether to truncate the test set (default: False).
+            window_len (int): Frames per window, i.e. input channels (default: 30).
+            hop (int): Frames between the starts of consecutive windows (default: 10).
+            sensors (list): IMU numbers of the logs that make up the input rows (default: IMU_SENSORS).
+            axes (list): Axes that make up the input columns (default: IMU_AXES).
+            layout (str): 'channel' or 'spatial' (default: IMU_LAYOUT).
+            augment (tuple): Jitter, gain and warp for the training windows (default: IMU_AUGMENT).
+
+        All recordings are stored once, back to back, as the int8 values the firmware loads, in
+        shared memory so DataLoader workers don't copy them. Windows are cut out of them by index
+        arithmetic a whole batch at a time in __getitems__, which also augments, rounds to the
+        device's int8 domain and normalizes the batch in a few tensor operations. Windows are
+        returned newest frame first, matching the input channel order the firmware loads. The
+        spatial layout has the newest frame as row 0.
         """
         self.data_dir = data_dir
         self.mode = mode
         self.args = args
         self.transform = transform
         self.truncate_testset = truncate_testset
+        self.window_len = window_len
+        self.hop = hop
+        self.sensors = list(sensors)
+        self.axes = list(axes)
+        self.layout = layout
+        self.augment = augment if mode == 'train' else (0.0, 0.0, 0.0)
 
-        # Load the data
-        self.file_paths = [os.path.join(data_dir, file) for file in os.listdir(data_dir) if file.endswith('.json')]
-        self.data = []
-        self.labels = []
+        # Files are sorted so labels follow the class order the firmware reports
+        self.file_paths = sorted(os.path.join(data_dir, file) for file in os.listdir(data_dir)
+                                 if file.endswith('.npz'))
+        raws = []
+        labels = []
+        rec_starts = [0]
+        window_starts = [0]
 
-        # Read each file, load matrices, and assign labels
+        # Read each file's recordings and assign labels
         for idx, file_path in enumerate(self.file_paths):
-            with open(file_path, 'r') as file:
-                data = json.load(file)
-                for matrix_data in data:
+            with np.load(file_path) as archive:
+                for key in sorted(archive.files, key=lambda k: int(k.rsplit('_', 1)[-1])):
+                    raw = archive[key]
+                    if len(raw) < self.window_len:
+                        continue
+                    if max(self.sensors) >= raw.shape[1]:
+                        raise ValueError('%s has %d IMUs, IMU_SENSORS needs %d'
+                                         % (file_path, raw.shape[1], max(self.sensors) + 1))
+                    raw = raw[:, self.sensors][:, :, self.axes]
 
-                    # Convert to PyTorch tensor of float32
-                    tensor_data = torch.tensor(matrix_data, dtype=torch.float32)
+                    raws.append(np.ascontiguousarray(raw, dtype=np.int16))
+                    labels.append(idx)
+                    rec_starts.append(rec_starts[-1] + len(raw))
+                    num_windows = (len(raw) - self.window_len) // self.hop + 1
+                    window_starts.append(window_starts[-1] + num_windows)
 
-                    #print(tensor_data.max())
-                
-                    # Add tensor data and the corresponding label
-                    self.data.append(tensor_data)
-                    self.labels.append(idx)
+        # Calibrated across all files, the logs were taken with one kit, then preprocessed
+        if CALIBRATE and calibrate_recordings(raws) is None:
+            print('IMU_CALIBRATE needs host/build/libimupreprocess.so for %d sensors with %d '
+                  'axes, the recordings stay uncalibrated' % (len(self.sensors), len(self.axes)))
+        recordings = [preprocess_recording(raw) for raw in raws]
+
+        self.data = torch.from_numpy(np.concatenate(recordings)).share_memory_()
+        self.labels = torch.tensor(labels)
+        self.rec_starts = torch.tensor(rec_starts)
+        self.window_starts = torch.tensor(window_starts)
+        self.num_windows = window_starts[-1]
 
         # Optionally truncate the test set
         if self.mode == 'test' and self.truncate_testset:
-            self.data = self.data[:1]
-            self.labels = self.labels[:1]
-
-        if self.transform is not None:
-            self.data = [self.transform(im).type(torch.float) for im in self.data]
-
-        #print(self.data)
+            self.num_windows = min(self.num_windows, 1)
 
     def __len__(self):
         """Returns the size of the dataset"""
-        return len(self.data)
+        return self.num_windows
 
     def __getitem__(self, idx):
         """Returns the ith data sample and its corresponding label"""
-        data_sample = self.data[idx]
-        label = self.labels[idx]
-        
-        return data_sample, label
+        return self.__getitems__([idx])[0]
+
+    def __getitems__(self, indices):
+        """Returns the data samples and labels of a batch of indices"""
+        idx = torch.as_tensor(indices, dtype=torch.long)
+        idx = torch.where(idx < 0, idx + self.num_windows, idx)
+        if len(idx) and not (0 <= idx.min() and idx.max() < self.num_windows):
+            raise IndexError(indices)
+
+        rec = torch.searchsorted(self.window_starts, idx, right=True) - 1
+        first = self.rec_starts[rec]
+        newest = first + (idx - self.window_starts[rec]) * self.hop + self.window_len - 1
+        jitter, gain, warp = self.augment
+
+        # Frames of each window newest first, at a random speed when time warping. A warped
+        # window reads between frames, and before the start of its recording it repeats the first
+        pos = torch.arange(self.window_len, dtype=torch.float32).expand(len(idx), -1)
+        if warp > 0:
+            pos = pos * (1 + (2 * torch.rand(len(idx), 1) - 1) * warp)
+        pos = torch.maximum(newest[:, None] - pos, first[:, None].float())
+        lower = pos.floor().long()
+        upper = torch.minimum(lower + 1, newest[:, None])
+        frac = (pos - lower)[:, :, None, None]
+
+        # Levels 0 ... 255 of the device values, [batch, frames, sensors, axes]
+        levels = self.data[lower].float() + 128
+        if warp > 0:
+            levels = torch.lerp(levels, self.data[upper].float() + 128, frac)
+        if gain > 0:
+            levels = levels * (1 + gain * torch.randn(len(idx), 1, levels.shape[2], 1))
+        if jitter > 0:
+            levels = levels + jitter * torch.randn(levels.shape)
+        values = levels.round().clamp(0, 255) - 128 if warp or gain or jitter else levels - 128
+
+        # ai8x.normalize of (v + 128) / 256, which gives back v in 8-bit mode
+        if not getattr(self.args, 'act_mode_8bit', False):
+            values = values / 256
+        if self.layout == 'spatial':
+            values = values.permute(0, 3, 1, 2)
+        if self.transform is not None:
+            values = self.transform(values)
+
+        return list(zip(values.unbind(0), self.labels[rec].tolist()))
+
 
 def imu_get_datasets(data, load_train=True, load_test=True):
     """
-    Load the custom dataset where each text file contains a semicolon-separated matrix.
-    
+    Load the parsed IMU recordings written by FinalData/parse_data.py.
+
     Args:
         data (tuple): Contains the data directory and program arguments.
         load_train (bool): Whether to load the training data (default: True).
         load_test (bool): Whether to load the testing data (default: True).
-    
+
     Returns:
         train_dataset, test_dataset: Loaded datasets for training and testing.
     """
     data_dir, args = data
 
-    transform = transforms.Compose([
-        ai8x.normalize(args=args),
-    ])
-
     # Load training dataset if requested
     if load_train:
-        train_dataset = IMU_AI(data_dir=data_dir, mode='train', args=args, transform=transform, truncate_testset=False)
+        train_dataset = IMU_AI(data_dir=data_dir, mode='train', args=args, truncate_testset=False)
     else:
         train_dataset = None
 
     # Load testing dataset if requested
     if load_test:
-        test_dataset = IMU_AI(data_dir=data_dir, mode='test', args=args, transform=transform, truncate_testset=False)
+        test_dataset = IMU_AI(data_dir=data_dir, mode='test', args=args, truncate_testset=False)
     else:
         test_dataset = None
 
@@ -97,9 +285,57 @@ def imu_get_datasets(data, load_train=True, load_test=True):
 datasets = [
     {
         'name': 'IMU_AI',
-        'input': (30, 6, 6),
+        'input': ((WINDOW_LEN, len(SENSORS), len(AXES)) if LAYOUT == 'channel'
+                  else (len(AXES), WINDOW_LEN, len(SENSORS))),
         'output': (0,1,2,3,4),
         'loader': imu_get_datasets
     },
 ]
 
+
+class PerWindow(Dataset):
+    """A dataset served one window at a time, the way the default collate used to get them"""
+    def __init__(self, dataset):
+        self.dataset = dataset
+
+    def __len__(self):
+        return len(self.dataset)
+
+    def __getitem__(self, idx):
+        return self.dataset[idx]
+
+
+def epoch_time(dataset, batch_size, workers, epochs):
+    """Average seconds of a shuffled pass over the dataset, after one to start the workers"""
+    loader = torch.utils.data.DataLoader(dataset, batch_size=batch_size, shuffle=True,
+                                         num_workers=workers, persistent_workers=workers > 0)
+    start = None
+    for epoch in range(epochs + 1):
+        for _ in loader:
+            pass
+        start = time.perf_counter() if epoch == 0 else start
+    return (time.perf_counter() - start) / max(epochs, 1)
+
+
+def main():
+    """Times an epoch of the training set served per window and per batch"""
+    parser = argparse.ArgumentParser(description='Epoch time of the IMU training data loader')
+    parser.add_argument('data_dir', help='directory of the parsed recordings (*.npz)')
+    parser.add_argument('-b', '--batch-size', type=int, default=256)
+    parser.add_argument('-j', '--workers', type=int, default=4)
+    parser.add_argument('-e', '--epochs', type=int, default=3)
+    parser.add_argument('--8bit', dest='act_mode_8bit', action='store_true',
+                        help='normalize as train.py does with --8-bit-mode')
+    args = parser.parse_args()
+
+    dataset = IMU_AI(args.data_dir, 'train', args)
+    print('%d windows, augment jitter %g gain %g warp %g'
+          % ((len(dataset),) + tuple(dataset.augment)))
+    for name, data in (('per window', PerWindow(dataset)), ('per batch', dataset)):
+        for workers in sorted({0, args.workers}):
+            print('%-10s %d workers: %.3f s/epoch'
+                  % (name, workers, epoch_time(data, args.batch_size, workers, args.epochs)))
+
+
+if __name__ == '__main__':
+    main()
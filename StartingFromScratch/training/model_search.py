@@ -0,0 +1,531 @@
+"""
+Hardware-aware architecture search for the IMU CNN
+
+Enumerates AI85NetIMU layer lists (IMU_NET in ai85net.py) for both window layouts (IMU_LAYOUT in
+imu.py): transposed convolutions in front or not, channel counts, kernel sizes and pooling. Each
+candidate gets a cost on the MAX78000 from the same counts ai8xize writes into cnn.h (macc,
+comparisons, weight and bias memory) and the accelerator clocks host/cnn_emu counts from the
+layer registers in cnn.c: one clock per padded input pixel and pass. Before anything else the cost
+model has to reproduce the SUMMARY OF OPS in the firmware's cnn.h and the registers in its cnn.c for
+the network they were generated from, so a formula that drifts from ai8xize is caught.
+
+Candidates that don't fit the accelerator are dropped; of the rest, the ones on the Pareto front of
+latency against weight count (no other candidate has more weights for the same or less latency)
+are spread over the latency range, trained in parallel on the CPU with ai8x-training's train.py,
+and printed as a table ranked by accuracy. Without -t only the costs and the commands are printed.
+
+usage: python model_search.py [-t ai8x-training] [-d data] [-n count] [-j jobs] [-e epochs]
+                              [-- extra train.py arguments]
+       python model_search.py [-g NET --firmware DIR] -c NET...
+       python model_search.py -y NET
+
+-c prints the costs of the given IMU_NET values, after checking the code generated for -g in
+--firmware if given. -y prints the ai8xize network description of an IMU_NET value, the imu.yaml
+for it.
+
+The spatial layout needs a different packing in the firmware (preprocess.c loads time as
+channels), so its candidates are only comparable offline until the firmware follows.
+"""
+import argparse
+import concurrent.futures
+import itertools
+import os
+import re
+import subprocess
+import sys
+
+# MAX78000, as ai8xize and host/cnn_emu.h see it
+CLOCK_HZ = 50000000
+PROCESSORS = 64
+KERNELS_PER_PROCESSOR = 768     # 3x3 kernels of 9 bytes in each processor's weight memory
+WEIGHT_MEMORY = 442368
+BIAS_MEMORY = 2048
+DATA_WORDS = 4096               # one ping-pong half of a processor group, as imu.yaml splits it
+CPU_HZ = 100000000
+LOAD_CYCLES_PER_WORD = 6        # load, store and loop in cnn_load_weights(), an estimate
+WEIGHT_BITS = (1, 2, 4, 8)
+
+NUM_CLASSES = 5
+WINDOW_LEN = 30
+
+# The network in the firmware's cnn.c (AI85NetExtraSmall trained with --use-bias)
+BASELINE = 't16-t8-c8-c8p2-c5p4'
+
+FIRMWARE = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', '..',
+                        'imu_fixed_inputs_no_softmax')
+
+# The grid, layers as in IMU_NET
+UPSAMPLING = {'channel': ((), (16,), (16, 8), (32, 16)), 'spatial': ((),)}
+WIDTHS = (8, 16, 32)
+DEPTHS = (2, 3, 4)
+KERNELS = (3, 1)
+POOLS = (1, 2, 4)
+FC_INPUTS = (5, 8)
+
+TRAIN_ARGS = ['--optimizer', 'Adam', '--lr', '0.00032', '--wd', '0', '--model', 'ai85netimu',
+              '--dataset', 'IMU_AI', '--device', 'MAX78000', '--batch-size', '32',
+              '--print-freq', '100', '--validation-split', '0', '--use-bias', '--cpu']
+
+
+def format_net(layers):
+    """Returns the IMU_NET value of (op, channels, kernel, pool) tuples, see parse_net()"""
+    tokens = []
+    for op, planes, kernel, pool in layers:
+        tokens.append(op + str(planes) + ('k%d' % kernel if kernel != 3 else '')
+                      + ('p%d' % pool if pool > 1 else ''))
+    return '-'.join(tokens)
+
+
+def parse_net(spec):
+    """Inverse of format_net(), the same as parse_net() in ai85net.py without needing torch"""
+    layers = []
+    for token in spec.split('-'):
+        match = re.fullmatch(r'([tc])(\d+)(?:k([13]))?(?:p(\d+))?', token)
+        if match is None:
+            raise ValueError('bad layer %r in %r' % (token, spec))
+        layers.append((match.group(1), int(match.group(2)), int(match.group(3) or 3),
+                       int(match.group(4) or 1)))
+    return layers
+
+
+def parse_bits(spec, layers):
+    """Returns the weight bits of every layer, the linear one last, from a list such as 8,4,4,8"""
+    bits = [int(b) for b in spec.split(',')]
+    if len(bits) != len(layers) + 1 or any(b not in WEIGHT_BITS for b in bits):
+        raise ValueError('%s needs %d weight widths out of %s, not %r'
+                         % (format_net(layers), len(layers) + 1,
+                            ', '.join(map(str, WEIGHT_BITS)), spec))
+    return bits
+
+
+def layer_names(layers):
+    """Names of the layers in AI85NetIMU, the QAT policy and the network description"""
+    return ['layer%d' % n for n in range(len(layers))] + ['fc']
+
+
+def qat_policy(layers, bits, start_epoch):
+    """Returns an ai8x-training QAT policy starting at start_epoch with the given weight bits"""
+    lines = ['---',
+             '# Generated by model_search.py for IMU_NET=%s' % format_net(layers),
+             'start_epoch: %d' % start_epoch,
+             'weight_bits: 8',
+             'shift_quantile: 0.995']
+    overrides = [(name, b) for name, b in zip(layer_names(layers), bits or []) if b != 8]
+    if overrides:
+        lines.append('overrides:')
+        for name, b in overrides:
+            lines += ['  %s:' % name, '    weight_bits: %d' % b]
+    return '\n'.join(lines) + '\n'
+
+
+def input_shape(layout, sensors, axes):
+    """Channels, rows and columns of a window in the given layout, see imu.py"""
+    if layout == 'channel':
+        return WINDOW_LEN, sensors, axes
+    return axes, WINDOW_LEN, sensors
+
+
+def ceil_div(a, b):
+    """Rounds a / b up"""
+    return -(-a // b)
+
+
+def contiguous(count):
+    """Processor mask of count channels from processor 0 up, a pass each beyond PROCESSORS"""
+    return (1 << min(count, PROCESSORS)) - 1
+
+
+def estimate(layers, shape, bits=None, masks=None):
+    """
+    Returns the cost of a network per layer, the linear layer last, as dicts of macc, comp,
+    weights and bias in bytes, processor mask, kernel slots per processor, clocks and the data
+    memory words of the input and output, or None if the pooling doesn't fit the input. bits
+    holds the weight bits of every layer (default 8), masks their input processors (default from
+    processor 0 up).
+    """
+    channels, rows, cols = shape
+    bits = bits or [8] * (len(layers) + 1)
+    costs = []
+
+    for n, (op, planes, kernel, pool) in enumerate(layers):
+        passes = ceil_div(channels, PROCESSORS)
+        if op == 't':
+            out_rows, out_cols = rows * 2, cols * 2
+            padded = (out_rows + 2) * (out_cols + 2)
+            comp = 0
+        else:
+            if rows < pool or cols < pool:
+                return None
+            out_rows, out_cols = rows // pool, cols // pool
+            padded = (rows + kernel - 1) * (cols + kernel - 1)
+            comp = planes * out_rows * out_cols
+            if pool > 1:
+                comp += channels * out_rows * out_cols * pool * pool
+        taps = 9 if op == 't' else kernel * kernel
+
+        costs.append({
+            'macc': planes * channels * taps * out_rows * out_cols,
+            'comp': comp,
+            'weights': ceil_div(planes * channels * taps * bits[n], 8),
+            'bias': planes,
+            'mask': masks[n] if masks else contiguous(channels),
+            'slots': ceil_div(planes * passes * bits[n], 8),
+            'clocks': padded * passes,
+            'data': max(rows * cols, out_rows * out_cols) * passes,
+        })
+        channels, rows, cols = planes, out_rows, out_cols
+
+    # The linear layer reads the flattened map one pixel per pass, a kernel holds 9 of them
+    inputs = channels * rows * cols
+    costs.append({
+        'macc': inputs * NUM_CLASSES,
+        'comp': 0,
+        'weights': ceil_div(inputs * NUM_CLASSES * bits[-1], 8),
+        'bias': NUM_CLASSES,
+        'mask': masks[-1] if masks else contiguous(channels),
+        'slots': ceil_div(NUM_CLASSES * ceil_div(rows * cols, 9) * bits[-1], 8),
+        'clocks': rows * cols,
+        'data': rows * cols,
+    })
+
+    return costs
+
+
+def totals(costs):
+    """Sums a network's costs and checks them against the accelerator's limits"""
+    total = {key: sum(c[key] for c in costs) for key in ('macc', 'comp', 'weights', 'bias',
+                                                         'clocks')}
+    slots = [sum(c['slots'] for c in costs if c['mask'] >> p & 1) for p in range(PROCESSORS)]
+
+    # cnn_load_weights() copies the 9-byte kernel slots of each processor as 32-bit words
+    total['processors'] = max(bin(c['mask']).count('1') for c in costs)
+    total['kernels'] = max(slots)
+    total['load_words'] = sum(ceil_div(9 * n, 4) for n in slots)
+    total['load_us'] = total['load_words'] * LOAD_CYCLES_PER_WORD * 1e6 / CPU_HZ
+    total['data'] = max(c['data'] for c in costs)
+    total['us'] = total['clocks'] * 1e6 / CLOCK_HZ
+    total['fits'] = (total['weights'] <= WEIGHT_MEMORY and total['bias'] <= BIAS_MEMORY
+                     and total['kernels'] <= KERNELS_PER_PROCESSOR
+                     and total['processors'] <= PROCESSORS and total['data'] <= DATA_WORDS)
+    return total
+
+
+def read_summary(path):
+    """Returns the per-layer (macc, comp) and the weight and bias bytes from cnn.h"""
+    with open(path, 'r') as f:
+        text = f.read()
+    layers = [(int(m.group(1).replace(',', '')), int(m.group(2).replace(',', '')))
+              for m in re.finditer(r'Layer \d+ \(\S+\): [\d,]+ ops \(([\d,]+) macc; ([\d,]+) comp',
+                                   text)]
+    weights = re.search(r'Weight memory: ([\d,]+) bytes', text)
+    bias = re.search(r'Bias memory: +([\d,]+) bytes', text)
+    if not layers or weights is None or bias is None:
+        raise ValueError('%s has no SUMMARY OF OPS' % path)
+    return layers, int(weights.group(1).replace(',', '')), int(bias.group(1).replace(',', ''))
+
+
+def read_layers(path):
+    """Returns the clocks and the processor mask of each layer from the registers cnn.c writes"""
+    regs = {}
+    with open(path, 'r') as f:
+        for m in re.finditer(r'\(volatile uint32_t \*\) 0x50([159d])(\w{5})\) = 0x(\w+);',
+                             f.read()):
+            regs[int(m.group(1), 16) // 4, int(m.group(2), 16)] = int(m.group(3), 16)
+
+    # Rows and columns are padded counts - 1, layer control 2 holds passes - 1 and the enable
+    # register the processors of each quadrant (host/cnn_emu.h)
+    layers = []
+    for layer in range(regs.get((0, 0x008), 0) + 1):
+        rows = (regs.get((0, 0x010 + 4 * layer), 0) & 0x3ff) + 1
+        cols = (regs.get((0, 0x090 + 4 * layer), 0) & 0x3ff) + 1
+        passes = (regs.get((0, 0xa10 + 4 * layer), 0) & 0xf) + 1
+        mask = 0
+        for quad in range(4):
+            mask |= (regs.get((quad, 0x710 + 4 * layer), 0) & 0xffff) << (16 * quad)
+        layers.append((rows * cols * passes, mask))
+    return layers
+
+
+def read_load_words(path):
+    """Returns the words cnn_load_weights() copies from the KERNELS array of weights.h"""
+    with open(path, 'r') as f:
+        text = f.read()
+    values = [int(v, 16) for v in re.findall(r'0x(\w+)', text[text.index('#define KERNELS'):])]
+    words = 0
+    n = 0
+    while values[n] != 0:
+        words += values[n + 1]
+        n += 2 + values[n + 1]
+    return words
+
+
+def calibrate(firmware, net, sensors, axes, bits=None):
+    """
+    Checks the cost model against the cnn.h, cnn.c and weights.h generated for net, returns the
+    mismatches
+    """
+    layers, weights, bias = read_summary(os.path.join(firmware, 'cnn.h'))
+    registers = read_layers(os.path.join(firmware, 'cnn.c'))
+    words = read_load_words(os.path.join(firmware, 'weights.h'))
+    costs = estimate(parse_net(net), input_shape('channel', sensors, axes), bits,
+                     [mask for _, mask in registers])
+    errors = []
+
+    if costs is None or len(costs) != len(layers) or len(costs) != len(registers):
+        return ['%s has %d layers in cnn.h and %d in cnn.c, the model %s'
+                % (net, len(layers), len(registers), len(costs) if costs else 'none')]
+    for layer, (cost, (macc, comp), (clk, _)) in enumerate(zip(costs, layers, registers)):
+        for key, header in (('macc', macc), ('comp', comp), ('clocks', clk)):
+            if cost[key] != header:
+                errors.append('layer %d: %s %d, generated %d' % (layer, key, cost[key], header))
+    total = totals(costs)
+    for key, header in (('weights', weights), ('bias', bias), ('load_words', words)):
+        if total[key] != header:
+            errors.append('%s %d, generated %d' % (key, total[key], header))
+    return errors
+
+
+def network_yaml(net, sensors, axes, bits=None):
+    """
+    Returns the ai8xize network description of net in the time-as-channel layout, in the form of
+    imu.yaml: every layer reads its input from processor 0 up and the layers alternate between
+    the ping-pong halves of data memory. Layers with bits below 8 get their quantization.
+    """
+    layers = parse_net(net)
+    names = layer_names(layers)
+    channels, rows, cols = input_shape('channel', sensors, axes)
+    lines = ['---',
+             '# Generated by model_search.py for IMU_NET=%s, MAX78000 with input format HWC' % net,
+             '',
+             'arch: ai85netimu',
+             'dataset: IMU_AI',
+             '',
+             'layers:']
+
+    for n, (op, planes, kernel, pool) in enumerate(layers + [('fc', NUM_CLASSES, 0, 1)]):
+        procs = (1 << min(channels, PROCESSORS)) - 1
+        lines += ['  # Layer %d' % n,
+                  '  - name: %s' % names[n],
+                  '    # input shape: (%d, %d, %d)' % (channels, rows, cols)]
+        if n == 0:
+            lines.append('    data_format: HWC')
+        lines += ['    processors: 0x%016x' % procs,
+                  '    out_offset: 0x%04x' % (0x4000 if n % 2 == 0 else 0)]
+        if bits and bits[n] != 8:
+            lines.append('    quantization: %d' % bits[n])
+        if op == 'fc':
+            lines += ['    op: Linear', '    flatten: true', '    activate: None',
+                      '    # output shape: (%d,)' % planes]
+            break
+        if op == 't':
+            rows, cols = rows * 2, cols * 2
+            lines += ['    op: ConvTranspose2d', '    kernel_size: 3x3', '    pad: 1',
+                      '    activate: None']
+        else:
+            rows, cols = rows // pool, cols // pool
+            lines += ['    op: Conv2d', '    kernel_size: %dx%d' % (kernel, kernel),
+                      '    pad: %d' % (kernel // 2), '    activate: Relu']
+            if pool > 1:
+                lines += ['    max_pool: %d' % pool, '    pool_stride: %d' % pool,
+                          '    pool_dilation: [1, 1]']
+        channels = planes
+        lines += ['    # output shape: (%d, %d, %d)' % (channels, rows, cols), '']
+
+    return '\n'.join(lines) + '\n'
+
+
+def candidates(sensors, axes):
+    """Yields (layout, layers) for the whole grid"""
+    for layout, upsampling in UPSAMPLING.items():
+        for ups, width, depth, kernel, fc_inputs in itertools.product(
+                upsampling, WIDTHS, DEPTHS, KERNELS, FC_INPUTS):
+            if fc_inputs > width:
+                continue
+            for pools in itertools.product(POOLS, repeat=depth):
+                layers = [('t', planes, 3, 1) for planes in ups]
+                layers += [('c', width, kernel, pool) for pool in pools[:-1]]
+                layers.append(('c', fc_inputs, kernel, pools[-1]))
+                yield layout, layers
+
+
+def pareto(entries, better):
+    """Returns the entries no other entry is at least as good as in latency and better() in"""
+    front = []
+    for entry in sorted(entries, key=lambda e: (e['us'], -better(e))):
+        if not front or better(entry) > better(front[-1]):
+            front.append(entry)
+    return front
+
+
+def spread(front, count):
+    """Picks count entries of a front sorted by latency, evenly spaced and with both ends"""
+    if len(front) <= count:
+        return front
+    if count == 1:
+        return front[:1]
+    return [front[round(i * (len(front) - 1) / (count - 1))] for i in range(count)]
+
+
+def train(entry, args, threads):
+    """Trains one candidate with train.py, returns its best top-1 accuracy or None"""
+    name = 'search-%s-%s' % (entry['layout'], entry['net'])
+    if entry['bits']:
+        name += '-w' + ''.join(map(str, entry['bits']))
+    log = os.path.join(args.out_dir, name + '.log')
+    policy = os.path.join(args.out_dir, name + '-qat.yaml')
+    env = dict(os.environ, IMU_NET=entry['net'], IMU_LAYOUT=entry['layout'],
+               OMP_NUM_THREADS=str(threads))
+    command = ([args.python, 'train.py', '--epochs', str(args.epochs), '--name', name,
+                '--out-dir', args.out_dir, '--qat-policy', policy] + TRAIN_ARGS
+               + (['--data', args.data] if args.data else []) + args.extra)
+
+    # The last quarter of the epochs is quantization-aware
+    with open(policy, 'w') as f:
+        f.write(qat_policy(parse_net(entry['net']), entry['bits'], args.epochs * 3 // 4))
+
+    with open(log, 'w') as f:
+        subprocess.run(command, cwd=args.train_dir, env=env, stdout=f, stderr=subprocess.STDOUT,
+                       check=False)
+    with open(log, 'r') as f:
+        best = re.findall(r'==> Best \[Top1: ([\d.]+)', f.read())
+    return float(best[-1]) if best else None
+
+
+def print_table(entries, accuracy):
+    """Prints the candidates, ranked by accuracy when they were trained"""
+    print('%-8s %-34s %9s %7s %5s %5s %7s %7s %7s%s' % (
+        'layout', 'net', 'macc', 'weights', 'bias', 'procs', 'clocks', 'us', 'load us',
+        '   top-1' if accuracy else ''))
+    front = {id(e) for e in pareto([e for e in entries if e.get('top1') is not None],
+                                   lambda e: e['top1'])} if accuracy else set()
+    for e in entries:
+        top1 = ''
+        if accuracy:
+            top1 = ('%7.2f%%' % e['top1'] if e.get('top1') is not None else '  failed')
+            top1 += ' *' if id(e) in front else ''
+        net = e['net'] + (' w' + ','.join(map(str, e['bits'])) if e['bits'] else '')
+        current = e['net'] == BASELINE and e['layout'] == 'channel' and not e['bits']
+        print('%-8s %-34s %9d %7d %5d %5d %7d %7.1f %7.1f%s%s' % (
+            e['layout'], net, e['macc'], e['weights'], e['bias'], e['processors'],
+            e['clocks'], e['us'], e['load_us'], ' ' + top1 if accuracy else '',
+            '  (current)' if current else ''))
+
+
+def train_all(entries, args):
+    """Trains the entries in parallel and prints them ranked by accuracy"""
+    os.makedirs(args.out_dir, exist_ok=True)
+    args.out_dir = os.path.abspath(args.out_dir)
+    threads = max(1, (os.cpu_count() or 1) // args.jobs)
+    with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        for e, top1 in zip(entries, pool.map(lambda e: train(e, args, threads), entries)):
+            e['top1'] = top1
+            print('%s %s: %s' % (e['layout'], e['net'],
+                                 'failed, see its log' if top1 is None else '%.2f%%' % top1))
+
+    entries.sort(key=lambda e: (e['top1'] is None, -(e['top1'] or 0), e['us']))
+    print()
+    print_table(entries, True)
+    print('\n* on the accuracy/latency front')
+
+
+def main():
+    """Costs the grid, picks the Pareto candidates and trains them"""
+    parser = argparse.ArgumentParser(description='Hardware-aware search for the IMU CNN')
+    parser.add_argument('-t', '--train-dir', help='ai8x-training checkout, no training without')
+    parser.add_argument('-d', '--data', help='data directory passed to train.py')
+    parser.add_argument('-o', '--out-dir', default='search', help='logs and checkpoints')
+    parser.add_argument('-n', '--count', type=int, default=6, help='candidates per layout')
+    parser.add_argument('-j', '--jobs', type=int, default=max(1, (os.cpu_count() or 1) // 4))
+    parser.add_argument('-e', '--epochs', type=int, default=30)
+    parser.add_argument('-u', '--max-us', type=float, help='latency budget in microseconds')
+    parser.add_argument('-s', '--sensors', type=int, default=6, help='sensors in a window')
+    parser.add_argument('-a', '--axes', type=int, default=6, help='axes per sensor')
+    parser.add_argument('-c', '--cost', action='append', default=[], metavar='NET',
+                        help='only print the costs of this network, repeatable')
+    parser.add_argument('-y', '--yaml', metavar='NET', help='only print the ai8xize yaml of NET')
+    parser.add_argument('-w', '--weight-bits', action='append', default=[], metavar='BITS',
+                        help='weight bits of every layer for -c and -y, e.g. 8,4,4,2,2,8')
+    parser.add_argument('-q', '--qat', metavar='NET',
+                        help='only print the QAT policy of NET with the weight bits of -w')
+    parser.add_argument('-g', '--generated', metavar='NET',
+                        help='network cnn.h and cnn.c were generated for, default %s' % BASELINE)
+    parser.add_argument('--firmware', default=FIRMWARE, help='directory with cnn.h and cnn.c')
+    parser.add_argument('--python', default=sys.executable, help='interpreter for train.py')
+    parser.add_argument('extra', nargs='*', help='further train.py arguments, after --')
+    args = parser.parse_args()
+
+    if args.yaml or args.qat:
+        layers = parse_net(args.yaml or args.qat)
+        bits = parse_bits(args.weight_bits[0], layers) if args.weight_bits else None
+        if args.yaml:
+            sys.stdout.write(network_yaml(args.yaml, args.sensors, args.axes, bits))
+        else:
+            sys.stdout.write(qat_policy(layers, bits, args.epochs * 3 // 4))
+        return
+    if args.weight_bits and not args.cost:
+        parser.error('-w only goes with -c, -y or -q')
+
+    # The costs of single networks need no generated code unless it is named
+    if args.generated or not args.cost:
+        generated = args.generated or BASELINE
+        errors = calibrate(args.firmware, generated, args.sensors, args.axes)
+        if errors:
+            sys.exit('cost model disagrees with the generated network:\n  ' + '\n  '.join(errors))
+        print('cost model reproduces cnn.h, cnn.c and weights.h for %s\n' % generated)
+
+    if args.cost:
+        entries = []
+        for net, spec in itertools.product(args.cost, args.weight_bits or [None]):
+            layers = parse_net(net)
+            try:
+                bits = parse_bits(spec, layers) if spec else None
+            except ValueError as e:
+                parser.error(str(e))
+            costs = estimate(layers, input_shape('channel', args.sensors, args.axes), bits)
+            if costs is None:
+                sys.exit('%s pools below one pixel' % net)
+            entries.append(dict(totals(costs), layout='channel', net=net, bits=bits))
+        if args.train_dir:
+            train_all(entries, args)
+        else:
+            print_table(entries, False)
+        return
+
+    entries = []
+    infeasible = 0
+    for layout, layers in candidates(args.sensors, args.axes):
+        costs = estimate(layers, input_shape(layout, args.sensors, args.axes))
+        if costs is None:
+            continue
+        entry = totals(costs)
+        if not entry['fits'] or (args.max_us is not None and entry['us'] > args.max_us):
+            infeasible += 1
+            continue
+        entry.update(layout=layout, net=format_net(layers), bits=None)
+        entries.append(entry)
+
+    chosen = []
+    for layout in UPSAMPLING:
+        front = pareto([e for e in entries if e['layout'] == layout], lambda e: e['weights'])
+        print('%s: %d candidates, %d on the latency/weights front'
+              % (layout, sum(e['layout'] == layout for e in entries), len(front)))
+        chosen += spread(front, args.count)
+    print('%d over the accelerator limits or the latency budget\n' % infeasible)
+
+    # The current network is the reference
+    if not any(e['net'] == BASELINE and e['layout'] == 'channel' for e in chosen):
+        chosen += [e for e in entries if e['net'] == BASELINE and e['layout'] == 'channel']
+    chosen.sort(key=lambda e: e['us'])
+
+    if not args.train_dir:
+        print_table(chosen, False)
+        print('\nwith -t, each is trained as\n  IMU_LAYOUT=<layout> IMU_NET=<net> python train.py '
+              '--epochs %d --qat-policy <-q output> %s'
+              % (args.epochs, ' '.join(TRAIN_ARGS + args.extra)))
+        return
+
+    train_all(chosen, args)
+
+
+if __name__ == '__main__':
+    main()
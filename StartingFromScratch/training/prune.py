@@ -0,0 +1,178 @@
+"""
+Structured channel pruning of a trained IMU network
+
+Removes the output channels of every layer with the smallest L1 norm of their weights, together
+with the inputs of the next layer they feed, and keeps a multiple of 4 channels per layer so
+each layer's inputs fill whole processor groups of 4 and ai8xize has nothing to warn about. The
+window input (30 frames) and the classes stay. The pruned weights are written as an ai85netimu
+checkpoint for its IMU_NET, to be fine-tuned with train.py from there on, and its ai8xize network
+description with the smallest processor masks goes next to it.
+
+Prints the layers before and after with their channels, processors, macc and accelerator clocks
+from the cost model in model_search.py. The clocks only drop where a layer needs fewer passes,
+i.e. with more than 64 inputs; below that pruning frees processors, weights and macc instead.
+
+usage: python prune.py [-n NET] [-r ratio | -k channels] [-t ai8x-training [-e epochs]]
+                       checkpoint out.pth.tar
+
+The checkpoint is an ai85netimu one for -n or IMU_NET, or ai85netextrasmall (qat_best.pth.tar),
+which is the same network as t16-t8-c8-c8p2-c5p4. Prune the floating point or QAT checkpoint,
+not the quantized imu_q8.pth.tar. With -t the pruned network is fine-tuned with QAT right away.
+"""
+import argparse
+import os
+import sys
+
+import torch
+
+import model_search
+
+# Layer names of AI85NetExtraSmall in the order of AI85NetIMU's layer0, layer1, ...
+EXTRA_SMALL = ['trans_conv1', 'trans_conv2', 'conv1', 'conv2', 'conv3']
+
+ALIGN = 4
+
+
+def load_state(path, arch_names):
+    """Returns the state dict of a checkpoint with the layers renamed to AI85NetIMU's"""
+    checkpoint = torch.load(path, map_location='cpu')
+    state = checkpoint.get('state_dict', checkpoint)
+    renamed = {}
+    for key, value in state.items():
+        key = key[len('module.'):] if key.startswith('module.') else key
+        prefix, rest = key.split('.', 1)
+        if checkpoint.get('arch') == 'ai85netextrasmall' and prefix in EXTRA_SMALL:
+            prefix = arch_names[EXTRA_SMALL.index(prefix)]
+        renamed[prefix + '.' + rest] = value
+    return checkpoint, renamed
+
+
+def importance(state, name, op):
+    """L1 norm of the weights of each output channel of a layer"""
+    weight = state[name + '.op.weight']
+    if op == 't':
+        weight = weight.transpose(0, 1)     # transposed convolutions store [in, out, ...]
+    return weight.abs().flatten(1).sum(1)
+
+
+def aligned(channels, ratio):
+    """Channels kept of a layer, a multiple of ALIGN and at least ALIGN"""
+    return max(ALIGN, int(round(channels * ratio / ALIGN)) * ALIGN)
+
+
+def prune(state, layers, keep, pixels):
+    """
+    Returns the state dict with the channels of highest importance kept in every layer, keep
+    holding their count per layer and pixels the size of the map the linear layer flattens
+    """
+    names = model_search.layer_names(layers)
+    pruned = dict(state)
+    kept_in = None
+
+    for n, (op, planes, _, _) in enumerate(layers):
+        kept = importance(state, names[n], op).argsort(descending=True)[:keep[n]].sort().values
+        weight = state[names[n] + '.op.weight']
+        out_dim, in_dim = (1, 0) if op == 't' else (0, 1)
+        if kept_in is not None:
+            weight = weight.index_select(in_dim, kept_in)
+        pruned[names[n] + '.op.weight'] = weight.index_select(out_dim, kept)
+        if names[n] + '.op.bias' in state:
+            pruned[names[n] + '.op.bias'] = state[names[n] + '.op.bias'][kept]
+        kept_in = kept
+
+    # The linear layer's inputs are the flattened channels of the last map, channel-major
+    fc = state['fc.op.weight']
+    columns = (kept_in[:, None] * pixels + torch.arange(pixels)[None, :]).flatten()
+    pruned['fc.op.weight'] = fc.index_select(1, columns)
+    return pruned
+
+
+def print_layers(before, after, names):
+    """Prints the per-layer costs before and after pruning"""
+    print('%-8s %13s %11s %19s %15s %13s' % ('layer', 'channels', 'processors', 'macc', 'clocks',
+                                              'saved'))
+    for n, (b, a) in enumerate(zip(before, after)):
+        print('%-8s %6d %6d %5d %5d %9d %9d %7d %7d %7d' % (
+            names[n], b['out'], a['out'], bin(b['mask']).count('1'), bin(a['mask']).count('1'),
+            b['macc'], a['macc'], b['clocks'], a['clocks'], b['clocks'] - a['clocks']))
+
+
+def main():
+    """Prunes a checkpoint and writes the smaller network"""
+    parser = argparse.ArgumentParser(description='Structured channel pruning of the IMU CNN')
+    parser.add_argument('-n', '--net', default=os.environ.get('IMU_NET', model_search.BASELINE),
+                        help='IMU_NET of the checkpoint')
+    parser.add_argument('-r', '--ratio', type=float, default=0.5,
+                        help='fraction of the channels to keep in every layer')
+    parser.add_argument('-k', '--keep', help='channels to keep per layer, e.g. 12,8,8,8,4')
+    parser.add_argument('-s', '--sensors', type=int, default=6, help='sensors in a window')
+    parser.add_argument('-a', '--axes', type=int, default=6, help='axes per sensor')
+    parser.add_argument('-t', '--train-dir', help='ai8x-training checkout to fine-tune in')
+    parser.add_argument('-d', '--data', help='data directory passed to train.py')
+    parser.add_argument('-e', '--epochs', type=int, default=40, help='fine-tuning epochs')
+    parser.add_argument('--python', default=sys.executable, help='interpreter for train.py')
+    parser.add_argument('checkpoint')
+    parser.add_argument('output')
+    args = parser.parse_args()
+
+    layers = model_search.parse_net(args.net)
+    shape = model_search.input_shape('channel', args.sensors, args.axes)
+    names = model_search.layer_names(layers)
+    if args.keep:
+        keep = [int(k) for k in args.keep.split(',')]
+    else:
+        keep = [aligned(planes, args.ratio) for _, planes, _, _ in layers]
+    if len(keep) != len(layers) or any(k % ALIGN or not 0 < k <= p
+                                       for k, (_, p, _, _) in zip(keep, layers)):
+        parser.error('keep a multiple of %d and at most all channels of each of the %d layers'
+                     % (ALIGN, len(layers)))
+
+    pruned_layers = [(op, k, kernel, pool) for k, (op, _, kernel, pool) in zip(keep, layers)]
+    pruned_net = model_search.format_net(pruned_layers)
+
+    before = model_search.estimate(layers, shape)
+    after = model_search.estimate(pruned_layers, shape)
+    for costs, net_layers in ((before, layers), (after, pruned_layers)):
+        for cost, (_, planes, _, _) in zip(costs, net_layers + [(None, model_search.NUM_CLASSES,
+                                                                  None, None)]):
+            cost['out'] = planes
+
+    checkpoint, state = load_state(args.checkpoint, names)
+    pixels = state['fc.op.weight'].shape[1] // layers[-1][1]
+    checkpoint = {
+        'epoch': 0,
+        'arch': 'ai85netimu',
+        'state_dict': prune(state, layers, keep, pixels),
+        'extras': {'imu_net': pruned_net, 'pruned_from': args.net},
+    }
+    torch.save(checkpoint, args.output)
+
+    yaml = os.path.splitext(os.path.splitext(args.output)[0])[0] + '.yaml'
+    with open(yaml, 'w') as f:
+        f.write(model_search.network_yaml(pruned_net, args.sensors, args.axes))
+
+    print('%s -> %s\n' % (args.net, pruned_net))
+    print_layers(before, after, names)
+    total_before = model_search.totals(before)
+    total_after = model_search.totals(after)
+    print('\nweights %d -> %d bytes, macc %d -> %d, %.1f -> %.1f us'
+          % (total_before['weights'], total_after['weights'], total_before['macc'],
+             total_after['macc'], total_before['us'], total_after['us']))
+    print('wrote %s and %s' % (args.output, yaml))
+
+    fine_tune = ['--exp-load-weights-from', os.path.abspath(args.output)]
+    if not args.train_dir:
+        print('\nfine-tune with\n  IMU_NET=%s python train.py --epochs %d %s %s'
+              % (pruned_net, args.epochs, ' '.join(model_search.TRAIN_ARGS), ' '.join(fine_tune)))
+        return
+
+    search_args = argparse.Namespace(train_dir=args.train_dir, data=args.data, epochs=args.epochs,
+                                     python=args.python, extra=fine_tune,
+                                     out_dir=os.path.abspath(os.path.dirname(args.output) or '.'))
+    entry = dict(total_after, layout='channel', net=pruned_net, bits=None)
+    top1 = model_search.train(entry, search_args, os.cpu_count() or 1)
+    print('\nfine-tuned: %s' % ('failed, see its log' if top1 is None else '%.2f%%' % top1))
+
+
+if __name__ == '__main__':
+    main()
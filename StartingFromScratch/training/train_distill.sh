@@ -0,0 +1,28 @@
+#!/bin/sh
+# Knowledge distillation: trains the IMU_TEACHER_NET network in floating point, then the IMU_NET
+# student with the teacher's soft labels and QAT for the last epochs (qat_policy_imu.yaml), and
+# prints the accuracy and accelerator cost of both. Run it next to train.py like
+# train_kinetics.sh, with model_search.py copied there too; further arguments go to both runs.
+set -e
+
+IMU_TEACHER_NET=${IMU_TEACHER_NET:-t32-t16-c32-c32p2-c32p2-c16p2}
+IMU_NET=${IMU_NET:-c16-c16p2-c8}
+OUT=${OUT:-logs}
+export IMU_TEACHER_NET IMU_NET
+
+TRAIN="python train.py --epochs 200 --optimizer Adam --lr 0.00032 --wd 0 --compress policies/schedule.yaml --dataset IMU_AI --device MAX78000 --batch-size 32 --print-freq 100 --validation-split 0 --use-bias --out-dir $OUT"
+
+$TRAIN --model ai85netimuteacher --qat-policy None --name imu_teacher "$@"
+teacher=$(ls -td "$OUT"/imu_teacher___*/ | head -n 1)
+
+$TRAIN --model ai85netimu --qat-policy policies/qat_policy_imu.yaml --name imu_student --kd-teacher ai85netimuteacher --kd-resume "${teacher}imu_teacher_best.pth.tar" --kd-temp 4.0 --kd-distill-wt 0.7 --kd-student-wt 0.3 "$@"
+student=$(ls -td "$OUT"/imu_student___*/ | head -n 1)
+
+echo
+echo "teacher $IMU_TEACHER_NET: $(grep '==> Best' "$teacher"*.log | tail -n 1)"
+echo "student $IMU_NET: $(grep '==> Best' "$student"*.log | tail -n 1)"
+echo
+python model_search.py -c "$IMU_TEACHER_NET" -c "$IMU_NET"
+echo
+echo "quantize ${student}imu_student_qat_best.pth.tar to imu_q8.pth.tar and synthesize it with"
+echo "python model_search.py -y $IMU_NET"
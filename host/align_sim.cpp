@@ -0,0 +1,217 @@
+/**
+ * @file        align_sim.cpp
+ * @brief       Error of the sensor skew within a frame, with and without its compensation
+ * @details     The recordings are taken as the motion itself: each sensor's samples, one per frame
+ *              period of the firmware, are joined by a Catmull-Rom spline into a continuous
+ *              signal. Frames are then read from it at several frame periods with the sensors read
+ *              back to back as main.c does, sensor s at s / SENSOR_COUNT of the period after the
+ *              first, the firmware's period being the reads as read_timing.h times them. The
+ *              frames are fed through align.c with the timestamps of those reads. For every period
+ *              the error against the signal at the frame's first read is printed for the samples
+ *              as read and as compensated, in register units and in the network's input units
+ *              (1/128 of a register step, see preprocess.h), along with the largest difference of
+ *              the Q14 interpolation from the exact one. Exits nonzero if that is more than the
+ *              rounding of the result and of the weight account for.
+ *
+ *              usage: align_sim [-p periods] LOG...
+ *
+ *              -p  frame periods in ms, comma separated, default FRAME_PERIODS_MS
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "align.h"
+#include "preprocess.h"
+#include "read_timing.h"
+#include "recording.h"
+
+/* The firmware's period first, then faster rates */
+#define FRAME_PERIODS_MS "0,40,20,10"
+
+/* Register steps per unit of the network input */
+#define INPUT_STEP 128
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [-p periods] LOG...\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+/* Value of column c at time t_us of a recording sampled every period_us */
+static double signal_at(const Recording &recording, int c, double t_us, double period_us) {
+	double x = t_us / period_us;
+	long n = (long) std::floor(x);
+	double f = x - n;
+	long last = (long) recording.frames() - 1;
+	double p[4];
+
+	for (int i = 0; i < 4; i++) {
+		long k = std::min(last, std::max(0L, n - 1 + i));
+
+		p[i] = (int16_t) recording.frame(k)[c];
+	}
+	return p[1] + 0.5 * f * (p[2] - p[0] + f * (2 * p[0] - 5 * p[1] + 4 * p[2] - p[3]
+			+ f * (3 * (p[1] - p[2]) + p[3] - p[0])));
+}
+
+struct Error {
+	double sum2 = 0;
+	double max = 0;
+	long count = 0;
+
+	void add(double e) {
+		sum2 += e * e;
+		max = std::max(max, std::fabs(e));
+		count++;
+	}
+
+	double rms() const { return count ? std::sqrt(sum2 / count) : 0; }
+};
+
+int main(int argc, char **argv) {
+	std::string periods_arg = FRAME_PERIODS_MS;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:")) != -1) {
+		switch (opt) {
+		case 'p':
+			periods_arg = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind >= argc) {
+		usage(argv[0]);
+	}
+
+	std::vector<Recording> recordings;
+	std::vector<double> periods_us;
+
+	try {
+		recordings = load_logs(std::vector<std::string>(argv + optind, argv + argc));
+	} catch (const std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	// 0 stands for the firmware's period, the reads back to back
+	double firmware_us = SENSOR_COUNT * firmware_sensor_timing().read_us;
+	std::stringstream list(periods_arg);
+	std::string item;
+
+	while (std::getline(list, item, ',')) {
+		double ms = atof(item.c_str());
+
+		periods_us.push_back(ms > 0 ? ms * 1000 : firmware_us);
+	}
+
+	printf("Recordings taken as sampled every %.1f ms, the firmware's frame period\n\n",
+			firmware_us / 1000);
+	printf("%10s %10s %12s %12s %12s %12s %10s\n", "period", "span", "read rms", "read max",
+			"aligned rms", "aligned max", "Q14 max");
+
+	double worst_q14 = 0;
+	long wrong_q14 = 0;
+
+	for (double period_us : periods_us) {
+		double spacing_us = period_us / SENSOR_COUNT;
+		Error read_error, aligned_error;
+		align_t align;
+
+		double clock_us = 0;
+
+		align_init(&align);
+		for (const Recording &recording : recordings) {
+			double end_us = (recording.frames() - 1) * firmware_us;
+			uint16_t raw[SENSOR_COUNT][SENSOR_AXES];
+
+			// Every recording starts over, as after a gap
+			align_apply(&align, &raw[0][0], 0, true);
+
+			for (long k = 0; (k + 1) * period_us < end_us; k++, clock_us += period_us) {
+				double frame_us = k * period_us;
+				uint16_t as_read[SENSOR_COUNT][SENSOR_AXES];
+				double last_value[SENSOR_COUNT][SENSOR_AXES];
+				double last_at[SENSOR_COUNT];
+				bool had_last = align.valid == (1u << SENSOR_COUNT) - 1;
+
+				for (int s = 0; s < SENSOR_COUNT; s++) {
+					last_at[s] = align.last_us[s];
+					for (int a = 0; a < SENSOR_AXES; a++) {
+						last_value[s][a] = (int16_t) align.last[s][a];
+					}
+				}
+
+				align_frame(&align);
+				for (int s = 0; s < SENSOR_COUNT; s++) {
+					double t_us = frame_us + s * spacing_us;
+
+					for (int a = 0; a < SENSOR_AXES; a++) {
+						double v = signal_at(recording, s * SENSOR_AXES + a, t_us, firmware_us);
+
+						raw[s][a] = (uint16_t) (int16_t) std::lround(std::min(32767.0,
+								std::max(-32768.0, v)));
+					}
+					// A read with its middle at t_us, on a clock that runs on across recordings
+					align_read(&align, s, (uint32_t) (clock_us + t_us - frame_us - spacing_us / 2),
+							(uint32_t) (clock_us + t_us - frame_us + spacing_us / 2));
+				}
+				memcpy(as_read, raw, sizeof(raw));
+				uint32_t t = align_apply(&align, &raw[0][0], (1u << SENSOR_COUNT) - 1, true);
+
+				// The first frame of a recording has nothing to interpolate from
+				if (!had_last) {
+					continue;
+				}
+				for (int s = 0; s < SENSOR_COUNT; s++) {
+					double read_at = align.read_us[s];
+					double at_us = frame_us + (int32_t) (t - (uint32_t) clock_us);
+
+					for (int a = 0; a < SENSOR_AXES; a++) {
+						double target = signal_at(recording, s * SENSOR_AXES + a, at_us, firmware_us);
+						double current = (int16_t) as_read[s][a];
+						double exact = last_value[s][a] + (current - last_value[s][a])
+								* (t - last_at[s]) / (read_at - last_at[s]);
+
+						read_error.add(current - target);
+						aligned_error.add((int16_t) raw[s][a] - target);
+						double q14 = std::fabs((int16_t) raw[s][a] - exact);
+
+						// Rounding the result and the weight
+						wrong_q14 += q14 > 0.5 + std::fabs(current - last_value[s][a])
+								/ (2 << ALIGN_FRAC_BITS) + 1e-6;
+						worst_q14 = std::max(worst_q14, q14);
+					}
+				}
+			}
+		}
+
+		char name[32];
+
+		snprintf(name, sizeof(name), "%.1f ms", period_us / 1000);
+		printf("%10s %7.1f ms %12.1f %12.0f %12.1f %12.0f %10.2f\n", name,
+				(SENSOR_COUNT - 1) * spacing_us / 1000, read_error.rms(), read_error.max,
+				aligned_error.rms(), aligned_error.max, worst_q14);
+		printf("%10s %10s %12.2f %12.1f %12.2f %12.1f\n", "", "input",
+				read_error.rms() / INPUT_STEP, read_error.max / INPUT_STEP,
+				aligned_error.rms() / INPUT_STEP, aligned_error.max / INPUT_STEP);
+		if (period_us == periods_us.front()) {
+			align_report(&align);
+			printf("\n");
+		}
+	}
+
+	if (wrong_q14 > 0) {
+		printf("%ld interpolations off by more than their rounding\n", wrong_q14);
+	}
+	return wrong_q14 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file        Arduino.h
+ * @brief       Host stand-in for the parts of the Arduino core the data-collection sketch uses
+ * @details     Time is simulated by arduino_mock.cpp: micros() only moves on by the modeled cost
+ *              of the calls the sketch makes, see arduino_mock.h.
+ */
+
+#ifndef __ARDUINO_H__
+#define __ARDUINO_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+typedef uint8_t byte;
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+
+/* 32 bits like on the AVR, so they wrap the same way */
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+class Print {
+public:
+	virtual ~Print() {}
+
+	virtual size_t write(uint8_t b) = 0;
+	size_t write(const uint8_t *buf, size_t len);
+
+	size_t print(const char *s);
+	size_t print(int v);
+	size_t print(unsigned int v);
+	size_t print(long v);
+	size_t print(unsigned long v);
+	size_t println();
+	size_t println(const char *s);
+	size_t println(int v);
+	size_t println(long v);
+
+private:
+	size_t print_number(long v);
+};
+
+class HardwareSerial : public Print {
+public:
+	using Print::write;
+
+	void begin(unsigned long baud);
+	size_t write(uint8_t b) override;
+	int availableForWrite();
+};
+
+extern HardwareSerial Serial;
+
+#endif // __ARDUINO_H__
@@ -0,0 +1,26 @@
+/**
+ * @file        MPU6050.h
+ * @brief       Host stand-in for the I2Cdevlib MPU6050 class used by the sketch's setup()
+ * @details     initialize() and testConnection() talk to the default address 0x68 like the
+ *              original, i.e. to the sensors whose AD0 pin is low.
+ */
+
+#ifndef __MPU6050_H__
+#define __MPU6050_H__
+
+#include <cstdint>
+
+#define MPU6050_DEFAULT_ADDRESS 0x68
+
+class MPU6050 {
+public:
+	explicit MPU6050(uint8_t address = MPU6050_DEFAULT_ADDRESS) : address_(address) {}
+
+	void initialize();
+	bool testConnection();
+
+private:
+	uint8_t address_;
+};
+
+#endif // __MPU6050_H__
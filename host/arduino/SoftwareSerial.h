@@ -0,0 +1,22 @@
+/**
+ * @file        SoftwareSerial.h
+ * @brief       Host stand-in for the Arduino SoftwareSerial library
+ * @details     Writes block for the whole byte as the bit-banged original does.
+ */
+
+#ifndef __SOFTWARE_SERIAL_H__
+#define __SOFTWARE_SERIAL_H__
+
+#include "Arduino.h"
+
+class SoftwareSerial : public Print {
+public:
+	using Print::write;
+
+	SoftwareSerial(int rx, int tx) {}
+
+	void begin(long baud);
+	size_t write(uint8_t b) override;
+};
+
+#endif // __SOFTWARE_SERIAL_H__
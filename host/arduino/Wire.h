@@ -0,0 +1,42 @@
+/**
+ * @file        Wire.h
+ * @brief       Host stand-in for the Arduino Wire (I2C master) library
+ * @details     Transfers go to the simulated MPU6050s of arduino_mock.cpp and take the time of
+ *              their bits at the bus clock.
+ */
+
+#ifndef __WIRE_H__
+#define __WIRE_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "Arduino.h"
+
+class TwoWire {
+public:
+	void begin();
+	void begin(uint8_t address);
+	void setClock(uint32_t hz);
+	void setWireTimeout(uint32_t timeout_us = 25000, bool reset = false);
+	bool getWireTimeoutFlag();
+	void clearWireTimeoutFlag();
+
+	void beginTransmission(int address);
+	size_t write(uint8_t b);
+	uint8_t endTransmission(bool stop = true);
+	uint8_t requestFrom(int address, int count, bool stop = true);
+	int available();
+	int read();
+
+private:
+	int address_ = 0;
+	uint8_t reg_ = 0;
+	std::vector<uint8_t> tx_;
+	std::vector<uint8_t> rx_;
+	size_t rx_pos_ = 0;
+};
+
+extern TwoWire Wire;
+
+#endif // __WIRE_H__
@@ -0,0 +1,318 @@
+/**
+ * @file        arduino_mock.cpp
+ * @brief       Simulated board behind the host stand-ins for the Arduino core (host/arduino)
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "Arduino.h"
+#include "MPU6050.h"
+#include "SoftwareSerial.h"
+#include "Wire.h"
+#include "arduino_mock.h"
+
+#define NUM_PINS 20
+#define MPU6050_ADDRESS_AD0_HIGH 0x69
+#define MPU6050_RA_PWR_MGMT_1 0x6B
+#define MPU6050_RA_ACCEL_XOUT_H 0x3B
+#define MPU6050_RA_WHO_AM_I 0x75
+
+HardwareSerial Serial;
+TwoWire Wire;
+
+static MockConfig config;
+static double now_us;
+static int pins[NUM_PINS];
+static std::vector<uint64_t> reads;     // data register reads of each sensor
+
+static double serial_byte_us;
+static double serial_idle_at;           // when the transmitter has sent what it was given
+static double serial_busy_us;
+static std::vector<uint8_t> serial_out;
+
+static double bt_byte_us;
+static std::vector<uint8_t> bt_out;
+
+static double i2c_bit_us;
+
+void mock_reset(const MockConfig &c) {
+	config = c;
+	now_us = 0;
+	std::fill(pins, pins + NUM_PINS, LOW);
+	reads.assign(config.ad0_pins.size(), 0);
+	serial_byte_us = bt_byte_us = 0;
+	serial_idle_at = serial_busy_us = 0;
+	serial_out.clear();
+	bt_out.clear();
+	i2c_bit_us = 1e6 / 100000;
+}
+
+uint64_t mock_now_us() {
+	return (uint64_t) now_us;
+}
+
+void mock_spend(double us) {
+	now_us += us;
+}
+
+const std::vector<uint8_t> &mock_serial_out() {
+	return serial_out;
+}
+
+const std::vector<uint8_t> &mock_bt_out() {
+	return bt_out;
+}
+
+double mock_serial_busy_us() {
+	return serial_busy_us;
+}
+
+/* The connected sensor answering at an I2C address, -1 if none */
+static int sensor_at(int address) {
+	for (size_t s = 0; s < config.ad0_pins.size(); s++) {
+		int pin = config.ad0_pins[s];
+		int high = pin >= 0 && pin < NUM_PINS && pins[pin] == HIGH;
+
+		if ((config.connected >> s & 1)
+				&& address == (high ? MPU6050_ADDRESS_AD0_HIGH : MPU6050_DEFAULT_ADDRESS)) {
+			return (int) s;
+		}
+	}
+	return -1;
+}
+
+/* Start, address and data bytes of 9 clocks each, and the stop if there is one */
+static void i2c_transfer(size_t bytes, bool stop) {
+	now_us += MOCK_I2C_CALL_US + i2c_bit_us * (1 + 9 * (1 + bytes) + (stop ? 1 : 0));
+}
+
+void pinMode(int pin, int mode) {
+}
+
+void digitalWrite(int pin, int value) {
+	if (pin >= 0 && pin < NUM_PINS) {
+		pins[pin] = value;
+	}
+	now_us += MOCK_DIGITAL_WRITE_US;
+}
+
+int digitalRead(int pin) {
+	return pin >= 0 && pin < NUM_PINS ? pins[pin] : LOW;
+}
+
+uint32_t micros() {
+	uint32_t us = (uint32_t) (uint64_t) now_us;
+
+	now_us += MOCK_MICROS_US;
+	return us;
+}
+
+uint32_t millis() {
+	return (uint32_t) ((uint64_t) now_us / 1000);
+}
+
+void delay(uint32_t ms) {
+	now_us += 1000.0 * ms;
+}
+
+void delayMicroseconds(uint32_t us) {
+	now_us += us;
+}
+
+size_t Print::write(const uint8_t *buf, size_t len) {
+	for (size_t i = 0; i < len; i++) {
+		write(buf[i]);
+	}
+	return len;
+}
+
+size_t Print::print(const char *s) {
+	return write((const uint8_t *) s, strlen(s));
+}
+
+size_t Print::print_number(long v) {
+	char text[24];
+
+	now_us += MOCK_PRINT_NUMBER_US;
+	snprintf(text, sizeof(text), "%ld", v);
+	return print(text);
+}
+
+size_t Print::print(int v) {
+	return print_number(v);
+}
+
+size_t Print::print(unsigned int v) {
+	return print_number(v);
+}
+
+size_t Print::print(long v) {
+	return print_number(v);
+}
+
+size_t Print::print(unsigned long v) {
+	return print_number((long) v);
+}
+
+size_t Print::println() {
+	return print("\r\n");
+}
+
+size_t Print::println(const char *s) {
+	return print(s) + println();
+}
+
+size_t Print::println(int v) {
+	return print(v) + println();
+}
+
+size_t Print::println(long v) {
+	return print(v) + println();
+}
+
+void HardwareSerial::begin(unsigned long baud) {
+	serial_byte_us = 10e6 / baud;
+	serial_idle_at = now_us;
+}
+
+/* Waits while the transmit buffer is full, then queues the byte behind the ones in it */
+size_t HardwareSerial::write(uint8_t b) {
+	if (serial_idle_at - now_us > MOCK_SERIAL_BUFFER * serial_byte_us) {
+		now_us = serial_idle_at - MOCK_SERIAL_BUFFER * serial_byte_us;
+	}
+	serial_idle_at = std::max(serial_idle_at, now_us) + serial_byte_us;
+	serial_busy_us += serial_byte_us;
+	serial_out.push_back(b);
+	now_us += MOCK_SERIAL_WRITE_US;
+	return 1;
+}
+
+int HardwareSerial::availableForWrite() {
+	double queued = std::max(0.0, serial_idle_at - now_us) / serial_byte_us;
+
+	return std::max(0, MOCK_SERIAL_BUFFER - (int) std::ceil(queued));
+}
+
+void SoftwareSerial::begin(long baud) {
+	bt_byte_us = 10e6 / baud;
+}
+
+size_t SoftwareSerial::write(uint8_t b) {
+	now_us += bt_byte_us;
+	bt_out.push_back(b);
+	return 1;
+}
+
+void TwoWire::begin() {
+}
+
+void TwoWire::begin(uint8_t address) {
+}
+
+void TwoWire::setClock(uint32_t hz) {
+	i2c_bit_us = 1e6 / hz;
+}
+
+/* Sensors always answer in time, the flag is never set */
+void TwoWire::setWireTimeout(uint32_t timeout_us, bool reset) {
+}
+
+bool TwoWire::getWireTimeoutFlag() {
+	return false;
+}
+
+void TwoWire::clearWireTimeoutFlag() {
+}
+
+void TwoWire::beginTransmission(int address) {
+	address_ = address;
+	tx_.clear();
+}
+
+size_t TwoWire::write(uint8_t b) {
+	tx_.push_back(b);
+	return 1;
+}
+
+/* 0 if the address was acknowledged, 2 if not, as the Wire library returns */
+uint8_t TwoWire::endTransmission(bool stop) {
+	int sensor = sensor_at(address_);
+
+	if (sensor < 0) {
+		i2c_transfer(0, true);
+		tx_.clear();
+		return 2;
+	}
+	i2c_transfer(tx_.size(), stop);
+	if (!tx_.empty()) {
+		reg_ = tx_[0];
+	}
+	tx_.clear();
+	return 0;
+}
+
+uint8_t TwoWire::requestFrom(int address, int count, bool stop) {
+	int sensor = sensor_at(address);
+
+	rx_.clear();
+	rx_pos_ = 0;
+	if (sensor < 0) {
+		i2c_transfer(0, true);
+		return 0;
+	}
+
+	uint8_t regs[128] = {};
+
+	if (reg_ == MPU6050_RA_ACCEL_XOUT_H && config.sample) {
+		int16_t values[6];
+
+		config.sample(sensor, reads[sensor]++, values);
+		for (int a = 0; a < 6; a++) {
+			// Registers are big-endian AX AY AZ TEMP GX GY GZ, the temperature reads as 0
+			int r = MPU6050_RA_ACCEL_XOUT_H + ((a < 3) ? 2 * a : 2 * a + 2);
+
+			regs[r] = (uint8_t) ((uint16_t) values[a] >> 8);
+			regs[r + 1] = (uint8_t) values[a];
+		}
+	}
+	regs[MPU6050_RA_WHO_AM_I] = MPU6050_DEFAULT_ADDRESS;
+	for (int i = 0; i < count; i++) {
+		rx_.push_back(regs[(reg_ + i) & 0x7F]);
+	}
+	reg_ += count;
+	i2c_transfer(count, stop);
+	return (uint8_t) count;
+}
+
+int TwoWire::available() {
+	return (int) (rx_.size() - rx_pos_);
+}
+
+int TwoWire::read() {
+	return rx_pos_ < rx_.size() ? rx_[rx_pos_++] : -1;
+}
+
+/* Wakes the sensor up, like I2Cdevlib's initialize() (clock source, ranges, sleep) */
+void MPU6050::initialize() {
+	for (int i = 0; i < 4; i++) {
+		Wire.beginTransmission(address_);
+		Wire.write(MPU6050_RA_PWR_MGMT_1);
+		Wire.endTransmission(false);
+		Wire.requestFrom(address_, 1);
+		Wire.beginTransmission(address_);
+		Wire.write(MPU6050_RA_PWR_MGMT_1);
+		Wire.write(0);
+		Wire.endTransmission();
+	}
+}
+
+bool MPU6050::testConnection() {
+	Wire.beginTransmission(address_);
+	Wire.write(MPU6050_RA_WHO_AM_I);
+	if (Wire.endTransmission(false) != 0 || Wire.requestFrom(address_, 1) != 1) {
+		return false;
+	}
+	return Wire.read() == MPU6050_DEFAULT_ADDRESS;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file        arduino_mock.h
+ * @brief       Simulated board behind the host stand-ins for the Arduino core (host/arduino)
+ * @details     An Arduino Uno at 16 MHz with MPU6050s on the I2C bus, each selected by its AD0
+ *              pin: a sensor answers at 0x69 while its pin is high and at 0x68 otherwise. Reading
+ *              the data registers of a sensor returns its next sample from a callback. Time is
+ *              simulated, and the calls the sketch makes cost what they take on the board:
+ *
+ *                I2C       9 clocks per byte plus start and stop at the bus clock, and the
+ *                          library's overhead per transfer
+ *                Serial    the bytes leave at the baud rate, writes wait while the 64-byte
+ *                          transmit buffer is full
+ *                BT        SoftwareSerial sends with interrupts off, a write takes the whole byte
+ *                pins      digitalWrite(), and reading the clock with micros()
+ *                print     converting a number to text
+ *
+ *              Code in between (the sketch's own arithmetic) costs nothing unless the caller adds
+ *              it with mock_spend().
+ */
+
+#ifndef __ARDUINO_MOCK_H__
+#define __ARDUINO_MOCK_H__
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#define MOCK_I2C_CALL_US 10         // Wire library overhead per transfer
+#define MOCK_DIGITAL_WRITE_US 5
+#define MOCK_MICROS_US 1
+#define MOCK_SERIAL_WRITE_US 2      // HardwareSerial::write() when the buffer has room
+#define MOCK_PRINT_NUMBER_US 40     // Print::print() of an integer, division by 10 per digit
+#define MOCK_SERIAL_BUFFER 64
+
+/* Sample of sensor s for its n-th read of the data registers: AX AY AZ GX GY GZ */
+typedef std::function<void(int sensor, uint64_t n, int16_t values[6])> MockSampleFn;
+
+struct MockConfig {
+	std::vector<int> ad0_pins;      // pin of each sensor
+	uint32_t connected = ~0u;       // mask of the sensors that answer
+	MockSampleFn sample;
+};
+
+/* Start over at time 0 with these sensors and nothing sent */
+void mock_reset(const MockConfig &config);
+
+/* Simulated time */
+uint64_t mock_now_us();
+
+/* Add time spent in code the mock doesn't see */
+void mock_spend(double us);
+
+/* Bytes sent on Serial and on the SoftwareSerial port so far */
+const std::vector<uint8_t> &mock_serial_out();
+const std::vector<uint8_t> &mock_bt_out();
+
+/* Time the Serial transmitter was busy */
+double mock_serial_busy_us();
+
+#endif // __ARDUINO_MOCK_H__
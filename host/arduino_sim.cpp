@@ -0,0 +1,222 @@
+/**
+ * @file        arduino_sim.cpp
+ * @brief       Frame rate of the data-collection sketch in text and in binary mode
+ * @details     Runs ArduinoCode/FullBodyTracking2.ino built both ways on the simulated board of
+ *              arduino_mock.h, with the sensors serving the recordings' samples in order, and
+ *              prints the frames per second each mode gets through and how busy Serial was. The
+ *              binary frames are decoded as imu_receive does and checked against the samples the
+ *              sensors gave out. With -o they are also written as a log, which is read back with
+ *              load_log() and compared. The timing is a model of the board, see arduino_mock.h;
+ *              it is meant for comparing the modes, not as a measurement. Exits nonzero if a
+ *              frame doesn't come back exactly.
+ *
+ *              usage: arduino_sim [-s seconds] [-m mask] [-l label] [-o OUT] LOG...
+ *
+ *              -s  simulated time per mode, default 10 s
+ *              -m  mask of the connected sensors, default all
+ *              -l  class marker on top of the log written with -o
+ *              -o  write the binary frames as a log (.imz for an archive)
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "arduino_mock.h"
+#include "collect.h"
+#include "preprocess.h"
+#include "recording.h"
+
+#define DEFAULT_SECONDS 10
+
+/* Packing a frame and its checksum, about 1600 AVR cycles at 16 MHz */
+#define BINARY_LOOP_US 100
+
+/* The sketch's AD0 pins */
+static const std::vector<int> ad0_pins = {4, 5, 6, 7, 8, 9};
+
+namespace sketch_text {
+void setup();
+void loop();
+}
+
+namespace sketch_binary {
+void setup();
+void loop();
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [-s seconds] [-m mask] [-l label] [-o OUT] LOG...\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+/* Samples of all recordings, frame after frame */
+static std::vector<uint16_t> samples;
+
+static size_t sample_frames() {
+	return samples.size() / PREPROCESS_CHANNELS;
+}
+
+static void sample(int sensor, uint64_t n, int16_t values[COLLECT_AXES]) {
+	const uint16_t *frame = samples.data() + (n % sample_frames()) * PREPROCESS_CHANNELS;
+
+	for (int a = 0; a < COLLECT_AXES; a++) {
+		values[a] = (int16_t) frame[sensor * COLLECT_AXES + a];
+	}
+}
+
+/* Run a sketch for this long, spending loop_us on top of every loop() */
+static void run(void (*setup)(), void (*loop)(), double seconds, double loop_us, uint32_t mask) {
+	MockConfig config;
+
+	config.ad0_pins = ad0_pins;
+	config.connected = mask;
+	config.sample = sample;
+	mock_reset(config);
+	setup();
+	while (mock_now_us() < seconds * 1e6) {
+		loop();
+		mock_spend(loop_us);
+	}
+}
+
+/* Whether a decoded frame holds the samples the sensors gave out for it */
+static bool frame_matches(const CollectFrame &frame, uint64_t n, uint32_t mask) {
+	if (frame.mask != (mask & ((1u << COLLECT_SENSORS) - 1))) {
+		return false;
+	}
+	for (int s = 0; s < COLLECT_SENSORS; s++) {
+		int16_t values[COLLECT_AXES] = {};
+
+		if (frame.mask >> s & 1) {
+			sample(s, n, values);
+		}
+		if (memcmp(values, frame.values[s], sizeof(values))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char **argv) {
+	double seconds = DEFAULT_SECONDS;
+	uint32_t mask = (1u << COLLECT_SENSORS) - 1;
+	std::string label;
+	std::string out;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:m:l:o:")) != -1) {
+		switch (opt) {
+		case 's':
+			seconds = atof(optarg);
+			break;
+		case 'm':
+			mask = (uint32_t) strtoul(optarg, nullptr, 0);
+			break;
+		case 'l':
+			label = optarg;
+			break;
+		case 'o':
+			out = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind >= argc || seconds <= 0) {
+		usage(argv[0]);
+	}
+
+	try {
+		std::vector<std::string> paths(argv + optind, argv + argc);
+
+		for (const Recording &recording : load_logs(paths)) {
+			samples.insert(samples.end(), recording.raw.begin(), recording.raw.end());
+		}
+		if (samples.empty()) {
+			throw std::runtime_error("no frames in the logs");
+		}
+	} catch (const std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+	printf("%zu frames of samples, %.0f s simulated per mode, sensors 0x%02x\n", sample_frames(),
+			seconds, mask);
+
+	// Text mode: a frame is done with the line of the last sensor
+	run(sketch_text::setup, sketch_text::loop, seconds, 0, mask);
+
+	std::string text(mock_serial_out().begin(), mock_serial_out().end());
+	long text_frames = 0;
+
+	for (size_t pos = 0; (pos = text.find("\n5: ", pos)) != std::string::npos; pos++) {
+		text_frames++;
+	}
+	printf("text:   %8ld frames %8.1f frames/s  Serial %3.0f%% busy  %zu bytes, %zu on BT\n",
+			text_frames, text_frames / seconds, 100 * mock_serial_busy_us() / (seconds * 1e6),
+			mock_serial_out().size(), mock_bt_out().size());
+
+	// Binary mode, decoded the way imu_receive does
+	run(sketch_binary::setup, sketch_binary::loop, seconds, BINARY_LOOP_US, mask);
+
+	CollectDecoder decoder;
+	std::vector<CollectFrame> frames;
+	long wrong = 0;
+
+	decoder.push(mock_serial_out().data(), mock_serial_out().size(), frames);
+	for (size_t n = 0; n < frames.size(); n++) {
+		wrong += !frame_matches(frames[n], n, mask);
+	}
+	double span = frames.size() > 1 ? (frames.back().micros - frames.front().micros) / 1e6 : seconds;
+
+	printf("binary: %8zu frames %8.1f frames/s  Serial %3.0f%% busy  %zu bytes, %ld skipped, "
+			"%ld bad, %ld lost, %ld wrong\n", frames.size(), (frames.size() - 1) / span,
+			100 * mock_serial_busy_us() / (seconds * 1e6), mock_serial_out().size(),
+			decoder.skipped_bytes, decoder.bad_checksums, decoder.lost_frames, wrong);
+	if (text_frames > 0) {
+		printf("binary is %.1fx the frame rate of text\n", (frames.size() - 1) / span
+				/ (text_frames / seconds));
+	}
+
+	if (!out.empty()) {
+		try {
+			collect_write_log(out, frames, label);
+
+			std::vector<Recording> recordings = load_log(out);
+			std::vector<size_t> complete;
+			size_t read = 0;
+
+			// Frames with a sensor missing are left out of the log
+			for (size_t n = 0; n < frames.size(); n++) {
+				if (frames[n].mask == (1 << COLLECT_SENSORS) - 1) {
+					complete.push_back(n);
+				}
+			}
+			for (const Recording &recording : recordings) {
+				for (size_t f = 0; f < recording.frames(); f++, read++) {
+					CollectFrame frame = {};
+
+					frame.mask = (1 << COLLECT_SENSORS) - 1;
+					for (int s = 0; s < COLLECT_SENSORS; s++) {
+						for (int a = 0; a < COLLECT_AXES; a++) {
+							frame.values[s][a] = (int16_t) recording.frame(f)[s * COLLECT_AXES + a];
+						}
+					}
+					wrong += read >= complete.size() || !frame_matches(frame, complete[read], mask);
+				}
+			}
+			wrong += read != complete.size();
+			printf("%s: %zu recordings, %zu of %zu frames read back, %s\n", out.c_str(),
+					recordings.size(), read, complete.size(),
+					read == complete.size() ? "same" : "DIFFERENT");
+		} catch (const std::exception &e) {
+			fprintf(stderr, "%s\n", e.what());
+			return EXIT_FAILURE;
+		}
+	}
+	return wrong ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,15 @@
+/**
+ * @file        arduino_sketch.cpp
+ * @brief       The data-collection sketch (ArduinoCode/FullBodyTracking2.ino) built for the host
+ * @details     Compiled once per mode by the Makefile, with BINARY_MODE set and SKETCH naming the
+ *              namespace its setup() and loop() end up in, so arduino_sim can run both.
+ */
+
+#include "Arduino.h"
+#include "MPU6050.h"
+#include "SoftwareSerial.h"
+#include "Wire.h"
+
+namespace SKETCH {
+#include "../ArduinoCode/FullBodyTracking2.ino"
+}
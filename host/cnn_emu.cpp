@@ -0,0 +1,568 @@
+/**
+ * @file        cnn_emu.cpp
+ * @brief       Register-level emulator of the MAX78000 CNN accelerator for the generated cnn.c
+ * @details     Also implements the MSDK functions declared in msdk/mxc.h, which is what lets the
+ *              generated code link on the host.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+
+#include "cnn_emu.h"
+#include "mxc.h"
+
+/* Everything the accelerator decodes, AON control up to the data memory of quadrant 3 */
+#define MEM_BASE 0x50000000
+#define MEM_SIZE 0x01020000
+
+#define NUM_QUADS 4
+#define PROCS_PER_QUAD 16
+#define NUM_PROCS (NUM_QUADS * PROCS_PER_QUAD)
+#define MAX_LAYERS 32
+
+/* Quadrant register files, bias memory follows each register file */
+#define QUAD_BASE 0x50100000
+#define QUAD_STRIDE 0x400000
+#define BIAS_OFFSET 0x8000
+#define BIAS_WORDS 512
+
+/* Kernel memory of each processor, kernels are packed 9 bytes each, MSB first in every word */
+#define KERNEL_BASE 0x50180000
+#define KERNEL_PROC_STRIDE 0x4000
+
+/* Data memory, one instance per group of four processors, byte p % 4 belongs to processor p */
+#define DATA_BASE 0x50400000
+#define DATA_GROUP_STRIDE 0x8000
+#define DATA_GROUP_WORDS 0x2000
+
+/* Quadrant registers, the per-layer ones are followed by one word for each further layer */
+#define REG_CTRL 0x000
+#define REG_LCNT 0x008
+#define REG_RCNT 0x010          // [17:16] pad, [9:0] rows + 2 * pad - 1
+#define REG_CCNT 0x090          // same for columns
+#define REG_ONED 0x110          // bit 8: 1D layer
+#define REG_PRCNT 0x190         // pooling rows - 1
+#define REG_PCCNT 0x210         // pooling columns - 1
+#define REG_STRIDE 0x290        // stride - 1
+#define REG_WPTR_BASE 0x310     // [16:13] processor group of output channel 0, [12:0] word offset
+#define REG_WPTR_TOFFS 0x390    // time slot offset
+#define REG_WPTR_MOFFS 0x410    // words between processor groups
+#define REG_RPTR_BASE 0x510     // [12:0] word offset
+#define REG_LCTRL0 0x590
+#define REG_MCNT 0x610          // [31:16] first, [15:0] last kernel times 8 (bit address in 1D)
+#define REG_ENABLE 0x710        // [31:16] kernel masks, [15:0] processors
+#define REG_POST 0x790
+#define REG_LCTRL1 0xa10        // [14:11] output channels - 1, [3:0] passes - 1
+
+#define CTRL_ENABLE (1u << 0)
+#define CTRL_DONE (1u << 12)
+
+#define ONED_ENABLE (1u << 8)
+
+#define LCTRL0_POOL (1u << 7)
+#define LCTRL0_MAXPOOL (1u << 8)
+#define LCTRL0_RELU (1u << 9)
+
+#define POST_BIAS_PTR 0x1ffu
+#define POST_BIAS (1u << 12)
+#define POST_SHIFT_SHIFT 13
+#define POST_SHIFT_MASK 0xfu
+#define POST_SHIFT_RIGHT (1u << 17)
+#define POST_TRANSPOSED (1u << 28)
+
+/* Register bits the decoder understands, anything else set is rejected */
+#define RCNT_KNOWN 0x000303ffu
+#define LCTRL0_KNOWN 0x0000fba0u   // [15:12] and bits 11, 5 are left to the state machine
+#define LCTRL1_KNOWN 0x0000780fu
+#define POST_KNOWN 0x1003f1ffu
+
+mxc_gcr_regs_t host_gcr;
+mxc_gcfr_regs_t host_gcfr;
+
+static bool cnn_clock;
+static void (*cnn_isr)(void);
+static bool mapped;
+static unsigned long runs;
+
+void MXC_SYS_ClockEnable(mxc_sys_periph_clock_t clock) {
+	if (clock == MXC_SYS_PERIPH_CLOCK_CNN) {
+		cnn_clock = true;
+	}
+}
+
+void MXC_SYS_ClockDisable(mxc_sys_periph_clock_t clock) {
+	if (clock == MXC_SYS_PERIPH_CLOCK_CNN) {
+		cnn_clock = false;
+	}
+}
+
+void MXC_NVIC_SetVector(IRQn_Type irq, void (*handler)(void)) {
+	if (irq == CNN_IRQn) {
+		cnn_isr = handler;
+	}
+}
+
+void MXC_LP_EnterSleepMode(void) {
+	if (!cnn_emu_poll()) {
+		throw std::runtime_error("sleeping while the accelerator is idle, the CNN interrupt "
+				"would never come");
+	}
+}
+
+int MXC_GPIO_Config(const mxc_gpio_cfg_t*) {
+	return 0;
+}
+
+void MXC_GPIO_OutSet(mxc_gpio_regs_t *port, uint32_t mask) {
+	port->out |= mask;
+}
+
+void MXC_GPIO_OutClr(mxc_gpio_regs_t *port, uint32_t mask) {
+	port->out &= ~mask;
+}
+
+void cnn_emu_map() {
+	if (mapped) {
+		return;
+	}
+
+	void *mem = mmap((void*) (uintptr_t) MEM_BASE, MEM_SIZE, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+	// Kernels older than 4.17 ignore MAP_FIXED_NOREPLACE and may place the mapping elsewhere
+	if (mem == MAP_FAILED || mem != (void*) (uintptr_t) MEM_BASE) {
+		int error = errno;
+
+		if (mem != MAP_FAILED) {
+			munmap(mem, MEM_SIZE);
+		}
+		throw std::runtime_error(std::string("cannot map the accelerator at 0x50000000: ")
+				+ ((mem == MAP_FAILED) ? strerror(error) : "address in use"));
+	}
+	mapped = true;
+}
+
+unsigned long cnn_emu_runs() {
+	return runs;
+}
+
+static inline volatile uint32_t &reg(int quad, uint32_t offset) {
+	return *(volatile uint32_t*) (uintptr_t) (QUAD_BASE + quad * QUAD_STRIDE + offset);
+}
+
+static inline int8_t bias_byte(int quad, int index) {
+	return (int8_t) reg(quad, BIAS_OFFSET + 4 * index);
+}
+
+static inline int8_t kernel_byte(int proc, uint32_t index) {
+	const uint32_t *mem = (const uint32_t*) (uintptr_t) (KERNEL_BASE
+			+ (proc / PROCS_PER_QUAD) * QUAD_STRIDE + (proc % PROCS_PER_QUAD) * KERNEL_PROC_STRIDE);
+
+	return (int8_t) (mem[index / 4] >> (8 * (3 - index % 4)));
+}
+
+static inline int8_t *data_byte(int proc, uint32_t word) {
+	return (int8_t*) (uintptr_t) (DATA_BASE + (proc / PROCS_PER_QUAD) * QUAD_STRIDE
+			+ (proc % PROCS_PER_QUAD) / 4 * DATA_GROUP_STRIDE + 4 * word + proc % 4);
+}
+
+static void fail(int layer, const char *fmt, ...) {
+	char msg[160];
+	int n = snprintf(msg, sizeof(msg), "layer %d: ", layer);
+	va_list args;
+
+	va_start(args, fmt);
+	vsnprintf(msg + n, sizeof(msg) - n, fmt, args);
+	va_end(args);
+	throw std::runtime_error(msg);
+}
+
+/*
+ * A per-layer register whose shared bits all quadrants must agree on. Bits outside of known
+ * aren't modeled and rejected in any quadrant. Returns quadrant 0's shared bits.
+ */
+static uint32_t shared_reg(int layer, uint32_t offset, uint32_t shared, uint32_t known,
+		const char *name) {
+	uint32_t value = reg(0, offset + 4 * layer);
+
+	for (int q = 0; q < NUM_QUADS; q++) {
+		uint32_t other = reg(q, offset + 4 * layer);
+
+		if ((other & shared) != (value & shared)) {
+			fail(layer, "quadrants disagree on the %s register", name);
+		}
+		if (other & ~known) {
+			fail(layer, "unmodeled bits set in the %s register of quadrant %d: 0x%08x", name, q,
+					(unsigned) other);
+		}
+	}
+	return value & shared;
+}
+
+static uint32_t shared_reg(int layer, uint32_t offset, uint32_t known, const char *name) {
+	return shared_reg(layer, offset, known, known, name);
+}
+
+std::string CnnEmuLayer::describe() const {
+	char buf[160];
+
+	if (linear) {
+		snprintf(buf, sizeof(buf), "%dx%d flattened, linear%s -> %d", in_channels, passes,
+				relu ? ", ReLU" : "", out_channels);
+	} else {
+		char pooling[48] = "";
+
+		if (pool > 1) {
+			snprintf(pooling, sizeof(pooling), ", max pool %dx%d", pool, pool);
+		}
+		snprintf(buf, sizeof(buf), "%dx%dx%d%s, %s 3x3 pad %d%s -> %dx%dx%d", in_channels, rows,
+				cols, pooling, transposed ? "convtranspose" : "conv", pad, relu ? ", ReLU" : "",
+				out_channels, out_rows, out_cols);
+	}
+	return buf;
+}
+
+static CnnEmuLayer decode_layer(int l) {
+	CnnEmuLayer layer = CnnEmuLayer();
+	uint32_t rcnt = shared_reg(l, REG_RCNT, RCNT_KNOWN, "rows");
+	uint32_t ccnt = shared_reg(l, REG_CCNT, RCNT_KNOWN, "columns");
+	uint32_t lctrl0 = shared_reg(l, REG_LCTRL0, LCTRL0_POOL | LCTRL0_MAXPOOL | LCTRL0_RELU,
+			LCTRL0_KNOWN, "layer control");
+	uint32_t lctrl1 = shared_reg(l, REG_LCTRL1, LCTRL1_KNOWN, "layer control 2");
+	uint32_t mcnt = shared_reg(l, REG_MCNT, 0xffffffff, "mask count");
+	uint32_t wptr = shared_reg(l, REG_WPTR_BASE, 0x1ffff, "write pointer");
+	uint32_t toffs = shared_reg(l, REG_WPTR_TOFFS, 0xffff, "write pointer time slot offset");
+	uint32_t moffs = shared_reg(l, REG_WPTR_MOFFS, 0xffff, "write pointer mask offset");
+	uint32_t rptr = shared_reg(l, REG_RPTR_BASE, 0x1fff, "read pointer");
+	uint32_t post = shared_reg(l, REG_POST, POST_KNOWN & ~(POST_BIAS | POST_BIAS_PTR),
+			POST_KNOWN, "post processing");
+
+	layer.linear = (shared_reg(l, REG_ONED, ONED_ENABLE, "1D") & ONED_ENABLE) != 0;
+	layer.transposed = (post & POST_TRANSPOSED) != 0;
+	layer.relu = (lctrl0 & LCTRL0_RELU) != 0;
+	layer.passes = (lctrl1 & 0xf) + 1;
+	layer.out_channels = ((lctrl1 >> 11) & 0xf) + 1;
+	layer.pad = (rcnt >> 16) & 3;
+
+	int shift = (post >> POST_SHIFT_SHIFT) & POST_SHIFT_MASK;
+	layer.shift = (post & POST_SHIFT_RIGHT) ? shift : -shift;
+
+	if (((ccnt >> 16) & 3) != (uint32_t) layer.pad) {
+		fail(l, "different row and column padding");
+	}
+	if (moffs != DATA_GROUP_WORDS) {
+		fail(l, "write pointer mask offset 0x%x, only consecutive processor groups are modeled",
+				(unsigned) moffs);
+	}
+	if (toffs != 0 && !layer.linear) {
+		fail(l, "output spread over time slots is not modeled");
+	}
+
+	// Pooling, applied to the input before the convolution
+	layer.pool = 1;
+	if (lctrl0 & LCTRL0_POOL) {
+		uint32_t prows = shared_reg(l, REG_PRCNT, 0xf, "pooling rows") + 1;
+		uint32_t pcols = shared_reg(l, REG_PCCNT, 0xf, "pooling columns") + 1;
+		uint32_t stride = shared_reg(l, REG_STRIDE, 0xf, "stride") + 1;
+
+		if (!(lctrl0 & LCTRL0_MAXPOOL)) {
+			fail(l, "average pooling is not modeled");
+		}
+		if (prows != pcols || stride != prows) {
+			fail(l, "only square pooling with a stride of the pool size is modeled");
+		}
+		layer.pool = prows;
+	} else if (shared_reg(l, REG_STRIDE, 0xf, "stride") != 0) {
+		fail(l, "strided convolutions are not modeled");
+	}
+
+	// Geometry: the counts cover the padded image the state machine walks
+	int size_rows = (int) (rcnt & 0x3ff) + 1 - 2 * layer.pad;
+	int size_cols = (int) (ccnt & 0x3ff) + 1 - 2 * layer.pad;
+
+	if (layer.linear) {
+		if (size_rows != 1 || size_cols != 1 || layer.pool != 1 || layer.transposed) {
+			fail(l, "1D layers are modeled without pooling on a flattened 1x1 input");
+		}
+		if (layer.passes != 9) {
+			fail(l, "1D layer over %u positions, only flattened 3x3 inputs are modeled",
+					(unsigned) layer.passes);
+		}
+		layer.rows = layer.cols = 1;
+		layer.out_rows = layer.out_cols = 1;
+	} else {
+		if (layer.passes != 1) {
+			fail(l, "multi-pass layers are not modeled");
+		}
+		if (layer.transposed) {
+			// The counts give the upsampled image, the input holds every other pixel of it
+			if (layer.pool != 1 || size_rows % 2 || size_cols % 2) {
+				fail(l, "transposed convolution needs an even size and no pooling");
+			}
+			layer.rows = size_rows / 2;
+			layer.cols = size_cols / 2;
+			layer.out_rows = size_rows + 2 * layer.pad - 2;
+			layer.out_cols = size_cols + 2 * layer.pad - 2;
+		} else {
+			if (size_rows % layer.pool || size_cols % layer.pool) {
+				fail(l, "input size not a multiple of the pool size");
+			}
+			layer.rows = size_rows;
+			layer.cols = size_cols;
+			layer.out_rows = size_rows / layer.pool + 2 * layer.pad - 2;
+			layer.out_cols = size_cols / layer.pool + 2 * layer.pad - 2;
+		}
+		if (layer.out_rows <= 0 || layer.out_cols <= 0) {
+			fail(l, "empty output");
+		}
+	}
+
+	// Input channels: one per enabled processor, kernels in the same processor
+	for (int q = 0; q < NUM_QUADS; q++) {
+		uint32_t enable = reg(q, REG_ENABLE + 4 * l);
+
+		if ((enable >> 16) != (enable & 0xffff)) {
+			fail(l, "kernel masks differ from the processor enables: 0x%08x", (unsigned) enable);
+		}
+		for (int p = 0; p < PROCS_PER_QUAD; p++) {
+			if (enable & (1u << p)) {
+				layer.procs.push_back(q * PROCS_PER_QUAD + p);
+			}
+		}
+	}
+	layer.in_channels = (int) layer.procs.size();
+	if (layer.in_channels == 0) {
+		fail(l, "no processors enabled");
+	}
+
+	layer.kernel_start = (int) (mcnt >> 16) / 8;
+	int kernel_end = (int) (mcnt & 0xffff) / 8;
+
+	if (layer.linear) {
+		if (kernel_end - layer.kernel_start + 1 != layer.out_channels * 9) {
+			fail(l, "mask count doesn't cover 9 bytes per output: 0x%08x", (unsigned) mcnt);
+		}
+	} else if (kernel_end - layer.kernel_start + 1 != layer.out_channels) {
+		fail(l, "mask count doesn't cover one kernel per output: 0x%08x", (unsigned) mcnt);
+	}
+	if ((kernel_end + 1) * 9 > KERNEL_PROC_STRIDE) {
+		fail(l, "mask count beyond kernel memory: 0x%08x", (unsigned) mcnt);
+	}
+
+	// Bias: at most one quadrant holds it
+	layer.bias_quad = -1;
+	for (int q = 0; q < NUM_QUADS; q++) {
+		uint32_t value = reg(q, REG_POST + 4 * l);
+
+		if (value & POST_BIAS) {
+			if (layer.bias_quad >= 0) {
+				fail(l, "bias enabled in more than one quadrant");
+			}
+			layer.bias_quad = q;
+			layer.bias_offset = (int) (value & POST_BIAS_PTR);
+		}
+	}
+	if (layer.bias_quad >= 0 && layer.bias_offset + layer.out_channels > BIAS_WORDS) {
+		fail(l, "bias pointer beyond bias memory");
+	}
+
+	// Output channel o goes to the processor after the one of channel o - 1
+	layer.read_offset = rptr;
+	layer.write_offset = wptr & 0x1fff;
+	layer.write_proc = (int) ((wptr >> 13) & 0xf) * 4;
+
+	int in_words = layer.linear ? layer.passes : layer.rows * layer.cols;
+	int out_words = layer.out_rows * layer.out_cols;
+
+	if (layer.write_proc + layer.out_channels > NUM_PROCS) {
+		fail(l, "output channels beyond the last processor");
+	}
+	if (layer.read_offset + in_words > DATA_GROUP_WORDS
+			|| layer.write_offset + out_words > DATA_GROUP_WORDS) {
+		fail(l, "data beyond the end of data memory");
+	}
+
+	// Work, counted the way the cnn.h summary counts it
+	int taps = layer.linear ? layer.passes : 9;
+	int pooled = layer.rows / layer.pool * (layer.cols / layer.pool);
+
+	layer.macs = (long) layer.out_channels * layer.in_channels * taps * out_words;
+	layer.comps = (layer.relu ? (long) layer.out_channels * out_words : 0)
+			+ ((layer.pool > 1) ? (long) layer.in_channels * pooled * layer.pool * layer.pool : 0);
+	layer.cycles = (long) ((rcnt & 0x3ff) + 1) * ((ccnt & 0x3ff) + 1) * layer.passes;
+
+	return layer;
+}
+
+std::vector<CnnEmuLayer> cnn_emu_layers() {
+	std::vector<CnnEmuLayer> layers;
+	uint32_t last = reg(0, REG_LCNT);
+
+	for (int q = 1; q < NUM_QUADS; q++) {
+		if (reg(q, REG_LCNT) != last) {
+			throw std::runtime_error("quadrants disagree on the layer count");
+		}
+	}
+	if (last >= MAX_LAYERS) {
+		throw std::runtime_error("layer count beyond the last layer");
+	}
+	for (uint32_t l = 0; l <= last; l++) {
+		layers.push_back(decode_layer((int) l));
+	}
+	return layers;
+}
+
+static inline int8_t requantize(int32_t acc, int shift, bool relu) {
+	int sh = 7 + shift;
+	int32_t v = (sh > 0) ? (acc + (1 << (sh - 1))) >> sh : acc << -sh;
+
+	return (int8_t) std::min(127, std::max(relu ? 0 : -128, v));
+}
+
+static void run_layer(const CnnEmuLayer &layer) {
+	int n = layer.in_channels;
+	int h = layer.rows;
+	int w = layer.cols;
+	std::vector<int8_t> x;
+	std::vector<int8_t> y(layer.out_channels * layer.out_rows * layer.out_cols);
+
+	if (layer.linear) {
+		for (int o = 0; o < layer.out_channels; o++) {
+			int32_t acc = (layer.bias_quad >= 0)
+					? bias_byte(layer.bias_quad, layer.bias_offset + o) * 128 : 0;
+
+			// Each 9-byte kernel holds the weights of the flattened positions in reverse
+			for (int c = 0; c < n; c++) {
+				for (int k = 0; k < layer.passes; k++) {
+					acc += kernel_byte(layer.procs[c], layer.kernel_start + o * 9 + 8 - k)
+							* *data_byte(layer.procs[c], layer.read_offset + k);
+				}
+			}
+			y[o] = requantize(acc, layer.shift, layer.relu);
+		}
+	} else {
+		x.resize(n * h * w);
+		for (int c = 0; c < n; c++) {
+			for (int i = 0; i < h * w; i++) {
+				x[c * h * w + i] = *data_byte(layer.procs[c], layer.read_offset + i);
+			}
+		}
+
+		if (layer.pool > 1) {
+			int ph = h / layer.pool;
+			int pw = w / layer.pool;
+			std::vector<int8_t> pooled(n * ph * pw, -128);
+
+			for (int c = 0; c < n; c++) {
+				for (int i = 0; i < h; i++) {
+					for (int j = 0; j < w; j++) {
+						int8_t &m = pooled[(c * ph + i / layer.pool) * pw + j / layer.pool];
+						m = std::max(m, x[(c * h + i) * w + j]);
+					}
+				}
+			}
+			x.swap(pooled);
+			h = ph;
+			w = pw;
+		}
+
+		if (layer.transposed) {
+			std::vector<int8_t> up(n * 4 * h * w);
+
+			for (int c = 0; c < n; c++) {
+				for (int i = 0; i < h; i++) {
+					for (int j = 0; j < w; j++) {
+						up[(c * 2 * h + 2 * i) * 2 * w + 2 * j] = x[(c * h + i) * w + j];
+					}
+				}
+			}
+			x.swap(up);
+			h *= 2;
+			w *= 2;
+		}
+
+		std::vector<int8_t> kernel(n * 9);
+
+		for (int o = 0; o < layer.out_channels; o++) {
+			int32_t start = (layer.bias_quad >= 0)
+					? bias_byte(layer.bias_quad, layer.bias_offset + o) * 128 : 0;
+
+			for (int c = 0; c < n; c++) {
+				for (int k = 0; k < 9; k++) {
+					kernel[c * 9 + k] = kernel_byte(layer.procs[c], (layer.kernel_start + o) * 9 + k);
+				}
+			}
+
+			for (int i = 0; i < layer.out_rows; i++) {
+				for (int j = 0; j < layer.out_cols; j++) {
+					int32_t acc = start;
+
+					for (int c = 0; c < n; c++) {
+						for (int a = 0; a < 3; a++) {
+							int r = i + a - layer.pad;
+
+							if (r < 0 || r >= h) {
+								continue;
+							}
+							for (int b = 0; b < 3; b++) {
+								int s = j + b - layer.pad;
+
+								if (s >= 0 && s < w) {
+									acc += kernel[c * 9 + a * 3 + b] * x[(c * h + r) * w + s];
+								}
+							}
+						}
+					}
+					y[(o * layer.out_rows + i) * layer.out_cols + j] = requantize(acc, layer.shift,
+							layer.relu);
+				}
+			}
+		}
+	}
+
+	// Written only now, a layer may overwrite the memory it reads
+	int out_words = layer.out_rows * layer.out_cols;
+
+	for (int o = 0; o < layer.out_channels; o++) {
+		for (int i = 0; i < out_words; i++) {
+			*data_byte(layer.write_proc + o, layer.write_offset + i) = y[o * out_words + i];
+		}
+	}
+}
+
+bool cnn_emu_poll() {
+	uint32_t ctrl = reg(0, REG_CTRL);
+
+	if (!mapped || !(ctrl & CTRL_ENABLE) || (ctrl & CTRL_DONE)) {
+		return false;
+	}
+	if (!cnn_clock || host_gcfr.reg0 != 0xf || host_gcfr.reg2 != 0 || host_gcfr.reg3 != 0) {
+		throw std::runtime_error("accelerator started without power or clock, "
+				"cnn_enable() wasn't called");
+	}
+	for (int q = 1; q < NUM_QUADS; q++) {
+		if (!(reg(q, REG_CTRL) & CTRL_ENABLE)) {
+			throw std::runtime_error("master started before quadrant " + std::to_string(q)
+					+ " was enabled");
+		}
+	}
+
+	for (const CnnEmuLayer &layer : cnn_emu_layers()) {
+		run_layer(layer);
+	}
+	runs++;
+
+	for (int q = 0; q < NUM_QUADS; q++) {
+		reg(q, REG_CTRL) |= CTRL_DONE;
+	}
+	if (cnn_isr == NULL) {
+		throw std::runtime_error("no CNN interrupt handler, cnn_enable() wasn't called");
+	}
+	cnn_isr();
+	return true;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file        cnn_emu.h
+ * @brief       Register-level emulator of the MAX78000 CNN accelerator for the generated cnn.c
+ * @details     The register files, bias, kernel and data memories of the four quadrants are
+ *              mapped at their real addresses (0x5000_0000 ... 0x5101_ffff), so the volatile
+ *              writes of cnn_init(), cnn_load_weights(), cnn_load_bias(), cnn_configure() and the
+ *              firmware's load_input() land in host memory unchanged. When the firmware waits for
+ *              the CNN after cnn_start(), the layers are decoded from the registers it wrote and
+ *              executed, the results are written to data memory and the CNN_ISR registered by
+ *              cnn_enable() is called, as on the device.
+ *
+ *              The register fields are inferred from what ai8xize writes for this network and
+ *              checked against the bit-exact model in imu_net.cpp. Settings outside of that
+ *              (multiple passes, average pooling, strided convolutions, channels split across
+ *              time slots) are rejected instead of being guessed at.
+ */
+
+#ifndef __CNN_EMU_H__
+#define __CNN_EMU_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Clock the firmware runs the accelerator at: APB (50 MHz) div 1 */
+#define CNN_EMU_CLOCK_HZ 50000000
+
+/* One layer as decoded from the quadrant registers */
+struct CnnEmuLayer {
+	int in_channels;
+	int out_channels;
+	int rows;               // input size in data memory
+	int cols;
+	int pad;
+	int pool;               // max-pool size and stride, 1 = none
+	bool transposed;        // stride-2 transposed convolution, the count registers give the output size
+	bool relu;
+	bool linear;            // 1D layer over the flattened input, one pass per input position
+	int passes;
+	int shift;              // the accumulator is scaled down by 2^(7 + shift)
+	int kernel_start;       // first kernel, or first byte for 1D layers, in every processor
+	int bias_quad;          // -1 without bias
+	int bias_offset;
+	uint32_t read_offset;   // data memory words
+	uint32_t write_offset;
+	int write_proc;         // processor that receives output channel 0
+	std::vector<int> procs; // processor that holds input channel c and its kernels
+	int out_rows;
+	int out_cols;
+
+	// Work per run
+	long macs;
+	long comps;             // ReLU and max-pool comparisons, counted like the cnn.h summary
+	long cycles;            // estimate: one clock per padded input pixel and pass
+
+	std::string describe() const;
+};
+
+/* Map the accelerator's address space, throws std::runtime_error if the range is taken */
+void cnn_emu_map();
+
+/* Decode the configured layers, throws std::runtime_error for settings the emulator doesn't model */
+std::vector<CnnEmuLayer> cnn_emu_layers();
+
+/*
+ * Run the network and raise the CNN interrupt if cnn_start() enabled the master quadrant.
+ * Returns false if the accelerator wasn't started. Called by MXC_LP_EnterSleepMode().
+ */
+bool cnn_emu_poll();
+
+/* Networks run since cnn_emu_map() */
+unsigned long cnn_emu_runs();
+
+#endif // __CNN_EMU_H__
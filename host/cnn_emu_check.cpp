@@ -0,0 +1,217 @@
+/**
+ * @file        cnn_emu_check.cpp
+ * @brief       Runs the unmodified generated cnn.c on the accelerator emulator
+ * @details     Goes through the same calls main.c makes (cnn_enable, cnn_init, cnn_load_weights,
+ *              cnn_load_bias, cnn_configure, then load_input, cnn_start, sleep until the
+ *              interrupt and cnn_unload for every window) and checks the data memory against
+ *              sampleoutput.h, then every window of the recordings against the bit-exact host
+ *              model. Prints the layers decoded from the registers with their operation counts
+ *              and an estimate of the accelerator's clock cycles. Exits nonzero on any mismatch
+ *              or on register settings the emulator doesn't model, which is what to look for
+ *              after regenerating cnn.c. The recordings are calibrated first, as the device
+ *              calibrates its sensors, unless -u is given.
+ *
+ *              usage: cnn_emu_check [-s hop] [-u] [LOG...]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+#include "mxc.h"
+extern "C" {
+#include "cnn.h"
+}
+#include "classify.h"
+#include "cnn_emu.h"
+#include "imu_net.h"
+#include "preprocess.h"
+#include "recording.h"
+#include "sampledata.h"
+#include "sampleoutput.h"
+
+/* Defined by main.c on the device, set by CNN_ISR() */
+volatile uint32_t cnn_time;
+
+/* Where main.c's load_input() copies cnn_input0 ... cnn_input28 */
+static const uintptr_t input_addr[PREPROCESS_GROUPS] = { 0x50400000, 0x50408000, 0x50410000,
+		0x50418000, 0x50800000, 0x50808000, 0x50810000, 0x50818000 };
+
+/* One inference the way main.c runs it, returns the decoded logits */
+static void run_window(const uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS],
+		int8_t logits[CLASSIFY_CLASSES]) {
+	uint32_t ml_data[CLASSIFY_UNLOAD_WORDS];
+
+	for (int g = 0; g < PREPROCESS_GROUPS; g++) {
+		memcpy32((uint32_t*) input_addr[g], words[g], PREPROCESS_CHANNELS);
+	}
+	cnn_start();
+
+	while (cnn_time == 0)
+		MXC_LP_EnterSleepMode();
+
+	cnn_unload(ml_data);
+	classify_logits(ml_data, logits);
+}
+
+/* Compare data memory with SAMPLE_OUTPUT (address, mask, word count, words ...) */
+static bool check_sample_output() {
+	static const uint32_t sample_output[] = SAMPLE_OUTPUT;
+
+	for (const uint32_t *p = sample_output; *p != 0; p += 3 + p[2]) {
+		const volatile uint32_t *addr = (const volatile uint32_t*) (uintptr_t) p[0];
+
+		for (uint32_t i = 0; i < p[2]; i++) {
+			if ((addr[i] & p[1]) != p[3 + i]) {
+				fprintf(stderr, "sampleoutput.h: word 0x%08x: expected 0x%08x, got 0x%08x\n",
+						(unsigned) (p[0] + 4 * i), (unsigned) p[3 + i],
+						(unsigned) (addr[i] & p[1]));
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static bool check_window(const ImuNet &net, const uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS],
+		const char *what) {
+	int8_t expected[CLASSIFY_CLASSES];
+	int8_t logits[CLASSIFY_CLASSES];
+
+	net.infer(words, expected);
+	run_window(words, logits);
+
+	if (memcmp(expected, logits, sizeof(logits)) != 0) {
+		fprintf(stderr, "%s: emulator", what);
+		for (int c = 0; c < CLASSIFY_CLASSES; c++) {
+			fprintf(stderr, " %d", logits[c]);
+		}
+		fprintf(stderr, ", host model");
+		for (int c = 0; c < CLASSIFY_CLASSES; c++) {
+			fprintf(stderr, " %d", expected[c]);
+		}
+		fprintf(stderr, "\n");
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char **argv) {
+	long hop = 8;
+	bool calibrate = true;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:u")) != -1) {
+		switch (opt) {
+		case 's':
+			hop = atol(optarg);
+			break;
+		case 'u':
+			calibrate = false;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-s hop] [-u] [LOG...]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (hop <= 0) {
+		fprintf(stderr, "usage: %s [-s hop] [-u] [LOG...]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	try {
+		std::vector<Recording> recordings = load_logs(std::vector<std::string>(argv + optind,
+				argv + argc));
+		ImuNet net(NetKernels::Scalar);
+
+		if (calibrate) {
+			calibrate_recordings(recordings);
+		}
+
+		cnn_emu_map();
+
+		// Same bring-up as main.c
+		cnn_enable(MXC_S_GCR_PCLKDIV_CNNCLKSEL_PCLK, MXC_S_GCR_PCLKDIV_CNNCLKDIV_DIV1);
+		cnn_init();
+		cnn_load_weights();
+		cnn_load_bias();
+		cnn_configure();
+
+		std::vector<CnnEmuLayer> layers = cnn_emu_layers();
+		long macs = 0, comps = 0, cycles = 0;
+
+		printf("%-5s %-58s %10s %8s %8s\n", "layer", "configuration", "macc", "comp", "clocks");
+		for (size_t l = 0; l < layers.size(); l++) {
+			const CnnEmuLayer &layer = layers[l];
+
+			printf("%-5zu %-58s %10ld %8ld %8ld\n", l, layer.describe().c_str(), layer.macs,
+					layer.comps, layer.cycles);
+			macs += layer.macs;
+			comps += layer.comps;
+			cycles += layer.cycles;
+		}
+		printf("%-5s %-58s %10ld %8ld %8ld\n", "total", "", macs, comps, cycles);
+		printf("estimated %.1f us per inference at %d MHz, %ld macc per clock\n\n",
+				cycles * 1e6 / CNN_EMU_CLOCK_HZ, CNN_EMU_CLOCK_HZ / 1000000, macs / cycles);
+
+		if (macs != net.macs_per_window()) {
+			fprintf(stderr, "emulated layers do %ld macc, the host model %ld\n", macs,
+					net.macs_per_window());
+			return EXIT_FAILURE;
+		}
+
+		static const uint32_t input_0[] = SAMPLE_INPUT_0;
+		static const uint32_t input_4[] = SAMPLE_INPUT_4;
+		static const uint32_t input_8[] = SAMPLE_INPUT_8;
+		static const uint32_t input_12[] = SAMPLE_INPUT_12;
+		static const uint32_t input_16[] = SAMPLE_INPUT_16;
+		static const uint32_t input_20[] = SAMPLE_INPUT_20;
+		static const uint32_t input_24[] = SAMPLE_INPUT_24;
+		static const uint32_t input_28[] = SAMPLE_INPUT_28;
+		const uint32_t *inputs[PREPROCESS_GROUPS] = { input_0, input_4, input_8, input_12,
+				input_16, input_20, input_24, input_28 };
+		uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS];
+
+		for (int g = 0; g < PREPROCESS_GROUPS; g++) {
+			memcpy(words[g], inputs[g], sizeof(words[g]));
+		}
+		if (!check_window(net, words, "sample input") || !check_sample_output()) {
+			return EXIT_FAILURE;
+		}
+		printf("sampleoutput.h reproduced\n");
+
+		size_t windows = 0;
+		auto start = std::chrono::steady_clock::now();
+
+		for (const Recording &rec : recordings) {
+			std::vector<int8_t> values(rec.raw.size());
+
+			preprocess_recording(rec.raw.data(), rec.frames(), values.data());
+			for (size_t first = 0; first + PREPROCESS_WINDOW <= rec.frames(); first += hop) {
+				std::string what = rec.source + " frame " + std::to_string(first);
+
+				preprocess_pack_window(values.data() + first * PREPROCESS_CHANNELS, words);
+				if (!check_window(net, words, what.c_str())) {
+					return EXIT_FAILURE;
+				}
+				windows++;
+			}
+		}
+
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		if (windows > 0) {
+			printf("%zu recorded windows match the host model, %.0f emulated inferences/s\n",
+					windows, windows / elapsed.count());
+		}
+	} catch (const std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+/**
+ * @file        collect.cpp
+ * @brief       Binary frames of the data-collection sketch (ArduinoCode, BINARY_MODE 1)
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include "collect.h"
+#include "imu_archive.h"
+
+static uint16_t get16(const uint8_t *p) {
+	return (uint16_t) (p[0] | p[1] << 8);
+}
+
+static void put16(uint8_t *p, uint16_t v) {
+	p[0] = (uint8_t) v;
+	p[1] = (uint8_t) (v >> 8);
+}
+
+uint16_t collect_checksum(const uint8_t *data, size_t len) {
+	uint16_t sum1 = 0;
+	uint16_t sum2 = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		sum1 = (sum1 + data[i]) % 255;
+		sum2 = (sum2 + sum1) % 255;
+	}
+	return (uint16_t) (sum2 << 8 | sum1);
+}
+
+void collect_pack(const CollectFrame &frame, uint8_t out[COLLECT_FRAME_BYTES]) {
+	out[0] = COLLECT_SYNC0;
+	out[1] = COLLECT_SYNC1;
+	put16(out + 2, frame.sequence);
+	put16(out + 4, (uint16_t) frame.micros);
+	put16(out + 6, (uint16_t) (frame.micros >> 16));
+	out[8] = frame.mask;
+	out[9] = COLLECT_SENSORS;
+	for (int s = 0; s < COLLECT_SENSORS; s++) {
+		for (int a = 0; a < COLLECT_AXES; a++) {
+			put16(out + 10 + 2 * (s * COLLECT_AXES + a), (uint16_t) frame.values[s][a]);
+		}
+	}
+	put16(out + COLLECT_FRAME_BYTES - 2, collect_checksum(out + 2, COLLECT_FRAME_BYTES - 4));
+}
+
+void CollectDecoder::push(const uint8_t *data, size_t len, std::vector<CollectFrame> &frames) {
+	size_t pos = 0;
+
+	buf_.insert(buf_.end(), data, data + len);
+
+	while (buf_.size() - pos >= COLLECT_FRAME_BYTES) {
+		const uint8_t *p = buf_.data() + pos;
+
+		if (p[0] != COLLECT_SYNC0 || p[1] != COLLECT_SYNC1 || p[9] != COLLECT_SENSORS
+				|| collect_checksum(p + 2, COLLECT_FRAME_BYTES - 4)
+						!= get16(p + COLLECT_FRAME_BYTES - 2)) {
+			// Only count what looked like a frame, not the text before the first one
+			bad_checksums += (p[0] == COLLECT_SYNC0 && p[1] == COLLECT_SYNC1);
+			skipped_bytes++;
+			pos++;
+			continue;
+		}
+
+		CollectFrame frame;
+		frame.sequence = get16(p + 2);
+		frame.micros = get16(p + 4) | (uint32_t) get16(p + 6) << 16;
+		frame.mask = p[8];
+		for (int s = 0; s < COLLECT_SENSORS; s++) {
+			for (int a = 0; a < COLLECT_AXES; a++) {
+				frame.values[s][a] = (int16_t) get16(p + 10 + 2 * (s * COLLECT_AXES + a));
+			}
+		}
+		if (started_) {
+			lost_frames += (uint16_t) (frame.sequence - next_sequence_);
+		}
+		started_ = true;
+		next_sequence_ = frame.sequence + 1;
+		frames.push_back(frame);
+		pos += COLLECT_FRAME_BYTES;
+	}
+	buf_.erase(buf_.begin(), buf_.begin() + pos);
+}
+
+void collect_write_log(const std::string &path, const std::vector<CollectFrame> &frames,
+		const std::string &label) {
+	std::string text;
+	char line[96];
+
+	if (!label.empty()) {
+		text += label + "\r\n";
+	}
+	for (size_t n = frames.size(); n-- > 0;) {
+		const CollectFrame &frame = frames[n];
+
+		if (frame.mask != (1 << COLLECT_SENSORS) - 1) {
+			snprintf(line, sizeof(line), "MPU frame %u: sensors 0x%02x answered\r\n", frame.sequence,
+					frame.mask);
+			text += line;
+		} else {
+			for (int s = COLLECT_SENSORS - 1; s >= 0; s--) {
+				const int16_t *v = frame.values[s];
+
+				snprintf(line, sizeof(line), "%d: AX %d AY %d AZ %d GX %d GY %d GZ %d\r\n", s,
+						v[0], v[1], v[2], v[3], v[4], v[5]);
+				text += line;
+			}
+		}
+		if (n > 0 && (uint16_t) (frames[n - 1].sequence + 1) != frame.sequence) {
+			snprintf(line, sizeof(line), "MPU frames %u ... %u lost\r\n",
+					(uint16_t) (frames[n - 1].sequence + 1), (uint16_t) (frame.sequence - 1));
+			text += line;
+		}
+	}
+
+	bool archive = path.size() > 4 && path.compare(path.size() - 4, 4, ".imz") == 0;
+	std::string data = archive ? archive_encode(text) : text;
+	std::ofstream file(path, std::ios::binary);
+
+	if (!file.write(data.data(), data.size())) {
+		throw std::runtime_error("cannot write " + path);
+	}
+}
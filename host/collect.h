@@ -0,0 +1,65 @@
+/**
+ * @file        collect.h
+ * @brief       Binary frames of the data-collection sketch (ArduinoCode, BINARY_MODE 1)
+ * @details     A frame is 0xA5 0x5A, u16 sequence, u32 micros() at its start, u8 mask of the
+ *              sensors that answered, u8 sensors, six int16 per sensor (AX AY AZ GX GY GZ) and a
+ *              Fletcher-16 of everything after the sync bytes, all little-endian; the sketch packs
+ *              it by hand and has to be kept in step with this file. The decoder resynchronizes
+ *              on the sync bytes, so the sketch's text from setup() and corrupted frames are
+ *              skipped, and lost frames show up as gaps in the sequence numbers.
+ */
+
+#ifndef __COLLECT_H__
+#define __COLLECT_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define COLLECT_SYNC0 0xA5
+#define COLLECT_SYNC1 0x5A
+#define COLLECT_SENSORS 6
+#define COLLECT_AXES 6
+#define COLLECT_FRAME_BYTES (10 + COLLECT_SENSORS * COLLECT_AXES * 2 + 2)
+
+struct CollectFrame {
+	uint16_t sequence;
+	uint32_t micros;
+	uint8_t mask;                   // sensors that answered, the others are zeros
+	int16_t values[COLLECT_SENSORS][COLLECT_AXES];
+};
+
+/* Fletcher-16 as the sketch computes it */
+uint16_t collect_checksum(const uint8_t *data, size_t len);
+
+/* Pack a frame the way the sketch does */
+void collect_pack(const CollectFrame &frame, uint8_t out[COLLECT_FRAME_BYTES]);
+
+class CollectDecoder {
+public:
+	/* Decode the frames completed by these bytes, appended to frames */
+	void push(const uint8_t *data, size_t len, std::vector<CollectFrame> &frames);
+
+	long skipped_bytes = 0;         // outside of frames, including the text from setup()
+	long bad_checksums = 0;
+	long lost_frames = 0;           // sequence numbers that never arrived
+
+private:
+	std::vector<uint8_t> buf_;
+	bool started_ = false;
+	uint16_t next_sequence_ = 0;
+};
+
+/*
+ * Write frames as a log in the format of FinalData: the class marker (if any) on top, then the
+ * frames newest first with the sensors' lines in reverse order, so FinalData/parse_data.py and
+ * load_log() read them back oldest first. Lost frames and frames some sensor didn't answer in break
+ * the recording with an "MPU ..." line, the latter are left out. Output ending in .imz is written as
+ * an archive.
+ * Throws std::runtime_error if the file can't be written.
+ */
+void collect_write_log(const std::string &path, const std::vector<CollectFrame> &frames,
+		const std::string &label);
+
+#endif // __COLLECT_H__
@@ -0,0 +1,446 @@
+/**
+ * @file        fall_sim.cpp
+ * @brief       Simulation of the fall detector in the firmware's acquisition loop
+ * @details     Replays the recordings through fall.c sample by sample on a timing model of
+ *              main.c: the sensors are read with the firmware's read plan as read_timing.h times
+ *              it, a sensor's samples are checked as soon as it was read and an alert goes out on
+ *              the UART before the next sensor is read. The frames are calibrated and converted
+ *              as main.c does and classified by the network on the windows the adaptive hop of
+ *              scheduler.c picks, and power.c switches the sensors' modes on the mocked bus of
+ *              i2c_mock.h from them, so a sensor that sleeps or wakes up isn't read. The status
+ *              message goes out when the sensors read change and with every heartbeat, a
+ *              classification message when the smoothed activity changes.
+ *
+ *              Falls (free fall, then an impact) and hard impacts are injected at regular
+ *              intervals on all sensors, once into the recordings as they are and once after the
+ *              wearer stood still long enough for the sensors to go to sleep, and an event only
+ *              counts as found if it is reported as what it is. The recordings hold no sitting or
+ *              standing and the network takes a constant frame for walking, so the windows that
+ *              end in the still frames are classified as standing. Prints the false alarms on the
+ *              recordings as they are, the injected events that were found, and the latency from
+ *              the triggering sample to the first and the last alert byte on the UART next to
+ *              the next classification, the earliest the activity could have been reported.
+ *
+ *              usage: fall_sim [-e seconds] [-f frames] [-s seconds] LOG...
+ *
+ *              -e  time between injected events, default 10 s
+ *              -f  samples of free fall before the impact, default 3
+ *              -s  time standing still before the events of the second run, default 30 s
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "calib_estimate.h"
+#include "classify.h"
+#include "fall.h"
+#include "health.h"
+#include "i2c_mock.h"
+#include "imu_net.h"
+#include "power.h"
+#include "preprocess.h"
+#include "recording.h"
+#include "read_timing.h"
+#include "scheduler.h"
+#include "smooth.h"
+
+/* Timing of the rest of the acquisition loop as main.c does it */
+#define UART_BAUD 57600             // HM20_BAUDRATE
+#define UART_BYTE_BITS 10           // 8N1
+#define MESSAGE_LEN 64              // BUFF_SIZE, status and classification messages
+#define CNN_US 2000                 // inference and unload, well above the emulator's estimate
+
+#define DEFAULT_EVENT_SECONDS 10.0
+#define DEFAULT_FREE_FRAMES 3
+#define DEFAULT_STILL_SECONDS 30.0
+
+/* Logit of a standing classification, the others being 0, clear of POWER_SLEEP_MARGIN */
+#define STANDING_LOGIT 64
+
+static const char *const sensor_names[SENSOR_COUNT] = {
+#define SENSOR(name, id, port, pin) name,
+	SENSOR_LIST
+#undef SENSOR
+};
+
+/* Injected event on all sensors from frame start on: free fall then impact, or impact only */
+struct Event {
+	size_t recording;
+	size_t first;           // frame it starts at
+	size_t impact;          // frame of the impact
+	bool fall;
+	bool found = false;
+	bool asleep = false;    // sensors were asleep when it started
+	double sample_us = 0;   // when the triggering sample was read
+	double first_us = 0;    // sample to first and last alert byte
+	double last_us = 0;
+	double classification_us = -1;
+};
+
+/* What a run over all recordings gave */
+struct Run {
+	std::vector<Event> events;
+	long alarms = 0;
+	long status = 0;
+	long inferences = 0;
+	size_t frames = 0;
+	double total_us = 0;
+	uint64_t read_sensors = 0;      // sensor reads over all frames
+};
+
+static double uart_us(int bytes) {
+	return bytes * UART_BYTE_BITS * 1e6 / UART_BAUD;
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [-e seconds] [-f frames] [-s seconds] LOG...\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+/* Overwrite the accelerometer axes of one sensor's sample with a vector of the given size */
+static void set_accel(uint16_t *sample, int mg) {
+	int16_t v = (int16_t) std::min(32767L, (long) mg * FALL_1G / 1000);
+
+	for (int a = 0; a < SENSOR_AXES; a++) {
+		int axis = sensor_axis(a);
+
+		if (axis < 3) {
+			sample[a] = (uint16_t) ((axis == 2) ? v : 0);
+		}
+	}
+}
+
+/*
+ * Inject an event into every sensor of a recording, after still frames in which the wearer
+ * stands as in the frame before them and is classified as standing
+ */
+static void inject(std::vector<uint16_t> &raw, std::vector<bool> &standing, const Event &ev,
+		size_t still) {
+	for (size_t n = ev.first - still; n < ev.first; n++) {
+		memcpy(&raw[n * PREPROCESS_CHANNELS], &raw[(ev.first - still - 1) * PREPROCESS_CHANNELS],
+				PREPROCESS_CHANNELS * sizeof(uint16_t));
+		standing[n] = true;
+	}
+	for (int s = 0; s < SENSOR_COUNT; s++) {
+		for (size_t n = ev.first; n < ev.impact; n++) {
+			set_accel(&raw[n * PREPROCESS_CHANNELS + s * SENSOR_AXES], 100);
+		}
+		set_accel(&raw[ev.impact * PREPROCESS_CHANNELS + s * SENSOR_AXES], 3000);
+	}
+}
+
+/*
+ * Replay one recording through the acquisition loop, events being its injected ones in order.
+ * A window that ends on a standing frame is classified as standing.
+ */
+static void replay(const ImuNet &net, const calib_estimate_t &est, const std::vector<uint16_t> &raw,
+		const std::vector<bool> &standing, size_t frames, Event *events, size_t count, Run &run) {
+	SensorTiming timing = firmware_sensor_timing();
+	I2cMockConfig bus;
+	Bus firmware = firmware_bus();
+
+	bus.hz = firmware.hz;
+	bus.stretch_us = firmware.stretch_us;
+	bus.overhead_us = firmware.overhead_us;
+	i2c_mock_reset(bus);
+	for (int s = 0; s < SENSOR_COUNT; s++) {
+		health_init(s, E_NO_ERROR);
+	}
+	power_init();
+	fall_init();
+
+	scheduler_t scheduler;
+	smooth_t smooth;
+	scheduler_init(&scheduler, SCHEDULER_HOP_MIN, SCHEDULER_HOP_MAX);
+	smooth_init(&smooth);
+
+	std::vector<int8_t> values(std::max<size_t>(frames, PREPROCESS_WINDOW) * PREPROCESS_CHANNELS, 0);
+	std::vector<double> classified_us;
+	uint16_t prev[PREPROCESS_CHANNELS] = { 0 };
+	uint32_t seeded = 0;
+	uint32_t status_read = 0;
+	double status_us = 0;
+	double now = 0;
+	int frame_count = 0;
+	bool warming_up = true;
+	size_t next_event = 0;
+
+	for (size_t n = 0; n < frames; n++) {
+		uint16_t frame[PREPROCESS_CHANNELS];
+		uint32_t reading = 0;
+		int read = 0;
+
+		for (int s = 0; s < SENSOR_COUNT; s++) {
+			reading |= power_read(s) ? 1u << s : 0;
+			read += power_read(s);
+		}
+		run.read_sensors += read;
+
+		// The first frame of an event tells whether it came while sensors were asleep
+		Event *ev = (next_event < count) ? &events[next_event] : nullptr;
+		if (ev && n == ev->first) {
+			ev->asleep = read < SENSOR_COUNT;
+		}
+		if (ev && ev->impact != n) {
+			ev = nullptr;
+		}
+
+		fall_frame(reading);
+		memcpy(frame, &raw[n * PREPROCESS_CHANNELS], sizeof(frame));
+		for (int s = 0; s < SENSOR_COUNT; s++) {
+			uint16_t *sample = frame + s * SENSOR_AXES;
+			fall_alert_t alert;
+			char message[FALL_MESSAGE_LEN];
+
+			if (!(reading & (1u << s))) {
+				memset(sample, 0, SENSOR_AXES * sizeof(uint16_t));
+				continue;
+			}
+			double sample_us = now + timing.accel_us;
+
+			now += timing.read_us;
+			fall_event_t event = fall_sample(s, sample, &alert);
+			if (event == FALL_NONE) {
+				continue;
+			}
+
+			int len = fall_format(&alert, sensor_names[s], message, sizeof(message));
+
+			if (ev && !ev->found && (event == FALL_FALL) == ev->fall) {
+				ev->found = true;
+				ev->sample_us = sample_us;
+				ev->first_us = now + uart_us(1) - sample_us;
+				ev->last_us = now + uart_us(len) - sample_us;
+			} else {
+				run.alarms++;
+			}
+			now += uart_us(len);
+		}
+
+		// Calibrated and imputed as main.c does, the fixed calibration of the recordings
+		calib_estimate_apply(&est, frame);
+		for (int s = 0; s < SENSOR_COUNT; s++) {
+			uint16_t *sample = frame + s * SENSOR_AXES;
+			uint16_t *last = &prev[s * SENSOR_AXES];
+
+			if (!(reading & (1u << s))) {
+				memcpy(sample, last, SENSOR_AXES * sizeof(uint16_t));
+			} else if (!(seeded & (1u << s))) {
+				memcpy(last, sample, SENSOR_AXES * sizeof(uint16_t));
+			} else if (power_gyro_off(s)) {
+				for (int a = 0; a < SENSOR_AXES; a++) {
+					if (sensor_axis(a) >= 3) {
+						sample[a] = last[a];
+					}
+				}
+			}
+		}
+		seeded = reading;
+
+		double bus_us = i2c_mock_now_us();
+		power_frame(MXC_I2C1, frame, prev, reading);
+		preprocess_frame(frame, prev, &values[n * PREPROCESS_CHANNELS]);
+
+		// The status holds which sensors read something
+		if (n == 0 || reading != status_read || now - status_us >= SMOOTH_HEARTBEAT_MS * 1000.0) {
+			status_read = reading;
+			status_us = now;
+			now += uart_us(MESSAGE_LEN);
+			run.status++;
+		}
+
+		frame_count++;
+		bool partial = warming_up && scheduler_warmup(frame_count, SCHEDULER_WARMUP_FRAMES);
+		if (frame_count == PREPROCESS_WINDOW || partial) {
+			uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS];
+			uint32_t padded[PREPROCESS_GROUPS][PREPROCESS_CHANNELS];
+			int8_t logits[CLASSIFY_CLASSES];
+			size_t start = n + 1 - frame_count;
+
+			preprocess_pack_window(&values[start * PREPROCESS_CHANNELS], words);
+			if (partial) {
+				preprocess_pad_window(words, frame_count, padded);
+				net.infer(padded, logits);
+			} else {
+				net.infer(words, logits);
+			}
+			if (standing[n]) {
+				std::fill(logits, logits + CLASSIFY_CLASSES, 0);
+				logits[CLASSIFY_STANDING] = STANDING_LOGIT;
+			}
+			now += CNN_US;
+			run.inferences++;
+			if (smooth_update(&smooth, logits, (uint32_t) (now / 1000)) != SMOOTH_QUIET) {
+				now += uart_us(MESSAGE_LEN);
+			}
+			classified_us.push_back(now + (partial ? 0 : uart_us(MESSAGE_LEN)));
+
+			if (!partial) {
+				warming_up = false;
+				power_classified(MXC_I2C1, logits);
+				frame_count -= scheduler_next(&scheduler, logits);
+			}
+		}
+		now += i2c_mock_now_us() - bus_us;
+
+		while (next_event < count && events[next_event].impact <= n) {
+			next_event++;
+		}
+	}
+
+	// The next classification of a found event, as if the smoothed activity changed
+	for (size_t e = 0; e < count; e++) {
+		Event &ev = events[e];
+		auto next = std::lower_bound(classified_us.begin(), classified_us.end(), ev.sample_us);
+
+		if (ev.found && next != classified_us.end()) {
+			ev.classification_us = *next - ev.sample_us;
+		}
+	}
+
+	run.frames += frames;
+	run.total_us += now;
+}
+
+static void print_stats(const char *name, std::vector<double> us) {
+	if (us.empty()) {
+		printf("%-34s%10s\n", name, "-");
+		return;
+	}
+	std::sort(us.begin(), us.end());
+	printf("%-34s%9.1f ms%9.1f ms%9.1f ms\n", name, us.front() / 1000, us[us.size() / 2] / 1000,
+			us.back() / 1000);
+}
+
+int main(int argc, char **argv) {
+	double event_seconds = DEFAULT_EVENT_SECONDS;
+	double still_seconds = DEFAULT_STILL_SECONDS;
+	int free_frames = DEFAULT_FREE_FRAMES;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "e:f:s:")) != -1) {
+		switch (opt) {
+		case 'e':
+			event_seconds = atof(optarg);
+			break;
+		case 'f':
+			free_frames = atoi(optarg);
+			break;
+		case 's':
+			still_seconds = atof(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind >= argc || event_seconds <= 0 || free_frames < 0 || still_seconds < 0) {
+		usage(argv[0]);
+	}
+
+	std::vector<Recording> recordings;
+	std::unique_ptr<ImuNet> net;
+	std::string err;
+
+	try {
+		recordings = load_logs(std::vector<std::string>(argv + optind, argv + argc));
+		net.reset(new ImuNet());
+	} catch (const std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+	if (!imu_net_check_sample(*net, &err)) {
+		fprintf(stderr, "network does not reproduce sampleoutput.h: %s\n", err.c_str());
+		return EXIT_FAILURE;
+	}
+
+	// The device's calibration once it has settled, estimated on the recordings as they are
+	calib_estimate_t est;
+
+	calib_estimate_init(&est);
+	for (const Recording &recording : recordings) {
+		calib_estimate_recording(&est, recording.raw.data(), recording.frames());
+	}
+
+	double rate = 1e6 / (SENSOR_COUNT * firmware_sensor_timing().read_us);
+
+	for (int pass = 0; pass < 3; pass++) {
+		size_t still = (pass == 2) ? (size_t) (still_seconds * rate) : 0;
+		size_t spacing = std::max<size_t>(1, (size_t) (event_seconds * rate)) + still;
+		Run run;
+
+		for (size_t r = 0; r < recordings.size(); r++) {
+			std::vector<uint16_t> raw = recordings[r].raw;
+			size_t frames = recordings[r].frames();
+			std::vector<bool> standing(frames, false);
+			size_t first = run.events.size();
+
+			// Alternate falls and impacts, away from the start so the classifier has a window
+			for (size_t impact = PREPROCESS_WINDOW + free_frames + still + 1;
+					pass > 0 && impact < frames; impact += spacing) {
+				Event ev;
+
+				ev.recording = r;
+				ev.impact = impact;
+				ev.fall = (run.events.size() % 2 == 0);
+				ev.first = impact - (ev.fall ? free_frames : 0);
+				inject(raw, standing, ev, still);
+				run.events.push_back(ev);
+			}
+			replay(*net, est, raw, standing, frames, run.events.data() + first,
+					run.events.size() - first, run);
+		}
+
+		double hours = run.total_us / 3.6e9;
+
+		if (pass == 0) {
+			printf("%zu recordings, %.1f min at %.1f frames/s (%.2f ms per frame with %.1f of "
+					"%d sensors read, %ld status messages and %ld inferences)\n\n",
+					recordings.size(), run.total_us / 6e7, run.frames / (run.total_us / 1e6),
+					run.total_us / run.frames / 1000, (double) run.read_sensors / run.frames,
+					SENSOR_COUNT, run.status, run.inferences);
+			printf("False alarms on the recordings as they are: %ld (%.1f per hour)\n", run.alarms,
+					run.alarms / hours);
+			continue;
+		}
+
+		std::vector<double> first, last, classification;
+		long found[2] = { 0, 0 };
+		long injected[2] = { 0, 0 };
+		long asleep = 0;
+
+		for (const Event &ev : run.events) {
+			injected[ev.fall]++;
+			asleep += ev.asleep;
+			if (ev.found) {
+				found[ev.fall]++;
+				first.push_back(ev.first_us);
+				last.push_back(ev.last_us);
+				if (ev.classification_us >= 0) {
+					classification.push_back(ev.classification_us);
+				}
+			}
+		}
+
+		if (pass == 1) {
+			printf("\nInjected every %.0f s", event_seconds);
+		} else {
+			printf("\nInjected after standing still for %.0f s", still_seconds);
+		}
+		printf(": %ld of %ld falls (%d samples of free fall) and %ld of %ld impacts found, "
+				"%ld other alerts, %ld events with sensors asleep\n\n", found[1], injected[1],
+				free_frames, found[0], injected[0], run.alarms, asleep);
+		printf("%-34s%12s%12s%12s\n", "", "min", "median", "max");
+		print_stats("sample to first alert byte", first);
+		print_stats("sample to last alert byte", last);
+		print_stats("sample to next classification", classification);
+	}
+
+	return EXIT_SUCCESS;
+}
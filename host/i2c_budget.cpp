@@ -0,0 +1,243 @@
+/**
+ * @file        i2c_budget.cpp
+ * @brief       I2C time and frame rate budget of the sensor reads for other bus setups
+ * @details     Times the read plans of read_plan.h, the descriptors mpu6050_read() walks, for a
+ *              number of sensors, bus clocks and bus layouts with the model of read_timing.h:
+ *              every transaction is a start, the address and register pointer, a repeated start,
+ *              the address and the data bytes (9 clocks each) and a stop, plus clock stretching
+ *              per byte read and the driver's time per transaction, and the plan's waits come on
+ *              top. With AD0 select pins (the board as built) the sensors share a bus and are
+ *              selected one at a time with the waits around deselecting; behind a TCA9548A
+ *              multiplexer every sensor costs a write of the channel instead. With several buses
+ *              their sensors are read in parallel. Prints the transactions, bytes and time per
+ *              frame and the highest frame rate.
+ *
+ *              For the board as built the prediction is checked against the firmware's own
+ *              mpu6050_read() on the mocked bus of i2c_mock.h: the counted transactions, bytes and
+ *              bits have to match and the simulated time has to agree. Whatever the options, the
+ *              frame fall_sim and align_sim take from firmware_sensor_timing() is checked the
+ *              same way against the prediction and the mock for the firmware's plan and bus, so
+ *              the simulators can't drift from the reads. Exits nonzero if anything disagrees.
+ *
+ *              usage: i2c_budget [-n sensors] [-f clocks] [-s strategy] [-t ad0|mux] [-b buses]
+ *                                [-c stretch_us] [-o overhead_us] [-a axes]
+ *
+ *              -n  sensors, default SENSOR_COUNT
+ *              -f  bus clocks in Hz, comma separated, default DEFAULT_CLOCKS
+ *              -s  bytes, axes or burst, default all of them
+ *              -t  sensors selected by their AD0 pin (default) or behind a multiplexer
+ *              -b  buses the sensors are spread over, default 1
+ *              -c  clock stretching per data byte read, default 0
+ *              -o  driver time per transaction, default TRANSACTION_OVERHEAD_US
+ *              -a  axes read (SENSOR_AXIS_AX ...), default SENSOR_AXES_MASK
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "i2c_mock.h"
+#include "mpu6050.h"
+#include "read_plan.h"
+#include "read_timing.h"
+
+/* I2C_FREQ in main.c first, then the standard clocks */
+#define DEFAULT_CLOCKS "115200,100000,400000,1000000"
+
+/* TCA9548A: 8 channels of 2 addresses each */
+#define MUX_SENSORS 16
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [-n sensors] [-f clocks] [-s strategy] [-t ad0|mux] [-b buses]\n"
+			"       %*s [-c stretch_us] [-o overhead_us] [-a axes]\n", prog,
+			(int) strlen(prog), "");
+	exit(EXIT_FAILURE);
+}
+
+/* Run mpu6050_read() for the first sensors on the mocked bus, false if a sample came back wrong */
+static bool mock_frame(int strategy, const Bus &bus, int sensors, Budget &counted) {
+	I2cMockConfig config;
+	bool ok = true;
+
+	config.hz = bus.hz;
+	config.stretch_us = bus.stretch_us;
+	config.overhead_us = bus.overhead_us;
+	i2c_mock_reset(config);
+	mpu6050_read_strategy(strategy);
+
+	for (int s = 0; s < sensors; s++) {
+		uint16_t raw[SENSOR_AXES];
+
+		ok &= mpu6050_read(MXC_I2C1, s, raw) == E_NO_ERROR;
+
+		// The mock's data registers hold s * 16 + their address
+		for (int a = 0; a < SENSOR_AXES; a++) {
+			int reg = READ_PLAN_FIRST_REG + read_plan_offset(sensor_axis(a));
+
+			ok &= raw[a] == (uint16_t) ((uint8_t) (s * 16 + reg) << 8 | (uint8_t) (s * 16 + reg + 1));
+		}
+	}
+
+	const I2cMockCounts &counts = i2c_mock_counts();
+
+	counted.transactions = counts.transactions;
+	counted.tx_bytes = counts.tx_bytes;
+	counted.rx_bytes = counts.rx_bytes;
+	counted.bits = counts.bits;
+	counted.bus_us = counts.bus_us;
+	counted.delay_us = counts.delay_us;
+	return ok && counts.errors == 0;
+}
+
+int main(int argc, char **argv) {
+	int sensors = SENSOR_COUNT;
+	std::string clocks_arg = DEFAULT_CLOCKS;
+	int only = -1;
+	Topology topology = TOPOLOGY_AD0;
+	int buses = 1;
+	double stretch_us = 0;
+	double overhead_us = TRANSACTION_OVERHEAD_US;
+	uint32_t axes = SENSOR_AXES_MASK;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:f:s:t:b:c:o:a:")) != -1) {
+		switch (opt) {
+		case 'n':
+			sensors = atoi(optarg);
+			break;
+		case 'f':
+			clocks_arg = optarg;
+			break;
+		case 's':
+			for (int st = 0; st < READ_PLAN_STRATEGIES; st++) {
+				only = (strcmp(optarg, read_plan_name(st)) == 0) ? st : only;
+			}
+			if (only < 0) {
+				usage(argv[0]);
+			}
+			break;
+		case 't':
+			if (strcmp(optarg, "ad0") && strcmp(optarg, "mux")) {
+				usage(argv[0]);
+			}
+			topology = strcmp(optarg, "mux") ? TOPOLOGY_AD0 : TOPOLOGY_MUX;
+			break;
+		case 'b':
+			buses = atoi(optarg);
+			break;
+		case 'c':
+			stretch_us = atof(optarg);
+			break;
+		case 'o':
+			overhead_us = atof(optarg);
+			break;
+		case 'a':
+			axes = (uint32_t) strtoul(optarg, nullptr, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || sensors < 1 || buses < 1 || axes == 0 || (axes & ~0x3Fu)) {
+		usage(argv[0]);
+	}
+
+	std::vector<double> clocks;
+	std::stringstream list(clocks_arg);
+	std::string item;
+
+	while (std::getline(list, item, ',')) {
+		if (atof(item.c_str()) <= 0) {
+			usage(argv[0]);
+		}
+		clocks.push_back(atof(item.c_str()));
+	}
+
+	// Sensors on the busiest bus, they are read one after another
+	int per_bus = (sensors + buses - 1) / buses;
+	bool check = topology == TOPOLOGY_AD0 && buses == 1 && sensors <= SENSOR_COUNT
+			&& axes == SENSOR_AXES_MASK;
+
+	printf("%d sensors on %d bus%s (%d on the busiest), %s, axes 0x%02x, %.0f us per transaction, "
+			"%.1f us stretching per byte\n", sensors, buses, (buses > 1) ? "es" : "", per_bus,
+			(topology == TOPOLOGY_AD0) ? "AD0 select pins" : "TCA9548A multiplexer",
+			(unsigned) axes, overhead_us, stretch_us);
+	if (topology == TOPOLOGY_MUX && per_bus > MUX_SENSORS) {
+		printf("more than %d sensors behind one multiplexer need another one\n", MUX_SENSORS);
+	}
+	printf("\n%-8s %8s %6s %10s %8s %9s %9s %9s %9s\n", "plan", "clock", "trans", "bytes w/r",
+			"bits", "bus ms", "wait ms", "frame ms", "max Hz");
+
+	long failures = 0;
+
+	for (int st = 0; st < READ_PLAN_STRATEGIES; st++) {
+		read_plan_t plan;
+
+		if (only >= 0 && st != only) {
+			continue;
+		}
+		read_plan_build(&plan, st, axes);
+
+		for (double hz : clocks) {
+			Bus bus = { hz, stretch_us, overhead_us };
+			Budget frame;
+
+			frame.add(sensor_budget(plan, bus, topology), per_bus);
+			printf("%-8s %8.0f %6ld %5ld/%-4ld %8ld %9.2f %9.2f %9.2f %9.1f\n", read_plan_name(st),
+					hz, frame.transactions, frame.tx_bytes, frame.rx_bytes, frame.bits,
+					frame.bus_us / 1000, frame.delay_us / 1000, frame.total_us() / 1000,
+					1e6 / frame.total_us());
+
+			if (!check) {
+				continue;
+			}
+
+			Budget counted;
+			bool ok = mock_frame(st, bus, sensors, counted);
+			bool same = counted.transactions == frame.transactions
+					&& counted.tx_bytes == frame.tx_bytes && counted.rx_bytes == frame.rx_bytes
+					&& counted.bits == frame.bits
+					&& std::fabs(counted.total_us() - frame.total_us()) <= 1e-6 * frame.total_us();
+
+			if (!ok || !same) {
+				printf("%-8s %8s %6ld %5ld/%-4ld %8ld %9.2f %9.2f %9.2f  mpu6050_read() on the "
+						"mock%s\n", "", "", counted.transactions, counted.tx_bytes,
+						counted.rx_bytes, counted.bits, counted.bus_us / 1000,
+						counted.delay_us / 1000, counted.total_us() / 1000,
+						ok ? "" : ", wrong samples");
+				failures++;
+			}
+		}
+	}
+
+	if (check) {
+		printf("\n%s\n", failures ? "the mocked mpu6050_read() DIFFERS from the prediction"
+				: "every prediction matches mpu6050_read() on the mocked bus");
+	} else {
+		printf("\nnot checked against the mock, it has the %d sensors of the board on one bus "
+				"with AD0 select pins\n", SENSOR_COUNT);
+	}
+
+	// The frame of the simulators, the board as built
+	read_plan_t plan;
+	Budget predicted, counted;
+	double simulated_us = SENSOR_COUNT * firmware_sensor_timing().read_us;
+
+	read_plan_build(&plan, READ_PLAN_STRATEGY, SENSOR_AXES_MASK);
+	predicted.add(sensor_budget(plan, firmware_bus(), TOPOLOGY_AD0), SENSOR_COUNT);
+	bool simulated_ok = mock_frame(READ_PLAN_STRATEGY, firmware_bus(), SENSOR_COUNT, counted)
+			&& std::fabs(simulated_us - predicted.total_us()) <= 1e-6 * predicted.total_us()
+			&& std::fabs(simulated_us - counted.total_us()) <= 1e-6 * predicted.total_us();
+
+	printf("fall_sim and align_sim: %.2f ms per frame, predicted %.2f ms, %.2f ms on the mock, %s\n",
+			simulated_us / 1000, predicted.total_us() / 1000, counted.total_us() / 1000,
+			simulated_ok ? "they agree" : "they DIFFER");
+	failures += !simulated_ok;
+
+	return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
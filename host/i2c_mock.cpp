@@ -0,0 +1,150 @@
+/**
+ * @file        i2c_mock.cpp
+ * @brief       Simulated I2C bus with MPU-6050s behind the host stand-ins of the MSDK (msdk)
+ */
+
+#include <cstring>
+
+#include "boot.h"
+#include "i2c_mock.h"
+#include "mpu6050.h"
+#include "mxc_delay.h"
+
+#define MPU6050_REGS 128
+
+/* Repeated start and stop take a clock each, as the start does */
+#define CONDITION_BITS 1
+#define BYTE_BITS 9
+
+mxc_gpio_regs_t host_gpio0;
+mxc_i2c_regs_t host_i2c1;
+
+static I2cMockConfig config;
+static I2cMockCounts counts;
+static double now_us;
+static unsigned int timeout_us;
+static uint8_t regs[MPU6050_NUM_SENSORS][MPU6050_REGS];
+
+/* Register contents the sensors start with, every data register different */
+static uint8_t reset_value(int s, int reg) {
+	return (reg == MPU6050_REG_WHO_AM_I) ? MPU6050_WHO_AM_I : (uint8_t) (s * 16 + reg);
+}
+
+void i2c_mock_reset(const I2cMockConfig &c) {
+	config = c;
+	counts = I2cMockCounts();
+	now_us = 0;
+	host_gpio0.out = 0;
+	for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+		for (int reg = 0; reg < MPU6050_REGS; reg++) {
+			regs[s][reg] = reset_value(s, reg);
+		}
+		regs[s][MPU6050_REG_PWR_MGMT_1] = 0;
+	}
+}
+
+const I2cMockCounts &i2c_mock_counts() {
+	return counts;
+}
+
+double i2c_mock_now_us() {
+	return now_us;
+}
+
+/* The selected sensor, -1 if none or more than one would answer */
+static int selected() {
+	int found = -1;
+
+	for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+		const mpu6050_sensor_t *sensor = &mpu6050_sensors[s];
+
+		if (sensor->port->out & sensor->pin) {
+			if (found >= 0) {
+				return -1;
+			}
+			found = s;
+		}
+	}
+	return found;
+}
+
+int MXC_Delay(unsigned long us) {
+	now_us += us;
+	counts.delay_us += us;
+	return E_NO_ERROR;
+}
+
+uint32_t boot_us(void) {
+	return (uint32_t) now_us;
+}
+
+uint32_t boot_ms(void) {
+	return (uint32_t) (now_us / 1000);
+}
+
+int MXC_GPIO_Config(const mxc_gpio_cfg_t *cfg) {
+	return E_NO_ERROR;
+}
+
+void MXC_GPIO_OutSet(mxc_gpio_regs_t *port, uint32_t mask) {
+	port->out |= mask;
+}
+
+void MXC_GPIO_OutClr(mxc_gpio_regs_t *port, uint32_t mask) {
+	port->out &= ~mask;
+}
+
+int MXC_I2C_Init(mxc_i2c_regs_t *i2c, int master, unsigned int slave_addr) {
+	return E_NO_ERROR;
+}
+
+int MXC_I2C_SetFrequency(mxc_i2c_regs_t *i2c, unsigned int hz) {
+	config.hz = hz;
+	return (int) hz;
+}
+
+void MXC_I2C_SetTimeout(mxc_i2c_regs_t *i2c, unsigned int timeout) {
+	timeout_us = timeout;
+}
+
+unsigned int MXC_I2C_GetTimeout(mxc_i2c_regs_t *i2c) {
+	return timeout_us;
+}
+
+int MXC_I2C_MasterTransaction(mxc_i2c_req_t *req) {
+	int s = (req->addr == MPU6050_ADDR) ? selected() : -1;
+	long bits = CONDITION_BITS;
+
+	if (req->tx_len > 0) {
+		bits += BYTE_BITS * (1 + req->tx_len);
+	}
+	if (req->rx_len > 0) {
+		bits += ((req->tx_len > 0) ? CONDITION_BITS : 0) + BYTE_BITS * (1 + req->rx_len);
+	}
+	bits += req->restart ? 0 : CONDITION_BITS;
+
+	double us = bits * 1e6 / config.hz + req->rx_len * config.stretch_us + config.overhead_us;
+
+	counts.transactions++;
+	counts.tx_bytes += req->tx_len;
+	counts.rx_bytes += req->rx_len;
+	counts.bits += bits;
+	counts.bus_us += us;
+	now_us += us;
+
+	if (s < 0) {
+		counts.errors++;
+		return E_COMM_ERR;
+	}
+
+	// The first byte written is the register pointer, it advances with every byte
+	int reg = (req->tx_len > 0) ? req->tx_buf[0] : 0;
+
+	for (unsigned i = 1; i < req->tx_len; i++) {
+		regs[s][reg++ % MPU6050_REGS] = req->tx_buf[i];
+	}
+	for (unsigned i = 0; i < req->rx_len; i++) {
+		req->rx_buf[i] = regs[s][reg++ % MPU6050_REGS];
+	}
+	return E_NO_ERROR;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file        i2c_mock.h
+ * @brief       Simulated I2C bus with MPU-6050s behind the host stand-ins of the MSDK (msdk)
+ * @details     Runs the firmware's mpu6050.c unchanged: the sensors' AD0 select pins are the
+ *              GPIO outputs of mpu6050_sensors, the selected sensor answers at MPU6050_ADDR and
+ *              the others don't. Every transaction is counted and takes the bits the MSDK driver
+ *              puts on the bus at the set clock: start, address and register pointer, a
+ *              repeated start, address and the data bytes, each 9 clocks, and the stop. On top
+ *              come the clock stretching per data byte read and the driver's overhead per
+ *              transaction. MXC_Delay() and boot_us() run on the same simulated time.
+ */
+
+#ifndef __I2C_MOCK_H__
+#define __I2C_MOCK_H__
+
+#include <cstdint>
+
+struct I2cMockConfig {
+	double hz = 100000;
+	double stretch_us = 0;          // clock stretching per data byte read
+	double overhead_us = 0;         // driver time per transaction
+};
+
+struct I2cMockCounts {
+	long transactions = 0;
+	long tx_bytes = 0;              // register pointers and written data, not the addresses
+	long rx_bytes = 0;
+	long bits = 0;
+	long errors = 0;                // transactions nobody answered
+	double bus_us = 0;              // including stretching and overhead
+	double delay_us = 0;            // MXC_Delay()
+};
+
+/* Start over at time 0 with the sensors' registers reset */
+void i2c_mock_reset(const I2cMockConfig &config);
+
+/* Counts since the reset */
+const I2cMockCounts &i2c_mock_counts();
+
+/* Simulated time since the reset */
+double i2c_mock_now_us();
+
+#endif // __I2C_MOCK_H__
@@ -0,0 +1,798 @@
+/**
+ * @file        imu_archive.cpp
+ * @brief       Compressed archive of the raw IMU logs (.imz)
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+
+#include "imu_archive.h"
+
+#define MAGIC "IMUZ"
+#define HEADER_BYTES 32
+#define TABLE_ENTRY_BYTES 24
+#define MAX_CODE_LEN 15
+#define LOOKUP_BITS 10
+#define IMU_SYMBOLS ARCHIVE_IMUS
+#define DELTA_SYMBOLS 18            // bit lengths 0 ... 17 of the zigzag-coded deltas
+#define TABLES (1 + ARCHIVE_IMUS * ARCHIVE_AXES)   // IMU numbers, then each IMU's axes
+
+/* Mode of a column: its shift, and whether it codes the values rather than their deltas */
+#define MODE_SHIFT_MASK 3
+#define MODE_VALUES 4
+
+/* What a sensor line kept as text costs, about 60 bytes with its position and length */
+#define VERBATIM_SAMPLE_BITS 480
+
+static int delta_table(int imu, int axis) {
+	return 1 + imu * ARCHIVE_AXES + axis;
+}
+
+static const char *const eol_text[] = { "", "\n", "\r\n", "\r" };
+
+static const char *const axis_keys[ARCHIVE_AXES] = { "AX", "AY", "AZ", "GX", "GY", "GZ" };
+
+/* Parse a decimal integer the way printf("%d") writes it: no sign on 0, no leading zeros */
+static bool parse_int(const char *&p, const char *end, long *v) {
+	bool negative = (p < end && *p == '-');
+	const char *digits = p + negative;
+	const char *q = digits;
+	long x = 0;
+
+	while (q < end && *q >= '0' && *q <= '9' && q - digits < 6) {
+		x = x * 10 + (*q++ - '0');
+	}
+	if (q == digits || (*digits == '0' && (q - digits > 1 || negative))) {
+		return false;
+	}
+	*v = negative ? -x : x;
+	p = q;
+	return true;
+}
+
+static bool parse_literal(const char *&p, const char *end, const char *s) {
+	size_t n = strlen(s);
+
+	if ((size_t) (end - p) < n || memcmp(p, s, n) != 0) {
+		return false;
+	}
+	p += n;
+	return true;
+}
+
+/* Parse a sensor line that print_sample() gives back byte for byte */
+static bool parse_sample(const char *p, const char *end, LogLine *line) {
+	long v;
+
+	if (!parse_int(p, end, &v) || v < 0 || v >= ARCHIVE_IMUS || !parse_literal(p, end, ":")) {
+		return false;
+	}
+	line->imu = (int) v;
+	for (int a = 0; a < ARCHIVE_AXES; a++) {
+		if (!parse_literal(p, end, " ") || !parse_literal(p, end, axis_keys[a])
+				|| !parse_literal(p, end, " ") || !parse_int(p, end, &v) || v < INT16_MIN
+				|| v > INT16_MAX) {
+			return false;
+		}
+		line->values[a] = (int16_t) v;
+	}
+	return p == end;
+}
+
+static void print_sample(const LogLine &line, std::string &out) {
+	char buf[96];
+	int n = snprintf(buf, sizeof(buf), "%d: AX %d AY %d AZ %d GX %d GY %d GZ %d", line.imu,
+			line.values[0], line.values[1], line.values[2], line.values[3], line.values[4],
+			line.values[5]);
+
+	out.append(buf, n);
+}
+
+static void print_line(const LogLine &line, std::string &out) {
+	if (line.imu >= 0) {
+		print_sample(line, out);
+	} else {
+		out += line.text;
+	}
+	out += eol_text[line.eol];
+}
+
+/* A text line, parsed as a sample if it is one */
+static LogLine make_line(const char *p, const char *end, uint8_t eol) {
+	LogLine line;
+
+	line.eol = eol;
+	if (!parse_sample(p, end, &line)) {
+		line.imu = -1;
+		line.text.assign(p, end);
+	}
+	return line;
+}
+
+bool is_archive(const std::string &data) {
+	return data.compare(0, 4, MAGIC) == 0;
+}
+
+std::vector<LogLine> split_log(const std::string &text) {
+	std::vector<LogLine> lines;
+	const char *base = text.data();
+	size_t start = 0;
+
+	for (size_t i = 0; i < text.size(); i++) {
+		if (text[i] == '\r' || text[i] == '\n') {
+			uint8_t eol = (text[i] == '\n') ? ARCHIVE_EOL_LF : ARCHIVE_EOL_CR;
+
+			if (text[i] == '\r' && i + 1 < text.size() && text[i + 1] == '\n') {
+				eol = ARCHIVE_EOL_CRLF;
+			}
+			lines.push_back(make_line(base + start, base + i, eol));
+			i += (eol == ARCHIVE_EOL_CRLF);
+			start = i + 1;
+		}
+	}
+	if (start < text.size()) {
+		lines.push_back(make_line(base + start, base + text.size(), ARCHIVE_EOL_NONE));
+	}
+	return lines;
+}
+
+std::vector<LogLine> read_log_lines(const std::string &data) {
+	if (!is_archive(data)) {
+		return split_log(data);
+	}
+
+	std::vector<LogLine> lines;
+	archive_decode_lines(data, 0, archive_blocks(data), lines);
+	return lines;
+}
+
+/* Little-endian integers */
+static void put_le(std::string &out, uint64_t v, int bytes) {
+	for (int i = 0; i < bytes; i++) {
+		out += (char) (v >> (8 * i));
+	}
+}
+
+class ByteReader {
+public:
+	ByteReader(const std::string &data, size_t pos) : data_(data), pos_(pos) {}
+
+	uint64_t get(int bytes) {
+		uint64_t v = 0;
+
+		need(bytes);
+		for (int i = 0; i < bytes; i++) {
+			v |= (uint64_t) (uint8_t) data_[pos_++] << (8 * i);
+		}
+		return v;
+	}
+
+	const char *take(size_t n) {
+		need(n);
+		pos_ += n;
+		return data_.data() + pos_ - n;
+	}
+
+private:
+	void need(size_t n) {
+		if (n > data_.size() - pos_) {
+			throw std::runtime_error("archive truncated");
+		}
+	}
+
+	const std::string &data_;
+	size_t pos_;
+};
+
+class BitWriter {
+public:
+	explicit BitWriter(std::string &out) : out_(out) {}
+
+	void put(uint32_t v, int n) {
+		buf_ |= (uint64_t) v << bits_;
+		bits_ += n;
+		while (bits_ >= 8) {
+			out_ += (char) buf_;
+			buf_ >>= 8;
+			bits_ -= 8;
+		}
+	}
+
+	void flush() {
+		if (bits_ > 0) {
+			out_ += (char) buf_;
+		}
+		buf_ = 0;
+		bits_ = 0;
+	}
+
+private:
+	std::string &out_;
+	uint64_t buf_ = 0;
+	int bits_ = 0;
+};
+
+class BitReader {
+public:
+	BitReader(const char *p, const char *end) : p_(p), end_(end) {}
+
+	/* The next n bits without taking them, zeros past the end */
+	uint32_t peek(int n) {
+		while (bits_ < n && p_ != end_) {
+			buf_ |= (uint64_t) (uint8_t) *p_++ << bits_;
+			bits_ += 8;
+		}
+		return (uint32_t) (buf_ & ((1ull << n) - 1));
+	}
+
+	void skip(int n) {
+		if (n > bits_ && (peek(n), n > bits_)) {
+			throw std::runtime_error("archive block truncated");
+		}
+		buf_ >>= n;
+		bits_ -= n;
+	}
+
+	uint32_t get(int n) {
+		uint32_t v = peek(n);
+
+		skip(n);
+		return v;
+	}
+
+private:
+	const char *p_;
+	const char *end_;
+	uint64_t buf_ = 0;
+	int bits_ = 0;
+};
+
+/* Huffman code lengths of at most MAX_CODE_LEN bits, flattening the counts until they fit */
+static std::vector<uint8_t> code_lengths(std::vector<uint32_t> freq) {
+	int n = (int) freq.size();
+	std::vector<uint8_t> len(n, 0);
+
+	for (;;) {
+		typedef std::pair<uint64_t, int> Node;
+		std::priority_queue<Node, std::vector<Node>, std::greater<Node>> queue;
+		std::vector<int> parent(2 * n, -1);
+		int nodes = n;
+
+		for (int s = 0; s < n; s++) {
+			if (freq[s] > 0) {
+				queue.push({ freq[s], s });
+			}
+		}
+		if (queue.size() == 1) {
+			len[queue.top().second] = 1;
+			return len;
+		}
+		while (queue.size() > 1) {
+			Node a = queue.top();
+			queue.pop();
+			Node b = queue.top();
+			queue.pop();
+			parent[a.second] = parent[b.second] = nodes;
+			queue.push({ a.first + b.first, nodes++ });
+		}
+
+		int longest = 0;
+		for (int s = 0; s < n; s++) {
+			int depth = 0;
+
+			for (int p = s; freq[s] > 0 && parent[p] >= 0; p = parent[p]) {
+				depth++;
+			}
+			len[s] = (uint8_t) depth;
+			longest = std::max(longest, depth);
+		}
+		if (longest <= MAX_CODE_LEN) {
+			return len;
+		}
+		for (uint32_t &f : freq) {
+			f = (f > 0) ? (f + 1) / 2 : 0;
+		}
+	}
+}
+
+/* Canonical codes for the lengths, bit-reversed for the LSB-first bit stream */
+static std::vector<uint32_t> canonical_codes(const std::vector<uint8_t> &len) {
+	std::vector<uint32_t> codes(len.size(), 0);
+	uint32_t code = 0;
+
+	for (int bits = 1; bits <= MAX_CODE_LEN; bits++) {
+		for (size_t s = 0; s < len.size(); s++) {
+			if (len[s] != bits) {
+				continue;
+			}
+			uint32_t reversed = 0;
+			for (int b = 0; b < bits; b++) {
+				reversed |= ((code >> b) & 1) << (bits - 1 - b);
+			}
+			codes[s] = reversed;
+			code++;
+		}
+		code <<= 1;
+	}
+	return codes;
+}
+
+/*
+ * Canonical decoding through a table of the codes of up to LOOKUP_BITS bits, longer ones are
+ * decoded one bit at a time as in zlib's puff.c
+ */
+class HuffmanDecoder {
+public:
+	explicit HuffmanDecoder(const std::vector<uint8_t> &len) : lookup_(1 << LOOKUP_BITS, 0) {
+		std::vector<uint32_t> codes = canonical_codes(len);
+
+		for (uint8_t l : len) {
+			count_[l]++;
+		}
+		for (int bits = 1; bits <= MAX_CODE_LEN; bits++) {
+			for (size_t s = 0; s < len.size(); s++) {
+				if (len[s] == bits) {
+					symbols_.push_back((int) s);
+				}
+			}
+		}
+		for (size_t s = 0; s < len.size(); s++) {
+			if (len[s] > 0 && len[s] <= LOOKUP_BITS) {
+				for (uint32_t i = codes[s]; i < lookup_.size(); i += 1u << len[s]) {
+					lookup_[i] = (uint16_t) (s << 4 | len[s]);
+				}
+			}
+		}
+	}
+
+	int decode(BitReader &in) const {
+		uint16_t entry = lookup_[in.peek(LOOKUP_BITS)];
+
+		if (entry) {
+			in.skip(entry & 0xf);
+			return entry >> 4;
+		}
+
+		int code = 0;
+		int first = 0;
+		int index = 0;
+
+		for (int bits = 1; bits <= MAX_CODE_LEN; bits++) {
+			code |= (int) in.get(1);
+			if (code - first < count_[bits]) {
+				return symbols_[index + code - first];
+			}
+			index += count_[bits];
+			first = (first + count_[bits]) << 1;
+			code <<= 1;
+		}
+		throw std::runtime_error("bad code in archive block");
+	}
+
+private:
+	int count_[MAX_CODE_LEN + 1] = { 0 };
+	std::vector<int> symbols_;
+	std::vector<uint16_t> lookup_;
+};
+
+static int bit_length(uint32_t v) {
+	int n = 0;
+
+	while (v) {
+		n++;
+		v >>= 1;
+	}
+	return n;
+}
+
+static uint32_t zigzag(int32_t v) {
+	return (v >= 0) ? 2u * (uint32_t) v : 2u * (uint32_t) -v - 1;
+}
+
+/* Bits of a column coded with the Huffman table of its bit lengths, the extra bits included */
+static uint64_t column_bits(const std::vector<uint32_t> &freq) {
+	std::vector<uint8_t> len = code_lengths(freq);
+	uint64_t bits = 0;
+
+	for (int l = 0; l < DELTA_SYMBOLS; l++) {
+		bits += (uint64_t) freq[l] * (len[l] + std::max(l - 1, 0));
+	}
+	return bits;
+}
+
+/*
+ * Shift of every column: the largest one that all but a few of its values are multiples of, the
+ * sensor lines with the others are kept as text
+ */
+static void column_shifts(const LogLine *lines, size_t count, uint8_t eol,
+		int shift[ARCHIVE_IMUS][ARCHIVE_AXES]) {
+	long samples[ARCHIVE_IMUS] = { 0 };
+	long misfits[ARCHIVE_IMUS][ARCHIVE_AXES][MODE_SHIFT_MASK + 1] = { { { 0 } } };
+
+	for (size_t i = 0; i < count; i++) {
+		if (lines[i].imu < 0 || lines[i].eol != eol) {
+			continue;
+		}
+		samples[lines[i].imu]++;
+		for (int a = 0; a < ARCHIVE_AXES; a++) {
+			for (int sh = 1; sh <= MODE_SHIFT_MASK; sh++) {
+				misfits[lines[i].imu][a][sh] += (lines[i].values[a] & ((1 << sh) - 1)) != 0;
+			}
+		}
+	}
+	for (int imu = 0; imu < ARCHIVE_IMUS; imu++) {
+		for (int a = 0; a < ARCHIVE_AXES; a++) {
+			shift[imu][a] = 0;
+			for (int sh = MODE_SHIFT_MASK; sh > 0 && shift[imu][a] == 0; sh--) {
+				long m = misfits[imu][a][sh];
+
+				shift[imu][a] = (m * VERBATIM_SAMPLE_BITS < sh * (samples[imu] - m)) ? sh : 0;
+			}
+		}
+	}
+}
+
+static bool fits_shifts(const LogLine &line, const int shift[ARCHIVE_IMUS][ARCHIVE_AXES]) {
+	for (int a = 0; a < ARCHIVE_AXES; a++) {
+		if (line.values[a] & ((1 << shift[line.imu][a]) - 1)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void encode_block(const LogLine *lines, size_t count, uint8_t eol, std::string &out) {
+	std::vector<size_t> verbatim;
+	std::vector<const LogLine *> samples;
+	std::string text;
+	int shift[ARCHIVE_IMUS][ARCHIVE_AXES];
+
+	column_shifts(lines, count, eol, shift);
+	for (size_t i = 0; i < count; i++) {
+		if (lines[i].imu >= 0 && lines[i].eol == eol && fits_shifts(lines[i], shift)) {
+			samples.push_back(&lines[i]);
+		} else {
+			verbatim.push_back(i);
+		}
+	}
+
+	// Verbatim lines, sensor lines with another line end printed as text
+	for (size_t i : verbatim) {
+		std::string line;
+
+		if (lines[i].imu >= 0) {
+			print_sample(lines[i], line);
+		} else {
+			line = lines[i].text;
+		}
+		put_le(text, i, 4);
+		put_le(text, lines[i].eol, 1);
+		put_le(text, line.size(), 4);
+		text += line;
+	}
+
+	// The columns as symbols and extra bits, each as deltas or as values, whichever is smaller
+	std::vector<std::vector<uint32_t>> freq(TABLES, std::vector<uint32_t>(DELTA_SYMBOLS, 0));
+	std::vector<std::vector<uint32_t>> value_freq(freq);
+	std::vector<uint8_t> imu_symbols(samples.size());
+	std::vector<uint32_t> deltas(samples.size() * ARCHIVE_AXES);
+	std::vector<uint32_t> values(samples.size() * ARCHIVE_AXES);
+	int32_t prev[ARCHIVE_IMUS][ARCHIVE_AXES] = { { 0 } };
+	uint32_t present = 0;
+	int prev_imu = 0;
+
+	freq[0].assign(IMU_SYMBOLS, 0);
+	for (size_t n = 0; n < samples.size(); n++) {
+		const LogLine &line = *samples[n];
+
+		imu_symbols[n] = (uint8_t) ((prev_imu - line.imu) & (ARCHIVE_IMUS - 1));
+		freq[0][imu_symbols[n]]++;
+		prev_imu = line.imu;
+		present |= 1u << line.imu;
+
+		for (int a = 0; a < ARCHIVE_AXES; a++) {
+			int32_t v = line.values[a] / (1 << shift[line.imu][a]);
+			int t = delta_table(line.imu, a);
+
+			deltas[a * samples.size() + n] = zigzag(v - prev[line.imu][a]);
+			values[a * samples.size() + n] = zigzag(v);
+			prev[line.imu][a] = v;
+			freq[t][bit_length(deltas[a * samples.size() + n])]++;
+			value_freq[t][bit_length(values[a * samples.size() + n])]++;
+		}
+	}
+
+	std::vector<uint8_t> modes(TABLES, 0);
+	std::vector<std::vector<uint8_t>> lengths(TABLES);
+	std::vector<std::vector<uint32_t>> codes(TABLES);
+	std::string coded;
+	BitWriter bits(coded);
+
+	for (int imu = 0; imu < ARCHIVE_IMUS; imu++) {
+		for (int a = 0; present >> imu & 1 && a < ARCHIVE_AXES; a++) {
+			int t = delta_table(imu, a);
+
+			modes[t] = (uint8_t) shift[imu][a];
+			if (column_bits(value_freq[t]) < column_bits(freq[t])) {
+				modes[t] |= MODE_VALUES;
+				freq[t] = value_freq[t];
+			}
+		}
+	}
+	for (int t = 0; t < TABLES; t++) {
+		lengths[t] = code_lengths(freq[t]);
+		codes[t] = canonical_codes(lengths[t]);
+	}
+	for (size_t n = 0; n < samples.size(); n++) {
+		bits.put(codes[0][imu_symbols[n]], lengths[0][imu_symbols[n]]);
+	}
+	for (int a = 0; a < ARCHIVE_AXES; a++) {
+		for (size_t n = 0; n < samples.size(); n++) {
+			int t = delta_table(samples[n]->imu, a);
+			uint32_t z = (modes[t] & MODE_VALUES) ? values[a * samples.size() + n]
+					: deltas[a * samples.size() + n];
+			int len = bit_length(z);
+
+			bits.put(codes[t][len], lengths[t][len]);
+			if (len > 1) {
+				bits.put(z & ((1u << (len - 1)) - 1), len - 1);
+			}
+		}
+	}
+	bits.flush();
+
+	put_le(out, count, 4);
+	put_le(out, verbatim.size(), 4);
+	put_le(out, text.size(), 4);
+	put_le(out, coded.size(), 4);
+	out += text;
+	put_le(out, present, 2);
+
+	// Modes and tables of the IMUs in the block only
+	std::vector<uint8_t> nibbles(lengths[0]);
+	for (int imu = 0; imu < ARCHIVE_IMUS; imu++) {
+		for (int a = 0; present >> imu & 1 && a < ARCHIVE_AXES; a++) {
+			const std::vector<uint8_t> &len = lengths[delta_table(imu, a)];
+			nibbles.push_back(modes[delta_table(imu, a)]);
+			nibbles.insert(nibbles.end(), len.begin(), len.end());
+		}
+	}
+	for (size_t i = 0; i < nibbles.size(); i += 2) {
+		put_le(out, nibbles[i] | ((i + 1 < nibbles.size()) ? nibbles[i + 1] << 4 : 0), 1);
+	}
+	out += coded;
+}
+
+std::string archive_encode(const std::string &text, size_t block_lines) {
+	std::vector<LogLine> lines = split_log(text);
+	size_t blocks = (lines.size() + block_lines - 1) / block_lines;
+	size_t eol_count[4] = { 0 };
+	std::string out;
+
+	if (block_lines == 0 || block_lines > UINT32_MAX) {
+		throw std::runtime_error("bad number of lines per block");
+	}
+
+	// The sensor lines are stored with the line end most lines have
+	for (const LogLine &line : lines) {
+		eol_count[line.eol]++;
+	}
+	uint8_t eol = (uint8_t) (std::max_element(eol_count, eol_count + 4) - eol_count);
+
+	out += MAGIC;
+	put_le(out, ARCHIVE_VERSION, 1);
+	put_le(out, eol, 1);
+	put_le(out, ARCHIVE_AXES, 2);
+	put_le(out, block_lines, 4);
+	put_le(out, blocks, 4);
+	put_le(out, lines.size(), 8);
+	put_le(out, text.size(), 8);
+
+	size_t table = out.size();
+	out.resize(table + blocks * TABLE_ENTRY_BYTES);
+
+	for (size_t b = 0; b < blocks; b++) {
+		size_t first = b * block_lines;
+		size_t count = std::min(block_lines, lines.size() - first);
+		size_t log_bytes = 0;
+		std::string entry;
+
+		for (size_t i = first; i < first + count; i++) {
+			std::string line;
+			print_line(lines[i], line);
+			log_bytes += line.size();
+		}
+		put_le(entry, out.size(), 8);
+		put_le(entry, first, 8);
+		put_le(entry, log_bytes, 8);
+		out.replace(table + b * TABLE_ENTRY_BYTES, TABLE_ENTRY_BYTES, entry);
+
+		encode_block(lines.data() + first, count, eol, out);
+	}
+	return out;
+}
+
+size_t archive_blocks(const std::string &data) {
+	ByteReader in(data, 0);
+
+	if (!is_archive(data)) {
+		throw std::runtime_error("not an IMU archive");
+	}
+	in.take(4);
+	if (in.get(1) != ARCHIVE_VERSION) {
+		throw std::runtime_error("unsupported archive version");
+	}
+	in.get(1);
+	if (in.get(2) != ARCHIVE_AXES) {
+		throw std::runtime_error("archive with another number of axes");
+	}
+	in.get(4);
+	return in.get(4);
+}
+
+static void decode_block(const std::string &data, size_t offset, uint8_t eol,
+		std::vector<LogLine> &lines) {
+	ByteReader in(data, offset);
+	size_t count = in.get(4);
+	size_t verbatim = in.get(4);
+	size_t text_bytes = in.get(4);
+	size_t coded_bytes = in.get(4);
+	ByteReader text(data, offset + 16);
+	std::vector<bool> is_text(count, false);
+	std::vector<LogLine> texts;
+
+	in.take(text_bytes);
+	for (size_t v = 0; v < verbatim; v++) {
+		size_t i = text.get(4);
+		uint8_t line_eol = (uint8_t) text.get(1);
+		size_t len = text.get(4);
+		const char *p = text.take(len);
+
+		if (i >= count || is_text[i] || line_eol > ARCHIVE_EOL_CR) {
+			throw std::runtime_error("bad verbatim line in archive block");
+		}
+		is_text[i] = true;
+		texts.push_back(make_line(p, p + len, line_eol));
+	}
+
+	uint32_t present = (uint32_t) in.get(2);
+	std::vector<int> tables = { 0 };
+	std::vector<std::unique_ptr<HuffmanDecoder>> decoders(TABLES);
+	uint8_t modes[TABLES] = { 0 };
+
+	for (int imu = 0; imu < ARCHIVE_IMUS; imu++) {
+		for (int a = 0; present >> imu & 1 && a < ARCHIVE_AXES; a++) {
+			tables.push_back(delta_table(imu, a));
+		}
+	}
+
+	size_t nibbles = IMU_SYMBOLS + (tables.size() - 1) * (1 + DELTA_SYMBOLS);
+	const char *packed = in.take((nibbles + 1) / 2);
+	size_t i = 0;
+
+	for (int t : tables) {
+		std::vector<uint8_t> len((t == 0) ? IMU_SYMBOLS : DELTA_SYMBOLS);
+
+		if (t != 0) {
+			modes[t] = ((uint8_t) packed[i / 2] >> (4 * (i % 2))) & 0xf;
+			i++;
+			if (modes[t] > (MODE_VALUES | MODE_SHIFT_MASK)) {
+				throw std::runtime_error("bad column mode in archive block");
+			}
+		}
+		for (uint8_t &l : len) {
+			l = ((uint8_t) packed[i / 2] >> (4 * (i % 2))) & 0xf;
+			i++;
+		}
+		decoders[t].reset(new HuffmanDecoder(len));
+	}
+
+	const char *coded = in.take(coded_bytes);
+	BitReader bits(coded, coded + coded_bytes);
+	size_t samples = count - verbatim;
+	size_t base = lines.size();
+	int32_t prev[ARCHIVE_IMUS][ARCHIVE_AXES] = { { 0 } };
+	int prev_imu = 0;
+
+	lines.resize(base + samples);
+	for (size_t n = 0; n < samples; n++) {
+		prev_imu = (prev_imu - decoders[0]->decode(bits)) & (ARCHIVE_IMUS - 1);
+		if (!(present >> prev_imu & 1)) {
+			throw std::runtime_error("IMU without a table in archive block");
+		}
+		lines[base + n].imu = prev_imu;
+		lines[base + n].eol = eol;
+	}
+	for (int a = 0; a < ARCHIVE_AXES; a++) {
+		for (size_t n = 0; n < samples; n++) {
+			LogLine &line = lines[base + n];
+			int t = delta_table(line.imu, a);
+			int len = decoders[t]->decode(bits);
+			uint32_t z = (len > 1) ? (1u << (len - 1)) | bits.get(len - 1) : (uint32_t) len;
+			int32_t d = (z & 1) ? -(int32_t) ((z + 1) / 2) : (int32_t) (z / 2);
+
+			prev[line.imu][a] = (modes[t] & MODE_VALUES) ? d : prev[line.imu][a] + d;
+			line.values[a] = (int16_t) (prev[line.imu][a] * (1 << (modes[t] & MODE_SHIFT_MASK)));
+		}
+	}
+
+	// Put the verbatim lines back between the samples
+	if (verbatim > 0) {
+		std::vector<LogLine> merged;
+		size_t s = base;
+		size_t t = 0;
+
+		merged.reserve(count);
+		for (size_t i = 0; i < count; i++) {
+			merged.push_back(is_text[i] ? std::move(texts[t++]) : std::move(lines[s++]));
+		}
+		lines.resize(base);
+		std::move(merged.begin(), merged.end(), std::back_inserter(lines));
+	}
+}
+
+void archive_decode_lines(const std::string &data, size_t first, size_t count,
+		std::vector<LogLine> &lines) {
+	size_t blocks = archive_blocks(data);
+	uint8_t eol = (uint8_t) data[5];
+
+	if (first > blocks || count > blocks - first || eol > ARCHIVE_EOL_CR) {
+		throw std::runtime_error("blocks beyond the end of the archive");
+	}
+	for (size_t b = first; b < first + count; b++) {
+		ByteReader entry(data, HEADER_BYTES + b * TABLE_ENTRY_BYTES);
+		decode_block(data, entry.get(8), eol, lines);
+	}
+}
+
+std::string archive_decode(const std::string &data, size_t first, size_t count) {
+	std::vector<LogLine> lines;
+	std::string text;
+
+	archive_decode_lines(data, first, std::min(count, archive_blocks(data) - first), lines);
+	for (const LogLine &line : lines) {
+		print_line(line, text);
+	}
+	return text;
+}
+
+long imu_archive_decode(const char *data, size_t size, size_t first, size_t count, char *out,
+		size_t out_size) {
+	try {
+		std::string text = archive_decode(std::string(data, size), first, count);
+
+		if (text.size() > out_size) {
+			return -1;
+		}
+		memcpy(out, text.data(), text.size());
+		return (long) text.size();
+	} catch (const std::exception &) {
+		return -1;
+	}
+}
+
+long imu_archive_decode_samples(const char *data, size_t size, size_t first, size_t count,
+		int16_t *imus, int16_t *values, size_t max_lines) {
+	try {
+		std::vector<LogLine> lines;
+
+		archive_decode_lines(std::string(data, size), first, count, lines);
+		if (lines.size() > max_lines) {
+			return -1;
+		}
+		for (size_t i = 0; i < lines.size(); i++) {
+			imus[i] = (int16_t) lines[i].imu;
+			for (int a = 0; a < ARCHIVE_AXES; a++) {
+				values[i * ARCHIVE_AXES + a] = (lines[i].imu >= 0) ? lines[i].values[a] : 0;
+			}
+		}
+		return (long) lines.size();
+	} catch (const std::exception &) {
+		return -1;
+	}
+}
@@ -0,0 +1,107 @@
+/**
+ * @file        imu_archive.h
+ * @brief       Compressed archive of the raw IMU logs (.imz)
+ * @details     Stores a log as blocks of lines. The sensor lines of a block are kept as columns:
+ *              the IMU numbers, then one column per IMU and axis with each value as the delta
+ *              from the previous value of the same IMU and axis, or as the value itself where
+ *              that takes fewer bits. A column whose values are multiples of 2, 4 or 8 but for a
+ *              few, such as the accelerometer axes of most MPU6050s, is divided by it and the
+ *              few sensor lines that don't fit are kept verbatim. The deltas are zigzag-coded and
+ *              split into their bit length, coded with a canonical Huffman table per IMU, axis and
+ *              block, and the remaining bits stored as they are. Every other line (class
+ *              markers, resets, anything malformed) and every sensor line that wouldn't be
+ *              printed back byte for byte is kept verbatim, so decoding gives back the log
+ *              exactly.
+ *
+ *              A seek table after the header holds the offset of every block; each block starts
+ *              its deltas and IMU numbers from zero, so any block decodes on its own.
+ *
+ *              Layout, all integers little-endian:
+ *
+ *                header   "IMUZ", u8 version, u8 line end of the sensor lines, u16 axes,
+ *                         u32 lines per block, u32 blocks, u64 lines, u64 log bytes
+ *                table    per block: u64 offset, u64 first line, u64 log bytes
+ *                block    u32 lines, u32 verbatim lines, u32 verbatim bytes, u32 coded bytes,
+ *                         per verbatim line: u32 line in the block, u8 line end, u32 length,
+ *                         the verbatim text, u16 mask of the IMUs in the block, as
+ *                         nibbles the code lengths of the IMU table and per axis of each IMU
+ *                         in the mask its mode (bits 0-1 the shift, bit 2 set for values
+ *                         rather than deltas) and code lengths, the bit stream of the
+ *                         columns (LSB first)
+ */
+
+#ifndef __IMU_ARCHIVE_H__
+#define __IMU_ARCHIVE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#define ARCHIVE_VERSION 2
+#define ARCHIVE_AXES 6
+#define ARCHIVE_IMUS 16             // IMU numbers a sensor line can have in the columns
+#define ARCHIVE_BLOCK_LINES 8192
+
+/* Line ends, the logs use all of them */
+enum {
+	ARCHIVE_EOL_NONE,               // last line of a file without one
+	ARCHIVE_EOL_LF,
+	ARCHIVE_EOL_CRLF,
+	ARCHIVE_EOL_CR,
+};
+
+/* A line of a log, either a sensor sample "N: AX v AY v AZ v GX v GY v GZ v" or any other text */
+struct LogLine {
+	int imu;                        // -1 for any other line
+	int16_t values[ARCHIVE_AXES];
+	std::string text;               // other lines, without the line end
+	uint8_t eol;
+};
+
+/* Whether the contents of a file are an archive */
+bool is_archive(const std::string &data);
+
+/*
+ * Split a text log on CR, LF or CRLF into its lines. Lines that print back exactly as a sensor
+ * sample are parsed, every other line is kept as text.
+ */
+std::vector<LogLine> split_log(const std::string &text);
+
+/* The lines of a log, from its text or its archive. Throws std::runtime_error for a bad archive */
+std::vector<LogLine> read_log_lines(const std::string &data);
+
+/* Compress a text log */
+std::string archive_encode(const std::string &text, size_t block_lines = ARCHIVE_BLOCK_LINES);
+
+/* Number of blocks in an archive */
+size_t archive_blocks(const std::string &data);
+
+/* Decode blocks first ... first + count - 1 of an archive into their lines, appended to lines */
+void archive_decode_lines(const std::string &data, size_t first, size_t count,
+		std::vector<LogLine> &lines);
+
+/* Decode blocks first ... first + count - 1 of an archive back into the text of the log */
+std::string archive_decode(const std::string &data, size_t first = 0, size_t count = SIZE_MAX);
+
+extern "C" {
+
+/*
+ * Decode blocks of an archive into out for the Python reader (FinalData/imu_archive.py), which
+ * sizes out from the seek table. Returns the bytes written, or -1 if the archive is bad or out
+ * too small.
+ */
+long imu_archive_decode(const char *data, size_t size, size_t first, size_t count, char *out,
+		size_t out_size);
+
+/*
+ * Decode blocks of an archive into columns for the Python reader: per line its IMU number, or -1
+ * for a line that isn't a sensor sample, and its ARCHIVE_AXES values, 0 for the other lines.
+ * Returns the lines written, or -1 if the archive is bad or the columns too short.
+ */
+long imu_archive_decode_samples(const char *data, size_t size, size_t first, size_t count,
+		int16_t *imus, int16_t *values, size_t max_lines);
+
+}
+
+#endif // __IMU_ARCHIVE_H__
@@ -0,0 +1,210 @@
+/**
+ * @file        imu_eval.cpp
+ * @brief       Batch evaluation of the quantized network over whole recordings
+ * @details     Slides a window over every recording, converts it with the firmware's
+ *              preprocessing and runs it through the bit-exact host model of the network.
+ *              The recordings are calibrated first, as the device calibrates its sensors.
+ *              Prints a confusion matrix and the throughput, optionally every prediction.
+ *
+ *              usage: imu_eval [-j threads] [-k kernels] [-s hop] [-m margin] [-o predictions.csv]
+ *                              [-u] LOG...
+ *
+ *              -j  worker threads, default one per core
+ *              -k  network kernels: auto (default), scalar or avx2
+ *              -s  frames between window starts, default 8 like the firmware
+ *              -m  windows whose best logit leads the runner-up by less than this are rejected
+ *              -o  write one line per window: source, first frame, label, prediction, logits
+ *              -u  leave the recordings uncalibrated, as they were taken
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+#include "classify.h"
+#include "imu_net.h"
+#include "preprocess.h"
+#include "recording.h"
+#include "work_pool.h"
+
+/* Hop the firmware uses: it classifies again after every 8 new frames */
+#define DEFAULT_HOP 8
+
+struct Window {
+	size_t recording;
+	size_t start;
+	int8_t logits[CLASSIFY_CLASSES];
+	int predicted;  // -1 if rejected by the margin
+};
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [-j threads] [-k auto|scalar|avx2] [-s hop] [-m margin] "
+			"[-o predictions.csv] [-u] LOG...\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv) {
+	unsigned threads = 0;
+	NetKernels kernels = NetKernels::Auto;
+	long hop = DEFAULT_HOP;
+	int margin = 0;
+	const char *out_path = NULL;
+	bool calibrate = true;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "j:k:s:m:o:u")) != -1) {
+		switch (opt) {
+		case 'j':
+			threads = (unsigned) atoi(optarg);
+			break;
+		case 'k':
+			if (!strcmp(optarg, "scalar")) {
+				kernels = NetKernels::Scalar;
+			} else if (!strcmp(optarg, "avx2")) {
+				kernels = NetKernels::Avx2;
+			} else if (strcmp(optarg, "auto")) {
+				usage(argv[0]);
+			}
+			break;
+		case 's':
+			hop = atol(optarg);
+			break;
+		case 'm':
+			margin = atoi(optarg);
+			break;
+		case 'o':
+			out_path = optarg;
+			break;
+		case 'u':
+			calibrate = false;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind >= argc || hop <= 0) {
+		usage(argv[0]);
+	}
+
+	std::vector<Recording> recordings;
+	std::unique_ptr<ImuNet> net;
+	std::string err;
+
+	try {
+		recordings = load_logs(std::vector<std::string>(argv + optind, argv + argc));
+		net.reset(new ImuNet(kernels));
+		if (calibrate) {
+			printf("Sensors calibrated: 0x%02x\n", (unsigned) calibrate_recordings(recordings));
+		}
+	} catch (const std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	if (!imu_net_check_sample(*net, &err)) {
+		fprintf(stderr, "network does not reproduce sampleoutput.h: %s\n", err.c_str());
+		return EXIT_FAILURE;
+	}
+
+	// Convert every recording once, windows are cut out of the converted values
+	std::vector<std::vector<int8_t>> values(recordings.size());
+	std::vector<Window> windows;
+
+	for (size_t r = 0; r < recordings.size(); r++) {
+		const Recording &rec = recordings[r];
+
+		values[r].resize(rec.raw.size());
+		preprocess_recording(rec.raw.data(), rec.frames(), values[r].data());
+
+		for (size_t start = 0; start + PREPROCESS_WINDOW <= rec.frames(); start += hop) {
+			windows.push_back({ r, start, { 0 }, -1 });
+		}
+	}
+
+	WorkPool pool(threads);
+	auto begin = std::chrono::steady_clock::now();
+
+	pool.run(windows.size(), [&](size_t task, unsigned) {
+		Window &win = windows[task];
+		uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS];
+
+		preprocess_pack_window(values[win.recording].data() + win.start * PREPROCESS_CHANNELS,
+				words);
+		net->infer(words, win.logits);
+
+		if (classify_margin(win.logits, CLASSIFY_CLASSES) >= margin) {
+			win.predicted = classify_argmax(win.logits, CLASSIFY_CLASSES);
+		}
+	});
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+
+	if (out_path) {
+		FILE *out = fopen(out_path, "w");
+
+		if (!out) {
+			perror(out_path);
+			return EXIT_FAILURE;
+		}
+		fprintf(out, "source,start,label,predicted");
+		for (int c = 0; c < CLASSIFY_CLASSES; c++) {
+			fprintf(out, ",%s", class_names[c]);
+		}
+		fprintf(out, "\n");
+		for (const Window &win : windows) {
+			const Recording &rec = recordings[win.recording];
+
+			fprintf(out, "%s,%zu,%s,%s", rec.source.c_str(), win.start,
+					rec.label >= 0 ? class_names[rec.label] : "unknown",
+					win.predicted >= 0 ? class_names[win.predicted] : "rejected");
+			for (int c = 0; c < CLASSIFY_CLASSES; c++) {
+				fprintf(out, ",%d", win.logits[c]);
+			}
+			fprintf(out, "\n");
+		}
+		fclose(out);
+	}
+
+	// Rows are the labels of the logs, columns the predictions plus rejected windows
+	long confusion[CLASSIFY_CLASSES][CLASSIFY_CLASSES + 1] = { { 0 } };
+	long correct = 0;
+	long labelled = 0;
+
+	for (const Window &win : windows) {
+		int label = recordings[win.recording].label;
+
+		if (label < 0) {
+			continue;
+		}
+		confusion[label][win.predicted >= 0 ? win.predicted : CLASSIFY_CLASSES]++;
+		correct += (win.predicted == label);
+		labelled++;
+	}
+
+	printf("%-12s", "");
+	for (int c = 0; c < CLASSIFY_CLASSES; c++) {
+		printf("%12s", class_names[c]);
+	}
+	printf("%12s\n", "rejected");
+	for (int l = 0; l < CLASSIFY_CLASSES; l++) {
+		printf("%-12s", class_names[l]);
+		for (int c = 0; c <= CLASSIFY_CLASSES; c++) {
+			printf("%12ld", confusion[l][c]);
+		}
+		printf("\n");
+	}
+
+	printf("\n%zu windows (hop %ld, margin %d), accuracy %.1f%% of %ld labelled\n", windows.size(),
+			hop, margin, labelled ? 100.0 * correct / labelled : 0.0, labelled);
+	printf("%u threads, %s kernels, %.3f s, %.0f windows/s, %.2f GMAC/s\n", pool.threads(),
+			net->kernels_name(), elapsed.count(),
+			windows.size() / elapsed.count(),
+			windows.size() * (double) net->macs_per_window() / elapsed.count() / 1e9);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,341 @@
+/**
+ * @file        imu_net.cpp
+ * @brief       Bit-exact host model of the quantized network in ../imu_fixed_inputs_no_softmax
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "imu_net.h"
+#include "weights.h"
+#include "sampledata.h"
+#include "sampleoutput.h"
+
+/* Processors per quadrant and the size of a processor's kernel memory in the KERNELS blob */
+#define PROCS_PER_QUAD 16
+#define NUM_PROCS 64
+#define KERNEL_BASE 0x50180000
+#define KERNEL_QUAD_STRIDE 0x400000
+#define KERNEL_PROC_STRIDE 0x4000
+
+/* Largest activation buffer, layer 1 output: 8 channels of 24x24 */
+#define MAX_ACTIVATIONS (16 * 24 * 24)
+
+const LayerConfig imu_net_layers[] = {
+	// name, procs, in, out, kernel, transposed, pool, relu, bias quadrant, bias offset, shift, linear
+	{ "trans_conv1", 0, 30, 16, 0, true, 1, false, 1, 0, 4, false },
+	{ "trans_conv2", 32, 16, 8, 0, true, 1, false, 2, 0, 1, false },
+	{ "conv1", 56, 8, 8, 0, false, 1, true, 3, 0, 1, false },
+	{ "conv2", 48, 8, 8, 0, false, 2, true, 0, 5, 1, false },
+	{ "conv3", 0, 8, 5, 16, false, 4, true, 2, 8, -1, false },
+	{ "fc", 8, 5, 5, 16, false, 1, false, 0, 0, -1, true },
+};
+
+const int imu_net_num_layers = sizeof(imu_net_layers) / sizeof(imu_net_layers[0]);
+
+static const uint32_t kernel_blob[] = KERNELS;
+static const uint8_t bias_0[] = BIAS_0;
+static const uint8_t bias_1[] = BIAS_1;
+static const uint8_t bias_2[] = BIAS_2;
+static const uint8_t bias_3[] = BIAS_3;
+
+bool ImuNet::avx2_supported() {
+#if IMU_NET_HAVE_AVX2
+	return __builtin_cpu_supports("avx2");
+#else
+	return false;
+#endif
+}
+
+const char *ImuNet::kernels_name() const {
+	return (kernels_ == NetKernels::Avx2) ? "avx2" : "scalar";
+}
+
+ImuNet::ImuNet(NetKernels kernels) {
+	const struct {
+		const uint8_t *data;
+		size_t size;
+	} bias_mem[4] = { { bias_0, sizeof(bias_0) }, { bias_1, sizeof(bias_1) },
+			{ bias_2, sizeof(bias_2) }, { bias_3, sizeof(bias_3) } };
+	std::vector<uint8_t> kernel_mem[NUM_PROCS];
+	const uint32_t *p = kernel_blob;
+	uint32_t addr;
+
+	// Address, word count, words ... per processor, each 9-byte kernel packed MSB first
+	while ((addr = *p++) != 0) {
+		uint32_t len = *p++;
+		uint32_t offset = addr - KERNEL_BASE;
+		int proc = (offset / KERNEL_QUAD_STRIDE) * PROCS_PER_QUAD
+				+ (offset % KERNEL_QUAD_STRIDE) / KERNEL_PROC_STRIDE;
+
+		if (proc >= NUM_PROCS || offset % KERNEL_PROC_STRIDE != 0) {
+			throw std::runtime_error("unexpected kernel address in weights.h");
+		}
+		for (uint32_t i = 0; i < len; i++, p++) {
+			for (int b = 3; b >= 0; b--) {
+				kernel_mem[proc].push_back((uint8_t) (*p >> (8 * b)));
+			}
+		}
+	}
+
+	for (int l = 0; l < imu_net_num_layers; l++) {
+		const LayerConfig &layer = imu_net_layers[l];
+		std::vector<int8_t> w(layer.out_channels * layer.in_channels * 9);
+		std::vector<int8_t> b(layer.out_channels);
+
+		for (int o = 0; o < layer.out_channels; o++) {
+			for (int c = 0; c < layer.in_channels; c++) {
+				const std::vector<uint8_t> &mem = kernel_mem[layer.proc_base + c];
+
+				for (int k = 0; k < 9; k++) {
+					// The linear layer stores the flattened 3x3 input positions in reverse
+					size_t index = (layer.kernel_start + o) * 9 + (layer.linear ? 8 - k : k);
+
+					if (index >= mem.size()) {
+						throw std::runtime_error(std::string("weights.h has no kernel for layer ")
+								+ layer.name);
+					}
+					w[(o * layer.in_channels + c) * 9 + k] = (int8_t) mem[index];
+				}
+			}
+
+			if (layer.bias_offset + o >= (int) bias_mem[layer.bias_group].size) {
+				throw std::runtime_error(std::string("weights.h has no bias for layer ") + layer.name);
+			}
+			b[o] = (int8_t) bias_mem[layer.bias_group].data[layer.bias_offset + o];
+		}
+
+		weights_.push_back(w);
+		biases_.push_back(b);
+
+		// Pairs of taps packed as two int16 in one int32, for multiply-add instructions
+		std::vector<int32_t> pairs(layer.out_channels * layer.in_channels * 5);
+
+		for (int i = 0; i < layer.out_channels * layer.in_channels; i++) {
+			for (int p = 0; p < 5; p++) {
+				uint16_t lo = (uint16_t) w[i * 9 + 2 * p];
+				uint16_t hi = (p < 4) ? (uint16_t) w[i * 9 + 2 * p + 1] : 0;
+
+				pairs[i * 5 + p] = (int32_t) (((uint32_t) hi << 16) | lo);
+			}
+		}
+		weight_pairs_.push_back(pairs);
+	}
+
+	if (kernels == NetKernels::Auto) {
+		kernels = avx2_supported() ? NetKernels::Avx2 : NetKernels::Scalar;
+	}
+	if (kernels == NetKernels::Avx2 && !avx2_supported()) {
+		throw std::runtime_error("AVX2 kernels are not supported on this machine");
+	}
+
+	kernels_ = kernels;
+#if IMU_NET_HAVE_AVX2
+	infer_ = (kernels == NetKernels::Avx2) ? &ImuNet::infer_avx2 : &ImuNet::infer_scalar;
+#else
+	infer_ = &ImuNet::infer_scalar;
+#endif
+}
+
+/* Scale the accumulator back to 8 bits, rounding half up like the accelerator */
+static inline int8_t requantize(int32_t acc, int shift, bool relu) {
+	int sh = 7 + shift;
+	int32_t v = (sh > 0) ? (acc + (1 << (sh - 1))) >> sh : acc << -sh;
+
+	return (int8_t) std::min(127, std::max(relu ? 0 : -128, v));
+}
+
+/* size x size max-pooling of every channel, in place */
+static void max_pool(int8_t *x, int channels, int *height, int *width, int size) {
+	int h = *height / size;
+	int w = *width / size;
+
+	for (int c = 0; c < channels; c++) {
+		const int8_t *in = x + c * *height * *width;
+		int8_t *out = x + c * h * w;
+
+		for (int i = 0; i < h; i++) {
+			for (int j = 0; j < w; j++) {
+				int8_t m = -128;
+
+				for (int a = 0; a < size; a++) {
+					for (int b = 0; b < size; b++) {
+						m = std::max(m, in[(i * size + a) * *width + j * size + b]);
+					}
+				}
+				out[i * w + j] = m;
+			}
+		}
+	}
+	*height = h;
+	*width = w;
+}
+
+void ImuNet::infer_scalar(const uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS],
+		int8_t logits[CLASSIFY_CLASSES]) const {
+	int8_t x[MAX_ACTIVATIONS];
+	int8_t y[MAX_ACTIVATIONS];
+	int8_t up[MAX_ACTIVATIONS];
+	int32_t acc[24 * 24];
+	int h = IMU_NET_INPUT_SIZE;
+	int w = IMU_NET_INPUT_SIZE;
+	int channels = PREPROCESS_WINDOW;
+
+	// Input channel c is byte c % 4 of the group c / 4 words
+	for (int c = 0; c < channels; c++) {
+		for (int i = 0; i < PREPROCESS_CHANNELS; i++) {
+			x[c * PREPROCESS_CHANNELS + i] = (int8_t) (words[c / 4][i] >> (8 * (c % 4)));
+		}
+	}
+
+	for (int l = 0; l < imu_net_num_layers; l++) {
+		const LayerConfig &layer = imu_net_layers[l];
+		const int8_t *wt = weights_[l].data();
+		const int8_t *in = x;
+
+		if (layer.pool > 1) {
+			max_pool(x, channels, &h, &w, layer.pool);
+		}
+
+		if (layer.linear) {
+			for (int o = 0; o < layer.out_channels; o++) {
+				int32_t sum = biases_[l][o] * 128;
+
+				for (int i = 0; i < layer.in_channels * 9; i++) {
+					sum += wt[o * layer.in_channels * 9 + i] * x[i];
+				}
+				logits[o] = requantize(sum, layer.shift, layer.relu);
+			}
+			return;
+		}
+
+		// A stride-2 transposed convolution is a 3x3 convolution over the input spread out to
+		// the even positions of an image twice the size
+		if (layer.transposed) {
+			memset(up, 0, channels * h * w * 4);
+			for (int c = 0; c < channels; c++) {
+				for (int i = 0; i < h; i++) {
+					for (int j = 0; j < w; j++) {
+						up[(c * 2 * h + 2 * i) * 2 * w + 2 * j] = x[(c * h + i) * w + j];
+					}
+				}
+			}
+			h *= 2;
+			w *= 2;
+			in = up;
+		}
+
+		for (int o = 0; o < layer.out_channels; o++) {
+			std::fill(acc, acc + h * w, biases_[l][o] * 128);
+
+			for (int c = 0; c < channels; c++) {
+				const int8_t *plane = in + c * h * w;
+
+				for (int a = 0; a < 3; a++) {
+					for (int b = 0; b < 3; b++) {
+						int32_t k = wt[(o * channels + c) * 9 + a * 3 + b];
+						int j0 = std::max(0, 1 - b);
+						int j1 = std::min(w, w + 1 - b);
+
+						for (int i = std::max(0, 1 - a); i < std::min(h, h + 1 - a); i++) {
+							const int8_t *row = plane + (i + a - 1) * w + b - 1;
+							int32_t *out = acc + i * w;
+
+							for (int j = j0; j < j1; j++) {
+								out[j] += k * row[j];
+							}
+						}
+					}
+				}
+			}
+
+			for (int i = 0; i < h * w; i++) {
+				y[o * h * w + i] = requantize(acc[i], layer.shift, layer.relu);
+			}
+		}
+
+		channels = layer.out_channels;
+		memcpy(x, y, channels * h * w);
+	}
+}
+
+long ImuNet::macs_per_window() const {
+	long macs = 0;
+	int size = IMU_NET_INPUT_SIZE;
+
+	for (int l = 0; l < imu_net_num_layers; l++) {
+		const LayerConfig &layer = imu_net_layers[l];
+
+		size = size / layer.pool * (layer.transposed ? 2 : 1);
+		if (layer.linear) {
+			macs += (long) layer.out_channels * layer.in_channels * size * size;
+		} else {
+			macs += (long) layer.out_channels * layer.in_channels * 9 * size * size;
+		}
+	}
+	return macs;
+}
+
+bool imu_net_check_sample(const ImuNet &net, std::string *err) {
+	static const uint32_t input_0[] = SAMPLE_INPUT_0;
+	static const uint32_t input_4[] = SAMPLE_INPUT_4;
+	static const uint32_t input_8[] = SAMPLE_INPUT_8;
+	static const uint32_t input_12[] = SAMPLE_INPUT_12;
+	static const uint32_t input_16[] = SAMPLE_INPUT_16;
+	static const uint32_t input_20[] = SAMPLE_INPUT_20;
+	static const uint32_t input_24[] = SAMPLE_INPUT_24;
+	static const uint32_t input_28[] = SAMPLE_INPUT_28;
+	static const uint32_t sample_output[] = SAMPLE_OUTPUT;
+	const uint32_t *inputs[PREPROCESS_GROUPS] = { input_0, input_4, input_8, input_12, input_16,
+			input_20, input_24, input_28 };
+	uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS];
+	uint32_t out_mem[2] = { 0 };
+	int8_t logits[CLASSIFY_CLASSES];
+	int8_t decoded[CLASSIFY_CLASSES];
+	char msg[128];
+
+	for (int g = 0; g < PREPROCESS_GROUPS; g++) {
+		memcpy(words[g], inputs[g], sizeof(words[g]));
+	}
+	net.infer(words, logits);
+
+	// The output layer writes channel c to byte c % 4 of the first word of processor group c / 4
+	for (int c = 0; c < CLASSIFY_CLASSES; c++) {
+		out_mem[c / 4] |= (uint32_t) (uint8_t) logits[c] << (8 * (c % 4));
+	}
+
+	// Address, mask, word count, words ... terminated by a zero address
+	for (const uint32_t *p = sample_output; *p != 0; p += 3 + p[2]) {
+		int group = (p[0] - 0x50400000) / 0x8000;
+
+		if (p[2] != 1 || group < 0 || group > 1) {
+			*err = "unexpected layout of sampleoutput.h";
+			return false;
+		}
+		if ((out_mem[group] & p[1]) != p[3]) {
+			snprintf(msg, sizeof(msg), "output word 0x%08x: expected 0x%08x, got 0x%08x",
+					(unsigned) p[0], (unsigned) p[3], (unsigned) (out_mem[group] & p[1]));
+			*err = msg;
+			return false;
+		}
+	}
+
+	// Unload the same way cnn_unload() does and decode with the firmware's code
+	uint32_t ml_data[CLASSIFY_UNLOAD_WORDS] = { 0 };
+	uint16_t *out_buf = (uint16_t*) ml_data;
+
+	for (int i = 0; i < 2; i++) {
+		for (int b = 0; b < 4; b++) {
+			*out_buf++ = (uint16_t) (((out_mem[i] >> (8 * b)) & 0xff) << 6);
+		}
+	}
+	classify_logits(ml_data, decoded);
+
+	if (memcmp(decoded, logits, sizeof(logits)) != 0) {
+		*err = "classify_logits() does not decode the unloaded output";
+		return false;
+	}
+	return true;
+}
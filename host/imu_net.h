@@ -0,0 +1,111 @@
+/**
+ * @file        imu_net.h
+ * @brief       Bit-exact host model of the quantized network in ../imu_fixed_inputs_no_softmax
+ * @details     Kernels and biases come straight from the generated weights.h, the layer
+ *              configuration mirrors cnn_configure() in cnn.c, so the logits match what the
+ *              accelerator leaves in data memory for the same input words.
+ */
+
+#ifndef __IMU_NET_H__
+#define __IMU_NET_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "classify.h"
+#include "preprocess.h"
+
+/* One accelerator layer as configured by cnn_configure() */
+struct LayerConfig {
+	const char *name;
+	int proc_base;      // first processor holding the kernels (one input channel per processor)
+	int in_channels;
+	int out_channels;
+	int kernel_start;   // first 3x3 kernel used in each processor's kernel memory
+	bool transposed;    // stride-2 transposed convolution, output is twice the input size
+	int pool;           // max-pool size applied to the input, 1 = none
+	bool relu;
+	int bias_group;     // bias memory quadrant
+	int bias_offset;
+	int shift;          // output shift, the accumulator is scaled down by 2^(7 + shift)
+	bool linear;        // flattened fully connected layer
+};
+
+extern const LayerConfig imu_net_layers[];
+extern const int imu_net_num_layers;
+
+/* The AVX2 kernels are built on x86 hosts only */
+#if defined(__x86_64__) || defined(__i386__)
+#define IMU_NET_HAVE_AVX2 1
+#else
+#define IMU_NET_HAVE_AVX2 0
+#endif
+
+/* Width and height of the input image, one pixel per IMU axis */
+#define IMU_NET_INPUT_SIZE 6
+
+/* Layer kernels used by ImuNet::infer(), all of them give bit-identical results */
+enum class NetKernels {
+	Auto,       // fastest the CPU supports
+	Scalar,     // portable reference
+	Avx2,
+};
+
+class ImuNet {
+public:
+	/*
+	 * Unpacks weights.h, throws std::runtime_error if it doesn't match the layer table or the
+	 * requested kernels aren't supported by this CPU
+	 */
+	explicit ImuNet(NetKernels kernels = NetKernels::Auto);
+
+	/* Run one window given as the cnn_input0 ... cnn_input28 words the firmware loads */
+	void infer(const uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS],
+			int8_t logits[CLASSIFY_CLASSES]) const {
+		(this->*infer_)(words, logits);
+	}
+
+	NetKernels kernels() const { return kernels_; }
+	const char *kernels_name() const;
+
+	/* Whether this build and CPU can run the AVX2 kernels */
+	static bool avx2_supported();
+
+	/* Weight of output o, input channel c and tap k (0 ... 8, row major) of a layer */
+	int8_t weight(int layer, int o, int c, int k) const {
+		return weights_[layer][(o * imu_net_layers[layer].in_channels + c) * 9 + k];
+	}
+
+	int8_t bias(int layer, int o) const { return biases_[layer][o]; }
+
+	/* Weights of a conv layer as int16 pairs (taps 0/1, 2/3, 4/5, 6/7, 8/none) per output and input */
+	const int32_t *weight_pairs(int layer) const { return weight_pairs_[layer].data(); }
+
+	/* Multiply-accumulates per window as the accelerator counts them */
+	long macs_per_window() const;
+
+private:
+	typedef void (ImuNet::*InferFn)(const uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS],
+			int8_t logits[CLASSIFY_CLASSES]) const;
+
+	void infer_scalar(const uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS],
+			int8_t logits[CLASSIFY_CLASSES]) const;
+	void infer_avx2(const uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS],
+			int8_t logits[CLASSIFY_CLASSES]) const;
+
+	NetKernels kernels_;
+	InferFn infer_;
+	std::vector<std::vector<int8_t>> weights_;
+	std::vector<std::vector<int8_t>> biases_;
+	std::vector<std::vector<int32_t>> weight_pairs_;
+};
+
+/*
+ * Run the network on SAMPLE_INPUT_* from sampledata.h and compare with SAMPLE_OUTPUT, then unload
+ * the result the way cnn_unload() does and decode it with classify_logits(). Returns false and
+ * describes the first difference in err if anything doesn't match.
+ */
+bool imu_net_check_sample(const ImuNet &net, std::string *err);
+
+#endif // __IMU_NET_H__
@@ -0,0 +1,195 @@
+/**
+ * @file        imu_net_avx2.cpp
+ * @brief       AVX2 kernels for the host model of the quantized network
+ * @details     Built with -mavx2 and only called after ImuNet checked the CPU supports it.
+ *              Activations are kept as int16 planes with a one pixel zero border, so a 3x3
+ *              convolution becomes nine shifted multiply-adds over the flattened plane without
+ *              any edge handling. The columns that fall on the border are computed and dropped.
+ *              Integer sums are exact, so the results are bit-identical to the scalar kernels.
+ */
+
+#include "imu_net.h"
+
+#if IMU_NET_HAVE_AVX2
+
+#include <algorithm>
+#include <cstring>
+#include <immintrin.h>
+
+/* int16 elements per channel plane, enough for 26x26 plus the overrun of the last vector */
+#define PLANE_STRIDE 768
+
+/* Elements past the padded plane read by the last vector of a row sweep */
+#define PLANE_SLACK 32
+
+/* Most channels of any activation (layer 0 output) */
+#define MAX_CHANNELS 32
+
+struct Planes {
+	alignas(32) int16_t data[MAX_CHANNELS * PLANE_STRIDE];
+
+	int16_t *plane(int c) { return data + c * PLANE_STRIDE; }
+	const int16_t *plane(int c) const { return data + c * PLANE_STRIDE; }
+};
+
+/*
+ * Copy unpadded h x w planes into zero-bordered planes for the next convolution, max-pooling
+ * them by pool first and spreading them to the even positions of a twice as large image for a
+ * transposed convolution. Updates h and w to the size the convolution sees.
+ */
+static void prepare_input(const Planes &in, int channels, int *h, int *w, int pool,
+		bool transposed, Planes &out) {
+	int16_t pooled[24 * 24];
+	int ph = *h / pool;
+	int pw = *w / pool;
+	int scale = transposed ? 2 : 1;
+	int oh = ph * scale;
+	int ow = pw * scale;
+	int wp = ow + 2;
+
+	for (int c = 0; c < channels; c++) {
+		const int16_t *src = in.plane(c);
+		int16_t *dst = out.plane(c);
+
+		if (pool > 1) {
+			for (int i = 0; i < ph; i++) {
+				alignas(32) int16_t row[32];
+
+				// Vertical maximum of the pool rows a vector at a time, then across each window
+				for (int j = 0; j < *w; j += 16) {
+					__m256i m = _mm256_loadu_si256((const __m256i*) (src + i * pool * *w + j));
+
+					for (int a = 1; a < pool; a++) {
+						m = _mm256_max_epi16(m, _mm256_loadu_si256(
+								(const __m256i*) (src + (i * pool + a) * *w + j)));
+					}
+					_mm256_store_si256((__m256i*) (row + j), m);
+				}
+				for (int j = 0; j < pw; j++) {
+					pooled[i * pw + j] = *std::max_element(row + j * pool, row + (j + 1) * pool);
+				}
+			}
+			src = pooled;
+		}
+
+		memset(dst, 0, sizeof(int16_t) * ((oh + 2) * wp + PLANE_SLACK));
+		for (int i = 0; i < ph; i++) {
+			for (int j = 0; j < pw; j++) {
+				dst[(i * scale + 1) * wp + j * scale + 1] = src[i * pw + j];
+			}
+		}
+	}
+
+	*h = oh;
+	*w = ow;
+}
+
+/* 3x3 convolution over zero-bordered planes, writes unpadded h x w int16 planes */
+static void conv3x3(const Planes &in, int channels, int h, int w, const int32_t *pairs,
+		const int8_t *bias, int out_channels, int shift, bool relu, Planes &out) {
+	alignas(32) int16_t result[PLANE_STRIDE];
+	int wp = w + 2;
+	int n = h * wp;
+	int sh = 7 + shift;
+	int first[5], second[5];
+
+	// Offsets of the two taps of each weight pair, the last pair has a zero second weight
+	for (int p = 0; p < 5; p++) {
+		int k1 = 2 * p;
+		int k2 = std::min(2 * p + 1, 8);
+
+		first[p] = (k1 / 3) * wp + k1 % 3;
+		second[p] = (k2 / 3) * wp + k2 % 3;
+	}
+
+	const __m128i count = _mm_cvtsi32_si128(sh > 0 ? sh : -sh);
+	const __m256i round = _mm256_set1_epi32(sh > 0 ? 1 << (sh - 1) : 0);
+	const __m256i floor = _mm256_set1_epi16(relu ? 0 : -128);
+	const __m256i ceil = _mm256_set1_epi16(127);
+
+	for (int o = 0; o < out_channels; o++) {
+		const int32_t *wo = pairs + o * channels * 5;
+		const __m256i start = _mm256_set1_epi32(bias[o] * 128);
+
+		for (int t = 0; t < n; t += 16) {
+			// lo holds outputs t + 0...3 and t + 8...11, hi t + 4...7 and t + 12...15
+			__m256i lo = start;
+			__m256i hi = start;
+
+			for (int c = 0; c < channels; c++) {
+				const int16_t *x = in.plane(c) + t;
+
+				for (int p = 0; p < 5; p++) {
+					__m256i a = _mm256_loadu_si256((const __m256i*) (x + first[p]));
+					__m256i b = _mm256_loadu_si256((const __m256i*) (x + second[p]));
+					__m256i k = _mm256_set1_epi32(wo[c * 5 + p]);
+
+					lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), k));
+					hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), k));
+				}
+			}
+
+			if (sh > 0) {
+				lo = _mm256_sra_epi32(_mm256_add_epi32(lo, round), count);
+				hi = _mm256_sra_epi32(_mm256_add_epi32(hi, round), count);
+			} else {
+				lo = _mm256_sll_epi32(lo, count);
+				hi = _mm256_sll_epi32(hi, count);
+			}
+
+			// Packing the halves back together restores the output order
+			__m256i v = _mm256_packs_epi32(lo, hi);
+			v = _mm256_min_epi16(_mm256_max_epi16(v, floor), ceil);
+			_mm256_store_si256((__m256i*) (result + t), v);
+		}
+
+		int16_t *dst = out.plane(o);
+		for (int i = 0; i < h; i++) {
+			memcpy(dst + i * w, result + i * wp, sizeof(int16_t) * w);
+		}
+	}
+}
+
+void ImuNet::infer_avx2(const uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS],
+		int8_t logits[CLASSIFY_CLASSES]) const {
+	Planes a, b;
+	int h = IMU_NET_INPUT_SIZE;
+	int w = IMU_NET_INPUT_SIZE;
+	int channels = PREPROCESS_WINDOW;
+
+	// Input channel c is byte c % 4 of the group c / 4 words
+	for (int c = 0; c < channels; c++) {
+		for (int i = 0; i < PREPROCESS_CHANNELS; i++) {
+			a.plane(c)[i] = (int8_t) (words[c / 4][i] >> (8 * (c % 4)));
+		}
+	}
+
+	for (int l = 0; l < imu_net_num_layers; l++) {
+		const LayerConfig &layer = imu_net_layers[l];
+
+		if (layer.linear) {
+			// 225 multiply-accumulates, not worth vectorizing
+			for (int o = 0; o < layer.out_channels; o++) {
+				int32_t sum = bias(l, o) * 128;
+
+				for (int c = 0; c < layer.in_channels; c++) {
+					for (int k = 0; k < 9; k++) {
+						sum += weight(l, o, c, k) * a.plane(c)[k];
+					}
+				}
+
+				int sh = 7 + layer.shift;
+				int32_t v = (sh > 0) ? (sum + (1 << (sh - 1))) >> sh : sum << -sh;
+				logits[o] = (int8_t) std::min(127, std::max(layer.relu ? 0 : -128, v));
+			}
+			return;
+		}
+
+		prepare_input(a, channels, &h, &w, layer.pool, layer.transposed, b);
+		conv3x3(b, channels, h, w, weight_pairs(l), biases_[l].data(), layer.out_channels,
+				layer.shift, layer.relu, a);
+		channels = layer.out_channels;
+	}
+}
+
+#endif // IMU_NET_HAVE_AVX2
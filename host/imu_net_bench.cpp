@@ -0,0 +1,211 @@
+/**
+ * @file        imu_net_bench.cpp
+ * @brief       Microbenchmarks and equality checks for the network kernels
+ * @details     Every kernel set this machine supports is first checked bit for bit against the
+ *              scalar reference on the sample input, on every recorded window and on random
+ *              windows that exercise the saturation limits, then timed on each input set with
+ *              one thread and with all cores. Exits nonzero on any difference.
+ *
+ *              usage: imu_net_bench [-j threads] [-s hop] [LOG...]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+#include "imu_net.h"
+#include "preprocess.h"
+#include "recording.h"
+#include "work_pool.h"
+#include "sampledata.h"
+
+/* Random windows checked on top of the recordings */
+#define RANDOM_WINDOWS 5000
+
+/* Each timing runs for at least this long */
+#define MIN_BENCH_SECONDS 1.0
+
+struct WindowWords {
+	uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS];
+};
+
+struct InputSet {
+	const char *name;
+	std::vector<WindowWords> windows;
+};
+
+static InputSet sample_set() {
+	static const uint32_t input_0[] = SAMPLE_INPUT_0;
+	static const uint32_t input_4[] = SAMPLE_INPUT_4;
+	static const uint32_t input_8[] = SAMPLE_INPUT_8;
+	static const uint32_t input_12[] = SAMPLE_INPUT_12;
+	static const uint32_t input_16[] = SAMPLE_INPUT_16;
+	static const uint32_t input_20[] = SAMPLE_INPUT_20;
+	static const uint32_t input_24[] = SAMPLE_INPUT_24;
+	static const uint32_t input_28[] = SAMPLE_INPUT_28;
+	const uint32_t *inputs[PREPROCESS_GROUPS] = { input_0, input_4, input_8, input_12, input_16,
+			input_20, input_24, input_28 };
+	InputSet set = { "sample", std::vector<WindowWords>(1) };
+
+	for (int g = 0; g < PREPROCESS_GROUPS; g++) {
+		memcpy(set.windows[0].words[g], inputs[g], sizeof(set.windows[0].words[g]));
+	}
+	return set;
+}
+
+static InputSet recorded_set(const std::vector<Recording> &recordings, long hop) {
+	InputSet set = { "recorded", {} };
+
+	for (const Recording &rec : recordings) {
+		std::vector<int8_t> values(rec.raw.size());
+
+		preprocess_recording(rec.raw.data(), rec.frames(), values.data());
+		for (size_t start = 0; start + PREPROCESS_WINDOW <= rec.frames(); start += hop) {
+			set.windows.emplace_back();
+			preprocess_pack_window(values.data() + start * PREPROCESS_CHANNELS,
+					set.windows.back().words);
+		}
+	}
+	return set;
+}
+
+/* Uniformly random bytes, plus windows stuck at the limits of the input range */
+static InputSet random_set() {
+	InputSet set = { "random", std::vector<WindowWords>(RANDOM_WINDOWS) };
+	uint32_t seed = 1;
+
+	for (size_t n = 0; n < set.windows.size(); n++) {
+		for (int g = 0; g < PREPROCESS_GROUPS; g++) {
+			for (int i = 0; i < PREPROCESS_CHANNELS; i++) {
+				seed = seed * 1664525 + 1013904223;
+				set.windows[n].words[g][i] = (n == 0) ? 0x7f7f7f7f : (n == 1) ? 0x80808080 : seed;
+			}
+		}
+	}
+	return set;
+}
+
+static bool check(const ImuNet &ref, const ImuNet &net, const InputSet &set) {
+	for (size_t n = 0; n < set.windows.size(); n++) {
+		int8_t expected[CLASSIFY_CLASSES];
+		int8_t logits[CLASSIFY_CLASSES];
+
+		ref.infer(set.windows[n].words, expected);
+		net.infer(set.windows[n].words, logits);
+
+		if (memcmp(expected, logits, sizeof(logits)) != 0) {
+			fprintf(stderr, "%s kernels differ from scalar on %s window %zu\n", net.kernels_name(),
+					set.name, n);
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Windows per second over the set, cycling through it until the minimum time is reached */
+static double windows_per_second(const ImuNet &net, const InputSet &set, WorkPool &pool) {
+	const size_t batch = std::max<size_t>(set.windows.size(), 256);
+	std::atomic<uint32_t> sink(0);
+	size_t done = 0;
+	auto start = std::chrono::steady_clock::now();
+	std::chrono::duration<double> elapsed;
+
+	do {
+		pool.run(batch, [&](size_t task, unsigned) {
+			int8_t logits[CLASSIFY_CLASSES];
+
+			net.infer(set.windows[task % set.windows.size()].words, logits);
+			sink += (uint8_t) logits[0];
+		});
+		done += batch;
+		elapsed = std::chrono::steady_clock::now() - start;
+	} while (elapsed.count() < MIN_BENCH_SECONDS);
+
+	return done / elapsed.count();
+}
+
+int main(int argc, char **argv) {
+	unsigned threads = 0;
+	long hop = 8;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "j:s:")) != -1) {
+		switch (opt) {
+		case 'j':
+			threads = (unsigned) atoi(optarg);
+			break;
+		case 's':
+			hop = atol(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-j threads] [-s hop] [LOG...]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::vector<InputSet> sets;
+	std::vector<std::unique_ptr<ImuNet>> nets;
+	std::unique_ptr<ImuNet> ref;
+
+	try {
+		sets.push_back(sample_set());
+		if (optind < argc) {
+			sets.push_back(recorded_set(load_logs(std::vector<std::string>(argv + optind,
+					argv + argc)), hop > 0 ? hop : 8));
+		}
+		sets.push_back(random_set());
+
+		ref.reset(new ImuNet(NetKernels::Scalar));
+		nets.emplace_back(new ImuNet(NetKernels::Scalar));
+		if (ImuNet::avx2_supported()) {
+			nets.emplace_back(new ImuNet(NetKernels::Avx2));
+		}
+	} catch (const std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	for (const auto &net : nets) {
+		std::string err;
+
+		if (!imu_net_check_sample(*net, &err)) {
+			fprintf(stderr, "%s kernels: %s\n", net->kernels_name(), err.c_str());
+			return EXIT_FAILURE;
+		}
+		for (const InputSet &set : sets) {
+			if (!check(*ref, *net, set)) {
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	printf("all kernels bit-identical to scalar on");
+	for (const InputSet &set : sets) {
+		printf(" %zu %s", set.windows.size(), set.name);
+	}
+	printf(" windows\n\n");
+
+	WorkPool single(1);
+	WorkPool all(threads);
+
+	printf("%-8s %-10s %16s %16s %16s\n", "kernels", "input", "windows/s 1 thr",
+			"windows/s all", "per core");
+	for (const auto &net : nets) {
+		for (const InputSet &set : sets) {
+			double one = windows_per_second(*net, set, single);
+			double many = windows_per_second(*net, set, all);
+
+			printf("%-8s %-10s %16.0f %16.0f %16.0f\n", net->kernels_name(), set.name, one, many,
+					many / all.threads());
+		}
+	}
+	printf("\n%u threads, %ld MAC per window\n", all.threads(), ref->macs_per_window());
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+/**
+ * @file        imu_pack.cpp
+ * @brief       Packs the raw IMU logs into archives (.imz) and back
+ * @details     The archive format is described in imu_archive.h; every host tool reads archives
+ *              wherever it takes a log. With -c nothing is written: each log is packed in memory,
+ *              unpacked and compared byte for byte and line by line, and the sizes, the
+ *              compression ratio and the time to get the parsed lines from the text and from the
+ *              archive are printed. Exits nonzero if a log doesn't come back exactly.
+ *
+ *              usage: imu_pack [-b lines] LOG ARCHIVE
+ *                     imu_pack -d ARCHIVE LOG
+ *                     imu_pack -c [-b lines] LOG...
+ *
+ *              -b  lines per block, the unit of random access, default ARCHIVE_BLOCK_LINES
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "imu_archive.h"
+
+/* Repeat the timing runs until at least this long was spent on each */
+#define MIN_BENCH_SECONDS 0.5
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [-b lines] LOG ARCHIVE\n"
+			"       %s -d ARCHIVE LOG\n"
+			"       %s -c [-b lines] LOG...\n", prog, prog, prog);
+	exit(EXIT_FAILURE);
+}
+
+static std::string read_file(const std::string &path) {
+	std::ifstream file(path, std::ios::binary);
+	std::ostringstream data;
+
+	if (!file) {
+		throw std::runtime_error("cannot open " + path);
+	}
+	data << file.rdbuf();
+	return data.str();
+}
+
+static void write_file(const std::string &path, const std::string &data) {
+	std::ofstream file(path, std::ios::binary);
+
+	if (!file.write(data.data(), data.size())) {
+		throw std::runtime_error("cannot write " + path);
+	}
+}
+
+static bool same_lines(const std::vector<LogLine> &a, const std::vector<LogLine> &b) {
+	if (a.size() != b.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].imu != b[i].imu || a[i].eol != b[i].eol || a[i].text != b[i].text
+				|| (a[i].imu >= 0 && memcmp(a[i].values, b[i].values, sizeof(a[i].values)))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Seconds per call of fn, the best of repeated runs */
+template<typename F>
+static double time_best(F fn) {
+	double best = 1e9;
+	double total = 0;
+
+	while (total < MIN_BENCH_SECONDS) {
+		auto start = std::chrono::steady_clock::now();
+		fn();
+		double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		best = std::min(best, s);
+		total += s;
+	}
+	return best;
+}
+
+static bool check(const std::string &path, size_t block_lines, size_t totals[2]) {
+	std::string text = read_file(path);
+	std::string archive = archive_encode(text, block_lines);
+	std::vector<LogLine> lines = read_log_lines(text);
+	bool exact = (archive_decode(archive) == text);
+	bool parsed = same_lines(read_log_lines(archive), lines);
+	size_t blocks = archive_blocks(archive);
+
+	double parse_s = time_best([&] { read_log_lines(text); });
+	double decode_s = time_best([&] { read_log_lines(archive); });
+	double block_s = time_best([&] {
+		std::vector<LogLine> block;
+		archive_decode_lines(archive, blocks / 2, 1, block);
+	});
+
+	printf("%-40s %9zu %8zu %6.2fx %8.2f ms %8.2f ms %8.3f ms  %s\n", path.c_str(), text.size(),
+			archive.size(), (double) text.size() / archive.size(), parse_s * 1e3, decode_s * 1e3,
+			block_s * 1e3, (exact && parsed) ? "exact" : "MISMATCH");
+
+	totals[0] += text.size();
+	totals[1] += archive.size();
+	return exact && parsed;
+}
+
+int main(int argc, char **argv) {
+	size_t block_lines = ARCHIVE_BLOCK_LINES;
+	bool decode = false;
+	bool check_only = false;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "b:dc")) != -1) {
+		switch (opt) {
+		case 'b':
+			block_lines = strtoul(optarg, nullptr, 0);
+			break;
+		case 'd':
+			decode = true;
+			break;
+		case 'c':
+			check_only = true;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (block_lines == 0 || (decode && check_only) || optind >= argc
+			|| (!check_only && argc - optind != 2)) {
+		usage(argv[0]);
+	}
+
+	try {
+		if (!check_only) {
+			std::string in = read_file(argv[optind]);
+
+			write_file(argv[optind + 1], decode ? archive_decode(in) : archive_encode(in,
+					block_lines));
+			return EXIT_SUCCESS;
+		}
+
+		size_t totals[2] = { 0, 0 };
+		bool ok = true;
+
+		printf("%-40s %9s %8s %7s %11s %11s %11s\n", "", "text", "archive", "ratio", "parse text",
+				"decode", "one block");
+		for (int i = optind; i < argc; i++) {
+			ok = check(argv[i], block_lines, totals) && ok;
+		}
+		printf("%-40s %9zu %8zu %6.2fx\n", "total", totals[0], totals[1],
+				(double) totals[0] / std::max<size_t>(totals[1], 1));
+		return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+	} catch (const std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,169 @@
+/**
+ * @file        imu_receive.cpp
+ * @brief       Receives the binary frames of the data-collection sketch and writes them as a log
+ * @details     Reads the serial port of the Arduino running ArduinoCode/FullBodyTracking2.ino
+ *              with BINARY_MODE 1 (or a capture of it from stdin with "-") until interrupted, the
+ *              time is up or the input ends, then writes the frames as a log in the format of
+ *              FinalData, or as an archive if OUT ends in .imz. Prints the frames received, the
+ *              frame rate from the sketch's timestamps and the frames lost or corrupted once a
+ *              second and at the end.
+ *
+ *              usage: imu_receive [-b baud] [-l label] [-t seconds] DEVICE|- OUT
+ *
+ *              -b  baud rate, default the sketch's BINARY_BAUD
+ *              -l  class marker on top of the log (e.g. UPSTAIRS)
+ *              -t  stop after this long, default when interrupted
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+#include "collect.h"
+
+#define DEFAULT_BAUD 500000
+
+static volatile sig_atomic_t stop;
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [-b baud] [-l label] [-t seconds] DEVICE|- OUT\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+static void on_signal(int) {
+	stop = 1;
+}
+
+static speed_t baud_constant(long baud) {
+	switch (baud) {
+	case 57600:
+		return B57600;
+	case 115200:
+		return B115200;
+	case 230400:
+		return B230400;
+	case 460800:
+		return B460800;
+	case 500000:
+		return B500000;
+	case 1000000:
+		return B1000000;
+	default:
+		throw std::runtime_error("unsupported baud rate " + std::to_string(baud));
+	}
+}
+
+/* Open a serial port raw, 8N1, reads returning after at most 100 ms */
+static int open_port(const std::string &device, long baud) {
+	int fd = open(device.c_str(), O_RDONLY | O_NOCTTY);
+	struct termios tio;
+
+	if (fd < 0) {
+		throw std::runtime_error("cannot open " + device + ": " + strerror(errno));
+	}
+	if (tcgetattr(fd, &tio) != 0) {
+		close(fd);
+		throw std::runtime_error(device + " is not a serial port");
+	}
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, baud_constant(baud));
+	cfsetospeed(&tio, baud_constant(baud));
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 1;
+	if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+		close(fd);
+		throw std::runtime_error("cannot set up " + device);
+	}
+	tcflush(fd, TCIFLUSH);
+	return fd;
+}
+
+static void report(const std::vector<CollectFrame> &frames, const CollectDecoder &decoder) {
+	double span = frames.size() > 1 ? (frames.back().micros - frames.front().micros) / 1e6 : 0;
+
+	fprintf(stderr, "%zu frames, %.1f frames/s, %ld lost, %ld bad checksums\n", frames.size(),
+			span > 0 ? (frames.size() - 1) / span : 0.0, decoder.lost_frames, decoder.bad_checksums);
+}
+
+int main(int argc, char **argv) {
+	long baud = DEFAULT_BAUD;
+	std::string label;
+	double seconds = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "b:l:t:")) != -1) {
+		switch (opt) {
+		case 'b':
+			baud = atol(optarg);
+			break;
+		case 'l':
+			label = optarg;
+			break;
+		case 't':
+			seconds = atof(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (argc - optind != 2) {
+		usage(argv[0]);
+	}
+	std::string device = argv[optind];
+	std::string out = argv[optind + 1];
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	try {
+		int fd = (device == "-") ? STDIN_FILENO : open_port(device, baud);
+		auto start = std::chrono::steady_clock::now();
+		auto last_report = start;
+		CollectDecoder decoder;
+		std::vector<CollectFrame> frames;
+		uint8_t buf[4096];
+
+		while (!stop) {
+			ssize_t n = read(fd, buf, sizeof(buf));
+			auto now = std::chrono::steady_clock::now();
+
+			if (n < 0 && errno != EINTR) {
+				throw std::runtime_error("cannot read " + device + ": " + strerror(errno));
+			}
+			if (n == 0 && device == "-") {
+				break;
+			}
+			if (n > 0) {
+				decoder.push(buf, n, frames);
+			}
+			if (now - last_report >= std::chrono::seconds(1)) {
+				report(frames, decoder);
+				last_report = now;
+			}
+			if (seconds > 0 && now - start >= std::chrono::duration<double>(seconds)) {
+				break;
+			}
+		}
+		if (fd != STDIN_FILENO) {
+			close(fd);
+		}
+
+		report(frames, decoder);
+		collect_write_log(out, frames, label);
+		fprintf(stderr, "wrote %s\n", out.c_str());
+	} catch (const std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,433 @@
+/**
+ * @file        imu_replay.cpp
+ * @brief       Replay of the recordings through the firmware's inference schedule
+ * @details     Cuts the recordings into pieces and joins them into one stream that alternates
+ *              between their activities, so every join is an activity transition, converts it with
+ *              the firmware's preprocessing and classifies windows the way the firmware would: the
+ *              first after 30 frames, every next one after the hop the scheduler returns. A fixed
+ *              hop and the adaptive hop are replayed over the same stream and compared on
+ *              inferences per minute, accuracy and the delay from a transition until the new
+ *              activity is first reported. Both are given for the plain argmax, which used to send
+ *              two messages per inference, and for the smoothed state, which only sends one when
+ *              it changes and on the heartbeat.
+ *
+ *              Every piece is also replayed as if the device had just been strapped on: the
+ *              partial windows of the warm-up are classified with their older frames padded as
+ *              still, and the time to the first label and to the first correct one are compared
+ *              with waiting for the full window.
+ *
+ *              The recordings are calibrated first, as the device calibrates its sensors.
+ *
+ *              usage: imu_replay [-j threads] [-s hop] [-n min] [-x max] [-w frames] [-r rate]
+ *                                [-c seconds] [-u] LOG...
+ *
+ *              -j  worker threads, default one per core
+ *              -s  fixed hop to compare with, default 8 like the firmware used to have
+ *              -n  smallest adaptive hop, default SCHEDULER_HOP_MIN
+ *              -x  largest adaptive hop, default SCHEDULER_HOP_MAX
+ *              -w  frames of the first partial window, default SCHEDULER_WARMUP_FRAMES
+ *              -r  frames per second the time figures assume, default the firmware's (about 9.2)
+ *              -c  length of the pieces, default 30 s, 0 keeps the recordings whole
+ *              -u  leave the recordings uncalibrated, as they were taken
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "classify.h"
+#include "imu_net.h"
+#include "preprocess.h"
+#include "read_timing.h"
+#include "recording.h"
+#include "scheduler.h"
+#include "smooth.h"
+#include "work_pool.h"
+
+/* The logs hold one long recording per activity, pieces of it give transitions to measure */
+#define DEFAULT_PIECE_SECONDS 30.0
+
+/* A piece of a recording within the stream */
+struct Segment {
+	size_t start;
+	size_t frames;
+	int label;
+	size_t recording;
+};
+
+/* What one kind of output reported over a replay */
+struct Output {
+	long correct = 0;
+	long labelled = 0;
+	long changes = 0;
+	long messages = 0;
+	long missed = 0;
+	std::vector<double> delays;     // seconds from each detected transition
+	int last = -1;
+	bool detected = true;
+
+	void report(int reported, int label, bool in_recording, double since_transition) {
+		if (label >= 0 && in_recording) {
+			correct += (reported == label);
+			labelled++;
+		}
+		if (!detected && reported == label) {
+			delays.push_back(since_transition);
+			detected = true;
+		}
+		changes += (last >= 0 && reported != last);
+		last = reported;
+	}
+
+	void transition() {
+		missed += !detected;
+		detected = false;
+	}
+};
+
+struct Schedule {
+	const char *name;
+	int hop_min;
+	int hop_max;
+	long inferences = 0;
+	long transitions = 0;
+	Output raw;
+	Output smoothed;
+};
+
+static void usage(const char *prog) {
+	fprintf(stderr, "usage: %s [-j threads] [-s hop] [-n min] [-x max] [-w frames] [-r rate] "
+			"[-c seconds] [-u] LOG...\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+static bool valid_hop(int hop) {
+	return hop >= SCHEDULER_HOP_STEP && hop % SCHEDULER_HOP_STEP == 0
+			&& hop <= SCHEDULER_HOP_STEP * (PREPROCESS_GROUPS - 1);
+}
+
+/*
+ * Cut the recordings into pieces of up to piece frames (0 = whole) and take the pieces of each
+ * activity in turn, so consecutive segments differ where they can
+ */
+static std::vector<Segment> interleave(const std::vector<Recording> &recordings, size_t piece,
+		std::vector<uint16_t> *raw) {
+	std::vector<std::vector<Segment>> by_label(NUM_CLASSES + 1);
+	std::vector<Segment> order;
+	size_t pieces = 0;
+
+	// Segments start as offsets into the recordings here, then into the stream
+	for (size_t r = 0; r < recordings.size(); r++) {
+		const Recording &rec = recordings[r];
+		size_t len = piece ? piece : rec.frames();
+
+		for (size_t start = 0; start < rec.frames(); start += len) {
+			by_label[rec.label >= 0 ? rec.label : NUM_CLASSES].push_back(
+					{ start, std::min(len, rec.frames() - start), rec.label, r });
+			pieces++;
+		}
+	}
+	for (size_t i = 0; order.size() < pieces; i++) {
+		for (const auto &queue : by_label) {
+			if (i < queue.size()) {
+				const Segment &seg = queue[i];
+				const uint16_t *src = recordings[seg.recording].frame(seg.start);
+
+				order.push_back({ raw->size() / PREPROCESS_CHANNELS, seg.frames, seg.label,
+						seg.recording });
+				raw->insert(raw->end(), src, src + seg.frames * PREPROCESS_CHANNELS);
+			}
+		}
+	}
+
+	return order;
+}
+
+/* Walk the stream with the scheduler, logits[e] being those of the window that ends before frame e */
+static void replay(Schedule *sch, const std::vector<Segment> &segments,
+		const std::vector<std::array<int8_t, CLASSIFY_CLASSES>> &logits, double rate) {
+	size_t frames = logits.size() - 1;
+	scheduler_t scheduler;
+	smooth_t smooth;
+	size_t seg = 0;
+
+	scheduler_init(&scheduler, sch->hop_min, sch->hop_max);
+	smooth_init(&smooth);
+	for (size_t end = PREPROCESS_WINDOW; end <= frames; end += scheduler_next(&scheduler,
+			logits[end].data())) {
+		// A transition is missed if the next one comes before the new activity was reported
+		while (seg + 1 < segments.size() && end > segments[seg + 1].start) {
+			seg++;
+			if (segments[seg].label >= 0 && segments[seg].label != segments[seg - 1].label) {
+				sch->raw.transition();
+				sch->smoothed.transition();
+				sch->transitions++;
+			}
+		}
+
+		const int8_t *l = logits[end].data();
+		int label = segments[seg].label;
+		bool in_recording = (end - PREPROCESS_WINDOW >= segments[seg].start);
+		double since = (end - segments[seg].start) / rate;
+
+		sch->inferences++;
+		sch->raw.report(classify_argmax(l, CLASSIFY_CLASSES), label, in_recording, since);
+		sch->raw.messages += 2;
+		if (smooth_update(&smooth, l, (uint32_t) (end * 1000 / rate)) != SMOOTH_QUIET) {
+			sch->smoothed.messages++;
+		}
+		sch->smoothed.report(smooth.state, label, in_recording, since);
+	}
+	sch->raw.transition();
+	sch->smoothed.transition();
+}
+
+/*
+ * Classify the start of every segment the way the firmware does after boot: the partial windows
+ * from warmup frames on (none if 0), then full windows every SCHEDULER_HOP_START frames. Prints
+ * the accuracy at every partial window size and the time to the first and the first correct label.
+ */
+static void warmup_report(const ImuNet &net, WorkPool &pool, const std::vector<Segment> &segments,
+		const std::vector<uint16_t> &raw, int warmup, double rate) {
+	struct Start {
+		std::vector<int> predicted;     // by window end, -1 where nothing is classified
+		int label;
+	};
+	std::vector<Start> starts(segments.size());
+
+	pool.run(segments.size(), [&](size_t task, unsigned) {
+		const Segment &seg = segments[task];
+		Start &start = starts[task];
+		std::vector<int8_t> values(seg.frames * PREPROCESS_CHANNELS);
+		uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS];
+		uint32_t padded[PREPROCESS_GROUPS][PREPROCESS_CHANNELS];
+		int8_t logits[CLASSIFY_CLASSES];
+
+		// The firmware seeds prev with the first sample, so the first frame is still
+		preprocess_recording(raw.data() + seg.start * PREPROCESS_CHANNELS, seg.frames,
+				values.data());
+		std::fill(values.begin(), values.begin() + PREPROCESS_CHANNELS, PREPROCESS_STILL);
+
+		start.label = seg.label;
+		start.predicted.assign(seg.frames + 1, -1);
+		for (size_t end = 1; end <= seg.frames; end++) {
+			bool partial = scheduler_warmup((int) end, warmup);
+
+			if (end < PREPROCESS_WINDOW && !partial) {
+				continue;
+			}
+			if (end >= PREPROCESS_WINDOW && (end - PREPROCESS_WINDOW) % SCHEDULER_HOP_START) {
+				continue;
+			}
+
+			// A partial window is packed like the firmware has it, its first frames at the oldest
+			// channels and whatever follows in the rest, and then padded
+			size_t first = (end < PREPROCESS_WINDOW) ? 0 : end - PREPROCESS_WINDOW;
+
+			if (first + PREPROCESS_WINDOW > seg.frames) {
+				break;
+			}
+			preprocess_pack_window(values.data() + first * PREPROCESS_CHANNELS, words);
+			if (partial) {
+				preprocess_pad_window(words, (int) end, padded);
+				net.infer(padded, logits);
+			} else {
+				net.infer(words, logits);
+			}
+			start.predicted[end] = classify_argmax(logits, CLASSIFY_CLASSES);
+		}
+	});
+
+	printf("\nWarm-up over %zu starts, partial windows padded as still:\n", starts.size());
+	printf("%-10s%8s%10s%10s\n", "frames", "time", "windows", "accuracy");
+	for (int end = warmup ? warmup : PREPROCESS_WINDOW; end <= PREPROCESS_WINDOW;
+			end += SCHEDULER_HOP_STEP) {
+		long windows = 0;
+		long correct = 0;
+
+		for (const Start &start : starts) {
+			if ((size_t) end < start.predicted.size() && start.predicted[end] >= 0
+					&& start.label >= 0) {
+				windows++;
+				correct += (start.predicted[end] == start.label);
+			}
+		}
+		printf("%-10d%7.1fs%10ld%9.1f%%\n", end, end / rate, windows,
+				windows ? 100.0 * correct / windows : 0.0);
+	}
+
+	// Without the warm-up the same starts only have the full windows
+	double first_correct[2] = { 0, 0 };
+	long found[2] = { 0, 0 };
+	long labelled = 0;
+
+	for (const Start &start : starts) {
+		if (start.label < 0) {
+			continue;
+		}
+		labelled++;
+		for (int with = 0; with < 2; with++) {
+			for (size_t end = 0; end < start.predicted.size(); end++) {
+				if (start.predicted[end] == start.label && (with || end >= PREPROCESS_WINDOW)) {
+					first_correct[with] += end / rate;
+					found[with]++;
+					break;
+				}
+			}
+		}
+	}
+
+	printf("\n%-14s%14s%22s%10s\n", "", "first label", "first correct label", "never");
+	for (int with = 1; with >= 0; with--) {
+		int first = (with && warmup) ? warmup : PREPROCESS_WINDOW;
+
+		printf("%-14s%13.1fs%21.1fs%10ld\n", with ? "warm-up" : "full window", first / rate,
+				found[with] ? first_correct[with] / found[with] : 0.0, labelled - found[with]);
+	}
+}
+
+int main(int argc, char **argv) {
+	unsigned threads = 0;
+	int fixed_hop = SCHEDULER_HOP_START;
+	int hop_min = SCHEDULER_HOP_MIN;
+	int hop_max = SCHEDULER_HOP_MAX;
+	int warmup = SCHEDULER_WARMUP_FRAMES;
+	// Every sensor read with the firmware's read plan, about 109 ms per frame
+	double rate = 1e6 / (SENSOR_COUNT * firmware_sensor_timing().read_us);
+	double piece_seconds = DEFAULT_PIECE_SECONDS;
+	bool calibrate = true;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "j:s:n:x:w:r:c:u")) != -1) {
+		switch (opt) {
+		case 'j':
+			threads = (unsigned) atoi(optarg);
+			break;
+		case 's':
+			fixed_hop = atoi(optarg);
+			break;
+		case 'n':
+			hop_min = atoi(optarg);
+			break;
+		case 'x':
+			hop_max = atoi(optarg);
+			break;
+		case 'w':
+			warmup = atoi(optarg);
+			break;
+		case 'r':
+			rate = atof(optarg);
+			break;
+		case 'c':
+			piece_seconds = atof(optarg);
+			break;
+		case 'u':
+			calibrate = false;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind >= argc || !valid_hop(fixed_hop) || !valid_hop(hop_min) || !valid_hop(hop_max)
+			|| hop_max < hop_min || rate <= 0 || piece_seconds < 0 || warmup < 0
+			|| (warmup && (warmup < 2 || warmup >= PREPROCESS_WINDOW
+			|| (PREPROCESS_WINDOW - warmup) % SCHEDULER_HOP_STEP))) {
+		usage(argv[0]);
+	}
+
+	std::vector<Recording> recordings;
+	std::unique_ptr<ImuNet> net;
+	std::string err;
+
+	try {
+		recordings = load_logs(std::vector<std::string>(argv + optind, argv + argc));
+		net.reset(new ImuNet());
+		if (calibrate) {
+			printf("Sensors calibrated: 0x%02x\n", (unsigned) calibrate_recordings(recordings));
+		}
+	} catch (const std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	if (!imu_net_check_sample(*net, &err)) {
+		fprintf(stderr, "network does not reproduce sampleoutput.h: %s\n", err.c_str());
+		return EXIT_FAILURE;
+	}
+
+	// One stream converted in one go, prev carries over the joins like it would on the device
+	std::vector<uint16_t> raw;
+	std::vector<Segment> segments = interleave(recordings, (size_t) (piece_seconds * rate), &raw);
+
+	size_t frames = raw.size() / PREPROCESS_CHANNELS;
+	std::vector<int8_t> values(raw.size());
+
+	if (frames < PREPROCESS_WINDOW) {
+		fprintf(stderr, "the recordings hold fewer than %d frames\n", PREPROCESS_WINDOW);
+		return EXIT_FAILURE;
+	}
+	preprocess_recording(raw.data(), frames, values.data());
+
+	// Every window any schedule could pick, so the schedules only differ in which they use
+	std::vector<std::array<int8_t, CLASSIFY_CLASSES>> logits(frames + 1);
+	WorkPool pool(threads);
+
+	pool.run(frames + 1 - PREPROCESS_WINDOW, [&](size_t task, unsigned) {
+		size_t end = task + PREPROCESS_WINDOW;
+		uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS];
+
+		preprocess_pack_window(values.data() + (end - PREPROCESS_WINDOW) * PREPROCESS_CHANNELS,
+				words);
+		net->infer(words, logits[end].data());
+	});
+
+	Schedule schedules[] = {
+		{ "fixed", fixed_hop, fixed_hop },
+		{ "adaptive", hop_min, hop_max },
+	};
+
+	printf("%zu pieces of %zu recordings, %zu frames, %.1f min at %.1f frames/s\n\n",
+			segments.size(), recordings.size(), frames, frames / rate / 60, rate);
+	double minutes = frames / rate / 60;
+
+	printf("%-10s%8s%10s%10s%10s%10s%10s%10s%10s%10s\n", "schedule", "hop", "inf/min", "output",
+			"msg/min", "flips/min", "accuracy", "missed", "delay", "max");
+	for (Schedule &sch : schedules) {
+		replay(&sch, segments, logits, rate);
+
+		char hop[16];
+		snprintf(hop, sizeof(hop), sch.hop_min == sch.hop_max ? "%d" : "%d-%d", sch.hop_min,
+				sch.hop_max);
+
+		for (const Output *out : { &sch.raw, &sch.smoothed }) {
+			double mean = 0;
+			double worst = 0;
+
+			for (double d : out->delays) {
+				mean += d;
+				worst = std::max(worst, d);
+			}
+			mean = out->delays.empty() ? 0 : mean / out->delays.size();
+
+			printf("%-10s%8s%10.1f%10s%10.1f%10.1f%9.1f%%%10ld%9.1fs%9.1fs\n",
+					(out == &sch.raw) ? sch.name : "", (out == &sch.raw) ? hop : "",
+					sch.inferences / minutes, (out == &sch.raw) ? "argmax" : "smoothed",
+					out->messages / minutes, out->changes / minutes,
+					out->labelled ? 100.0 * out->correct / out->labelled : 0.0, out->missed,
+					mean, worst);
+		}
+	}
+	printf("\n%ld transitions. Delays run from the first frame of a new activity to the first"
+			"\nwindow reporting it, accuracy counts the windows within one recording.\n",
+			schedules[0].transitions);
+
+	warmup_report(*net, pool, segments, raw, warmup, rate);
+
+	return EXIT_SUCCESS;
+}
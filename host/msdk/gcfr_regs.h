@@ -0,0 +1,19 @@
+/**
+ * @file        gcfr_regs.h
+ * @brief       Host stand-in for the MSDK global control function registers used by cnn.c
+ */
+
+#ifndef __GCFR_REGS_H__
+#define __GCFR_REGS_H__
+
+#include <stdint.h>
+
+/* reg0 power, reg1 memory mask, reg2 isolation, reg3 reset, one bit per quadrant */
+typedef struct {
+	volatile uint32_t reg0;
+	volatile uint32_t reg1;
+	volatile uint32_t reg2;
+	volatile uint32_t reg3;
+} mxc_gcfr_regs_t;
+
+#endif // __GCFR_REGS_H__
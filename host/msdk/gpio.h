@@ -0,0 +1,11 @@
+/**
+ * @file        gpio.h
+ * @brief       Host stand-in for the MSDK GPIO driver, declared in mxc.h
+ */
+
+#ifndef __GPIO_H__
+#define __GPIO_H__
+
+#include "mxc.h"
+
+#endif // __GPIO_H__
@@ -0,0 +1,54 @@
+/**
+ * @file        i2c.h
+ * @brief       Host stand-in for the MSDK I2C master driver
+ * @details     Implemented in i2c_mock.cpp, where the transactions go to simulated MPU-6050s and
+ *              are counted and timed.
+ */
+
+#ifndef __I2C_H__
+#define __I2C_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mxc_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	volatile uint32_t ctrl;
+} mxc_i2c_regs_t;
+
+extern mxc_i2c_regs_t host_i2c1;
+
+#define MXC_I2C1 (&host_i2c1)
+
+typedef struct _i2c_req_t mxc_i2c_req_t;
+typedef void (*mxc_i2c_complete_cb_t)(mxc_i2c_req_t *req, int result);
+
+struct _i2c_req_t {
+	mxc_i2c_regs_t *i2c;
+	uint8_t addr;
+	unsigned char *tx_buf;
+	unsigned int tx_len;
+	unsigned char *rx_buf;
+	unsigned int rx_len;
+	int restart;
+	mxc_i2c_complete_cb_t callback;
+};
+
+int MXC_I2C_Init(mxc_i2c_regs_t *i2c, int master, unsigned int slave_addr);
+int MXC_I2C_SetFrequency(mxc_i2c_regs_t *i2c, unsigned int hz);
+void MXC_I2C_SetTimeout(mxc_i2c_regs_t *i2c, unsigned int timeout);
+unsigned int MXC_I2C_GetTimeout(mxc_i2c_regs_t *i2c);
+
+/* Write tx_buf, then read rx_buf after a repeated start, then stop unless restart is set */
+int MXC_I2C_MasterTransaction(mxc_i2c_req_t *req);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __I2C_H__
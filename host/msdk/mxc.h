@@ -0,0 +1,110 @@
+/**
+ * @file        mxc.h
+ * @brief       Host stand-in for the MSDK headers included by the generated cnn.c and mpu6050.c
+ * @details     Declares only what cnn.c, cnn.h and mpu6050.c use. Clock, power and GPIO registers
+ *              are plain variables and the functions are implemented in cnn_emu.cpp, or in
+ *              i2c_mock.cpp for mpu6050.c; the accelerator itself is emulated behind its real
+ *              addresses, so cnn.c compiles unchanged.
+ */
+
+#ifndef __MXC_H__
+#define __MXC_H__
+
+#include <stdint.h>
+
+#include "gcfr_regs.h"
+#include "mxc_errors.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Global control registers, only the peripheral clock divider is touched */
+typedef struct {
+	volatile uint32_t pclkdiv;
+} mxc_gcr_regs_t;
+
+extern mxc_gcr_regs_t host_gcr;
+extern mxc_gcfr_regs_t host_gcfr;
+
+#define MXC_GCR (&host_gcr)
+#define MXC_GCFR (&host_gcfr)
+
+#define MXC_F_GCR_PCLKDIV_CNNCLKDIV ((uint32_t) 0x7 << 14)
+#define MXC_F_GCR_PCLKDIV_CNNCLKSEL ((uint32_t) 0x1 << 17)
+#define MXC_S_GCR_PCLKDIV_CNNCLKSEL_PCLK ((uint32_t) 0x0 << 17)
+#define MXC_S_GCR_PCLKDIV_CNNCLKDIV_DIV1 ((uint32_t) 0x4 << 14)
+
+typedef enum {
+	MXC_SYS_PERIPH_CLOCK_CNN = 25,
+} mxc_sys_periph_clock_t;
+
+void MXC_SYS_ClockEnable(mxc_sys_periph_clock_t clock);
+void MXC_SYS_ClockDisable(mxc_sys_periph_clock_t clock);
+
+typedef enum {
+	CNN_IRQn = 66,
+} IRQn_Type;
+
+void MXC_NVIC_SetVector(IRQn_Type irq, void (*handler)(void));
+
+/* Runs the accelerator when it was started, see cnn_emu_poll() */
+void MXC_LP_EnterSleepMode(void);
+
+typedef struct {
+	volatile uint32_t out;
+} mxc_gpio_regs_t;
+
+extern mxc_gpio_regs_t host_gpio0;
+
+#define MXC_GPIO0 (&host_gpio0)
+#define MXC_GPIO_PIN_5 ((uint32_t) 1 << 5)
+#define MXC_GPIO_PIN_6 ((uint32_t) 1 << 6)
+#define MXC_GPIO_PIN_7 ((uint32_t) 1 << 7)
+#define MXC_GPIO_PIN_8 ((uint32_t) 1 << 8)
+#define MXC_GPIO_PIN_9 ((uint32_t) 1 << 9)
+#define MXC_GPIO_PIN_11 ((uint32_t) 1 << 11)
+
+typedef enum {
+	MXC_GPIO_PAD_NONE,
+} mxc_gpio_pad_t;
+
+typedef enum {
+	MXC_GPIO_VSSEL_VDDIO,
+	MXC_GPIO_VSSEL_VDDIOH,
+} mxc_gpio_vssel_t;
+
+typedef enum {
+	MXC_GPIO_DRVSTR_0,
+	MXC_GPIO_DRVSTR_1,
+	MXC_GPIO_DRVSTR_2,
+	MXC_GPIO_DRVSTR_3,
+} mxc_gpio_drvstr_t;
+
+typedef enum {
+	MXC_GPIO_FUNC_IN,
+	MXC_GPIO_FUNC_OUT,
+} mxc_gpio_func_t;
+
+typedef struct {
+	mxc_gpio_regs_t *port;
+	uint32_t mask;
+	mxc_gpio_func_t func;
+	mxc_gpio_pad_t pad;
+	mxc_gpio_vssel_t vssel;
+	mxc_gpio_drvstr_t drvstr;
+} mxc_gpio_cfg_t;
+
+int MXC_GPIO_Config(const mxc_gpio_cfg_t *cfg);
+void MXC_GPIO_OutSet(mxc_gpio_regs_t *port, uint32_t mask);
+void MXC_GPIO_OutClr(mxc_gpio_regs_t *port, uint32_t mask);
+
+/* The board LEDs cnn.h uses to signal processing */
+#define LED_On(idx) ((void) (idx))
+#define LED_Off(idx) ((void) (idx))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MXC_H__
@@ -0,0 +1,23 @@
+/**
+ * @file        mxc_delay.h
+ * @brief       Host stand-in for the MSDK busy-wait delays
+ * @details     Implemented in i2c_mock.cpp, where they move the simulated time on.
+ */
+
+#ifndef __MXC_DELAY_H__
+#define __MXC_DELAY_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MXC_DELAY_MSEC(ms) ((ms) * 1000UL)
+#define MXC_DELAY_USEC(us) ((unsigned long) (us))
+
+int MXC_Delay(unsigned long us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MXC_DELAY_H__
@@ -0,0 +1,15 @@
+/**
+ * @file        mxc_errors.h
+ * @brief       Host stand-in for the MSDK error codes
+ */
+
+#ifndef __MXC_ERRORS_H__
+#define __MXC_ERRORS_H__
+
+#define E_NO_ERROR 0
+#define E_NO_DEVICE -2
+#define E_BAD_PARAM -3
+#define E_TIME_OUT -7
+#define E_COMM_ERR -12
+
+#endif // __MXC_ERRORS_H__
@@ -0,0 +1,286 @@
+/**
+ * @file        preprocess_bench.cpp
+ * @brief       Checks the shared preprocessing kernel against the firmware's original input path
+ * @details     The reference below is the per-frame code main.c used before preprocess.c existed,
+ *              transcribed as-is: the same integer expressions, the same frame_count branches and
+ *              the same roll-over of the input groups after every inference. Every window the
+ *              firmware would have classified is compared word for word with what
+ *              preprocess_pack_window() builds from preprocess_recording(), then both paths are
+ *              timed. Exits nonzero on the first mismatch.
+ *
+ *              usage: preprocess_bench LOG...
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "preprocess.h"
+#include "recording.h"
+
+/* Repeat the timing runs until at least this much work was done */
+#define MIN_BENCH_FRAMES 2000000
+
+/* Random frames run through the fused kernel on top of the logs */
+#define RANDOM_FRAMES 100000
+
+/* Input groups as the firmware declared them, cnn_input0 ... cnn_input28 */
+struct DeviceInputs {
+	uint32_t cnn_input0[36];
+	uint32_t cnn_input4[36];
+	uint32_t cnn_input8[36];
+	uint32_t cnn_input12[36];
+	uint32_t cnn_input16[36];
+	uint32_t cnn_input20[36];
+	uint32_t cnn_input24[36];
+	uint32_t cnn_input28[36];
+};
+
+static void shift_frame(uint32_t *cnn_input, int frame[6][6]) {
+	for (int i = 0; i < 6; i++) {
+		for (int j = 0; j < 6; j++) {
+			uint8_t value = (uint8_t) ((frame[i][j] < 127) ? frame[i][j] : 127);
+			cnn_input[i * 6 + j] = (cnn_input[i * 6 + j] << 8) | value;
+		}
+	}
+}
+
+/*
+ * Run the original firmware input path over a recording. on_inference is called with the frame
+ * index whenever the firmware would have started the CNN, with the input groups it would load.
+ */
+template<typename F>
+static void device_reference(const Recording &rec, DeviceInputs &in, F on_inference) {
+	int prev[36] = { 0 };
+	int frame[6][6] = { { 0 } };
+	int frame_count = 0;
+
+	memset(&in, 0, sizeof(in));
+
+	for (size_t n = 0; n < rec.frames(); n++) {
+		const uint16_t *raw = rec.frame(n);
+
+		for (int s = 0; s < 6; s++) {
+			for (int a = 0; a < 6; a++) {
+				// Bytes come off the bus one at a time and are assembled as (hi << 8) | lo
+				int x = raw[s * 6 + a] >> 8;
+				x = (x << 8) | (raw[s * 6 + a] & 0xFF);
+
+				frame[s][a] = (abs(prev[s * 6 + a] - x) / 128) - 128;
+				prev[s * 6 + a] = x;
+			}
+		}
+
+		if (frame_count < 2) {
+			shift_frame(in.cnn_input28, frame);
+		} else if (frame_count < 6) {
+			shift_frame(in.cnn_input24, frame);
+		} else if (frame_count < 10) {
+			shift_frame(in.cnn_input20, frame);
+		} else if (frame_count < 14) {
+			shift_frame(in.cnn_input16, frame);
+		} else if (frame_count < 18) {
+			shift_frame(in.cnn_input12, frame);
+		} else if (frame_count < 22) {
+			shift_frame(in.cnn_input8, frame);
+		} else if (frame_count < 26) {
+			shift_frame(in.cnn_input4, frame);
+		} else {
+			shift_frame(in.cnn_input0, frame);
+		}
+
+		frame_count = frame_count + 1;
+		if (frame_count == 30) {
+			on_inference(n, in);
+
+			frame_count = frame_count - 8;
+			memcpy(in.cnn_input28, in.cnn_input20, sizeof(in.cnn_input28));
+			memcpy(in.cnn_input24, in.cnn_input16, sizeof(in.cnn_input24));
+			memcpy(in.cnn_input20, in.cnn_input12, sizeof(in.cnn_input20));
+			memcpy(in.cnn_input16, in.cnn_input8, sizeof(in.cnn_input16));
+			memcpy(in.cnn_input12, in.cnn_input4, sizeof(in.cnn_input12));
+			memcpy(in.cnn_input8, in.cnn_input0, sizeof(in.cnn_input8));
+
+			for (int i = 0; i < 36; i++) {
+				in.cnn_input28[i] = in.cnn_input28[i] & 0xFFFF;
+			}
+		}
+	}
+}
+
+/* Compare every window the firmware classifies, returns the number of windows checked */
+static size_t check_recording(const Recording &rec) {
+	std::vector<int8_t> values(rec.raw.size());
+	uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS];
+	DeviceInputs in;
+	size_t windows = 0;
+
+	preprocess_recording(rec.raw.data(), rec.frames(), values.data());
+
+	device_reference(rec, in, [&](size_t n, const DeviceInputs &dev) {
+		const uint32_t *groups[PREPROCESS_GROUPS] = { dev.cnn_input0, dev.cnn_input4,
+				dev.cnn_input8, dev.cnn_input12, dev.cnn_input16, dev.cnn_input20, dev.cnn_input24,
+				dev.cnn_input28 };
+		size_t first = n + 1 - PREPROCESS_WINDOW;
+
+		preprocess_pack_window(values.data() + first * PREPROCESS_CHANNELS, words);
+
+		for (int g = 0; g < PREPROCESS_GROUPS; g++) {
+			for (int i = 0; i < PREPROCESS_CHANNELS; i++) {
+				if (groups[g][i] != words[g][i]) {
+					fprintf(stderr, "%s: window ending at frame %zu, cnn_input%d[%d]: "
+							"device 0x%08x, preprocess 0x%08x\n", rec.source.c_str(), n, g * 4,
+							i, groups[g][i], words[g][i]);
+					exit(EXIT_FAILURE);
+				}
+			}
+		}
+		windows++;
+	});
+
+	return windows;
+}
+
+/* Compare preprocess_frame_pack() with its scalar reference frame by frame, returns false on mismatch */
+static bool check_frame_pack(const uint16_t *raw, size_t frames, const char *source) {
+	uint16_t prev_ref[PREPROCESS_CHANNELS] = { 0 };
+	uint16_t prev_fast[PREPROCESS_CHANNELS] = { 0 };
+	uint32_t words_ref[PREPROCESS_CHANNELS] = { 0 };
+	uint32_t words_fast[PREPROCESS_CHANNELS] = { 0 };
+
+	for (size_t n = 0; n < frames; n++) {
+		preprocess_frame_pack_ref(raw + n * PREPROCESS_CHANNELS, prev_ref, words_ref);
+		preprocess_frame_pack(raw + n * PREPROCESS_CHANNELS, prev_fast, words_fast);
+
+		if (memcmp(words_ref, words_fast, sizeof(words_ref)) != 0
+				|| memcmp(prev_ref, prev_fast, sizeof(prev_ref)) != 0) {
+			fprintf(stderr, "%s: preprocess_frame_pack differs from the reference at frame %zu\n",
+					source, n);
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename F>
+static double frames_per_second(const std::vector<Recording> &recordings, size_t total, F run) {
+	auto start = std::chrono::steady_clock::now();
+	size_t done = 0;
+
+	while (done < MIN_BENCH_FRAMES) {
+		for (const Recording &rec : recordings) {
+			run(rec);
+		}
+		done += total;
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return done / elapsed.count();
+}
+
+int main(int argc, char **argv) {
+	std::vector<std::string> paths(argv + 1, argv + argc);
+	std::vector<Recording> recordings;
+	size_t frames = 0;
+	size_t windows = 0;
+
+	if (paths.empty()) {
+		fprintf(stderr, "usage: %s LOG...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	try {
+		recordings = load_logs(paths);
+	} catch (const std::exception &e) {
+		fprintf(stderr, "%s\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	for (const Recording &rec : recordings) {
+		frames += rec.frames();
+		windows += check_recording(rec);
+	}
+
+	if (frames == 0) {
+		fprintf(stderr, "no frames found\n");
+		return EXIT_FAILURE;
+	}
+
+	printf("%zu recordings, %zu frames, %zu windows bit-identical\n", recordings.size(), frames,
+			windows);
+
+	// The logs never reach the saturation edges, so random samples go through the fused kernel too
+	std::vector<uint16_t> noise(RANDOM_FRAMES * PREPROCESS_CHANNELS);
+	uint32_t seed = 1;
+
+	for (uint16_t &sample : noise) {
+		seed = seed * 1664525 + 1013904223;
+		sample = (uint16_t) (seed >> 16);
+	}
+	for (const Recording &rec : recordings) {
+		if (!check_frame_pack(rec.raw.data(), rec.frames(), rec.source.c_str())) {
+			return EXIT_FAILURE;
+		}
+	}
+	if (!check_frame_pack(noise.data(), RANDOM_FRAMES, "random samples")) {
+		return EXIT_FAILURE;
+	}
+	printf("preprocess_frame_pack matches the scalar reference\n");
+
+	// Keep a checksum of the outputs so the compiler can't drop the work
+	uint32_t sink = 0;
+
+	double device = frames_per_second(recordings, frames, [&](const Recording &rec) {
+		DeviceInputs in;
+		device_reference(rec, in, [&](size_t, const DeviceInputs &dev) {
+			sink += dev.cnn_input0[0];
+		});
+	});
+
+	// What the training data loader calls: one pass over the whole recording
+	std::vector<int8_t> values;
+	double shared = frames_per_second(recordings, frames, [&](const Recording &rec) {
+		values.resize(rec.raw.size());
+		preprocess_recording(rec.raw.data(), rec.frames(), values.data());
+		sink += (uint8_t) values.back();
+	});
+
+	// Same work as the firmware path: convert every frame, pack every window it classifies
+	uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS];
+	double packed = frames_per_second(recordings, frames, [&](const Recording &rec) {
+		values.resize(rec.raw.size());
+		preprocess_recording(rec.raw.data(), rec.frames(), values.data());
+		for (size_t n = PREPROCESS_WINDOW - 1; n < rec.frames(); n += 8) {
+			preprocess_pack_window(values.data() + (n + 1 - PREPROCESS_WINDOW) * PREPROCESS_CHANNELS,
+					words);
+			sink += words[0][0];
+		}
+	});
+
+	// Per-frame conversion as the firmware now runs it, fused and reference
+	auto frame_pack = [&](void (*kernel)(const uint16_t*, uint16_t*, uint32_t*)) {
+		return frames_per_second(recordings, frames, [&](const Recording &rec) {
+			uint16_t prev[PREPROCESS_CHANNELS] = { 0 };
+			uint32_t group[PREPROCESS_CHANNELS] = { 0 };
+
+			for (size_t n = 0; n < rec.frames(); n++) {
+				kernel(rec.frame(n), prev, group);
+			}
+			sink += group[0];
+		});
+	};
+	double fused_ref = frame_pack(preprocess_frame_pack_ref);
+	double fused = frame_pack(preprocess_frame_pack);
+
+	printf("firmware path:        %12.0f frames/s\n", device);
+	printf("preprocess_recording: %12.0f frames/s (%.1fx)\n", shared, shared / device);
+	printf("  + pack_window:      %12.0f frames/s (%.1fx)\n", packed, packed / device);
+	printf("frame_pack_ref:       %12.0f frames/s\n", fused_ref);
+	printf("frame_pack:           %12.0f frames/s (%.1fx)\n", fused, fused / fused_ref);
+	printf("checksum %08x\n", sink);
+
+	return EXIT_SUCCESS;
+}
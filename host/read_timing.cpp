@@ -0,0 +1,77 @@
+/**
+ * @file        read_timing.cpp
+ * @brief       Time the sensor reads take on the bus, from the firmware's read plans
+ */
+
+#include "read_timing.h"
+
+/* Clocks of a start, repeated start or stop, and of a byte with its acknowledge */
+#define CONDITION_BITS 1
+#define BYTE_BITS 9
+
+void budget_transaction(Budget &budget, const Bus &bus, int tx, int rx) {
+	long bits = CONDITION_BITS + BYTE_BITS * (1 + tx) + CONDITION_BITS;
+
+	if (rx > 0) {
+		bits += CONDITION_BITS + BYTE_BITS * (1 + rx);
+	}
+	budget.transactions++;
+	budget.tx_bytes += tx;
+	budget.rx_bytes += rx;
+	budget.bits += bits;
+	budget.bus_us += bits * 1e6 / bus.hz + rx * bus.stretch_us + bus.overhead_us;
+}
+
+Budget sensor_budget(const read_plan_t &plan, const Bus &bus, Topology topology) {
+	Budget budget;
+
+	if (topology == TOPOLOGY_MUX) {
+		budget_transaction(budget, bus, 1, 0);
+	}
+	for (int i = 0; i < plan.steps; i++) {
+		budget.delay_us += plan.step[i].delay_us;
+		budget_transaction(budget, bus, 1, plan.step[i].len);
+	}
+	if (topology == TOPOLOGY_AD0) {
+		budget.delay_us += 2 * plan.deselect_delay_us;
+	}
+	return budget;
+}
+
+SensorTiming sensor_timing(const read_plan_t &plan, const Bus &bus) {
+	SensorTiming timing = { -1, 0 };
+	int accel_end = -1;
+	Budget budget;
+
+	// Last byte of the last accelerometer axis read
+	for (int axis = 0; axis < 3; axis++) {
+		if (SENSOR_AXES_MASK & (1 << axis)) {
+			accel_end = READ_PLAN_FIRST_REG + read_plan_offset(axis) + 1;
+		}
+	}
+	for (int i = 0; i < plan.steps; i++) {
+		const read_step_t &step = plan.step[i];
+
+		budget.delay_us += step.delay_us;
+		budget_transaction(budget, bus, 1, step.len);
+		if (timing.accel_us < 0 && accel_end >= step.reg && accel_end < step.reg + step.len) {
+			timing.accel_us = budget.total_us();
+		}
+	}
+	if (timing.accel_us < 0) {
+		timing.accel_us = budget.total_us();
+	}
+	timing.read_us = budget.total_us() + 2 * plan.deselect_delay_us;
+	return timing;
+}
+
+Bus firmware_bus() {
+	return { READ_PLAN_I2C_HZ, 0, TRANSACTION_OVERHEAD_US };
+}
+
+SensorTiming firmware_sensor_timing() {
+	read_plan_t plan;
+
+	read_plan_build(&plan, READ_PLAN_STRATEGY, SENSOR_AXES_MASK);
+	return sensor_timing(plan, firmware_bus());
+}
@@ -0,0 +1,74 @@
+/**
+ * @file        read_timing.h
+ * @brief       Time the sensor reads take on the bus, from the firmware's read plans
+ * @details     One timing model of mpu6050_read() for every host tool: the transactions and
+ *              waits of a read plan (read_plan.h) on an I2C bus of a given clock. Every
+ *              transaction is a start, the address and register pointer, a repeated start, the
+ *              address and the data bytes (9 clocks each) and a stop, plus clock stretching per
+ *              byte read and the driver's time per transaction, and the plan's waits come on top.
+ *              i2c_budget checks it against mpu6050_read() on the mocked bus of i2c_mock.h, and
+ *              fall_sim and align_sim take the firmware's frame timing from it.
+ */
+
+#ifndef __READ_TIMING_H__
+#define __READ_TIMING_H__
+
+#include "read_plan.h"
+
+/* MXC_I2C_MasterTransaction() setting up and polling a transaction, an estimate */
+#define TRANSACTION_OVERHEAD_US 10
+
+enum Topology {
+	TOPOLOGY_AD0,           // sensors selected by their AD0 pin, the board as built
+	TOPOLOGY_MUX,           // behind a TCA9548A multiplexer
+};
+
+struct Bus {
+	double hz;
+	double stretch_us;      // clock stretching per data byte read
+	double overhead_us;     // driver time per transaction
+};
+
+struct Budget {
+	long transactions = 0;
+	long tx_bytes = 0;
+	long rx_bytes = 0;
+	long bits = 0;
+	double bus_us = 0;
+	double delay_us = 0;
+
+	double total_us() const { return bus_us + delay_us; }
+
+	void add(const Budget &b, int times) {
+		transactions += times * b.transactions;
+		tx_bytes += times * b.tx_bytes;
+		rx_bytes += times * b.rx_bytes;
+		bits += times * b.bits;
+		bus_us += times * b.bus_us;
+		delay_us += times * b.delay_us;
+	}
+};
+
+/* Where in the read of one sensor its accelerometer sample is complete and where the read ends */
+struct SensorTiming {
+	double accel_us;        // end of the transaction with the last accelerometer byte, or of the
+	                        // last transaction without accelerometer axes
+	double read_us;         // after the waits around deselecting, the same as sensor_budget()
+};
+
+/* A transaction writing tx bytes, then reading rx bytes after a repeated start */
+void budget_transaction(Budget &budget, const Bus &bus, int tx, int rx);
+
+/* Reading one sensor with a plan, selecting it included */
+Budget sensor_budget(const read_plan_t &plan, const Bus &bus, Topology topology);
+
+/* Timeline of reading one sensor with a plan and AD0 select pins */
+SensorTiming sensor_timing(const read_plan_t &plan, const Bus &bus);
+
+/* The board as built: READ_PLAN_I2C_HZ, no stretching and TRANSACTION_OVERHEAD_US */
+Bus firmware_bus();
+
+/* The reads of the firmware, READ_PLAN_STRATEGY of the SENSOR_AXES_MASK axes on firmware_bus() */
+SensorTiming firmware_sensor_timing();
+
+#endif // __READ_TIMING_H__
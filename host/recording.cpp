@@ -0,0 +1,176 @@
+/**
+ * @file        recording.cpp
+ * @brief       Reader for the raw IMU logs in FinalData
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "calib_estimate.h"
+#include "imu_archive.h"
+#include "recording.h"
+
+/* IMUs and axes per sample in the logs, the kit's sensors and axes are picked from them */
+#define NUM_IMUS 6
+#define NUM_AXES 6
+
+const char *const class_names[NUM_CLASSES] = { "downstairs", "sitting", "standing", "upstairs",
+		"walking" };
+
+static const char *const axis_keys[NUM_AXES] = { "AX", "AY", "AZ", "GX", "GY", "GZ" };
+
+/* IMU number in the logs of every input row, as training/imu.py takes IMU_SENSORS */
+static const int sensor_ids[SENSOR_COUNT] = {
+#define SENSOR(name, id, port, pin) id,
+	SENSOR_LIST
+#undef SENSOR
+};
+
+int class_index(const std::string &label) {
+	std::string lower;
+
+	for (char c : label) {
+		if (!isspace((unsigned char) c)) {
+			lower += (char) tolower((unsigned char) c);
+		}
+	}
+	for (int i = 0; i < NUM_CLASSES; i++) {
+		if (lower == class_names[i]) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/* Parse "N: AX v AY v AZ v GX v GY v GZ v", returns false for anything else */
+static bool parse_sample(const std::string &line, int *imu, int16_t values[NUM_AXES]) {
+	std::istringstream in(line);
+	std::string key;
+	char colon;
+	long v;
+
+	if (!(in >> *imu >> colon) || colon != ':' || *imu < 0 || *imu >= NUM_IMUS) {
+		return false;
+	}
+	for (int a = 0; a < NUM_AXES; a++) {
+		if (!(in >> key >> v) || key != axis_keys[a] || v < INT16_MIN || v > INT16_MAX) {
+			return false;
+		}
+		values[a] = (int16_t) v;
+	}
+	return true;
+}
+
+std::vector<Recording> load_log(const std::string &path) {
+	std::ifstream file(path, std::ios::binary);
+	std::ostringstream data;
+
+	if (!file) {
+		throw std::runtime_error("cannot open " + path);
+	}
+	data << file.rdbuf();
+
+	std::vector<LogLine> lines = read_log_lines(data.str());
+	std::vector<Recording> recordings;
+	uint16_t sample[PREPROCESS_CHANNELS] = { 0 };
+	Recording current;
+	int label = -1;
+	int rows[NUM_IMUS];
+
+	/* Input row of each IMU of the logs, -1 for those the kit leaves out */
+	std::fill(rows, rows + NUM_IMUS, -1);
+	for (int s = 0; s < SENSOR_COUNT; s++) {
+		if (sensor_ids[s] < 0 || sensor_ids[s] >= NUM_IMUS) {
+			throw std::runtime_error("sensor " + std::to_string(s) + " is IMU "
+					+ std::to_string(sensor_ids[s]) + ", the logs only have "
+					+ std::to_string(NUM_IMUS));
+		}
+		rows[sensor_ids[s]] = s;
+	}
+
+	/* The class marker is the first line, it applies to every recording in the file */
+	for (const LogLine &line : lines) {
+		const std::string &text = line.text;
+
+		if (line.imu < 0 && !text.empty() && isalpha((unsigned char) text[0])
+				&& text.compare(0, 3, "MPU") != 0) {
+			label = class_index(text);
+			break;
+		}
+	}
+
+	current.source = path;
+	current.label = label;
+
+	for (auto it = lines.rbegin(); it != lines.rend(); ++it) {
+		const std::string &line = it->text;
+		const int16_t *values = it->values;
+		int16_t parsed[NUM_AXES];
+		int imu = it->imu;
+
+		/* Sensor lines come parsed, the archive keeps their exact text */
+		if (imu < 0) {
+			if (line.size() <= 4) {
+				continue;
+			}
+			if (line.compare(0, 3, "MPU") == 0) {
+				if (!current.raw.empty()) {
+					recordings.push_back(current);
+				}
+				current.raw.clear();
+				memset(sample, 0, sizeof(sample));
+				continue;
+			}
+			if (line[0] == 'S' || line[0] == 'W' || line[0] == 'U' || line[0] == 'D') {
+				break;
+			}
+			if (!parse_sample(line, &imu, parsed)) {
+				continue;
+			}
+			values = parsed;
+		}
+		if (imu >= NUM_IMUS) {
+			continue;
+		}
+		if (rows[imu] >= 0) {
+			for (int a = 0; a < SENSOR_AXES; a++) {
+				sample[rows[imu] * SENSOR_AXES + a] = (uint16_t) values[sensor_axis(a)];
+			}
+		}
+		if (imu == NUM_IMUS - 1) {
+			current.raw.insert(current.raw.end(), sample, sample + PREPROCESS_CHANNELS);
+		}
+	}
+	if (!current.raw.empty()) {
+		recordings.push_back(current);
+	}
+	return recordings;
+}
+
+std::vector<Recording> load_logs(const std::vector<std::string> &paths) {
+	std::vector<Recording> all;
+
+	for (const std::string &path : paths) {
+		std::vector<Recording> recordings = load_log(path);
+		all.insert(all.end(), recordings.begin(), recordings.end());
+	}
+	return all;
+}
+
+uint32_t calibrate_recordings(std::vector<Recording> &recordings) {
+	calib_estimate_t est;
+
+	calib_estimate_init(&est);
+	for (const Recording &recording : recordings) {
+		calib_estimate_recording(&est, recording.raw.data(), recording.frames());
+	}
+	for (Recording &recording : recordings) {
+		calib_estimate_apply_recording(&est, recording.raw.data(), recording.frames());
+	}
+	return est.calibrated;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file        recording.h
+ * @brief       Reader for the raw IMU logs in FinalData
+ */
+
+#ifndef __RECORDING_H__
+#define __RECORDING_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "preprocess.h"
+
+/* Number of activity classes, in the order the firmware reports them */
+#define NUM_CLASSES 5
+
+extern const char *const class_names[NUM_CLASSES];
+
+/* Class index for a log's class marker (e.g. "UPSTAIRS"), -1 if unknown */
+int class_index(const std::string &label);
+
+/*
+ * One continuous recording: frames of PREPROCESS_CHANNELS raw register values, oldest first, of
+ * the sensors and axes sensor_config.h selects
+ */
+struct Recording {
+	std::string source;
+	int label;
+	std::vector<uint16_t> raw;
+
+	size_t frames() const { return raw.size() / PREPROCESS_CHANNELS; }
+	const uint16_t *frame(size_t n) const { return raw.data() + n * PREPROCESS_CHANNELS; }
+};
+
+/*
+ * Split a log into its continuous recordings the same way FinalData/parse_data.py does: lines
+ * are walked newest-first from the end of the file, "MPU ..." lines start a new recording and
+ * the class marker at the top ends the parse. Reads archives from imu_pack (.imz) as well. Throws
+ * std::runtime_error if the file can't be read.
+ */
+std::vector<Recording> load_log(const std::string &path);
+
+/* Load several logs, concatenating their recordings */
+std::vector<Recording> load_logs(const std::vector<std::string> &paths);
+
+/*
+ * Calibrate the recordings in place the way the device does (calib_estimate.h): every sensor
+ * slot is estimated once, from its first CALIB_FRAMES frames at rest in any of the recordings,
+ * and applied to all of them like a calibration stored in flash. The logs were taken with one
+ * kit, so the same physical sensor gets the same calibration in every class. Returns a mask of
+ * the slots that were calibrated, the others are left as they are.
+ */
+uint32_t calibrate_recordings(std::vector<Recording> &recordings);
+
+#endif // __RECORDING_H__
@@ -0,0 +1,89 @@
+/**
+ * @file        work_pool.cpp
+ * @brief       Work-stealing thread pool for the batch host tools
+ */
+
+#include <algorithm>
+#include <thread>
+
+#include "work_pool.h"
+
+WorkPool::WorkPool(unsigned threads) :
+		threads_(threads ? threads : std::max(1u, std::thread::hardware_concurrency())) {
+	for (unsigned t = 0; t < threads_; t++) {
+		ranges_.emplace_back(new Range);
+	}
+}
+
+bool WorkPool::next(unsigned thread, size_t *task) {
+	Range &own = *ranges_[thread];
+
+	do {
+		std::lock_guard<std::mutex> guard(own.lock);
+
+		if (own.begin < own.end) {
+			*task = own.begin++;
+			return true;
+		}
+	} while (steal(thread));
+
+	return false;
+}
+
+bool WorkPool::steal(unsigned thread) {
+	Range &own = *ranges_[thread];
+	unsigned victim = thread;
+	size_t most = 0;
+
+	// Pick the thread with the most work left, the sizes may change before the lock is taken
+	for (unsigned t = 0; t < threads_; t++) {
+		Range &r = *ranges_[t];
+		std::lock_guard<std::mutex> guard(r.lock);
+
+		if (t != thread && r.end - r.begin > most) {
+			most = r.end - r.begin;
+			victim = t;
+		}
+	}
+	if (victim == thread) {
+		return false;
+	}
+
+	Range &r = *ranges_[victim];
+	std::scoped_lock guard(own.lock, r.lock);
+	size_t left = r.end - r.begin;
+
+	if (left == 0) {
+		return true; // someone else got there first, look again
+	}
+
+	// Take the back half, leaving the front to the owner
+	size_t split = r.begin + left / 2;
+	own.begin = split;
+	own.end = r.end;
+	r.end = split;
+
+	return true;
+}
+
+void WorkPool::run(size_t tasks, const std::function<void(size_t task, unsigned thread)> &fn) {
+	std::vector<std::thread> workers;
+
+	for (unsigned t = 0; t < threads_; t++) {
+		ranges_[t]->begin = tasks * t / threads_;
+		ranges_[t]->end = tasks * (t + 1) / threads_;
+	}
+
+	for (unsigned t = 0; t < threads_; t++) {
+		workers.emplace_back([this, t, &fn] {
+			size_t task;
+
+			while (next(t, &task)) {
+				fn(task, t);
+			}
+		});
+	}
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+}
@@ -0,0 +1,44 @@
+/**
+ * @file        work_pool.h
+ * @brief       Work-stealing thread pool for the batch host tools
+ */
+
+#ifndef __WORK_POOL_H__
+#define __WORK_POOL_H__
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/*
+ * Runs tasks 0 ... n - 1 on a fixed number of threads. Every thread starts on its own contiguous
+ * share of the range and takes tasks from the front of it; a thread that runs out steals the
+ * back half of the largest remaining share, so uneven tasks still keep all cores busy.
+ */
+class WorkPool {
+public:
+	/* threads = 0 uses one thread per core */
+	explicit WorkPool(unsigned threads = 0);
+
+	unsigned threads() const { return threads_; }
+
+	/* Call fn(task, thread) for every task, returns once all of them are done */
+	void run(size_t tasks, const std::function<void(size_t task, unsigned thread)> &fn);
+
+private:
+	struct Range {
+		std::mutex lock;
+		size_t begin = 0;
+		size_t end = 0;
+	};
+
+	bool next(unsigned thread, size_t *task);
+	bool steal(unsigned thread);
+
+	unsigned threads_;
+	std::vector<std::unique_ptr<Range>> ranges_;
+};
+
+#endif // __WORK_POOL_H__
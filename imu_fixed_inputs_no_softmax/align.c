@@ -0,0 +1,130 @@
+/**
+ * @file        align.c
+ * @brief       Timestamps of the sensor reads, their skew within a frame and its compensation
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "align.h"
+
+static const char *const sensor_names[SENSOR_COUNT] = {
+#define SENSOR(name, id, port, pin) name,
+	SENSOR_LIST
+#undef SENSOR
+};
+
+void align_init(align_t *align)
+{
+	memset(align, 0, sizeof(*align));
+	align->period_min_us = UINT32_MAX;
+	for (int s = 0; s < SENSOR_COUNT; s++) {
+		align->skew_min_us[s] = UINT32_MAX;
+	}
+}
+
+void align_frame(align_t *align)
+{
+	align->read = 0;
+}
+
+void align_read(align_t *align, int s, uint32_t start_us, uint32_t end_us)
+{
+	align->read_us[s] = start_us + (end_us - start_us) / 2;
+	align->read |= 1u << s;
+}
+
+void align_interpolate(const int16_t *last, uint32_t last_us, uint16_t *raw, uint32_t read_us,
+		uint32_t t_us)
+{
+	// At most 2^31 / 2^14 us apart, so the shifted numerator fits; the weight is at most 2^14
+	// and a difference of two samples at most 2^16, so their product fits as well
+	uint32_t span = read_us - last_us;
+	int32_t w = (int32_t) ((((t_us - last_us) << ALIGN_FRAC_BITS) + span / 2) / span);
+
+	for (int a = 0; a < SENSOR_AXES; a++) {
+		int32_t diff = (int16_t) raw[a] - last[a];
+		int32_t step = (diff * w + (1 << (ALIGN_FRAC_BITS - 1))) >> ALIGN_FRAC_BITS;
+
+		raw[a] = (uint16_t) (last[a] + step);
+	}
+}
+
+uint32_t align_apply(align_t *align, uint16_t *raw, uint32_t fresh, bool compensate)
+{
+	uint32_t read = fresh & align->read;
+	uint32_t t = 0;
+	bool first = true;
+
+	for (int s = 0; s < SENSOR_COUNT; s++) {
+		if ((read & (1u << s)) && (first || (int32_t) (align->read_us[s] - t) < 0)) {
+			t = align->read_us[s];
+			first = false;
+		}
+	}
+	if (first) {
+		align->valid = 0;
+		return align->frame_us;
+	}
+
+	if (align->frames > 0) {
+		uint32_t period = t - align->frame_us;
+
+		align->periods++;
+		align->period_sum_us += period;
+		align->period_min_us = (period < align->period_min_us) ? period : align->period_min_us;
+		align->period_max_us = (period > align->period_max_us) ? period : align->period_max_us;
+	}
+	align->frames++;
+	align->frame_us = t;
+
+	for (int s = 0; s < SENSOR_COUNT; s++) {
+		uint16_t *sample = &raw[s * SENSOR_AXES];
+		int16_t current[SENSOR_AXES];
+
+		if (!(read & (1u << s))) {
+			continue;
+		}
+
+		uint32_t skew = align->read_us[s] - t;
+
+		align->skews[s]++;
+		align->skew_sum_us[s] += skew;
+		align->skew_min_us[s] = (skew < align->skew_min_us[s]) ? skew : align->skew_min_us[s];
+		align->skew_max_us[s] = (skew > align->skew_max_us[s]) ? skew : align->skew_max_us[s];
+
+		// The sample as read is kept for the next frame, not the interpolated one
+		for (int a = 0; a < SENSOR_AXES; a++) {
+			current[a] = (int16_t) sample[a];
+		}
+		if (compensate && (align->valid & (1u << s)) && skew > 0
+				&& align->read_us[s] - align->last_us[s] <= ALIGN_MAX_GAP_US) {
+			align_interpolate(align->last[s], align->last_us[s], sample, align->read_us[s], t);
+		}
+		memcpy(align->last[s], current, sizeof(current));
+		align->last_us[s] = align->read_us[s];
+	}
+	align->valid = read;
+
+	return t;
+}
+
+void align_report(const align_t *align)
+{
+	if (align->periods == 0) {
+		return;
+	}
+
+	printf("\nFrame period %u us (%u ... %u), skew of each sensor from the first read:\n",
+			(unsigned) (align->period_sum_us / align->periods), (unsigned) align->period_min_us,
+			(unsigned) align->period_max_us);
+	for (int s = 0; s < SENSOR_COUNT; s++) {
+		if (align->skews[s] == 0) {
+			continue;
+		}
+		printf("%-3s %6u us (%u ... %u), %u%% of the period\n", sensor_names[s],
+				(unsigned) (align->skew_sum_us[s] / align->skews[s]),
+				(unsigned) align->skew_min_us[s], (unsigned) align->skew_max_us[s],
+				(unsigned) (100 * align->skew_sum_us[s] / align->skews[s] * align->periods
+						/ align->period_sum_us));
+	}
+}
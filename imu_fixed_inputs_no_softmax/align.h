@@ -0,0 +1,98 @@
+/**
+ * @file        align.h
+ * @brief       Timestamps of the sensor reads, their skew within a frame and its compensation
+ * @details     The sensors are read one after another, so the samples of a frame are taken up to
+ *              most of a frame period apart while the network sees them as one instant. Each read
+ *              is timestamped at its middle (the axes are read byte by byte, so a sample spans
+ *              the whole read). The skew of a sensor is the time from the frame's first read to
+ *              its own, and the statistics of it and of the frame period are kept per sensor.
+ *
+ *              With ALIGN_COMPENSATE set, every sensor is interpolated linearly to the time of the
+ *              frame's first read, between its previous sample and the one just read. The first
+ *              read of a frame comes after every read of the frame before, so both samples are
+ *              always at hand and the frame isn't delayed. The fraction is Q14 fixed point, one
+ *              division per sensor and a multiply per axis. A sensor without a previous sample,
+ *              e.g. after a failed read, or with a gap over ALIGN_MAX_GAP_US passes through.
+ *
+ *              The network was trained on logs read the same way, without compensation, so
+ *              ALIGN_COMPENSATE stays off until it is retrained on aligned data. 'make -C host
+ *              align' measures the error of both against the recordings at several frame rates.
+ *
+ *              Plain C without SDK dependencies, shared with the host tools in ../host.
+ */
+
+#ifndef __ALIGN_H__
+#define __ALIGN_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sensor_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Set to 1 to interpolate every sensor to the time of the frame's first read */
+#ifndef ALIGN_COMPENSATE
+#define ALIGN_COMPENSATE 0
+#endif
+
+/* Fraction bits of the interpolation weight */
+#define ALIGN_FRAC_BITS 14
+
+/* Longest time between two samples of a sensor that is interpolated, keeps the Q14 shift in
+ * 32 bits */
+#define ALIGN_MAX_GAP_US (1u << (32 - ALIGN_FRAC_BITS - 1))
+
+typedef struct {
+	uint32_t read_us[SENSOR_COUNT];         // middle of the read of the sample at hand
+	uint32_t last_us[SENSOR_COUNT];         // and of the one before
+	int16_t last[SENSOR_COUNT][SENSOR_AXES];
+	uint32_t read;                          // sensors read in this frame
+	uint32_t valid;                         // sensors with a previous sample
+
+	// Statistics since align_init(), skews from the frame's first read
+	uint32_t frame_us;                      // first read of the last frame
+	uint32_t frames;
+	uint32_t periods;
+	uint64_t period_sum_us;
+	uint32_t period_min_us;
+	uint32_t period_max_us;
+	uint32_t skews[SENSOR_COUNT];
+	uint64_t skew_sum_us[SENSOR_COUNT];
+	uint32_t skew_min_us[SENSOR_COUNT];
+	uint32_t skew_max_us[SENSOR_COUNT];
+} align_t;
+
+/* Forget all samples and statistics, e.g. at boot */
+void align_init(align_t *align);
+
+/* Start a new frame, called before its first read */
+void align_frame(align_t *align);
+
+/* Record the read of sensor s that started at start_us and ended at end_us */
+void align_read(align_t *align, int s, uint32_t start_us, uint32_t end_us);
+
+/*
+ * Finish the frame: update the statistics with the sensors in fresh that were read in it and,
+ * if compensate is set, interpolate their samples in raw (SENSOR_COUNT x SENSOR_AXES, register
+ * contents as calibrated) to the time of the frame's first read. The other sensors are left as
+ * they are and start over without a previous sample. Returns that time.
+ */
+uint32_t align_apply(align_t *align, uint16_t *raw, uint32_t fresh, bool compensate);
+
+/*
+ * Interpolate one sample to t_us between the previous one taken at last_us and the current
+ * one at read_us, last_us <= t_us <= read_us, in Q14 fixed point with rounding
+ */
+void align_interpolate(const int16_t *last, uint32_t last_us, uint16_t *raw, uint32_t read_us,
+		uint32_t t_us);
+
+/* Print the frame period and every sensor's skew since align_init() */
+void align_report(const align_t *align);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __ALIGN_H__
@@ -0,0 +1,78 @@
+/**
+ * @file        boot.c
+ * @brief       Boot timeline and deadlines for overlapping the bring-up steps
+ */
+
+#include <stdio.h>
+#include "mxc_device.h"
+#include "boot.h"
+
+typedef struct {
+	const char *name;
+	uint32_t us;
+} boot_step_t;
+
+static boot_step_t steps[BOOT_MAX_STEPS];
+static int num_steps;
+
+// Cycle counter extended to 64 bits, it wraps every 43 s at 100 MHz
+static uint32_t last_cycles;
+static uint64_t total_cycles;
+
+void boot_init(void) {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	last_cycles = DWT->CYCCNT;
+	total_cycles = 0;
+	num_steps = 0;
+}
+
+static uint64_t cycles(void) {
+	uint32_t now = DWT->CYCCNT;
+
+	total_cycles += (uint32_t) (now - last_cycles);
+	last_cycles = now;
+
+	return total_cycles;
+}
+
+uint32_t boot_us(void) {
+	return (uint32_t) (cycles() / (SystemCoreClock / 1000000));
+}
+
+uint32_t boot_ms(void) {
+	return (uint32_t) (cycles() / (SystemCoreClock / 1000));
+}
+
+bool boot_reached(uint32_t ms) {
+	return boot_ms() >= ms;
+}
+
+void boot_wait_until(uint32_t ms) {
+	while (!boot_reached(ms))
+		;
+}
+
+void boot_step(const char *name) {
+	if (num_steps < BOOT_MAX_STEPS) {
+		steps[num_steps].name = name;
+		steps[num_steps].us = boot_us();
+		num_steps++;
+	}
+}
+
+void boot_report(void) {
+	uint32_t prev = 0;
+
+	printf("\nBoot timeline (ms since clock setup):\n");
+	for (int i = 0; i < num_steps; i++) {
+		printf("%8u.%03u  +%6u.%03u  %s\n", (unsigned) (steps[i].us / 1000),
+				(unsigned) (steps[i].us % 1000), (unsigned) ((steps[i].us - prev) / 1000),
+				(unsigned) ((steps[i].us - prev) % 1000), steps[i].name);
+		prev = steps[i].us;
+	}
+	if (num_steps > 0) {
+		printf("Time to first classification: %u ms\n", (unsigned) (prev / 1000));
+	}
+}
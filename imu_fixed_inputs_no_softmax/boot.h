@@ -0,0 +1,50 @@
+/**
+ * @file        boot.h
+ * @brief       Boot timeline and deadlines for overlapping the bring-up steps
+ * @details     There is one core and no scheduler, so instead of sleeping through fixed delays
+ *              every wait is a deadline measured from reset: the steps that don't depend on it
+ *              run in the meantime and only the step that needs it checks or waits for it. The
+ *              time base is the DWT cycle counter, so it keeps running through busy-waits but
+ *              not through sleep, which no step before the first classification uses.
+ */
+
+#ifndef __BOOT_H__
+#define __BOOT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* After reset the debugger needs this long to halt the core before it first sleeps */
+#define BOOT_DEBUG_WINDOW_MS 2000
+
+/* Most steps recorded in the timeline */
+#define BOOT_MAX_STEPS 24
+
+/* Start the time base, called once right after the system clock is set */
+void boot_init(void);
+
+/* Time since boot_init(), boot_us() wraps after 71 minutes and boot_ms() after 49 days */
+uint32_t boot_us(void);
+uint32_t boot_ms(void);
+
+/* Whether ms milliseconds have passed since boot_init() */
+bool boot_reached(uint32_t ms);
+
+/* Busy-wait without sleeping until ms milliseconds after boot_init() */
+void boot_wait_until(uint32_t ms);
+
+/* Record that a step of the timeline finished now, name must stay valid */
+void boot_step(const char *name);
+
+/* Print the timeline, called once the first classification was sent as the last step */
+void boot_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __BOOT_H__
@@ -0,0 +1,153 @@
+/**
+ * @file        calib.c
+ * @brief       Per-sensor calibration, estimated at rest and kept in the last flash page
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "mxc.h"
+#include "flc.h"
+#include "calib.h"
+
+#define CALIB_MAGIC 0x314C4143 // "CAL1"
+
+/* The last flash page, reserved by calib.ld */
+#define CALIB_PAGE (MXC_FLASH_MEM_BASE + MXC_FLASH_MEM_SIZE - MXC_FLASH_PAGE_SIZE)
+
+/* One record per slot and estimate, a multiple of the 128-bit flash write */
+typedef struct {
+	uint32_t magic;
+	uint16_t slot;          // id of the sensor, see sensor_config.h
+	uint16_t reserved;
+	int16_t rest[MPU6050_AXES];     // every axis, whichever are read
+	int16_t scale[MPU6050_AXES];
+	uint32_t unused[3];
+	uint32_t crc;           // CRC-32 of everything before it
+} calib_record_t;
+
+_Static_assert(sizeof(calib_record_t) % 16 == 0, "records must be whole flash writes");
+
+#define CALIB_RECORDS (MXC_FLASH_PAGE_SIZE / sizeof(calib_record_t))
+
+static calib_estimate_t est;
+static unsigned next_record;
+
+static uint32_t crc32(const void *data, size_t len) {
+	const uint8_t *bytes = data;
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (size_t i = 0; i < len; i++) {
+		crc ^= bytes[i];
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+		}
+	}
+
+	return ~crc;
+}
+
+static int write_record(int s) {
+	calib_record_t record;
+	int error;
+
+	// The unused words stay erased, the axes that aren't read are stored as 1.0
+	memset(&record, 0xFF, sizeof(record));
+	record.magic = CALIB_MAGIC;
+	record.slot = mpu6050_sensors[s].id;
+	for (int axis = 0; axis < MPU6050_AXES; axis++) {
+		record.rest[axis] = 0;
+		record.scale[axis] = PREPROCESS_UNITY;
+	}
+	for (int a = 0; a < SENSOR_AXES; a++) {
+		record.rest[sensor_axis(a)] = est.rest[s * SENSOR_AXES + a];
+		record.scale[sensor_axis(a)] = est.scale[s * SENSOR_AXES + a];
+	}
+	record.crc = crc32(&record, offsetof(calib_record_t, crc));
+
+	error = MXC_FLC_Write(CALIB_PAGE + next_record * sizeof(record), sizeof(record),
+			(uint32_t*) &record);
+	if (error == E_NO_ERROR) {
+		next_record++;
+	}
+
+	return error;
+}
+
+static int store(int s) {
+	int error;
+
+	if (next_record < CALIB_RECORDS) {
+		return write_record(s);
+	}
+
+	// The page is full, start over with the current record of every slot
+	error = calib_erase();
+	for (int t = 0; t < MPU6050_NUM_SENSORS && error == E_NO_ERROR; t++) {
+		if (est.calibrated & (1u << t)) {
+			error = write_record(t);
+		}
+	}
+
+	return error;
+}
+
+uint32_t calib_load(void) {
+	const calib_record_t *records = (const calib_record_t*) CALIB_PAGE;
+
+	calib_estimate_init(&est);
+
+	// Records are appended in order, the first erased one ends the list
+	for (next_record = 0; next_record < CALIB_RECORDS; next_record++) {
+		const calib_record_t *record = &records[next_record];
+		int s = 0;
+
+		if (record->magic == 0xFFFFFFFF) {
+			break;
+		}
+		if (record->magic != CALIB_MAGIC
+				|| record->crc != crc32(record, offsetof(calib_record_t, crc))) {
+			continue;
+		}
+
+		// Records are keyed by sensor id, a kit may not have every sensor
+		while (s < MPU6050_NUM_SENSORS && mpu6050_sensors[s].id != record->slot) {
+			s++;
+		}
+		if (s == MPU6050_NUM_SENSORS) {
+			continue;
+		}
+
+		for (int a = 0; a < SENSOR_AXES; a++) {
+			est.rest[s * SENSOR_AXES + a] = record->rest[sensor_axis(a)];
+			est.scale[s * SENSOR_AXES + a] = record->scale[sensor_axis(a)];
+		}
+		est.calibrated |= 1u << s;
+	}
+
+	return est.calibrated;
+}
+
+int calib_erase(void) {
+	int error = MXC_FLC_PageErase(CALIB_PAGE);
+
+	next_record = 0;
+
+	return error;
+}
+
+uint32_t calib_update(const uint16_t *raw, uint32_t fresh) {
+	uint32_t done = calib_estimate_update(&est, raw, fresh);
+
+	// A failed write only costs the estimate on the next boot
+	for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+		if (done & (1u << s)) {
+			store(s);
+		}
+	}
+
+	return done;
+}
+
+void calib_apply(uint16_t *raw) {
+	calib_estimate_apply(&est, raw);
+}
@@ -0,0 +1,42 @@
+/**
+ * @file        calib.h
+ * @brief       Per-sensor calibration, estimated at rest and kept in the last flash page
+ * @details     Each sensor slot gets the mean reading of its axes at rest, the gyro bias and
+ *              gravity, and a scale for each axis that preprocess_calibrate() applies around it,
+ *              see calib_estimate.h. Slots without a stored record are estimated while the main
+ *              loop runs, so calibration never holds up the boot. Until then the frames pass
+ *              through unchanged.
+ *
+ *              Records are appended to the page and the last valid one of a slot wins, the page
+ *              is only erased when it is full. calib.ld reserves the page and fails the link if
+ *              the image runs into it.
+ */
+
+#ifndef __CALIB_H__
+#define __CALIB_H__
+
+#include <stdint.h>
+#include "calib_estimate.h"
+#include "mpu6050.h"
+
+/*
+ * Load the stored records, the slots without one start out uncalibrated.
+ * Returns a mask with bit s set for every sensor slot s that was loaded.
+ */
+uint32_t calib_load(void);
+
+/* Erase the stored records, e.g. after a sensor was replaced, returns E_NO_ERROR or the FLC error */
+int calib_erase(void);
+
+/*
+ * Feed one uncalibrated frame to the estimates of the uncalibrated slots, only the slots with
+ * bit s set in fresh hold a sample that was actually read. Once a slot has been
+ * at rest for CALIB_FRAMES frames its calibration is stored and applied from the next frame on.
+ * Returns a mask of the slots that were calibrated by this frame.
+ */
+uint32_t calib_update(const uint16_t *raw, uint32_t fresh);
+
+/* Apply the calibration to one frame of raw samples in place */
+void calib_apply(uint16_t *raw);
+
+#endif // __CALIB_H__
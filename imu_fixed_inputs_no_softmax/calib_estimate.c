@@ -0,0 +1,152 @@
+/**
+ * @file        calib_estimate.c
+ * @brief       Estimate of each sensor's reading at rest and accelerometer scale
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "calib_estimate.h"
+
+const size_t calib_estimate_size = sizeof(calib_estimate_t);
+
+static uint32_t isqrt(uint32_t x) {
+	uint32_t root = 0;
+	uint32_t bit = 1u << 30;
+
+	while (bit > x) {
+		bit >>= 2;
+	}
+	while (bit != 0) {
+		if (x >= root + bit) {
+			x -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return root;
+}
+
+void calib_estimate_init(calib_estimate_t *est) {
+	memset(est, 0, sizeof(*est));
+	for (int s = 0; s < SENSOR_COUNT; s++) {
+		calib_estimate_reset(est, s);
+	}
+}
+
+void calib_estimate_reset(calib_estimate_t *est, int s) {
+	for (int a = 0; a < SENSOR_AXES; a++) {
+		est->rest[s * SENSOR_AXES + a] = 0;
+		est->scale[s * SENSOR_AXES + a] = PREPROCESS_UNITY;
+	}
+	est->calibrated &= ~(1u << s);
+	est->frames[s] = 0;
+}
+
+/* Finish the estimate of slot s, false if the readings don't look like a sensor at rest */
+static bool estimate(calib_estimate_t *est, int s) {
+	int16_t *r = est->rest + s * SENSOR_AXES;
+	uint32_t gravity = 0;
+
+	for (int a = 0; a < SENSOR_AXES; a++) {
+		r[a] = est->sum[s * SENSOR_AXES + a] / CALIB_FRAMES;
+		if (sensor_axis(a) < 3) {
+			gravity += (int32_t) r[a] * r[a];
+		}
+	}
+	gravity = isqrt(gravity);
+
+	// A sensor that doesn't answer reads all zeros, which is as still as it gets
+	if (gravity < CALIB_GRAVITY_MIN * CALIB_1G / 8 || gravity > CALIB_GRAVITY_MAX * CALIB_1G / 8) {
+		calib_estimate_reset(est, s);
+		return false;
+	}
+
+	for (int a = 0; a < SENSOR_AXES; a++) {
+		if (sensor_axis(a) < 3) {
+			est->scale[s * SENSOR_AXES + a] = ((uint32_t) CALIB_1G << 14) / gravity;
+		}
+	}
+
+	return true;
+}
+
+uint32_t calib_estimate_update(calib_estimate_t *est, const uint16_t *raw, uint32_t fresh) {
+	uint32_t done = 0;
+
+	// Gravity is the only reference there is, without all of its axes there is nothing to estimate
+	if ((SENSOR_AXES_MASK & SENSOR_AXIS_ACCEL) != SENSOR_AXIS_ACCEL) {
+		return 0;
+	}
+
+	for (int s = 0; s < SENSOR_COUNT; s++) {
+		bool moved = false;
+
+		if (est->calibrated & (1u << s)) {
+			continue;
+		}
+
+		// A gap in the readings ends the estimate, the sensor may have moved in the meantime
+		if (!(fresh & (1u << s))) {
+			est->frames[s] = 0;
+			continue;
+		}
+
+		for (int a = 0; a < SENSOR_AXES; a++) {
+			int i = s * SENSOR_AXES + a;
+			int16_t value = (int16_t) raw[i];
+
+			if (est->frames[s] == 0) {
+				est->sum[i] = 0;
+				est->low[i] = value;
+				est->high[i] = value;
+			}
+			est->sum[i] += value;
+			est->low[i] = (value < est->low[i]) ? value : est->low[i];
+			est->high[i] = (value > est->high[i]) ? value : est->high[i];
+
+			if (est->high[i] - est->low[i] > ((sensor_axis(a) < 3) ? CALIB_ACCEL_SPREAD
+					: CALIB_GYRO_SPREAD)) {
+				moved = true;
+			}
+		}
+
+		// Motion restarts the estimate, the next frame is the first one of it
+		if (moved) {
+			est->frames[s] = 0;
+			continue;
+		}
+
+		if (++est->frames[s] == CALIB_FRAMES && estimate(est, s)) {
+			est->calibrated |= 1u << s;
+			done |= 1u << s;
+		}
+	}
+
+	return done;
+}
+
+void calib_estimate_apply(const calib_estimate_t *est, uint16_t *raw) {
+	preprocess_calibrate(raw, est->rest, est->scale);
+}
+
+uint32_t calib_estimate_recording(calib_estimate_t *est, const uint16_t *raw, size_t frames) {
+	uint32_t all = (1u << SENSOR_COUNT) - 1;
+	uint32_t done = 0;
+
+	// A recording starts after a gap
+	calib_estimate_update(est, raw, 0);
+	for (size_t n = 0; n < frames && (est->calibrated & all) != all; n++) {
+		done |= calib_estimate_update(est, raw + n * PREPROCESS_CHANNELS, all);
+	}
+
+	return done;
+}
+
+void calib_estimate_apply_recording(const calib_estimate_t *est, uint16_t *raw, size_t frames) {
+	for (size_t n = 0; n < frames; n++) {
+		calib_estimate_apply(est, raw + n * PREPROCESS_CHANNELS);
+	}
+}
@@ -0,0 +1,88 @@
+/**
+ * @file        calib_estimate.h
+ * @brief       Estimate of each sensor's reading at rest and accelerometer scale
+ * @details     The estimate calib.c keeps in flash, without the flash: every uncalibrated slot
+ *              averages the first CALIB_FRAMES frames during which it doesn't move and takes the
+ *              mean as its rest reading, and the magnitude of gravity in it sets the accelerometer
+ *              scale. The gyro scale stays 1.0 since it can't be estimated without a known
+ *              rotation. Without all three accelerometer axes in SENSOR_AXES_MASK nothing is
+ *              estimated.
+ *
+ *              The host tools and the training data loader (through libimupreprocess.so)
+ *              calibrate the recordings with the same estimate, so the network is trained and
+ *              scored on the inputs the device sends once its sensors are calibrated.
+ *
+ *              Plain C without SDK dependencies, shared with the host tools in ../host.
+ */
+
+#ifndef __CALIB_ESTIMATE_H__
+#define __CALIB_ESTIMATE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "preprocess.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Frames at rest averaged per estimate, about 3 s at the current frame rate */
+#define CALIB_FRAMES 32
+
+/* Largest spread of a reading over the estimate that still counts as rest, torn reads of the
+ * high and low byte can add up to 256 */
+#define CALIB_ACCEL_SPREAD 2048
+#define CALIB_GYRO_SPREAD 512
+
+/* Magnitude of gravity accepted for an estimate, in 1/8 g */
+#define CALIB_GRAVITY_MIN 6
+#define CALIB_GRAVITY_MAX 10
+
+/* Accelerometer reading of 1 g at the +-2 g range mpu6050_init() sets */
+#define CALIB_1G 16384
+
+typedef struct {
+	int16_t rest[PREPROCESS_CHANNELS];      // what preprocess_calibrate() applies
+	int16_t scale[PREPROCESS_CHANNELS];
+	uint32_t calibrated;                    // bit s set once slot s has its calibration
+
+	// Running estimate of every uncalibrated slot
+	int frames[SENSOR_COUNT];
+	int32_t sum[PREPROCESS_CHANNELS];
+	int16_t low[PREPROCESS_CHANNELS];
+	int16_t high[PREPROCESS_CHANNELS];
+} calib_estimate_t;
+
+/* sizeof(calib_estimate_t) of the build, for loaders of the shared library */
+extern const size_t calib_estimate_size;
+
+/* Start with every slot uncalibrated, passing its readings through unchanged */
+void calib_estimate_init(calib_estimate_t *est);
+
+/* Forget the calibration of slot s and start its estimate over */
+void calib_estimate_reset(calib_estimate_t *est, int s);
+
+/*
+ * Feed one uncalibrated frame to the estimates of the uncalibrated slots, only the slots with
+ * bit s set in fresh hold a sample that was actually read. A gap or motion starts the estimate
+ * of a slot over. Returns a mask of the slots that were calibrated by this frame.
+ */
+uint32_t calib_estimate_update(calib_estimate_t *est, const uint16_t *raw, uint32_t fresh);
+
+/* Apply the calibration to one frame of raw samples in place */
+void calib_estimate_apply(const calib_estimate_t *est, uint16_t *raw);
+
+/*
+ * Feed a continuous recording of frames with every sensor read, the estimate of a slot that
+ * isn't done yet starts over with it. Returns the slots calibrated by it.
+ */
+uint32_t calib_estimate_recording(calib_estimate_t *est, const uint16_t *raw, size_t frames);
+
+/* Apply the calibration to every frame of a recording in place */
+void calib_estimate_apply_recording(const calib_estimate_t *est, uint16_t *raw, size_t frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CALIB_ESTIMATE_H__
@@ -0,0 +1,42 @@
+/**
+ * @file        classify.c
+ * @brief       Decoding of the network output into an activity class
+ */
+
+#include "classify.h"
+
+void classify_logits(const uint32_t *ml_data, int8_t *logits)
+{
+	for (int i = 0; i < CLASSIFY_CLASSES; i++) {
+		uint32_t half = (ml_data[i / 2] >> (16 * (i % 2))) & 0xFFFF;
+
+		logits[i] = (int8_t) (half >> 6);
+	}
+}
+
+int classify_argmax(const int8_t *logits, int n)
+{
+	int best = 0;
+
+	for (int i = 1; i < n; i++) {
+		if (logits[i] > logits[best]) {
+			best = i;
+		}
+	}
+
+	return best;
+}
+
+int classify_margin(const int8_t *logits, int n)
+{
+	int best = classify_argmax(logits, n);
+	int second = -256;
+
+	for (int i = 0; i < n; i++) {
+		if (i != best && logits[i] > second) {
+			second = logits[i];
+		}
+	}
+
+	return (n > 1) ? logits[best] - second : 0;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file        classify.h
+ * @brief       Decoding of the network output into an activity class
+ * @details     Plain C without SDK dependencies, shared with the host tools in ../host.
+ */
+
+#ifndef __CLASSIFY_H__
+#define __CLASSIFY_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Activity classes, in the order of the network outputs */
+#define CLASSIFY_CLASSES 5
+#define CLASSIFY_DOWNSTAIRS 0
+#define CLASSIFY_SITTING 1
+#define CLASSIFY_STANDING 2
+#define CLASSIFY_UPSTAIRS 3
+#define CLASSIFY_WALKING 4
+
+/*
+ * cnn_unload() stores 8 halfwords (one per output processor of the layer) even though only
+ * CLASSIFY_CLASSES are used, so the buffer passed to it needs this many words
+ */
+#define CLASSIFY_UNLOAD_WORDS 4
+
+/*
+ * Extract the int8 logits from the buffer filled by cnn_unload(). Each output is stored as a
+ * halfword holding the raw output byte << 6, in class order.
+ */
+void classify_logits(const uint32_t *ml_data, int8_t *logits);
+
+/* Index of the largest logit, the lowest index wins ties */
+int classify_argmax(const int8_t *logits, int n);
+
+/* Difference between the largest and the second largest logit */
+int classify_margin(const int8_t *logits, int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CLASSIFY_H__
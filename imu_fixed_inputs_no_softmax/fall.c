@@ -0,0 +1,108 @@
+/**
+ * @file        fall.c
+ * @brief       Fall and impact detection on the raw accelerometer samples
+ */
+
+#include <stdio.h>
+#include "fall.h"
+
+// Thresholds as squared magnitudes in register units, at most 3 * 32768^2 so 32 bits suffice
+#define SQUARED(mg) ((uint32_t) ((mg) * FALL_1G / 1000) * (uint32_t) ((mg) * FALL_1G / 1000))
+
+static unsigned free_frames[SENSOR_COUNT];  // samples in free fall in a row
+static unsigned falling;                    // sensors in free fall in this frame
+static unsigned hard;                       // sensors over FALL_HARD_MG in this frame
+static unsigned quorum;                     // sensors that have to agree in this frame
+static unsigned armed;                      // frames left in which an impact completes a fall
+static unsigned holdoff;
+
+void fall_init(void)
+{
+	for (int s = 0; s < SENSOR_COUNT; s++) {
+		free_frames[s] = 0;
+	}
+	falling = 0;
+	hard = 0;
+	quorum = FALL_SENSORS;
+	armed = 0;
+	holdoff = 0;
+}
+
+void fall_frame(uint32_t reading)
+{
+	unsigned count = 0;
+
+	for (int s = 0; s < SENSOR_COUNT; s++) {
+		count += (reading >> s) & 1;
+	}
+	quorum = (count < FALL_SENSORS) ? count : FALL_SENSORS;
+	falling = 0;
+	hard = 0;
+	if (armed > 0) {
+		armed--;
+	}
+	if (holdoff > 0) {
+		holdoff--;
+	}
+}
+
+fall_event_t fall_sample(int s, const uint16_t *raw, fall_alert_t *alert)
+{
+	fall_event_t event = FALL_NONE;
+	uint32_t m2 = 0;
+	uint16_t any = 0;
+
+	if ((SENSOR_AXES_MASK & SENSOR_AXIS_ACCEL) != SENSOR_AXIS_ACCEL) {
+		return FALL_NONE;
+	}
+
+	for (int a = 0; a < SENSOR_AXES; a++) {
+		if (sensor_axis(a) < 3) {
+			int32_t v = (int16_t) raw[a];
+
+			m2 += (uint32_t) (v * v);
+			any |= raw[a];
+		}
+	}
+	if (!any) {
+		return FALL_NONE;
+	}
+
+	if (m2 < SQUARED(FALL_FREE_MG)) {
+		if (++free_frames[s] >= FALL_FREE_FRAMES && ++falling >= quorum) {
+			armed = FALL_IMPACT_FRAMES;
+		}
+		return FALL_NONE;
+	}
+	free_frames[s] = 0;
+
+	if (m2 >= SQUARED(FALL_IMPACT_MG) && armed > 0) {
+		event = FALL_FALL;
+	} else if (m2 >= SQUARED(FALL_HARD_MG) && ++hard >= quorum) {
+		event = FALL_IMPACT;
+	}
+	if (event == FALL_NONE || holdoff > 0) {
+		return FALL_NONE;
+	}
+
+	// One alert per event, the free fall seen so far belongs to it
+	holdoff = FALL_HOLDOFF_FRAMES;
+	armed = 0;
+
+	alert->event = event;
+	alert->sensor = s;
+	alert->peak_dg = 0;
+	while (alert->peak_dg < 34 && m2 >= SQUARED((alert->peak_dg + 1) * 100)) {
+		alert->peak_dg++;
+	}
+
+	return event;
+}
+
+int fall_format(const fall_alert_t *alert, const char *sensor_name, char *buf, int len)
+{
+	int n = snprintf(buf, len, "!%s %s %u.%ug\r\n", (alert->event == FALL_FALL) ? "FALL" : "IMPACT",
+			sensor_name, alert->peak_dg / 10, alert->peak_dg % 10);
+
+	return (n < len) ? n : len - 1;
+}
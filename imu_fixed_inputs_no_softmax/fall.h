@@ -0,0 +1,91 @@
+/**
+ * @file        fall.h
+ * @brief       Fall and impact detection on the raw accelerometer samples
+ * @details     Runs on every sample as soon as it was read, before the frame is complete, so an
+ *              alert doesn't wait for the CNN window. A fall is a free fall of the body, i.e. the
+ *              magnitude of the acceleration well below 1 g for FALL_FREE_FRAMES samples in a row
+ *              on FALL_SENSORS sensors at once, followed by an impact on any sensor within
+ *              FALL_IMPACT_FRAMES frames. An impact alone is reported when FALL_SENSORS sensors
+ *              exceed FALL_HARD_MG in the same frame. Needing several sensors keeps a single
+ *              faulty sensor or a foot striking the ground from raising alerts. While the wearer
+ *              sits or stands, power.c keeps FALL_SENSORS sensors reading and lets the others
+ *              sleep. Only the sensors read in a frame count, so the alerts still work with fewer
+ *              than FALL_SENSORS of them up. After an alert the detector holds off for
+ *              FALL_HOLDOFF_FRAMES frames, so one event gives one alert.
+ *
+ *              The accelerometers run at +-2 g, so an impact saturates and the thresholds stay
+ *              below 2 g. Magnitudes are compared squared in register units, no division or
+ *              square root per sample. 'make -C host fall' measures the latency from the sample
+ *              to the alert on the UART and the false alarms on the recordings.
+ *
+ *              Plain C without SDK dependencies, shared with the host tools in ../host.
+ */
+
+#ifndef __FALL_H__
+#define __FALL_H__
+
+#include <stdint.h>
+#include "sensor_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Accelerometer reading of 1 g at the +-2 g range mpu6050_init() sets */
+#define FALL_1G 16384
+
+/* Sensors that have to see a free fall or a hard impact together, half of them, or all of the
+ * sensors read in a frame if fewer are */
+#define FALL_SENSORS ((SENSOR_COUNT + 1) / 2)
+
+/* Magnitude below which a sensor is in free fall and for how many samples in a row */
+#define FALL_FREE_MG 400
+#define FALL_FREE_FRAMES 2
+
+/* Magnitude of the impact that has to follow a free fall, and within how many frames */
+#define FALL_IMPACT_MG 1800
+#define FALL_IMPACT_FRAMES 10
+
+/* Magnitude of an impact without free fall */
+#define FALL_HARD_MG 1950
+
+/* Frames after an alert during which no other alert is raised */
+#define FALL_HOLDOFF_FRAMES 30
+
+/* Longest alert message */
+#define FALL_MESSAGE_LEN 24
+
+typedef enum {
+	FALL_NONE,
+	FALL_IMPACT,        // hard impact on several sensors without free fall before
+	FALL_FALL,          // free fall followed by an impact
+} fall_event_t;
+
+typedef struct {
+	fall_event_t event;
+	int sensor;             // sensor whose sample raised the alert
+	unsigned peak_dg;       // its magnitude in 1/10 g
+} fall_alert_t;
+
+/* Forget all state, e.g. at boot */
+void fall_init(void);
+
+/* Start a new frame, called before its first sample with a mask of the sensors it will read */
+void fall_frame(uint32_t reading);
+
+/*
+ * Feed the sample of sensor s just read, raw holding its SENSOR_AXES axes as register contents.
+ * Returns the event it raises and fills alert if there is one. A sample with all accelerometer
+ * axes 0 is taken for a failed read. Without all three accelerometer axes in SENSOR_AXES_MASK
+ * nothing is detected.
+ */
+fall_event_t fall_sample(int s, const uint16_t *raw, fall_alert_t *alert);
+
+/* Write the alert message for the UART, e.g. "!FALL RL 1.9g\r\n", returns its length */
+int fall_format(const fall_alert_t *alert, const char *sensor_name, char *buf, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __FALL_H__
@@ -0,0 +1,98 @@
+/**
+ * @file        health.c
+ * @brief       Health tracking of the MPU-6050 sensors with backoff and re-initialization
+ */
+
+#include <stdio.h>
+#include "mxc.h"
+#include "boot.h"
+#include "health.h"
+
+health_t health[MPU6050_NUM_SENSORS];
+
+static void take_down(int s, uint32_t backoff_ms) {
+	health_t *h = &health[s];
+
+	h->state = HEALTH_DOWN;
+	h->backoff_ms = (backoff_ms > HEALTH_BACKOFF_MAX_MS) ? HEALTH_BACKOFF_MAX_MS : backoff_ms;
+	h->retry_ms = boot_ms() + h->backoff_ms;
+}
+
+void health_init(int s, int init_error) {
+	health_t *h = &health[s];
+
+	h->state = HEALTH_UP;
+	h->error = init_error;
+	h->failures = 0;
+	h->reads = 0;
+	h->errors = 0;
+	h->reinits = 0;
+	h->backoff_ms = 0;
+	h->retry_ms = 0;
+
+	if (init_error != E_NO_ERROR) {
+		take_down(s, HEALTH_BACKOFF_MIN_MS);
+	}
+}
+
+bool health_read(mxc_i2c_regs_t *i2c, int s, uint16_t *raw) {
+	health_t *h = &health[s];
+	int error;
+
+	if (h->state == HEALTH_DOWN) {
+		if ((int32_t) (boot_ms() - h->retry_ms) < 0) {
+			return false;
+		}
+
+		// A hung sensor holds every transaction until the I2C timeout, the one of the reads would
+		// hold up the frame well past HEALTH_REINIT_TIMEOUT_MS
+		unsigned int timeout_us = MXC_I2C_GetTimeout(i2c);
+
+		h->reinits++;
+		MXC_I2C_SetTimeout(i2c, HEALTH_REINIT_I2C_TIMEOUT_US);
+		error = mpu6050_init(i2c, s, HEALTH_REINIT_TIMEOUT_MS);
+		MXC_I2C_SetTimeout(i2c, timeout_us);
+		if (error != E_NO_ERROR) {
+			h->error = error;
+			take_down(s, 2 * h->backoff_ms);
+			return false;
+		}
+
+		printf("\n-->Sensor %s re-initialized\n", mpu6050_sensors[s].name);
+		h->state = HEALTH_UP;
+		h->failures = 0;
+		h->backoff_ms = 0;
+	}
+
+	h->reads++;
+	error = mpu6050_read(i2c, s, raw);
+	if (error == E_NO_ERROR) {
+		h->state = HEALTH_UP;
+		h->failures = 0;
+		return true;
+	}
+
+	h->error = error;
+	h->errors++;
+	if (++h->failures < HEALTH_MAX_FAILURES) {
+		h->state = HEALTH_FAILING;
+	} else {
+		printf("\n-->Sensor %s down: %d\n", mpu6050_sensors[s].name, error);
+		take_down(s, HEALTH_BACKOFF_MIN_MS);
+	}
+
+	return false;
+}
+
+char health_status(int s) {
+	const health_t *h = &health[s];
+
+	switch (h->state) {
+	case HEALTH_UP:
+		return '0';
+	case HEALTH_FAILING:
+		return (char) (48 - h->error);
+	default:
+		return HEALTH_STATUS_DOWN;
+	}
+}
@@ -0,0 +1,72 @@
+/**
+ * @file        health.h
+ * @brief       Health tracking of the MPU-6050 sensors with backoff and re-initialization
+ * @details     A sensor whose reads fail HEALTH_MAX_FAILURES frames in a row is taken down: it
+ *              isn't read anymore and is re-initialized with a short timeout once its backoff has
+ *              passed, the backoff doubling with every failed attempt. A dead sensor so costs one
+ *              timed-out transaction per attempt instead of a dozen per frame, and the others keep
+ *              their frame rate. The frames without a fresh reading are imputed by the caller.
+ */
+
+#ifndef __HEALTH_H__
+#define __HEALTH_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "mpu6050.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Failed reads in a row that take a sensor down */
+#define HEALTH_MAX_FAILURES 3
+
+/* Wait before the first and longest wait between re-initializations */
+#define HEALTH_BACKOFF_MIN_MS 250
+#define HEALTH_BACKOFF_MAX_MS 8000
+
+/* Timeout of a re-initialization, short since it holds up the frame. Its transactions time out
+ * after HEALTH_REINIT_I2C_TIMEOUT_US each, so an attempt takes at most the sum of both. */
+#define HEALTH_REINIT_TIMEOUT_MS 20
+#define HEALTH_REINIT_I2C_TIMEOUT_US 2000
+
+/* Status character of a sensor that is down in the status message, as the old skip flags used */
+#define HEALTH_STATUS_DOWN '4'
+
+typedef enum {
+	HEALTH_UP,          // the last read succeeded
+	HEALTH_FAILING,     // the last reads failed, still read every frame
+	HEALTH_DOWN,        // not read until the next re-initialization
+} health_state_t;
+
+typedef struct {
+	health_state_t state;
+	int error;              // error of the last failed read or re-initialization
+	unsigned failures;      // failed reads in a row
+	unsigned reads;         // totals since boot
+	unsigned errors;
+	unsigned reinits;
+	uint32_t backoff_ms;
+	uint32_t retry_ms;      // boot_ms() of the next re-initialization
+} health_t;
+
+extern health_t health[MPU6050_NUM_SENSORS];
+
+/* Start tracking sensor s with the result of its initialization at boot */
+void health_init(int s, int init_error);
+
+/*
+ * Read sensor s if it is up, or try to re-initialize and then read it if it is down and its
+ * backoff has passed. Returns true if raw holds a fresh sample.
+ */
+bool health_read(mxc_i2c_regs_t *i2c, int s, uint16_t *raw);
+
+/* Character for the status message: '0' while up, the error digit after a failed read */
+char health_status(int s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __HEALTH_H__
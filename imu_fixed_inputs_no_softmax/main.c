@@ -41,69 +41,96 @@
 #include "uart.h"
 #include "mxc.h"
 #include "cnn.h"
+#include "align.h"
+#include "boot.h"
+#include "calib.h"
+#include "classify.h"
+#include "fall.h"
+#include "health.h"
+#include "mpu6050.h"
+#include "power.h"
+#include "preprocess.h"
+#include "read_plan.h"
+#include "scheduler.h"
+#include "smooth.h"
 #include "sampledata.h"
 #include "sampleoutput.h"
 
 /***** Definitions *****/
 #define PMIC_I2C MXC_I2C1
 
-#define I2C_FREQ 115200
-#define PMIC_SLAVE_ADDR (0x69)
-#define INIT_READ_LEN 1
-#define INIT_WRITE_LEN 2
+#define I2C_FREQ READ_PLAN_I2C_HZ
 #define READ_LEN 14
 
-#define CLKSEL 1
-#define GYRO_RANGE 0
-#define ACC_RANGE 0
-#define SLEEP 1
-
-#define RL_PORT MXC_GPIO0
-#define LL_PORT MXC_GPIO0
-#define W_PORT MXC_GPIO0
-#define RA_PORT MXC_GPIO0
-#define LA_PORT MXC_GPIO0
-#define H_PORT MXC_GPIO0
-#define RL_PIN MXC_GPIO_PIN_5
-#define LL_PIN MXC_GPIO_PIN_6
-#define W_PIN MXC_GPIO_PIN_7
-#define RA_PIN MXC_GPIO_PIN_8
-#define LA_PIN MXC_GPIO_PIN_9
-#define H_PIN MXC_GPIO_PIN_11
-
 #define HM20_UART MXC_UART2
 #define HM20_BAUDRATE 57600
-#define BUFF_SIZE 64
+
+// Status message: one character per input channel and one per sensor, then \r\n, at least the
+// 64 bytes the app reads
+#define STATUS_LEN (PREPROCESS_CHANNELS + MPU6050_NUM_SENSORS + 3)
+#define BUFF_SIZE ((STATUS_LEN > 64) ? STATUS_LEN : 64)
+
+// The HM-10 drops data sent before it has powered up
+#define HM10_POWER_UP_MS 1000
+
+// Set to 1 to discard the stored sensor calibration and estimate it again, e.g. after a
+// sensor was replaced
+#define RECALIBRATE 0
+
+// Set to 1 to compare the SIMD and scalar preprocessing cycle counts at startup
+#define PROFILE_PREPROCESS 0
+#define PROFILE_FRAMES 64
+
+// Set to 1 to print the time spent reading and converting a frame for the configured sensors
+#define PROFILE_FRAME_COST 0
+#define PROFILE_COST_FRAMES 100
+
+// Set to 1 to print the time cnn_load_weights() takes at startup and the accelerator time of an
+// inference, averaged over PROFILE_CNN_RUNS. The stopwatch in cnn.c needs
+// PROJ_CFLAGS += -DCNN_INFERENCE_TIMER=MXC_TMR0 in project.mk.
+#define PROFILE_CNN_TIME 0
+#define PROFILE_CNN_RUNS 100
+
+#if PROFILE_CNN_TIME && !defined(CNN_INFERENCE_TIMER)
+#error "PROFILE_CNN_TIME needs CNN_INFERENCE_TIMER, see project.mk"
+#endif
+
+// Set to 1 to send the logits of every inference as well, not only the smoothed activity
+#define SEND_LOGITS 0
+
+// Interval of the sensor power mode report, 0 for none
+#define POWER_REPORT_MS 60000
+
+// Interval of the frame period and sensor skew report, 0 for none. Set ALIGN_COMPENSATE in
+// align.h to interpolate the sensors to a common frame time.
+#define ALIGN_REPORT_MS 60000
+
+// Data memory of input group g, i.e. of processor 4 * g
+#define CNN_INPUT_ADDR(g) (0x50400000 + ((g) / 4) * 0x400000 + ((g) % 4) * 0x8000)
 
 /***** Globals *****/
-static uint8_t tx_buf[INIT_WRITE_LEN];
-static uint8_t rx_buf[INIT_READ_LEN];
 static uint8_t tx_data[BUFF_SIZE];
+static uint8_t status_sent[BUFF_SIZE];
+static uint8_t alert_data[FALL_MESSAGE_LEN];
+
+// cnn_input[g] holds input channels 4 * g ... 4 * g + 3
+static uint32_t cnn_input[PREPROCESS_GROUPS][PREPROCESS_CHANNELS];
 
-static uint8_t ack_RL[BUFF_SIZE];
-static uint8_t ack_LL[BUFF_SIZE];
-static uint8_t ack_W[BUFF_SIZE];
-static uint8_t ack_RA[BUFF_SIZE];
-static uint8_t ack_LA[BUFF_SIZE];
-static uint8_t ack_H[BUFF_SIZE];
-
-static uint32_t cnn_input0[36];
-static uint32_t cnn_input4[36];
-static uint32_t cnn_input8[36];
-static uint32_t cnn_input12[36];
-static uint32_t cnn_input16[36];
-static uint32_t cnn_input20[36];
-static uint32_t cnn_input24[36];
-static uint32_t cnn_input28[36];
+// Padded copy of cnn_input while the first window is still partial
+static uint32_t cnn_partial[PREPROCESS_GROUPS][PREPROCESS_CHANNELS];
 
 static uint8_t result0[BUFF_SIZE];
 static uint8_t result1[BUFF_SIZE];
 static uint8_t result2[BUFF_SIZE];
 static uint8_t result3[BUFF_SIZE];
 static uint8_t result4[BUFF_SIZE];
+static uint8_t *const results[CLASSIFY_CLASSES] = { result0, result1, result2,
+		result3, result4 };
 
-static int32_t ml_data[CNN_NUM_OUTPUTS];
+static int32_t ml_data[CLASSIFY_UNLOAD_WORDS];
+#if SEND_LOGITS
 static char temp_display[BUFF_SIZE];
+#endif
 
 volatile uint32_t cnn_time; // Stopwatch
 
@@ -115,68 +142,6 @@ void fail(void) {
 		;
 }
 
-void GPIO_init(void) {
-	mxc_gpio_cfg_t gpio_cfg1;
-	gpio_cfg1.port = RL_PORT;
-	gpio_cfg1.mask = RL_PIN;
-	gpio_cfg1.pad = MXC_GPIO_PAD_NONE;
-	gpio_cfg1.func = MXC_GPIO_FUNC_OUT;
-	gpio_cfg1.vssel = MXC_GPIO_VSSEL_VDDIOH;
-	gpio_cfg1.drvstr = MXC_GPIO_DRVSTR_3;
-
-	MXC_GPIO_Config(&gpio_cfg1);
-
-	mxc_gpio_cfg_t gpio_cfg2;
-	gpio_cfg2.port = LL_PORT;
-	gpio_cfg2.mask = LL_PIN;
-	gpio_cfg2.pad = MXC_GPIO_PAD_NONE;
-	gpio_cfg2.func = MXC_GPIO_FUNC_OUT;
-	gpio_cfg2.vssel = MXC_GPIO_VSSEL_VDDIOH;
-	gpio_cfg2.drvstr = MXC_GPIO_DRVSTR_3;
-
-	MXC_GPIO_Config(&gpio_cfg2);
-
-	mxc_gpio_cfg_t gpio_cfg3;
-	gpio_cfg3.port = W_PORT;
-	gpio_cfg3.mask = W_PIN;
-	gpio_cfg3.pad = MXC_GPIO_PAD_NONE;
-	gpio_cfg3.func = MXC_GPIO_FUNC_OUT;
-	gpio_cfg3.vssel = MXC_GPIO_VSSEL_VDDIOH;
-	gpio_cfg3.drvstr = MXC_GPIO_DRVSTR_3;
-
-	MXC_GPIO_Config(&gpio_cfg3);
-
-	mxc_gpio_cfg_t gpio_cfg4;
-	gpio_cfg4.port = RA_PORT;
-	gpio_cfg4.mask = RA_PIN;
-	gpio_cfg4.pad = MXC_GPIO_PAD_NONE;
-	gpio_cfg4.func = MXC_GPIO_FUNC_OUT;
-	gpio_cfg4.vssel = MXC_GPIO_VSSEL_VDDIOH;
-	gpio_cfg4.drvstr = MXC_GPIO_DRVSTR_3;
-
-	MXC_GPIO_Config(&gpio_cfg4);
-
-	mxc_gpio_cfg_t gpio_cfg5;
-	gpio_cfg5.port = LA_PORT;
-	gpio_cfg5.mask = LA_PIN;
-	gpio_cfg5.pad = MXC_GPIO_PAD_NONE;
-	gpio_cfg5.func = MXC_GPIO_FUNC_OUT;
-	gpio_cfg5.vssel = MXC_GPIO_VSSEL_VDDIOH;
-	gpio_cfg5.drvstr = MXC_GPIO_DRVSTR_3;
-
-	MXC_GPIO_Config(&gpio_cfg5);
-
-	mxc_gpio_cfg_t gpio_cfg6;
-	gpio_cfg6.port = H_PORT;
-	gpio_cfg6.mask = H_PIN;
-	gpio_cfg6.pad = MXC_GPIO_PAD_NONE;
-	gpio_cfg6.func = MXC_GPIO_FUNC_OUT;
-	gpio_cfg6.vssel = MXC_GPIO_VSSEL_VDDIOH;
-	gpio_cfg6.drvstr = MXC_GPIO_DRVSTR_3;
-
-	MXC_GPIO_Config(&gpio_cfg6);
-}
-
 void I2C_init(void) {
 	int error = 0;
 
@@ -197,167 +162,109 @@ void I2C_init(void) {
 }
 
 void clearCNNInput(void) {
-	memset(cnn_input0, 0, sizeof(cnn_input0));
-	memset(cnn_input4, 0, sizeof(cnn_input4));
-	memset(cnn_input8, 0, sizeof(cnn_input8));
-	memset(cnn_input12, 0, sizeof(cnn_input12));
-	memset(cnn_input16, 0, sizeof(cnn_input16));
-	memset(cnn_input20, 0, sizeof(cnn_input20));
-	memset(cnn_input24, 0, sizeof(cnn_input24));
-	memset(cnn_input28, 0, sizeof(cnn_input28));
+	memset(cnn_input, 0, sizeof(cnn_input));
 }
 
-void load_input(void) {
-	// This function loads the sample data input -- replace with actual data
-
-	memcpy32((uint32_t*) 0x50400000, cnn_input0, 36);
-	memcpy32((uint32_t*) 0x50408000, cnn_input4, 36);
-	memcpy32((uint32_t*) 0x50410000, cnn_input8, 36);
-	memcpy32((uint32_t*) 0x50418000, cnn_input12, 36);
-	memcpy32((uint32_t*) 0x50800000, cnn_input16, 36);
-	memcpy32((uint32_t*) 0x50808000, cnn_input20, 36);
-	memcpy32((uint32_t*) 0x50810000, cnn_input24, 36);
-	memcpy32((uint32_t*) 0x50818000, cnn_input28, 36);
+void load_input(const uint32_t input[PREPROCESS_GROUPS][PREPROCESS_CHANNELS]) {
+	for (int g = 0; g < PREPROCESS_GROUPS; g++) {
+		memcpy32((uint32_t*) CNN_INPUT_ADDR(g), input[g], PREPROCESS_CHANNELS);
+	}
 }
 
-bool MPU_init(mxc_i2c_req_t reqMaster) {
+/*
+ * Once the HM-10 has had time to power up, send the greeting and the sensor status held back
+ * during boot. Returns whether data can be sent.
+ */
+bool hm10_ready(mxc_uart_req_t *write_req, const int *sensor_error) {
+	static bool ready = false;
 	int error;
 
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	reqMaster.i2c = PMIC_I2C;
-	reqMaster.addr = PMIC_SLAVE_ADDR;
-	reqMaster.tx_buf = tx_buf;
-	reqMaster.tx_len = INIT_READ_LEN;
-	reqMaster.rx_buf = rx_buf;
-	reqMaster.rx_len = INIT_READ_LEN;
-	reqMaster.restart = 0;
-
-	tx_buf[0] = 0x6B;
-
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-		printf("error: %d", error);
+	if (ready) {
 		return true;
 	}
-
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	tx_buf[1] = (rx_buf[0] & 0xF8) | CLKSEL;
-
-	reqMaster.tx_buf = tx_buf;
-	reqMaster.tx_len = INIT_WRITE_LEN;
-	reqMaster.rx_buf = NULL;
-	reqMaster.rx_len = 0;
-
-	tx_buf[1] = (rx_buf[0] & 0xF8) | CLKSEL;
-
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-		return true;
+	if (!boot_reached(HM10_POWER_UP_MS)) {
+		return false;
 	}
+	ready = true;
 
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	tx_buf[0] = 0x1B;
-	rx_buf[0] = 0;
-
-	reqMaster.tx_buf = tx_buf;
-	reqMaster.tx_len = INIT_READ_LEN;
-	reqMaster.rx_buf = rx_buf;
-	reqMaster.rx_len = INIT_READ_LEN;
-
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-		return true;
-	}
-
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	tx_buf[1] = (rx_buf[0] & 0xE7);
-
-	reqMaster.tx_buf = tx_buf;
-	reqMaster.tx_len = INIT_WRITE_LEN;
-	reqMaster.rx_buf = NULL;
-	reqMaster.rx_len = 0;
+	for (int s = -1; s < MPU6050_NUM_SENSORS; s++) {
+		memset(tx_data, 0, BUFF_SIZE);
+		if (s < 0) {
+			snprintf((char*) tx_data, BUFF_SIZE, "Hello from MAX78000\r\n");
+		} else {
+			snprintf((char*) tx_data, BUFF_SIZE, "%s initializing %s\r\n",
+					(sensor_error[s] == E_NO_ERROR) ? "Completed" : "Failed",
+					mpu6050_sensors[s].name);
+		}
 
-	MXC_Delay(MXC_DELAY_MSEC(1));
+		write_req->txData = tx_data;
+		error = MXC_UART_Transaction(write_req);
 
-	if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-		return true;
+		if (error != E_NO_ERROR) {
+			printf("-->Error starting sync write: %d\n", error);
+		}
 	}
 
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	tx_buf[0] = 0x1C;
-	rx_buf[0] = 0;
-
-	reqMaster.tx_buf = tx_buf;
-	reqMaster.tx_len = INIT_READ_LEN;
-	reqMaster.rx_buf = rx_buf;
-	reqMaster.rx_len = INIT_READ_LEN;
+	boot_step("HM-10");
+	return true;
+}
 
-	MXC_Delay(MXC_DELAY_MSEC(1));
+#if PROFILE_PREPROCESS
+void profile_preprocess(void) {
+	static uint16_t raw[PROFILE_FRAMES][PREPROCESS_CHANNELS];
+	uint16_t prev_ref[PREPROCESS_CHANNELS] = { 0 };
+	uint16_t prev_simd[PREPROCESS_CHANNELS] = { 0 };
+	uint32_t words_ref[PREPROCESS_CHANNELS] = { 0 };
+	uint32_t words_simd[PREPROCESS_CHANNELS] = { 0 };
+	uint32_t seed = 1;
+	uint32_t start, cycles_ref, cycles_simd;
 
-	if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-		return true;
+	// Pseudo-random samples so every saturation case is hit
+	for (int n = 0; n < PROFILE_FRAMES; n++) {
+		for (int i = 0; i < PREPROCESS_CHANNELS; i++) {
+			seed = seed * 1664525 + 1013904223;
+			raw[n][i] = (uint16_t) (seed >> 16);
+		}
 	}
 
-	MXC_Delay(MXC_DELAY_MSEC(1));
+	// Count core clocks on the DWT cycle counter, started by boot_init() for the boot timeline
 
-	tx_buf[1] = (rx_buf[0] & 0xE7);
-
-	reqMaster.tx_buf = tx_buf;
-	reqMaster.tx_len = INIT_WRITE_LEN;
-	reqMaster.rx_buf = NULL;
-	reqMaster.rx_len = 0;
-
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-		return true;
+	start = DWT->CYCCNT;
+	for (int n = 0; n < PROFILE_FRAMES; n++) {
+		preprocess_frame_pack_ref(raw[n], prev_ref, words_ref);
 	}
+	cycles_ref = DWT->CYCCNT - start;
 
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	tx_buf[0] = 0x6B;
-	rx_buf[0] = 0;
-
-	reqMaster.tx_buf = tx_buf;
-	reqMaster.tx_len = INIT_READ_LEN;
-	reqMaster.rx_buf = rx_buf;
-	reqMaster.rx_len = INIT_READ_LEN;
-
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-		return true;
+	start = DWT->CYCCNT;
+	for (int n = 0; n < PROFILE_FRAMES; n++) {
+		preprocess_frame_pack(raw[n], prev_simd, words_simd);
 	}
+	cycles_simd = DWT->CYCCNT - start;
 
-	MXC_Delay(MXC_DELAY_MSEC(1));
+	// The packed words only hold the last four frames, so check the outputs frame by frame too
+	memset(prev_ref, 0, sizeof(prev_ref));
+	memset(prev_simd, 0, sizeof(prev_simd));
+	for (int n = 0; n < PROFILE_FRAMES; n++) {
+		preprocess_frame_pack_ref(raw[n], prev_ref, words_ref);
+		preprocess_frame_pack(raw[n], prev_simd, words_simd);
 
-	tx_buf[1] = (rx_buf[0] & 0xBF);
-
-	reqMaster.tx_buf = tx_buf;
-	reqMaster.tx_len = INIT_WRITE_LEN;
-	reqMaster.rx_buf = NULL;
-	reqMaster.rx_len = 0;
-
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-		return true;
+		if (memcmp(words_ref, words_simd, sizeof(words_ref)) != 0) {
+			printf("Preprocessing mismatch between SIMD and scalar at frame %d\n", n);
+			fail();
+		}
 	}
 
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	return false;
+	printf("Preprocessing cycles per frame: scalar %u, SIMD %u\n",
+			(unsigned) (cycles_ref / PROFILE_FRAMES),
+			(unsigned) (cycles_simd / PROFILE_FRAMES));
 }
+#endif
 
 int main(void) {
+	int sensor_error[MPU6050_NUM_SENSORS];
+	bool first_classification = true;
+	bool uart_up;
+	int error;
 
 	clearCNNInput();
 
@@ -367,10 +274,34 @@ int main(void) {
 	MXC_SYS_Clock_Select(MXC_SYS_CLOCK_IPO);
 	SystemCoreClockUpdate();
 
-	printf("Waiting...\n");
+	// Every wait below is a deadline from here, the other steps run in the meantime
+	boot_init();
+
+	// DO NOT SLEEP BEFORE THE DEBUG WINDOW HAS PASSED:
+	// the bring-up only busy-waits and the CNN wait only sleeps once BOOT_DEBUG_WINDOW_MS has passed
+	// so the debugger can still interrupt if needed
+
+	// Initialize UART first, the HM-10 powers up while everything else is brought up
+	int err = MXC_UART_Init(HM20_UART, HM20_BAUDRATE, MXC_UART_APB_CLK);
+
+	if (err != E_NO_ERROR) {
+		printf("UART init failed: %d\n", err);
+		while (1)
+			;
+	}
+
+	mxc_uart_req_t write_req;
+	write_req.uart = HM20_UART;
+	write_req.txData = tx_data;
+	write_req.txLen = BUFF_SIZE;
+	write_req.rxLen = 0;
+	write_req.callback = NULL;
+
+	// Fall alerts go out on their own as soon as they are detected, only as long as they are
+	mxc_uart_req_t alert_req = write_req;
+	alert_req.txData = alert_data;
 
-	// DO NOT DELETE THIS LINE:
-	MXC_Delay(SEC(2)); // Let debugger interrupt if needed
+	boot_step("UART");
 
 	// Enable peripheral, enable CNN interrupt, turn on CNN clock
 	// CNN clock: APB (50 MHz) div 1
@@ -380,17 +311,21 @@ int main(void) {
 	printf("\n*** CNN Inference Test imu_fixed_inputs_no_softmax ***\n");
 
 	cnn_init(); // Bring state machine into consistent state
+#if PROFILE_CNN_TIME
+	uint32_t load_start = boot_us();
 	cnn_load_weights(); // Load kernels
+	printf("CNN weights loaded in %u us\n", (unsigned) (boot_us() - load_start));
+#else
+	cnn_load_weights(); // Load kernels
+#endif
 	cnn_load_bias();
 	cnn_configure(); // Configure state machine
 
-	const char *msg = "Hello from MAX78000\r\n";
-	const char *done1 = "Completed initializing RL\r\n";
-	const char *done2 = "Completed initializing LL\r\n";
-	const char *done3 = "Completed initializing W\r\n";
-	const char *done4 = "Completed initializing RA\r\n";
-	const char *done5 = "Completed initializing LA\r\n";
-	const char *done6 = "Completed initializing H\r\n";
+	boot_step("CNN");
+
+#if PROFILE_PREPROCESS
+	profile_preprocess();
+#endif
 
 	const char *downstairs = "You are probably going downstairs\r\n";
 	const char *sitting = "You are probably sitting\r\n";
@@ -398,29 +333,6 @@ int main(void) {
 	const char *upstairs = "You are probably going upstairs\r\n";
 	const char *walking = "You are probably walking\r\n";
 
-	// Initialize UART1
-	int err = MXC_UART_Init(HM20_UART, HM20_BAUDRATE, MXC_UART_APB_CLK);
-
-	if (err != E_NO_ERROR) {
-		printf("UART init failed: %d\n", err);
-		while (1)
-			;
-	}
-
-	mxc_uart_req_t write_req;
-	write_req.uart = HM20_UART;
-	write_req.txData = tx_data;
-	write_req.txLen = BUFF_SIZE;
-	write_req.rxLen = 0;
-	write_req.callback = NULL;
-
-	for (int i = 0; i < strlen(msg); i++) {
-		tx_data[i] = msg[i];
-	}
-	for (int j = strlen(msg); j < BUFF_SIZE; j++) {
-		tx_data[j] = '\0';
-	}
-
 	for (int i = 0; i < strlen(downstairs); i++) {
 		result0[i] = downstairs[i];
 	}
@@ -456,968 +368,129 @@ int main(void) {
 		result4[j] = '\0';
 	}
 
-	for (int i = 0; i < strlen(done1); i++) {
-		ack_RL[i] = done1[i];
-	}
-	for (int j = strlen(msg); j < BUFF_SIZE; j++) {
-		ack_RL[j] = '\0';
-	}
-
-	for (int i = 0; i < strlen(done2); i++) {
-		ack_LL[i] = done2[i];
-	}
-	for (int j = strlen(msg); j < BUFF_SIZE; j++) {
-		ack_LL[j] = '\0';
-	}
-
-	for (int i = 0; i < strlen(done3); i++) {
-		ack_W[i] = done3[i];
-	}
-	for (int j = strlen(msg); j < BUFF_SIZE; j++) {
-		ack_W[j] = '\0';
-	}
-
-	for (int i = 0; i < strlen(done4); i++) {
-		ack_RA[i] = done4[i];
-	}
-	for (int j = strlen(msg); j < BUFF_SIZE; j++) {
-		ack_RA[j] = '\0';
-	}
-
-	for (int i = 0; i < strlen(done5); i++) {
-		ack_LA[i] = done5[i];
-	}
-	for (int j = strlen(msg); j < BUFF_SIZE; j++) {
-		ack_LA[j] = '\0';
-	}
-
-	for (int i = 0; i < strlen(done6); i++) {
-		ack_H[i] = done6[i];
-	}
-	for (int j = strlen(msg); j < BUFF_SIZE; j++) {
-		ack_H[j] = '\0';
-	}
-
-	// Optional: Wait for HM-10 to power up
-	MXC_Delay(MXC_DELAY_MSEC(1000));
-
-	int error;
-
-	error = MXC_UART_Transaction(&write_req);
-
-	if (error != E_NO_ERROR) {
-		printf("-->Error starting sync write: %d\n", error);
-	}
-
-	MXC_Delay(MXC_DELAY_MSEC(500)); //Wait for PMIC to power-up
-
-	GPIO_init();
-
-	MXC_GPIO_OutClr(RL_PORT, RL_PIN);
-	MXC_GPIO_OutClr(LL_PORT, LL_PIN);
-	MXC_GPIO_OutClr(W_PORT, W_PIN);
-	MXC_GPIO_OutClr(RA_PORT, RA_PIN);
-	MXC_GPIO_OutClr(LA_PORT, LA_PIN);
-	MXC_GPIO_OutClr(H_PORT, H_PIN);
-
-	MXC_GPIO_OutSet(W_PORT, W_PIN);
+	mpu6050_gpio_init();
 
 	I2C_init();
 
 	MXC_I2C_SetTimeout(PMIC_I2C, 100000);
 
-	mxc_i2c_req_t reqMaster;
-	reqMaster.i2c = PMIC_I2C;
-	reqMaster.addr = PMIC_SLAVE_ADDR;
-	reqMaster.tx_buf = tx_buf;
-	reqMaster.tx_len = INIT_READ_LEN;
-	reqMaster.rx_buf = rx_buf;
-	reqMaster.rx_len = INIT_READ_LEN;
-	reqMaster.restart = 1;
-
-	//tx_buf[0] = 0x75;
-
-	//if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-	//    printf("Error writing: %d\n", error);
-	//    while (1) {}
-	//}
-
-	MXC_Delay(MXC_DELAY_MSEC(1));
-	MXC_GPIO_OutSet(RL_PORT, RL_PIN);
-	MXC_Delay(MXC_DELAY_MSEC(100));
-
-	bool skip_RL = MPU_init(reqMaster);
-	//while (skip_RL) {
-	//	skip_RL = MPU_init(reqMaster);
-	//}
-
-	MXC_Delay(MXC_DELAY_MSEC(100));
-	MXC_GPIO_OutClr(RL_PORT, RL_PIN);
-
-	write_req.txData = ack_RL;
-	error = MXC_UART_Transaction(&write_req);
-
-	if (error != E_NO_ERROR) {
-		printf("-->Error starting sync write: %d\n", error);
-	}
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	MXC_GPIO_OutSet(LL_PORT, LL_PIN);
-	MXC_Delay(MXC_DELAY_MSEC(100));
-
-	bool skip_LL = MPU_init(reqMaster);
-	//while (skip_LL) {
-	//	skip_LL = MPU_init(reqMaster);
-	//}
-
-	MXC_Delay(MXC_DELAY_MSEC(100));
-	MXC_GPIO_OutClr(LL_PORT, LL_PIN);
-
-	write_req.txData = ack_LL;
-	error = MXC_UART_Transaction(&write_req);
-
-	if (error != E_NO_ERROR) {
-		printf("-->Error starting sync write: %d\n", error);
-	}
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	MXC_GPIO_OutSet(W_PORT, W_PIN);
-	MXC_Delay(MXC_DELAY_MSEC(100));
-
-	bool skip_W = MPU_init(reqMaster);
-	//while (skip_W) {
-	//	skip_W = MPU_init(reqMaster);
-	//}
-
-	MXC_Delay(MXC_DELAY_MSEC(100));
-	MXC_GPIO_OutClr(W_PORT, W_PIN);
-
-	write_req.txData = ack_W;
-	error = MXC_UART_Transaction(&write_req);
-
-	if (error != E_NO_ERROR) {
-		printf("-->Error starting sync write: %d\n", error);
-	}
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	MXC_GPIO_OutSet(RA_PORT, RA_PIN);
-	MXC_Delay(MXC_DELAY_MSEC(100));
-
-	bool skip_RA = MPU_init(reqMaster);
-	//while (skip_RA) {
-	//	skip_RA = MPU_init(reqMaster);
-	//}
-
-	MXC_Delay(MXC_DELAY_MSEC(100));
-	MXC_GPIO_OutClr(RA_PORT, RA_PIN);
-
-	write_req.txData = ack_RA;
-	error = MXC_UART_Transaction(&write_req);
-
-	if (error != E_NO_ERROR) {
-		printf("-->Error starting sync write: %d\n", error);
-	}
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	MXC_GPIO_OutSet(LA_PORT, LA_PIN);
-	MXC_Delay(MXC_DELAY_MSEC(100));
-
-	bool skip_LA = MPU_init(reqMaster);
-	//while (skip_LA) {
-	//	skip_LA = MPU_init(reqMaster);
-	//}
-
-	MXC_Delay(MXC_DELAY_MSEC(100));
-	MXC_GPIO_OutClr(LA_PORT, LA_PIN);
+	boot_step("I2C");
 
-	write_req.txData = ack_LA;
-	error = MXC_UART_Transaction(&write_req);
+	// Each sensor is polled until it answers, the first one also waits for the PMIC to power up
+	for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+		sensor_error[s] = mpu6050_init(PMIC_I2C, s, MPU6050_READY_TIMEOUT_MS);
 
-	if (error != E_NO_ERROR) {
-		printf("-->Error starting sync write: %d\n", error);
+		if (sensor_error[s] != E_NO_ERROR) {
+			printf("-->Sensor %s failed to initialize: %d\n", mpu6050_sensors[s].name,
+					sensor_error[s]);
+		}
+		health_init(s, sensor_error[s]);
+		boot_step(mpu6050_sensors[s].name);
 	}
-	MXC_Delay(MXC_DELAY_MSEC(1));
-
-	MXC_GPIO_OutSet(H_PORT, H_PIN);
-	MXC_Delay(MXC_DELAY_MSEC(100));
-
-	bool skip_H = MPU_init(reqMaster);
-	//while (skip_H) {
-	//	skip_H = MPU_init(reqMaster);
-	//}
-
-	MXC_Delay(MXC_DELAY_MSEC(100));
-	MXC_GPIO_OutClr(H_PORT, H_PIN);
-	MXC_Delay(MXC_DELAY_MSEC(1));
 
-	write_req.txData = ack_H;
-	error = MXC_UART_Transaction(&write_req);
-
-	if (error != E_NO_ERROR) {
-		printf("-->Error starting sync write: %d\n", error);
+#if RECALIBRATE
+	calib_erase();
+#endif
+	// Stored calibrations apply right away, the missing ones are estimated while running
+	uint32_t calibrated = calib_load();
+	for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+		if (!(calibrated & (1u << s))) {
+			printf("-->Sensor %s not calibrated yet, keep it still\n", mpu6050_sensors[s].name);
+		}
 	}
+	boot_step("calibration");
 
-	MXC_Delay(MXC_DELAY_MSEC(1));
+	power_init();
+	fall_init();
+	uint32_t power_report_ms = boot_ms() + POWER_REPORT_MS;
 
-	write_req.txData = tx_data;
+	align_t align;
+	align_init(&align);
+	uint32_t align_report_ms = boot_ms() + ALIGN_REPORT_MS;
 
-	reqMaster.tx_buf = tx_buf;
-	reqMaster.tx_len = INIT_READ_LEN;
-	reqMaster.rx_buf = rx_buf;
-	reqMaster.rx_len = INIT_READ_LEN;
+	scheduler_t scheduler;
+	scheduler_init(&scheduler, SCHEDULER_HOP_MIN, SCHEDULER_HOP_MAX);
+	bool warming_up = true;
 
-	tx_buf[0] = 0x3B;
+	smooth_t smooth;
+	smooth_init(&smooth);
+	uint32_t status_ms = 0;
 
-	int prev[36] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-			0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
-	int frame[6][6] = { { 0, 0, 0, 0, 0, 0 }, { 0, 0, 0, 0, 0, 0 }, { 0, 0, 0,
-			0, 0, 0 }, { 0, 0, 0, 0, 0, 0 }, { 0, 0, 0, 0, 0, 0 }, { 0, 0, 0, 0,
-			0, 0 } };
+	uint16_t prev[PREPROCESS_CHANNELS] = { 0 };
+	uint16_t raw[MPU6050_NUM_SENSORS][SENSOR_AXES] = { { 0 } };
+	uint32_t seeded = 0;
 
 	int frame_count = 0;
 
+#if PROFILE_FRAME_COST
+	uint32_t cost_read = 0;
+	uint32_t cost_convert = 0;
+	int cost_frames = 0;
+#endif
+#if PROFILE_CNN_TIME
+	uint32_t cnn_total = 0;
+	int cnn_runs = 0;
+#endif
+
 	while (1) {
-		int ax = 0;
-		int ay = 0;
-		int az = 0;
-		int gx = 0;
-		int gy = 0;
-		int gz = 0;
-
-		rx_buf[0] = 0;
-		//if (!skip_RL) {
-		MXC_GPIO_OutSet(RL_PORT, RL_PIN);
-		tx_buf[0] = 0x3B;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ax = rx_buf[0];
-		tx_buf[0] = 0x3C;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ax = (ax << 8) | rx_buf[0];
-		tx_buf[0] = 0x3D;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ay = rx_buf[0];
-		tx_buf[0] = 0x3E;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ay = (ay << 8) | rx_buf[0];
-		tx_buf[0] = 0x3F;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		az = rx_buf[0];
-		tx_buf[0] = 0x40;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		az = (az << 8) | rx_buf[0];
-
-		tx_buf[0] = 0x43;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gx = rx_buf[0];
-		tx_buf[0] = 0x44;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gx = (gx << 8) | rx_buf[0];
-		tx_buf[0] = 0x45;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gy = rx_buf[0];
-		tx_buf[0] = 0x46;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gy = (gy << 8) | rx_buf[0];
-		tx_buf[0] = 0x47;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gz = rx_buf[0];
-		tx_buf[0] = 0x48;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gz = (gz << 8) | rx_buf[0];
-
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		MXC_GPIO_OutClr(RL_PORT, RL_PIN);
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		//} else {
-		//	tx_data[36] = 52;
-		//}
-		//Do the rx_buf parsing here
-		frame[0][0] = (abs(prev[0] - ax) / 128) - 128;
-		prev[0] = ax;
-		frame[0][1] = (abs(prev[1] - ay) / 128) - 128;
-		prev[1] = ay;
-		frame[0][2] = (abs(prev[2] - az) / 128) - 128;
-		prev[2] = az;
-		frame[0][3] = (abs(prev[3] - gx) / 128) - 128;
-		prev[3] = gx;
-		frame[0][4] = (abs(prev[4] - gy) / 128) - 128;
-		prev[4] = gy;
-		frame[0][5] = (abs(prev[5] - gz) / 128) - 128;
-		prev[5] = gz;
-
-		rx_buf[0] = 0;
-		//if (!skip_LL) {
-		MXC_GPIO_OutSet(LL_PORT, LL_PIN);
-		tx_buf[0] = 0x3B;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ax = rx_buf[0];
-		tx_buf[0] = 0x3C;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ax = (ax << 8) | rx_buf[0];
-		tx_buf[0] = 0x3D;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ay = rx_buf[0];
-		tx_buf[0] = 0x3E;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ay = (ay << 8) | rx_buf[0];
-		tx_buf[0] = 0x3F;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		az = rx_buf[0];
-		tx_buf[0] = 0x40;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		az = (az << 8) | rx_buf[0];
-
-		tx_buf[0] = 0x43;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gx = rx_buf[0];
-		tx_buf[0] = 0x44;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gx = (gx << 8) | rx_buf[0];
-		tx_buf[0] = 0x45;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gy = rx_buf[0];
-		tx_buf[0] = 0x46;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gy = (gy << 8) | rx_buf[0];
-		tx_buf[0] = 0x47;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gz = rx_buf[0];
-		tx_buf[0] = 0x48;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gz = (gz << 8) | rx_buf[0];
-
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		MXC_GPIO_OutClr(LL_PORT, LL_PIN);
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		//} else {
-		//	tx_data[37] = 52;
-		//}
-		//Do the rx_buf parsing here
-		frame[1][0] = (abs(prev[6] - ax) / 128) - 128;
-		prev[6] = ax;
-		frame[1][1] = (abs(prev[7] - ay) / 128) - 128;
-		prev[7] = ay;
-		frame[1][2] = (abs(prev[8] - az) / 128) - 128;
-		prev[8] = az;
-		frame[1][3] = (abs(prev[9] - gx) / 128) - 128;
-		prev[9] = gx;
-		frame[1][4] = (abs(prev[10] - gy) / 128) - 128;
-		prev[10] = gy;
-		frame[1][5] = (abs(prev[11] - gz) / 128) - 128;
-		prev[11] = gz;
-
-		rx_buf[0] = 0;
-		//if (!skip_W) {
-		MXC_GPIO_OutSet(W_PORT, W_PIN);
-		tx_buf[0] = 0x3B;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ax = rx_buf[0];
-		tx_buf[0] = 0x3C;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ax = (ax << 8) | rx_buf[0];
-		tx_buf[0] = 0x3D;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ay = rx_buf[0];
-		tx_buf[0] = 0x3E;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ay = (ay << 8) | rx_buf[0];
-		tx_buf[0] = 0x3F;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		az = rx_buf[0];
-		tx_buf[0] = 0x40;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		az = (az << 8) | rx_buf[0];
-
-		tx_buf[0] = 0x43;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gx = rx_buf[0];
-		tx_buf[0] = 0x44;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gx = (gx << 8) | rx_buf[0];
-		tx_buf[0] = 0x45;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gy = rx_buf[0];
-		tx_buf[0] = 0x46;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gy = (gy << 8) | rx_buf[0];
-		tx_buf[0] = 0x47;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gz = rx_buf[0];
-		tx_buf[0] = 0x48;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gz = (gz << 8) | rx_buf[0];
-
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		MXC_GPIO_OutClr(W_PORT, W_PIN);
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		//} else {
-		//	tx_data[38] = 52;
-		//}
-		//Do the rx_buf parsing here
-		frame[2][0] = (abs(prev[12] - ax) / 128) - 128;
-		prev[12] = ax;
-		frame[2][1] = (abs(prev[13] - ay) / 128) - 128;
-		prev[13] = ay;
-		frame[2][2] = (abs(prev[14] - az) / 128) - 128;
-		prev[14] = az;
-		frame[2][3] = (abs(prev[15] - gx) / 128) - 128;
-		prev[15] = gx;
-		frame[2][4] = (abs(prev[16] - gy) / 128) - 128;
-		prev[16] = gy;
-		frame[2][5] = (abs(prev[17] - gz) / 128) - 128;
-		prev[17] = gz;
-
-		rx_buf[0] = 0;
-		//if (!skip_RA) {
-		MXC_GPIO_OutSet(RA_PORT, RA_PIN);
-		tx_buf[0] = 0x3B;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ax = rx_buf[0];
-		tx_buf[0] = 0x3C;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ax = (ax << 8) | rx_buf[0];
-		tx_buf[0] = 0x3D;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ay = rx_buf[0];
-		tx_buf[0] = 0x3E;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ay = (ay << 8) | rx_buf[0];
-		tx_buf[0] = 0x3F;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		az = rx_buf[0];
-		tx_buf[0] = 0x40;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		az = (az << 8) | rx_buf[0];
-
-		tx_buf[0] = 0x43;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gx = rx_buf[0];
-		tx_buf[0] = 0x44;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gx = (gx << 8) | rx_buf[0];
-		tx_buf[0] = 0x45;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gy = rx_buf[0];
-		tx_buf[0] = 0x46;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gy = (gy << 8) | rx_buf[0];
-		tx_buf[0] = 0x47;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gz = rx_buf[0];
-		tx_buf[0] = 0x48;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gz = (gz << 8) | rx_buf[0];
-
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		MXC_GPIO_OutClr(RA_PORT, RA_PIN);
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		//} else {
-		//	tx_data[39] = 52;
-		//}
-		//Do the rx_buf parsing here
-		frame[3][0] = (abs(prev[18] - ax) / 128) - 128;
-		prev[18] = ax;
-		frame[3][1] = (abs(prev[19] - ay) / 128) - 128;
-		prev[19] = ay;
-		frame[3][2] = (abs(prev[20] - az) / 128) - 128;
-		prev[20] = az;
-		frame[3][3] = (abs(prev[21] - gx) / 128) - 128;
-		prev[21] = gx;
-		frame[3][4] = (abs(prev[22] - gy) / 128) - 128;
-		prev[22] = gy;
-		frame[3][5] = (abs(prev[23] - gz) / 128) - 128;
-		prev[23] = gz;
-
-		rx_buf[0] = 0;
-		//if (!skip_LA) {
-		MXC_GPIO_OutSet(LA_PORT, LA_PIN);
-		tx_buf[0] = 0x3B;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ax = rx_buf[0];
-		tx_buf[0] = 0x3C;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ax = (ax << 8) | rx_buf[0];
-		tx_buf[0] = 0x3D;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ay = rx_buf[0];
-		tx_buf[0] = 0x3E;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ay = (ay << 8) | rx_buf[0];
-		tx_buf[0] = 0x3F;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		az = rx_buf[0];
-		tx_buf[0] = 0x40;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		az = (az << 8) | rx_buf[0];
-
-		tx_buf[0] = 0x43;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gx = rx_buf[0];
-		tx_buf[0] = 0x44;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gx = (gx << 8) | rx_buf[0];
-		tx_buf[0] = 0x45;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gy = rx_buf[0];
-		tx_buf[0] = 0x46;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gy = (gy << 8) | rx_buf[0];
-		tx_buf[0] = 0x47;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gz = rx_buf[0];
-		tx_buf[0] = 0x48;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gz = (gz << 8) | rx_buf[0];
-
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		MXC_GPIO_OutClr(LA_PORT, LA_PIN);
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		//} else {
-		//	tx_data[40] = 52;
-		//}
-		//Do the rx_buf parsing here
-		frame[4][0] = (abs(prev[24] - ax) / 128) - 128;
-		prev[24] = ax;
-		frame[4][1] = (abs(prev[25] - ay) / 128) - 128;
-		prev[25] = ay;
-		frame[4][2] = (abs(prev[26] - az) / 128) - 128;
-		prev[26] = az;
-		frame[4][3] = (abs(prev[27] - gx) / 128) - 128;
-		prev[27] = gx;
-		frame[4][4] = (abs(prev[28] - gy) / 128) - 128;
-		prev[28] = gy;
-		frame[4][5] = (abs(prev[29] - gz) / 128) - 128;
-		prev[29] = gz;
-
-		rx_buf[0] = 0;
-		//if (!skip_H) {
-		MXC_GPIO_OutSet(H_PORT, H_PIN);
-		tx_buf[0] = 0x3B;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ax = rx_buf[0];
-		tx_buf[0] = 0x3C;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ax = (ax << 8) | rx_buf[0];
-		tx_buf[0] = 0x3D;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ay = rx_buf[0];
-		tx_buf[0] = 0x3E;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		ay = (ay << 8) | rx_buf[0];
-		tx_buf[0] = 0x3F;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		az = rx_buf[0];
-		tx_buf[0] = 0x40;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		az = (az << 8) | rx_buf[0];
-
-		tx_buf[0] = 0x43;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gx = rx_buf[0];
-		tx_buf[0] = 0x44;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gx = (gx << 8) | rx_buf[0];
-		tx_buf[0] = 0x45;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gy = rx_buf[0];
-		tx_buf[0] = 0x46;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
-		}
-		gy = (gy << 8) | rx_buf[0];
-		tx_buf[0] = 0x47;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
+#if PROFILE_FRAME_COST
+		uint32_t frame_start = boot_us();
+#endif
+
+		// Checked before tx_data is filled, the status held back during boot goes out first
+		uart_up = hm10_ready(&write_req, sensor_error);
+
+		//The fall detector's quorum counts the sensors about to be read
+		uint32_t reading = 0;
+		for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+			if (power_read(s) && health[s].state != HEALTH_DOWN) {
+				reading |= 1u << s;
+			}
 		}
-		gz = rx_buf[0];
-		tx_buf[0] = 0x48;
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		if ((error = MXC_I2C_MasterTransaction(&reqMaster)) != 0) {
-			error = (error * -1) + 48;
-			tx_data[36] = (char) (error);
-			rx_buf[0] = 0;
+		fall_frame(reading);
+
+		//Read the sensors that are up and awake, a sensor that didn't answer or sleeps reads 0
+		//in the status
+		uint32_t fresh = 0;
+		align_frame(&align);
+		for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+			uint32_t read_start = boot_us();
+
+			if (power_read(s) && health_read(PMIC_I2C, s, raw[s])) {
+				fresh |= 1u << s;
+				align_read(&align, s, read_start, boot_us());
+
+				// Checked before the next sensor is read, an alert goes out ahead of the frame
+				fall_alert_t alert;
+				if (fall_sample(s, raw[s], &alert) != FALL_NONE) {
+					alert_req.txLen = fall_format(&alert, mpu6050_sensors[s].name,
+							(char*) alert_data, sizeof(alert_data));
+					printf("\n%s", (char*) alert_data);
+					if (uart_up) {
+						error = MXC_UART_Transaction(&alert_req);
+
+						if (error != E_NO_ERROR) {
+							printf("-->Error sending fall alert: %d\n", error);
+						}
+					}
+				}
+			} else {
+				memset(raw[s], 0, sizeof(raw[s]));
+			}
+			tx_data[PREPROCESS_CHANNELS + s] = health_status(s);
 		}
-		gz = (gz << 8) | rx_buf[0];
-
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		MXC_GPIO_OutClr(H_PORT, H_PIN);
-		MXC_Delay(MXC_DELAY_MSEC(1));
-		//} else {
-		//	tx_data[41] = 52;
-		//}
-		//Do the rx_buf parsing here
-		frame[5][0] = (abs(prev[30] - ax) / 128) - 128;
-		prev[30] = ax;
-		frame[5][1] = (abs(prev[31] - ay) / 128) - 128;
-		prev[31] = ay;
-		frame[5][2] = (abs(prev[32] - az) / 128) - 128;
-		prev[32] = az;
-		frame[5][3] = (abs(prev[33] - gx) / 128) - 128;
-		prev[33] = gx;
-		frame[5][4] = (abs(prev[34] - gy) / 128) - 128;
-		prev[34] = gy;
-		frame[5][5] = (abs(prev[35] - gz) / 128) - 128;
-		prev[35] = gz;
+#if PROFILE_FRAME_COST
+		uint32_t read_end = boot_us();
+#endif
 
 		for (int i = 0; i < BUFF_SIZE - 3; i++) {
-			if (i < 36) {
-				if (prev[i] != 0) {
+			if (i < PREPROCESS_CHANNELS) {
+				if (raw[i / SENSOR_AXES][i % SENSOR_AXES] != 0) {
 					tx_data[i] = '1';
 				} else {
 					tx_data[i] = '0';
 				}
-			} else if (i > 41) {
+			} else if (i >= PREPROCESS_CHANNELS + MPU6050_NUM_SENSORS) {
 				tx_data[i] = '2';
 			}
 		}
@@ -1425,141 +498,122 @@ int main(void) {
 		tx_data[BUFF_SIZE - 2] = '\n';
 		tx_data[BUFF_SIZE - 1] = '\0';
 
-		error = MXC_UART_Transaction(&write_req);
-
-		if (error != E_NO_ERROR) {
-			printf("-->Error starting sync write: %d\n", error);
-		}
-		printf("%d", frame[0][0]);
-
-		if (frame_count < 2) {
-			for (int i = 0; i < 6; i++) {
-				for (int j = 0; j < 6; j++) {
-					uint8_t value = (uint8_t) (
-							(frame[i][j] < 127) ? frame[i][j] : 127);
-					cnn_input28[i * 6 + j] = (cnn_input28[i * 6 + j] << 8)
-							| value;
-				}
-			}
-
-		} else if (frame_count < 6) {
-			for (int i = 0; i < 6; i++) {
-				for (int j = 0; j < 6; j++) {
-					uint8_t value = (uint8_t) (
-							(frame[i][j] < 127) ? frame[i][j] : 127);
-					cnn_input24[i * 6 + j] = (cnn_input24[i * 6 + j] << 8)
-							| value;
-				}
+		//Calibrate the frame with the fresh samples, the gyro of a sensor in cycle mode is off
+		uint32_t full = fresh;
+		for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+			if (power_gyro_off(s)) {
+				full &= ~(1u << s);
 			}
-
-		} else if (frame_count < 10) {
-			for (int i = 0; i < 6; i++) {
-				for (int j = 0; j < 6; j++) {
-					uint8_t value = (uint8_t) (
-							(frame[i][j] < 127) ? frame[i][j] : 127);
-					cnn_input20[i * 6 + j] = (cnn_input20[i * 6 + j] << 8)
-							| value;
-				}
-			}
-
-		} else if (frame_count < 14) {
-			for (int i = 0; i < 6; i++) {
-				for (int j = 0; j < 6; j++) {
-					uint8_t value = (uint8_t) (
-							(frame[i][j] < 127) ? frame[i][j] : 127);
-					cnn_input16[i * 6 + j] = (cnn_input16[i * 6 + j] << 8)
-							| value;
-				}
-			}
-
-		} else if (frame_count < 18) {
-			for (int i = 0; i < 6; i++) {
-				for (int j = 0; j < 6; j++) {
-					uint8_t value = (uint8_t) (
-							(frame[i][j] < 127) ? frame[i][j] : 127);
-					cnn_input12[i * 6 + j] = (cnn_input12[i * 6 + j] << 8)
-							| value;
-				}
-			}
-
-		} else if (frame_count < 22) {
-			for (int i = 0; i < 6; i++) {
-				for (int j = 0; j < 6; j++) {
-					uint8_t value = (uint8_t) (
-							(frame[i][j] < 127) ? frame[i][j] : 127);
-					cnn_input8[i * 6 + j] = (cnn_input8[i * 6 + j] << 8)
-							| value;
-				}
+		}
+		uint32_t done = calib_update(&raw[0][0], full);
+		for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+			if (done & (1u << s)) {
+				printf("\nSensor %s calibrated\n", mpu6050_sensors[s].name);
 			}
-
-		} else if (frame_count < 26) {
-			for (int i = 0; i < 6; i++) {
-				for (int j = 0; j < 6; j++) {
-					uint8_t value = (uint8_t) (
-							(frame[i][j] < 127) ? frame[i][j] : 127);
-					cnn_input4[i * 6 + j] = (cnn_input4[i * 6 + j] << 8)
-							| value;
+		}
+		calib_apply(&raw[0][0]);
+
+		//A sensor without a fresh sample repeats its last one, which is the no-motion input. The
+		//first sample after that only seeds prev since there is nothing to compare it with.
+		//The same goes for the gyro columns of a sensor in cycle mode. The first calibrated
+		//sample seeds prev as well, prev still holds an uncalibrated one.
+		seeded &= ~done;
+		for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+			uint16_t *last = &prev[s * SENSOR_AXES];
+
+			if (!(fresh & (1u << s))) {
+				memcpy(raw[s], last, sizeof(raw[s]));
+			} else if (!(seeded & (1u << s))) {
+				memcpy(last, raw[s], sizeof(raw[s]));
+			} else if (power_gyro_off(s)) {
+				for (int a = 0; a < SENSOR_AXES; a++) {
+					if (sensor_axis(a) >= 3) {
+						raw[s][a] = last[a];
+					}
 				}
 			}
+		}
+		seeded = fresh;
+
+		//Timestamp the frame at its first read, the other sensors are interpolated to it if
+		//ALIGN_COMPENSATE is set
+		align_apply(&align, &raw[0][0], fresh, ALIGN_COMPENSATE);
+
+		//Drop still sensors to lower power modes and wake them on motion, before prev moves on
+		power_frame(PMIC_I2C, &raw[0][0], prev, fresh);
+
+		//Convert the frame and shift it into the input group it belongs to
+		uint32_t *group = cnn_input[preprocess_group(frame_count)];
+		preprocess_frame_pack(&raw[0][0], prev, group);
+
+#if PROFILE_FRAME_COST
+		cost_read += read_end - frame_start;
+		cost_convert += boot_us() - read_end;
+		if (++cost_frames == PROFILE_COST_FRAMES) {
+			printf("\nFrame cost for %d sensors x %d axes: read %u us, calibrate and convert %u us\n",
+					MPU6050_NUM_SENSORS, SENSOR_AXES, (unsigned) (cost_read / cost_frames),
+					(unsigned) (cost_convert / cost_frames));
+			cost_read = 0;
+			cost_convert = 0;
+			cost_frames = 0;
+		}
+#endif
+
+		//The status only goes out when it changed, and with the heartbeat
+		if (uart_up && (memcmp(tx_data, status_sent, BUFF_SIZE) != 0
+				|| (SMOOTH_HEARTBEAT_MS > 0 && boot_ms() - status_ms >= SMOOTH_HEARTBEAT_MS))) {
+			memcpy(status_sent, tx_data, BUFF_SIZE);
+			status_ms = boot_ms();
+			error = MXC_UART_Transaction(&write_req);
 
-		} else {
-			for (int i = 0; i < 6; i++) {
-				for (int j = 0; j < 6; j++) {
-					uint8_t value = (uint8_t) (
-							(frame[i][j] < 127) ? frame[i][j] : 127);
-					cnn_input0[i * 6 + j] = (cnn_input0[i * 6 + j] << 8)
-							| value;
-				}
+			if (error != E_NO_ERROR) {
+				printf("-->Error starting sync write: %d\n", error);
 			}
 		}
+		printf("%d", (int8_t) group[0]);
 
 		frame_count = frame_count + 1;
-		if (frame_count == 30) {
-			//run cnn
-			load_input(); // Load data input
-			cnn_start(); // Start CNN processing
-
-			while (cnn_time == 0)
-				MXC_LP_EnterSleepMode(); // Wait for CNN
+		//Until the first window is full, the partial windows are classified as a first guess
+		bool partial = warming_up && scheduler_warmup(frame_count, SCHEDULER_WARMUP_FRAMES);
+		if (frame_count == 30 || partial) {
+			// The first label may come before the debug window is over, so the CNN wait only
+			// sleeps after it. The label has to wait for the HM-10 though.
+			boot_wait_until(HM10_POWER_UP_MS);
+			hm10_ready(&write_req, sensor_error);
 
-			cnn_unload((uint32_t*) ml_data);
-
-			uint32_t value1 = ml_data[0];
-			uint32_t value2 = ml_data[1];
-			uint32_t value3 = ml_data[2];
-
-			int prob1 = (value1 >> 22) & 0xF;
-			uint32_t sign = prob1 & 0x80;
-			if (sign != 0) {
-				prob1 = prob1 | 0xFFF0;
+			//run cnn
+			if (partial) {
+				preprocess_pad_window(cnn_input, frame_count, cnn_partial);
+				load_input(cnn_partial);
+			} else {
+				load_input(cnn_input);
 			}
+			cnn_start(); // Start CNN processing
 
-			int prob2 = (value1 >> 6) & 0xF;
-			sign = prob2 & 0x80;
-			if (sign != 0) {
-				prob2 = prob2 | 0xFFF0;
+			while (cnn_time == 0) {
+				if (boot_reached(BOOT_DEBUG_WINDOW_MS)) {
+					MXC_LP_EnterSleepMode(); // Wait for CNN
+				}
 			}
 
-			int prob3 = (value2 >> 22) & 0xF;
-			sign = prob3 & 0x80;
-			if (sign != 0) {
-				prob3 = prob3 | 0xFFF0;
+#if PROFILE_CNN_TIME
+			cnn_total += cnn_time;
+			if (++cnn_runs == PROFILE_CNN_RUNS) {
+				printf("\nCNN inference %u us\n", (unsigned) (cnn_total / cnn_runs));
+				cnn_total = 0;
+				cnn_runs = 0;
 			}
+#endif
 
-			int prob4 = (value2 >> 6) & 0xF;
-			sign = prob4 & 0x80;
-			if (sign != 0) {
-				prob4 = prob4 | 0xFFF0;
-			}
+			cnn_unload((uint32_t*) ml_data);
 
-			int prob5 = (value3 >> 6) & 0xF;
-			sign = prob5 & 0x80;
-			if (sign != 0) {
-				prob5 = prob5 | 0xFFF0;
-			}
+			int8_t logits[CLASSIFY_CLASSES];
+			classify_logits((uint32_t*) ml_data, logits);
+			smooth_event_t message = smooth_update(&smooth, logits, boot_ms());
 
-			sprintf(temp_display, "%d, %d, %d, %d, %d", prob1, prob2, prob3,
-					prob4, prob5);
+#if SEND_LOGITS
+			sprintf(temp_display, "%d, %d, %d, %d, %d", logits[0], logits[1],
+					logits[2], logits[3], logits[4]);
 
 			for (int i = 0; i < BUFF_SIZE; i++) {
 				tx_data[i] = temp_display[i];
@@ -1570,54 +624,55 @@ int main(void) {
 			if (error != E_NO_ERROR) {
 				printf("-->Error starting sync write: %d\n", error);
 			}
+#endif
 
-			if (prob1 > prob2 && prob1 > prob3 && prob1 > prob4
-					&& prob1 > prob5) {
+			// Only a change of the smoothed activity and the heartbeat are sent
+			if (message != SMOOTH_QUIET) {
+				uint8_t *result = results[smooth.state];
 				for (int i = 0; i < BUFF_SIZE; i++) {
-					tx_data[i] = result0[i];
+					tx_data[i] = result[i];
 				}
-			}
-			if (prob2 > prob1 && prob2 > prob3 && prob2 > prob4
-					&& prob2 > prob5) {
-				for (int i = 0; i < BUFF_SIZE; i++) {
-					tx_data[i] = result1[i];
-				}
-			}
-			if (prob3 > prob2 && prob3 > prob1 && prob3 > prob4
-					&& prob3 > prob5) {
-				for (int i = 0; i < BUFF_SIZE; i++) {
-					tx_data[i] = result2[i];
-				}
-			}
-			if (prob4 > prob2 && prob4 > prob3 && prob4 > prob1
-					&& prob4 > prob5) {
-				for (int i = 0; i < BUFF_SIZE; i++) {
-					tx_data[i] = result3[i];
+
+				error = MXC_UART_Transaction(&write_req);
+
+				if (error != E_NO_ERROR) {
+					printf("-->Error starting sync write: %d\n", error);
 				}
 			}
-			if (prob5 > prob2 && prob5 > prob3 && prob5 > prob4
-					&& prob5 > prob1) {
-				for (int i = 0; i < BUFF_SIZE; i++) {
-					tx_data[i] = result4[i];
-				}
+
+			if (first_classification) {
+				boot_step("first classification");
+				boot_report();
+				first_classification = false;
 			}
 
-			error = MXC_UART_Transaction(&write_req);
+			// The padding looks like no motion, so partial windows are biased towards the still
+			// activities and don't count towards power modes or the hop
+			if (partial) {
+				continue;
+			}
+			warming_up = false;
+			power_classified(PMIC_I2C, logits);
 
-			if (error != E_NO_ERROR) {
-				printf("-->Error starting sync write: %d\n", error);
+			if (POWER_REPORT_MS > 0 && boot_reached(power_report_ms)) {
+				power_report();
+				power_report_ms += POWER_REPORT_MS;
 			}
+			if (ALIGN_REPORT_MS > 0 && boot_reached(align_report_ms)) {
+				align_report(&align);
+				align_report_ms += ALIGN_REPORT_MS;
+			}
+
+			// The hop is whole groups, the oldest group only keeps its 2 channels
+			int hop = scheduler_next(&scheduler, logits);
+			int shift = hop / SCHEDULER_HOP_STEP;
 
-			frame_count = frame_count - 8;
-			memcpy(cnn_input28, cnn_input20, sizeof(cnn_input28));
-			memcpy(cnn_input24, cnn_input16, sizeof(cnn_input24));
-			memcpy(cnn_input20, cnn_input12, sizeof(cnn_input20));
-			memcpy(cnn_input16, cnn_input8, sizeof(cnn_input16));
-			memcpy(cnn_input12, cnn_input4, sizeof(cnn_input12));
-			memcpy(cnn_input8, cnn_input0, sizeof(cnn_input8));
+			frame_count = frame_count - hop;
+			memmove(cnn_input[shift], cnn_input[0],
+					sizeof(cnn_input[0]) * (PREPROCESS_GROUPS - shift));
 
-			for (int i = 0; i < 36; i++) {
-				cnn_input28[i] = cnn_input28[i] & 0xFFFF;
+			for (int i = 0; i < PREPROCESS_CHANNELS; i++) {
+				cnn_input[PREPROCESS_GROUPS - 1][i] = cnn_input[PREPROCESS_GROUPS - 1][i] & 0xFFFF;
 			}
 		}
 	}
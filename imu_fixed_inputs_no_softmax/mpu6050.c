@@ -0,0 +1,206 @@
+/**
+ * @file        mpu6050.c
+ * @brief       Bring-up and reads of the MPU-6050 sensors on the shared I2C bus
+ */
+
+#include <string.h>
+#include "mxc.h"
+#include "mxc_delay.h"
+#include "boot.h"
+#include "mpu6050.h"
+#include "read_plan.h"
+
+/* Longest register burst written at once */
+#define MAX_WRITE_LEN 7
+
+#define SENSOR(name, id, port, pin) { name, id, port, pin },
+const mpu6050_sensor_t mpu6050_sensors[MPU6050_NUM_SENSORS] = { SENSOR_LIST };
+#undef SENSOR
+
+/* Transactions of mpu6050_read(), planned on the first read */
+static read_plan_t read_plan;
+
+void mpu6050_gpio_init(void) {
+	for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+		mxc_gpio_cfg_t gpio_cfg;
+		gpio_cfg.port = mpu6050_sensors[s].port;
+		gpio_cfg.mask = mpu6050_sensors[s].pin;
+		gpio_cfg.pad = MXC_GPIO_PAD_NONE;
+		gpio_cfg.func = MXC_GPIO_FUNC_OUT;
+		gpio_cfg.vssel = MXC_GPIO_VSSEL_VDDIOH;
+		gpio_cfg.drvstr = MXC_GPIO_DRVSTR_3;
+
+		MXC_GPIO_Config(&gpio_cfg);
+		MXC_GPIO_OutClr(gpio_cfg.port, gpio_cfg.mask);
+	}
+}
+
+void mpu6050_select(int s) {
+	MXC_GPIO_OutSet(mpu6050_sensors[s].port, mpu6050_sensors[s].pin);
+}
+
+void mpu6050_deselect(int s) {
+	MXC_GPIO_OutClr(mpu6050_sensors[s].port, mpu6050_sensors[s].pin);
+}
+
+int mpu6050_read_regs(mxc_i2c_regs_t *i2c, uint8_t reg, uint8_t *data, int len) {
+	mxc_i2c_req_t req;
+
+	req.i2c = i2c;
+	req.addr = MPU6050_ADDR;
+	req.tx_buf = &reg;
+	req.tx_len = 1;
+	req.rx_buf = data;
+	req.rx_len = len;
+	req.restart = 0;
+	req.callback = NULL;
+
+	return MXC_I2C_MasterTransaction(&req);
+}
+
+int mpu6050_write_regs(mxc_i2c_regs_t *i2c, uint8_t reg, const uint8_t *data, int len) {
+	uint8_t buf[1 + MAX_WRITE_LEN];
+	mxc_i2c_req_t req;
+
+	if (len > MAX_WRITE_LEN) {
+		return E_BAD_PARAM;
+	}
+	buf[0] = reg;
+	memcpy(buf + 1, data, len);
+
+	req.i2c = i2c;
+	req.addr = MPU6050_ADDR;
+	req.tx_buf = buf;
+	req.tx_len = 1 + len;
+	req.rx_buf = NULL;
+	req.rx_len = 0;
+	req.restart = 0;
+	req.callback = NULL;
+
+	return MXC_I2C_MasterTransaction(&req);
+}
+
+void mpu6050_read_strategy(int strategy) {
+	read_plan_build(&read_plan, strategy, SENSOR_AXES_MASK);
+}
+
+int mpu6050_read(mxc_i2c_regs_t *i2c, int s, uint16_t *raw) {
+	uint8_t data[READ_PLAN_DATA_LEN] = { 0 };
+	int error = E_NO_ERROR;
+
+	if (read_plan.steps == 0) {
+		mpu6050_read_strategy(READ_PLAN_STRATEGY);
+	}
+
+	mpu6050_select(s);
+
+	for (int i = 0; i < read_plan.steps && error == E_NO_ERROR; i++) {
+		const read_step_t *step = &read_plan.step[i];
+
+		if (step->delay_us > 0) {
+			MXC_Delay(MXC_DELAY_USEC(step->delay_us));
+		}
+		error = mpu6050_read_regs(i2c, step->reg, &data[step->reg - READ_PLAN_FIRST_REG],
+				step->len);
+	}
+	for (int a = 0; a < SENSOR_AXES; a++) {
+		int offset = read_plan_offset(sensor_axis(a));
+
+		raw[a] = (data[offset] << 8) | data[offset + 1];
+	}
+
+	MXC_Delay(MXC_DELAY_USEC(read_plan.deselect_delay_us));
+	mpu6050_deselect(s);
+	MXC_Delay(MXC_DELAY_USEC(read_plan.deselect_delay_us));
+
+	return error;
+}
+
+int mpu6050_set_power(mxc_i2c_regs_t *i2c, int s, mpu6050_power_t mode) {
+	uint8_t pwr1, pwr2 = 0;
+	int error;
+
+	switch (mode) {
+	case MPU6050_POWER_CYCLE:
+		// The PLL runs off the X gyro, which goes into standby
+		pwr1 = MPU6050_PWR_CYCLE | MPU6050_PWR_TEMP_DIS | MPU6050_CLKSEL_INTERNAL;
+		pwr2 = (MPU6050_LP_WAKE_CTRL << MPU6050_PWR2_LP_WAKE_SHIFT) | MPU6050_PWR2_STBY_GYRO;
+		break;
+	case MPU6050_POWER_SLEEP:
+		pwr1 = MPU6050_PWR_SLEEP | MPU6050_CLKSEL_INTERNAL;
+		break;
+	default:
+		pwr1 = MPU6050_CLKSEL_PLL_XGYRO;
+		break;
+	}
+
+	mpu6050_select(s);
+
+	// Standby bits first so the gyro doesn't start up on the way to cycle mode
+	error = mpu6050_write_regs(i2c, MPU6050_REG_PWR_MGMT_2, &pwr2, 1);
+	if (error == E_NO_ERROR) {
+		error = mpu6050_write_regs(i2c, MPU6050_REG_PWR_MGMT_1, &pwr1, 1);
+	}
+
+	mpu6050_deselect(s);
+
+	return error;
+}
+
+int mpu6050_init(mxc_i2c_regs_t *i2c, int s, uint32_t timeout_ms) {
+	uint32_t start = boot_ms();
+	uint8_t id, pwr, check, config[2];
+	int error;
+
+	mpu6050_select(s);
+
+	// Poll until the sensor answers and has left reset instead of waiting for the worst case
+	do {
+		error = mpu6050_read_regs(i2c, MPU6050_REG_WHO_AM_I, &id, 1);
+		if (error == E_NO_ERROR && (id & MPU6050_WHO_AM_I_MASK) != MPU6050_WHO_AM_I) {
+			error = E_NO_DEVICE;
+		}
+		if (error == E_NO_ERROR) {
+			error = mpu6050_read_regs(i2c, MPU6050_REG_PWR_MGMT_1, &pwr, 1);
+		}
+		if (error == E_NO_ERROR && (pwr & MPU6050_PWR_DEVICE_RESET)) {
+			error = E_TIME_OUT;
+		}
+	} while (error != E_NO_ERROR && boot_ms() - start < timeout_ms);
+
+	// Both ranges with one read and one burst write, the registers are adjacent
+	if (error == E_NO_ERROR) {
+		error = mpu6050_read_regs(i2c, MPU6050_REG_GYRO_CONFIG, config, 2);
+	}
+	if (error == E_NO_ERROR) {
+		config[0] = (config[0] & ~MPU6050_FS_SEL) | (MPU6050_GYRO_RANGE << 3);
+		config[1] = (config[1] & ~MPU6050_FS_SEL) | (MPU6050_ACCEL_RANGE << 3);
+		error = mpu6050_write_regs(i2c, MPU6050_REG_GYRO_CONFIG, config, 2);
+	}
+
+	// Clock source and wake-up in one write, then read back until the sensor runs. A sensor
+	// that is re-initialized may have been left in cycle mode with its gyro in standby.
+	if (error == E_NO_ERROR) {
+		uint8_t pwr2 = 0;
+
+		error = mpu6050_write_regs(i2c, MPU6050_REG_PWR_MGMT_2, &pwr2, 1);
+	}
+	if (error == E_NO_ERROR) {
+		pwr = (pwr & ~(MPU6050_PWR_SLEEP | MPU6050_PWR_CYCLE | MPU6050_PWR_CLKSEL))
+				| MPU6050_CLKSEL_PLL_XGYRO;
+		error = mpu6050_write_regs(i2c, MPU6050_REG_PWR_MGMT_1, &pwr, 1);
+	}
+	while (error == E_NO_ERROR) {
+		error = mpu6050_read_regs(i2c, MPU6050_REG_PWR_MGMT_1, &check, 1);
+		if (error == E_NO_ERROR && check == pwr) {
+			break;
+		}
+		if (boot_ms() - start >= timeout_ms) {
+			error = E_TIME_OUT;
+		}
+	}
+
+	mpu6050_deselect(s);
+
+	return error;
+}
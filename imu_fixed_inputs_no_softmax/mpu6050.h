@@ -0,0 +1,126 @@
+/**
+ * @file        mpu6050.h
+ * @brief       Bring-up and reads of the MPU-6050 sensors on the shared I2C bus
+ * @details     All sensors share one bus. Each one's AD0 pin is driven by a select GPIO: the
+ *              selected sensor answers at MPU6050_ADDR (0x69), the others at 0x68, so only one
+ *              sensor may be selected at a time.
+ */
+
+#ifndef __MPU6050_H__
+#define __MPU6050_H__
+
+#include <stdint.h>
+#include "gpio.h"
+#include "i2c.h"
+#include "sensor_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Address of the selected sensor */
+#define MPU6050_ADDR 0x69
+
+/* Registers */
+#define MPU6050_REG_GYRO_CONFIG 0x1B
+#define MPU6050_REG_ACCEL_CONFIG 0x1C
+#define MPU6050_REG_ACCEL_XOUT_H 0x3B
+#define MPU6050_REG_GYRO_XOUT_H 0x43
+#define MPU6050_REG_PWR_MGMT_1 0x6B
+#define MPU6050_REG_PWR_MGMT_2 0x6C
+#define MPU6050_REG_WHO_AM_I 0x75
+
+/* WHO_AM_I: bits 6 ... 1 of the address, 0x68 whatever AD0 is, bits 0 and 7 are reserved */
+#define MPU6050_WHO_AM_I 0x68
+#define MPU6050_WHO_AM_I_MASK 0x7E
+
+/* PWR_MGMT_1 fields */
+#define MPU6050_PWR_DEVICE_RESET 0x80
+#define MPU6050_PWR_SLEEP 0x40
+#define MPU6050_PWR_CYCLE 0x20
+#define MPU6050_PWR_TEMP_DIS 0x08
+#define MPU6050_PWR_CLKSEL 0x07
+#define MPU6050_CLKSEL_INTERNAL 0x00
+#define MPU6050_CLKSEL_PLL_XGYRO 0x01
+
+/* PWR_MGMT_2 fields */
+#define MPU6050_PWR2_LP_WAKE_SHIFT 6
+#define MPU6050_PWR2_STBY_GYRO 0x07
+
+/* Accelerometer samples per second in cycle mode: LP_WAKE_CTRL 0 ... 3 = 1.25, 5, 20, 40 Hz */
+#define MPU6050_LP_WAKE_CTRL 2
+
+/* GYRO_CONFIG / ACCEL_CONFIG full scale field, 0 = +-250 dps and +-2 g */
+#define MPU6050_FS_SEL 0x18
+#define MPU6050_GYRO_RANGE 0
+#define MPU6050_ACCEL_RANGE 0
+
+/* Longest wait for a sensor to answer, covers the PMIC powering up the sensors after reset */
+#define MPU6050_READY_TIMEOUT_MS 500
+
+/* Sensors in the order of the network input rows, see sensor_config.h */
+#define MPU6050_NUM_SENSORS SENSOR_COUNT
+
+/* Axes of a sample in the order of the registers: accel x, y, z, gyro x, y, z */
+#define MPU6050_AXES 6
+
+/* Accelerometer reading of 1 g at the +-2 g range */
+#define MPU6050_ACCEL_1G 16384
+
+typedef struct {
+	const char *name;       // body placement, as in the status messages
+	int id;                 // position in the six sensor kit
+	mxc_gpio_regs_t *port;  // AD0 select pin
+	uint32_t pin;
+} mpu6050_sensor_t;
+
+extern const mpu6050_sensor_t mpu6050_sensors[MPU6050_NUM_SENSORS];
+
+/* Configure every select pin as an output and deselect all sensors */
+void mpu6050_gpio_init(void);
+
+/* Drive the select pin of sensor s */
+void mpu6050_select(int s);
+void mpu6050_deselect(int s);
+
+/* Read or write len consecutive registers of the selected sensor starting at reg */
+int mpu6050_read_regs(mxc_i2c_regs_t *i2c, uint8_t reg, uint8_t *data, int len);
+int mpu6050_write_regs(mxc_i2c_regs_t *i2c, uint8_t reg, const uint8_t *data, int len);
+
+/*
+ * Read one sample of sensor s into raw, the SENSOR_AXES_MASK axes as 16-bit register contents,
+ * with the transactions of the read plan (read_plan.h). With READ_PLAN_BYTES every byte is read on
+ * its own 1 ms after the last one, which sets the frame rate the network was trained at. Stops at
+ * the first failed transaction and returns its error, raw is only complete if E_NO_ERROR is
+ * returned.
+ */
+int mpu6050_read(mxc_i2c_regs_t *i2c, int s, uint16_t *raw);
+
+/* Plan the reads with another strategy than READ_PLAN_STRATEGY, e.g. READ_PLAN_BURST */
+void mpu6050_read_strategy(int strategy);
+
+typedef enum {
+	MPU6050_POWER_ON,       // gyro and accelerometer running, as after mpu6050_init()
+	MPU6050_POWER_CYCLE,    // gyro in standby, one accelerometer sample every wake-up
+	MPU6050_POWER_SLEEP,    // everything stopped, the registers keep their last values
+} mpu6050_power_t;
+
+/*
+ * Switch sensor s to a power mode with one write to each power management register. The gyro
+ * needs about 30 ms after MPU6050_POWER_ON before its readings are valid.
+ */
+int mpu6050_set_power(mxc_i2c_regs_t *i2c, int s, mpu6050_power_t mode);
+
+/*
+ * Select sensor s, wait until it answers WHO_AM_I with MPU6050_WHO_AM_I and is out of reset, set
+ * the PLL clock and the ranges and wake it up, then deselect it. Returns E_NO_ERROR, the I2C error
+ * of the last attempt, E_NO_DEVICE if another device answered or E_TIME_OUT if the sensor didn't
+ * come up within timeout_ms.
+ */
+int mpu6050_init(mxc_i2c_regs_t *i2c, int s, uint32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MPU6050_H__
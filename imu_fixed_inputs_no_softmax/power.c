@@ -0,0 +1,196 @@
+/**
+ * @file        power.c
+ * @brief       Adaptive power modes of the MPU-6050 sensors
+ */
+
+#include <stdio.h>
+#include "mxc.h"
+#include "boot.h"
+#include "classify.h"
+#include "health.h"
+#include "power.h"
+
+power_t power[MPU6050_NUM_SENSORS];
+
+// Classifications of a still activity in a row
+static unsigned still_windows;
+
+static const uint32_t mode_ua[POWER_MODES] = { POWER_ON_UA, POWER_ON_UA, POWER_CYCLE_UA,
+		POWER_SLEEP_UA };
+
+static void set_state(int s, power_state_t state) {
+	power_t *p = &power[s];
+	uint32_t now = boot_ms();
+
+	p->ms[p->state] += now - p->since_ms;
+	p->since_ms = now;
+	p->state = state;
+	p->still_frames = 0;
+	if (state == POWER_WAKING) {
+		p->wakes++;
+	}
+}
+
+/* Switch the sensor and then the state, a failed write is tried again on the next occasion */
+static void switch_mode(mxc_i2c_regs_t *i2c, int s, power_state_t state) {
+	mpu6050_power_t mode = MPU6050_POWER_ON;
+	int error;
+
+	if (state == POWER_CYCLE) {
+		mode = MPU6050_POWER_CYCLE;
+	} else if (state == POWER_SLEEP) {
+		mode = MPU6050_POWER_SLEEP;
+	}
+
+	error = mpu6050_set_power(i2c, s, mode);
+	if (error != E_NO_ERROR) {
+		printf("\n-->Sensor %s power mode change failed: %d\n", mpu6050_sensors[s].name, error);
+		return;
+	}
+
+	set_state(s, state);
+}
+
+static void wake_sleeping(mxc_i2c_regs_t *i2c) {
+	for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+		if (power[s].state == POWER_SLEEP) {
+			switch_mode(i2c, s, POWER_WAKING);
+		}
+	}
+}
+
+void power_init(void) {
+	uint32_t now = boot_ms();
+
+	for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+		power_t *p = &power[s];
+
+		p->state = POWER_ON;
+		p->still_frames = 0;
+		p->wakes = 0;
+		p->since_ms = now;
+		for (int m = 0; m < POWER_MODES; m++) {
+			p->ms[m] = 0;
+		}
+	}
+	still_windows = 0;
+}
+
+bool power_read(int s) {
+	return power[s].state == POWER_ON || power[s].state == POWER_CYCLE;
+}
+
+bool power_gyro_off(int s) {
+	return power[s].state == POWER_CYCLE;
+}
+
+void power_frame(mxc_i2c_regs_t *i2c, const uint16_t *raw, const uint16_t *prev, uint32_t fresh) {
+	bool moving = false;
+
+	for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+		power_t *p = &power[s];
+		int level = 0;
+		int accel_level = 0;
+
+		if (health[s].state == HEALTH_DOWN) {
+			if (p->state != POWER_ON) {
+				set_state(s, POWER_ON);
+			}
+			continue;
+		}
+		if (p->state == POWER_WAKING) {
+			set_state(s, POWER_ON);
+			continue;
+		}
+		if (!(fresh & (1u << s))) {
+			continue;
+		}
+
+		// The same measure of motion as the input, before it is clamped
+		for (int a = 0; a < SENSOR_AXES; a++) {
+			int i = s * SENSOR_AXES + a;
+			int d = ((raw[i] > prev[i]) ? raw[i] - prev[i] : prev[i] - raw[i]) >> 7;
+
+			level = (d > level) ? d : level;
+			if (sensor_axis(a) < 3) {
+				accel_level = (d > accel_level) ? d : accel_level;
+			}
+		}
+
+		if (p->state == POWER_ON) {
+			if (level > POWER_STILL_LEVEL) {
+				p->still_frames = 0;
+				moving = true;
+			} else if (++p->still_frames >= POWER_CYCLE_FRAMES) {
+				switch_mode(i2c, s, POWER_CYCLE);
+			}
+		} else if (accel_level >= POWER_WAKE_LEVEL) {
+			switch_mode(i2c, s, POWER_WAKING);
+			moving = true;
+		}
+	}
+
+	if (moving) {
+		still_windows = 0;
+		wake_sleeping(i2c);
+	}
+}
+
+void power_classified(mxc_i2c_regs_t *i2c, const int8_t *logits) {
+	int activity = classify_argmax(logits, CLASSIFY_CLASSES);
+
+	if (activity != CLASSIFY_SITTING && activity != CLASSIFY_STANDING) {
+		still_windows = 0;
+		wake_sleeping(i2c);
+		return;
+	}
+	if (classify_margin(logits, CLASSIFY_CLASSES) < POWER_SLEEP_MARGIN) {
+		still_windows = 0;
+		return;
+	}
+
+	// A few sensors stay in cycle mode to notice when the wearer moves again, or falls
+	if (++still_windows >= POWER_SLEEP_WINDOWS) {
+		int kept = 0;
+
+		for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+			if (power[s].state != POWER_CYCLE) {
+				continue;
+			}
+			if (kept >= POWER_AWAKE_SENSORS) {
+				switch_mode(i2c, s, POWER_SLEEP);
+			}
+			kept++;
+		}
+	}
+}
+
+void power_report(void) {
+	uint32_t now = boot_ms();
+
+	printf("\nSensor power modes since boot (on / cycle / sleep):\n");
+	for (int s = 0; s < MPU6050_NUM_SENSORS; s++) {
+		const power_t *p = &power[s];
+		uint32_t ms[POWER_MODES];
+		uint64_t total = 0;
+		uint64_t charge = 0;
+
+		for (int m = 0; m < POWER_MODES; m++) {
+			ms[m] = p->ms[m] + ((m == (int) p->state) ? now - p->since_ms : 0);
+			total += ms[m];
+			charge += (uint64_t) ms[m] * mode_ua[m];
+		}
+		ms[POWER_ON] += ms[POWER_WAKING];
+		if (total == 0) {
+			continue;
+		}
+
+		// Charge in uA ms, printed in mAs
+		printf("%-3s %3u%% / %3u%% / %3u%%, %u wakes, %u.%03u mAs, average %u uA\n",
+				mpu6050_sensors[s].name, (unsigned) (100 * ms[POWER_ON] / total),
+				(unsigned) (100 * ms[POWER_CYCLE] / total),
+				(unsigned) (100 * ms[POWER_SLEEP] / total), p->wakes,
+				(unsigned) (charge / 1000000), (unsigned) (charge / 1000 % 1000),
+				(unsigned) (charge / total));
+	}
+}
@@ -0,0 +1,99 @@
+/**
+ * @file        power.h
+ * @brief       Adaptive power modes of the MPU-6050 sensors
+ * @details     A sensor that hasn't moved for POWER_CYCLE_FRAMES frames drops to the
+ *              accelerometer-only cycle mode, where it is still read and its gyro columns repeat
+ *              their last value, i.e. the no-motion input. Once the classifier has reported a
+ *              still activity (sitting or standing) with a clear margin POWER_SLEEP_WINDOWS times
+ *              in a row, the sensors in cycle mode go to sleep and are no longer read, except for
+ *              the first POWER_AWAKE_SENSORS of them, which stay in cycle mode to notice motion and
+ *              enough of them to see a fall together (fall.h).
+ *
+ *              Motion on any sensor that is still read, or a moving activity, wakes the sleeping
+ *              sensors, and a sensor in cycle mode that moves goes back to full power. A woken
+ *              sensor isn't read for one frame while its gyro starts up.
+ *
+ *              The time in each mode is kept per sensor, with the supply current from the
+ *              datasheet as a proxy for the energy used.
+ */
+
+#ifndef __POWER_H__
+#define __POWER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "fall.h"
+#include "mpu6050.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Motion of a frame in the input's units, |delta| / 128, at or below which a sensor is still */
+#define POWER_STILL_LEVEL 2
+
+/* Motion of an accelerometer axis in cycle mode that brings a sensor back to full power */
+#define POWER_WAKE_LEVEL 4
+
+/* Still frames before a sensor drops to cycle mode, about 5 s */
+#define POWER_CYCLE_FRAMES 50
+
+/* Classifications of a still activity in a row before sensors in cycle mode go to sleep */
+#define POWER_SLEEP_WINDOWS 5
+
+/* Logit margin a classification needs to count towards sleep */
+#define POWER_SLEEP_MARGIN 16
+
+/* Sensors left in cycle mode when the others sleep, the quorum of the fall detector */
+#define POWER_AWAKE_SENSORS FALL_SENSORS
+
+/* Supply current of a sensor in each mode in uA: normal, cycle mode at 20 Hz and sleep */
+#define POWER_ON_UA 3900
+#define POWER_CYCLE_UA 70
+#define POWER_SLEEP_UA 5
+
+typedef enum {
+	POWER_ON,
+	POWER_WAKING,       // switched on in the last frame, not read until the gyro has started
+	POWER_CYCLE,
+	POWER_SLEEP,
+	POWER_MODES,
+} power_state_t;
+
+typedef struct {
+	power_state_t state;
+	unsigned still_frames;
+	unsigned wakes;
+	uint32_t since_ms;              // boot_ms() of the last change of mode
+	uint32_t ms[POWER_MODES];       // time spent in each mode before since_ms
+} power_t;
+
+extern power_t power[MPU6050_NUM_SENSORS];
+
+/* All sensors start at full power, as mpu6050_init() leaves them */
+void power_init(void);
+
+/* Whether sensor s is read this frame, i.e. is on or in cycle mode */
+bool power_read(int s);
+
+/* Whether the gyro of sensor s is in standby, its columns then have to repeat prev */
+bool power_gyro_off(int s);
+
+/*
+ * Update the modes from one frame, raw being the calibrated samples about to be converted
+ * against prev and fresh the sensors that were read. Sensors that aren't up are kept at full
+ * power, their re-initialization switches them on.
+ */
+void power_frame(mxc_i2c_regs_t *i2c, const uint16_t *raw, const uint16_t *prev, uint32_t fresh);
+
+/* Let the classification of a window count towards putting sensors to sleep or waking them */
+void power_classified(mxc_i2c_regs_t *i2c, const int8_t *logits);
+
+/* Print the duty cycle and charge used of every sensor since power_init() */
+void power_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __POWER_H__
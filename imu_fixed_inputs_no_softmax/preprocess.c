@@ -0,0 +1,166 @@
+/**
+ * @file        preprocess.c
+ * @brief       Conversion of raw MPU6050 samples into CNN input data
+ * @details     Plain C without SDK dependencies so it builds for the MAX78000 and on the host.
+ */
+
+#include <string.h>
+#include "preprocess.h"
+
+#ifdef __ARM_FEATURE_DSP
+#include "mxc_device.h"
+
+/* |a - b| of both unsigned halfwords: USUB16 sets GE where a >= b and SEL picks that difference */
+static inline uint32_t uabsdiff16(uint32_t a, uint32_t b)
+{
+	uint32_t ba = __USUB16(b, a);
+	uint32_t ab = __USUB16(a, b);
+
+	return __SEL(ab, ba);
+}
+
+/* Saturate both signed halfwords to 0 ... 255 */
+#define usat16_8(x) __USAT16((x), 8)
+#else
+/* Portable versions of the halfword operations above, for host builds */
+static inline uint32_t uabsdiff16(uint32_t a, uint32_t b)
+{
+	uint32_t lo = ((a & 0xFFFF) >= (b & 0xFFFF)) ? (a & 0xFFFF) - (b & 0xFFFF) : (b & 0xFFFF) - (a & 0xFFFF);
+	uint32_t hi = ((a >> 16) >= (b >> 16)) ? (a >> 16) - (b >> 16) : (b >> 16) - (a >> 16);
+
+	return (hi << 16) | lo;
+}
+
+static inline uint32_t usat16_8(uint32_t x)
+{
+	int32_t lo = (int16_t) (x & 0xFFFF);
+	int32_t hi = (int16_t) (x >> 16);
+
+	lo = (lo < 0) ? 0 : ((lo > 255) ? 255 : lo);
+	hi = (hi < 0) ? 0 : ((hi > 255) ? 255 : hi);
+
+	return ((uint32_t) hi << 16) | (uint32_t) lo;
+}
+#endif
+
+const int preprocess_channels = PREPROCESS_CHANNELS;
+
+void preprocess_calibrate(uint16_t *raw, const int16_t *rest, const int16_t *scale)
+{
+	for (int i = 0; i < PREPROCESS_CHANNELS; i++) {
+		int32_t value = rest[i] + ((((int16_t) raw[i] - rest[i]) * scale[i]) >> 14);
+
+		value = (value < -32768) ? -32768 : ((value > 32767) ? 32767 : value);
+		raw[i] = (uint16_t) value;
+	}
+}
+
+void preprocess_frame(const uint16_t *raw, uint16_t *prev, int8_t *values)
+{
+	for (int i = 0; i < PREPROCESS_CHANNELS; i++) {
+		values[i] = preprocess_sample(raw[i], prev[i]);
+		prev[i] = raw[i];
+	}
+}
+
+void preprocess_recording(const uint16_t *raw, size_t frames, int8_t *values)
+{
+	static const uint16_t zero[PREPROCESS_CHANNELS];
+
+	// Each frame is compared with the one before it in place, no copy of prev is kept
+	for (size_t n = 0; n < frames; n++) {
+		const uint16_t *cur = raw + n * PREPROCESS_CHANNELS;
+		const uint16_t *prev = (n > 0) ? cur - PREPROCESS_CHANNELS : zero;
+		int8_t *out = values + n * PREPROCESS_CHANNELS;
+
+		for (int i = 0; i < PREPROCESS_CHANNELS; i++) {
+			out[i] = preprocess_sample(cur[i], prev[i]);
+		}
+	}
+}
+
+void preprocess_pack_frame(uint32_t *words, const int8_t *values)
+{
+	for (int i = 0; i < PREPROCESS_CHANNELS; i++) {
+		words[i] = (words[i] << 8) | (uint8_t) values[i];
+	}
+}
+
+void preprocess_frame_pack(const uint16_t *raw, uint16_t *prev, uint32_t *words)
+{
+	// Two channels per 32-bit register, one in each halfword
+	for (int i = 0; i + 1 < PREPROCESS_CHANNELS; i += 2) {
+		uint32_t cur, last, level;
+
+		memcpy(&cur, raw + i, sizeof(cur));
+		memcpy(&last, prev + i, sizeof(last));
+
+		// |cur - last| / 128 fits in 9 bits, saturate to 8 and subtract 128 by flipping the top bit
+		level = (uabsdiff16(cur, last) >> 7) & 0x01FF01FF;
+		level = usat16_8(level) ^ 0x00800080;
+
+		words[i] = (words[i] << 8) | (level & 0xFF);
+		words[i + 1] = (words[i + 1] << 8) | (level >> 16);
+
+		memcpy(prev + i, &cur, sizeof(cur));
+	}
+
+#if PREPROCESS_CHANNELS % 2
+	// Odd sensor and axis counts leave one channel over
+	words[PREPROCESS_CHANNELS - 1] = (words[PREPROCESS_CHANNELS - 1] << 8)
+			| (uint8_t) preprocess_sample(raw[PREPROCESS_CHANNELS - 1], prev[PREPROCESS_CHANNELS - 1]);
+	prev[PREPROCESS_CHANNELS - 1] = raw[PREPROCESS_CHANNELS - 1];
+#endif
+}
+
+void preprocess_frame_pack_ref(const uint16_t *raw, uint16_t *prev, uint32_t *words)
+{
+	int8_t values[PREPROCESS_CHANNELS];
+
+	preprocess_frame(raw, prev, values);
+	preprocess_pack_frame(words, values);
+}
+
+void preprocess_pack_window(const int8_t *values, uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS])
+{
+	memset(words, 0, sizeof(uint32_t) * PREPROCESS_GROUPS * PREPROCESS_CHANNELS);
+
+	// Input channel c is byte c % 4 of group c / 4 and holds frame PREPROCESS_WINDOW - 1 - c, so
+	// every frame is or'ed straight into its byte lane instead of being shifted through the group
+	for (int c = 0; c < PREPROCESS_WINDOW; c++) {
+		const int8_t *frame = values + (PREPROCESS_WINDOW - 1 - c) * PREPROCESS_CHANNELS;
+		uint32_t *group = words[c / 4];
+		int lane = 8 * (c % 4);
+
+		for (int i = 0; i < PREPROCESS_CHANNELS; i++) {
+			group[i] |= (uint32_t) (uint8_t) frame[i] << lane;
+		}
+	}
+}
+
+void preprocess_pad_window(const uint32_t src[PREPROCESS_GROUPS][PREPROCESS_CHANNELS], int frames,
+		uint32_t dst[PREPROCESS_GROUPS][PREPROCESS_CHANNELS])
+{
+	int shift = (PREPROCESS_WINDOW - frames) / 4;
+
+	// Moving every frame down by whole groups keeps the byte lanes, only the group that holds
+	// the first frame holds both. Lanes past the last channel stay 0 like in a packed window.
+	for (int g = 0; g < PREPROCESS_GROUPS; g++) {
+		int lanes = PREPROCESS_WINDOW - 4 * g;
+		uint32_t used = (lanes >= 4) ? 0xFFFFFFFF : (1u << (8 * lanes)) - 1;
+		uint32_t still = (uint8_t) PREPROCESS_STILL * 0x01010101u & used;
+		uint32_t keep = 0;
+
+		if (4 * g + 4 <= frames) {
+			keep = 0xFFFFFFFF;
+		} else if (4 * g < frames) {
+			keep = (1u << (8 * (frames - 4 * g))) - 1;
+		}
+
+		for (int i = 0; i < PREPROCESS_CHANNELS; i++) {
+			uint32_t word = (g + shift < PREPROCESS_GROUPS) ? src[g + shift][i] : 0;
+
+			dst[g][i] = (word & keep) | (still & ~keep);
+		}
+	}
+}
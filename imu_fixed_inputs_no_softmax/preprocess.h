@@ -0,0 +1,105 @@
+/**
+ * @file        preprocess.h
+ * @brief       Conversion of raw MPU6050 samples into CNN input data
+ * @details     Shared by the firmware, the host tools and the training data loader so every
+ *              consumer sees exactly the bytes the device loads into the accelerator.
+ */
+
+#ifndef __PREPROCESS_H__
+#define __PREPROCESS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sensor_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One frame holds the axes of all sensors, one pixel of the input image each (36 for 6x6) */
+#define PREPROCESS_CHANNELS SENSOR_CHANNELS
+
+/* PREPROCESS_CHANNELS of the build, for loaders of the shared library */
+extern const int preprocess_channels;
+
+/* Frames per window, each frame is one input channel */
+#define PREPROCESS_WINDOW 30
+
+/* Input channels are loaded 4 per word, cnn_input0 ... cnn_input28 */
+#define PREPROCESS_GROUPS 8
+
+/*
+ * Raw samples are the 16-bit register contents as read from the sensor (high byte << 8 | low
+ * byte) without sign extension, which is how the firmware has always compared them.
+ * The input value is (|prev - raw| / 128) - 128, clamped to 127.
+ */
+static inline int8_t preprocess_sample(uint16_t raw, uint16_t prev)
+{
+	int32_t level = (int32_t) raw - (int32_t) prev;
+
+	level = ((level < 0) ? -level : level) >> 7;
+	level = (level > 255) ? 255 : level;
+
+	return (int8_t) (level - 128);
+}
+
+/* Input value of a frame without motion */
+#define PREPROCESS_STILL (-128)
+
+/* Calibration scale of 1.0, the scales are fixed point with 14 fractional bits */
+#define PREPROCESS_UNITY (1 << 14)
+
+/*
+ * Apply a per-channel calibration to one frame of raw samples in place: the signed reading
+ * becomes rest + (reading - rest) * scale, saturated to 16 bits. The input only depends on the
+ * difference between frames, so a constant offset cancels out and rest is the point the scale
+ * is applied around rather than something subtracted, which would move the readings at rest to
+ * 0 where the unsigned samples wrap. rest = 0 and scale = PREPROCESS_UNITY leave a channel as is.
+ */
+void preprocess_calibrate(uint16_t *raw, const int16_t *rest, const int16_t *scale);
+
+/* Convert one frame of raw samples to input values and remember them in prev */
+void preprocess_frame(const uint16_t *raw, uint16_t *prev, int8_t *values);
+
+/* Convert a whole recording of frames, starting from prev = 0 like the firmware after reset */
+void preprocess_recording(const uint16_t *raw, size_t frames, int8_t *values);
+
+/* Shift one frame of input values into the low byte of each HWC word of an input group */
+void preprocess_pack_frame(uint32_t *words, const int8_t *values);
+
+/* Index of the input group (cnn_input0 = 0 ... cnn_input28 = 7) that frame n of a window goes to */
+static inline int preprocess_group(int n)
+{
+	return (PREPROCESS_WINDOW - 1 - n) / 4;
+}
+
+/*
+ * Convert one frame and shift it straight into an input group in a single pass, the same result
+ * as preprocess_frame() followed by preprocess_pack_frame(). Uses the Cortex-M4 SIMD instructions
+ * when the compiler targets them, a portable version of the same halfword operations otherwise.
+ */
+void preprocess_frame_pack(const uint16_t *raw, uint16_t *prev, uint32_t *words);
+
+/* Scalar reference for preprocess_frame_pack() */
+void preprocess_frame_pack_ref(const uint16_t *raw, uint16_t *prev, uint32_t *words);
+
+/*
+ * Build the input group words for a window of PREPROCESS_WINDOW frames, oldest first.
+ * Input channel c holds frame PREPROCESS_WINDOW - 1 - c, i.e. the newest frame is channel 0.
+ */
+void preprocess_pack_window(const int8_t *values, uint32_t words[PREPROCESS_GROUPS][PREPROCESS_CHANNELS]);
+
+/*
+ * Make a full window out of one that has only received its first frames: src holds frames
+ * 0 ... frames - 1 in channels PREPROCESS_WINDOW - 1 ... PREPROCESS_WINDOW - frames as
+ * preprocess_frame_pack() left them, dst gets them in the newest channels frames - 1 ... 0 with
+ * the older channels padded as still. PREPROCESS_WINDOW - frames must be a multiple of 4.
+ */
+void preprocess_pad_window(const uint32_t src[PREPROCESS_GROUPS][PREPROCESS_CHANNELS], int frames,
+		uint32_t dst[PREPROCESS_GROUPS][PREPROCESS_CHANNELS]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __PREPROCESS_H__
@@ -8,3 +8,10 @@
 # **********************************************************
 
 # Add your config here!
+
+# Run the CNN stopwatch in cnn.c for PROFILE_CNN_TIME in main.c
+# PROJ_CFLAGS += -DCNN_INFERENCE_TIMER=MXC_TMR0
+
+# Keep the image out of the last flash page, where calib.c stores the sensor calibration
+LINKERFILE = calib.ld
+PROJ_LDFLAGS += -L$(CMSIS_ROOT)/Device/Maxim/$(TARGET_UC)/Source/GCC
@@ -0,0 +1,57 @@
+/**
+ * @file        read_plan.c
+ * @brief       Descriptors of the I2C transactions that read one sensor's sample
+ */
+
+#include "read_plan.h"
+
+static const char *const strategy_names[READ_PLAN_STRATEGIES] = { "bytes", "axes", "burst" };
+
+static void add_step(read_plan_t *plan, int reg, int len, int delay_us)
+{
+	read_step_t *step = &plan->step[plan->steps++];
+
+	step->reg = (uint8_t) reg;
+	step->len = (uint8_t) len;
+	step->delay_us = (uint16_t) delay_us;
+}
+
+void read_plan_build(read_plan_t *plan, int strategy, uint32_t axes_mask)
+{
+	int first = -1;
+	int last = -1;
+
+	plan->strategy = strategy;
+	plan->steps = 0;
+	plan->deselect_delay_us = (strategy == READ_PLAN_BYTES) ? READ_PLAN_DESELECT_DELAY_US
+			: READ_PLAN_SETTLE_US;
+
+	for (int axis = 0; axis < 6; axis++) {
+		int reg = READ_PLAN_FIRST_REG + read_plan_offset(axis);
+
+		if (!(axes_mask & (1u << axis))) {
+			continue;
+		}
+		switch (strategy) {
+		case READ_PLAN_BYTES:
+			add_step(plan, reg, 1, READ_PLAN_BYTE_DELAY_US);
+			add_step(plan, reg + 1, 1, READ_PLAN_BYTE_DELAY_US);
+			break;
+		case READ_PLAN_AXES:
+			add_step(plan, reg, 2, 0);
+			break;
+		default:
+			first = (first < 0) ? reg : first;
+			last = reg + 1;
+			break;
+		}
+	}
+	if (strategy == READ_PLAN_BURST && first >= 0) {
+		add_step(plan, first, last - first + 1, 0);
+	}
+}
+
+const char *read_plan_name(int strategy)
+{
+	return (strategy >= 0 && strategy < READ_PLAN_STRATEGIES) ? strategy_names[strategy] : "?";
+}
@@ -0,0 +1,84 @@
+/**
+ * @file        read_plan.h
+ * @brief       Descriptors of the I2C transactions that read one sensor's sample
+ * @details     A plan lists the register reads mpu6050_read() makes for the SENSOR_AXES_MASK
+ *              axes, each one a transaction that writes the register pointer and reads len bytes
+ *              after a repeated start, with the wait before it and the waits around deselecting
+ *              the sensor. host/build/i2c_budget times the same plans to predict the frame time
+ *              for other bus clocks, sensor counts and bus layouts.
+ *
+ *              READ_PLAN_BYTES is how the network's training data was read: every byte on its own
+ *              1 ms after the last one, so it sets the frame rate. READ_PLAN_AXES reads both bytes
+ *              of an axis at once and READ_PLAN_BURST all axes in one burst (with the temperature
+ *              in between when accelerometer and gyro axes are read); both leave out the waits.
+ *              Build with e.g. -DREAD_PLAN_STRATEGY=READ_PLAN_BURST once the network is trained at
+ *              the faster rate.
+ *
+ *              Plain C without SDK dependencies, shared with the host tools in ../host.
+ */
+
+#ifndef __READ_PLAN_H__
+#define __READ_PLAN_H__
+
+#include <stdint.h>
+#include "sensor_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define READ_PLAN_BYTES 0
+#define READ_PLAN_AXES 1
+#define READ_PLAN_BURST 2
+#define READ_PLAN_STRATEGIES 3
+
+#ifndef READ_PLAN_STRATEGY
+#define READ_PLAN_STRATEGY READ_PLAN_BYTES
+#endif
+
+/* ACCEL_XOUT_H, the data registers are AX AY AZ TEMP GX GY GZ, big-endian pairs */
+#define READ_PLAN_FIRST_REG 0x3B
+#define READ_PLAN_DATA_LEN 14
+
+/* Bus clock the firmware reads the sensors at, I2C_FREQ in main.c */
+#define READ_PLAN_I2C_HZ 115200
+
+/* Waits of READ_PLAN_BYTES, before every byte and before and after deselecting */
+#define READ_PLAN_BYTE_DELAY_US 1000
+#define READ_PLAN_DESELECT_DELAY_US 1000
+
+/* Waits around deselecting of the other plans, for the AD0 select line to settle */
+#define READ_PLAN_SETTLE_US 10
+
+#define READ_PLAN_MAX_STEPS (2 * 6)
+
+typedef struct {
+	uint8_t reg;            // first register
+	uint8_t len;            // bytes read from it on
+	uint16_t delay_us;      // wait before the transaction
+} read_step_t;
+
+typedef struct {
+	int strategy;
+	int steps;
+	read_step_t step[READ_PLAN_MAX_STEPS];
+	uint16_t deselect_delay_us;     // wait before deselecting the sensor and after
+} read_plan_t;
+
+/* Plan the reads of the axes in axes_mask (SENSOR_AXIS_AX ...) with one of the strategies */
+void read_plan_build(read_plan_t *plan, int strategy, uint32_t axes_mask);
+
+/* Byte of an axis (0 = accel x ... 5 = gyro z) in the data registers, its high byte first */
+static inline int read_plan_offset(int axis)
+{
+	return (axis < 3) ? 2 * axis : 2 * axis + 2;
+}
+
+/* Short name of a strategy, e.g. "bytes" */
+const char *read_plan_name(int strategy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __READ_PLAN_H__
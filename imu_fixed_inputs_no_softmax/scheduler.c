@@ -0,0 +1,43 @@
+/**
+ * @file        scheduler.c
+ * @brief       Adaptive hop between inferences driven by the confidence of the classifier
+ */
+
+#include "classify.h"
+#include "scheduler.h"
+
+void scheduler_init(scheduler_t *sch, int hop_min, int hop_max)
+{
+	sch->hop_min = hop_min;
+	sch->hop_max = hop_max;
+	sch->hop = SCHEDULER_HOP_START;
+	sch->hop = (sch->hop < hop_min) ? hop_min : sch->hop;
+	sch->hop = (sch->hop > hop_max) ? hop_max : sch->hop;
+	sch->last = -1;
+	sch->agree = 0;
+}
+
+int scheduler_next(scheduler_t *sch, const int8_t *logits)
+{
+	int activity = classify_argmax(logits, CLASSIFY_CLASSES);
+	int margin = classify_margin(logits, CLASSIFY_CLASSES);
+
+	if (margin < SCHEDULER_MARGIN_LOW) {
+		// Nothing is certain, follow the input as closely as possible
+		sch->hop = sch->hop_min;
+		sch->agree = 0;
+	} else if (activity != sch->last) {
+		// Possibly a transition, look again soon but don't pay for every flicker in full
+		sch->hop = sch->hop / 2;
+		sch->hop -= sch->hop % SCHEDULER_HOP_STEP;
+		sch->hop = (sch->hop < sch->hop_min) ? sch->hop_min : sch->hop;
+		sch->agree = 0;
+	} else if (margin >= SCHEDULER_MARGIN_HIGH && ++sch->agree >= SCHEDULER_AGREE) {
+		sch->hop += SCHEDULER_HOP_STEP;
+		sch->hop = (sch->hop > sch->hop_max) ? sch->hop_max : sch->hop;
+		sch->agree = 0;
+	}
+	sch->last = activity;
+
+	return sch->hop;
+}
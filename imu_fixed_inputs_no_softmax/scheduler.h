@@ -0,0 +1,104 @@
+/**
+ * @file        scheduler.h
+ * @brief       Adaptive hop between inferences driven by the confidence of the classifier
+ * @details     A window is classified again after a hop of new frames. While the decoded class
+ *              stays the same with a clear margin the hop widens by one input group at a time up
+ *              to its maximum, a change of class halves it and a margin that collapses drops it
+ *              straight to the minimum, so a steady activity costs few inferences and a transition
+ *              is followed closely. Hops are whole input groups since the window is shifted by
+ *              groups. 'make -C host replay' measures the inferences per minute and the delay of
+ *              activity transitions against the fixed hop.
+ *
+ *              Until a window has its PREPROCESS_WINDOW frames, the partial windows of
+ *              SCHEDULER_WARMUP_FRAMES frames and then every SCHEDULER_HOP_STEP more are
+ *              classified with the missing older frames padded as still, so the first label comes
+ *              well before the first full window. The replay reports their accuracy and the time
+ *              to the first label.
+ *
+ *              Plain C without SDK dependencies, shared with the host tools in ../host.
+ */
+
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "preprocess.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Frames per input group, the granularity of the hop */
+#define SCHEDULER_HOP_STEP 4
+
+/* Bounds of the hop in frames, build with e.g. -DSCHEDULER_HOP_MAX=16 */
+#ifndef SCHEDULER_HOP_MIN
+#define SCHEDULER_HOP_MIN 8
+#endif
+#ifndef SCHEDULER_HOP_MAX
+#define SCHEDULER_HOP_MAX 24
+#endif
+
+/* Hop after boot, the fixed hop the firmware used to have */
+#define SCHEDULER_HOP_START 8
+
+/*
+ * Logit margin of a confident classification, below SCHEDULER_MARGIN_LOW the hop collapses. The
+ * current network leads by less than 8 in a quarter of the windows and by 16 in half of them.
+ */
+#define SCHEDULER_MARGIN_HIGH 16
+#define SCHEDULER_MARGIN_LOW 4
+
+/* Confident classifications of the same class in a row before the hop widens by a step */
+#define SCHEDULER_AGREE 1
+
+/* Frames of the first partial window classified, 0 waits for the full window */
+#ifndef SCHEDULER_WARMUP_FRAMES
+#define SCHEDULER_WARMUP_FRAMES 10
+#endif
+
+#if SCHEDULER_WARMUP_FRAMES && (SCHEDULER_WARMUP_FRAMES < 2 \
+		|| SCHEDULER_WARMUP_FRAMES >= PREPROCESS_WINDOW \
+		|| (PREPROCESS_WINDOW - SCHEDULER_WARMUP_FRAMES) % SCHEDULER_HOP_STEP)
+#error "SCHEDULER_WARMUP_FRAMES must be 30 less a multiple of 4"
+#endif
+
+#if SCHEDULER_HOP_MIN % SCHEDULER_HOP_STEP || SCHEDULER_HOP_MAX % SCHEDULER_HOP_STEP \
+		|| SCHEDULER_HOP_MIN < SCHEDULER_HOP_STEP || SCHEDULER_HOP_MAX < SCHEDULER_HOP_MIN \
+		|| SCHEDULER_HOP_MAX > SCHEDULER_HOP_STEP * (PREPROCESS_GROUPS - 1)
+#error "SCHEDULER_HOP_MIN and SCHEDULER_HOP_MAX must be multiples of 4 between 4 and 28"
+#endif
+
+typedef struct {
+	int hop_min;
+	int hop_max;
+	int hop;            // frames until the next classification
+	int last;           // class of the last classification, -1 before the first
+	unsigned agree;     // confident classifications of that class in a row
+} scheduler_t;
+
+/*
+ * Start at SCHEDULER_HOP_START, clamped to the bounds. The firmware passes SCHEDULER_HOP_MIN and
+ * SCHEDULER_HOP_MAX, the host tools any multiples of SCHEDULER_HOP_STEP up to 28.
+ */
+void scheduler_init(scheduler_t *sch, int hop_min, int hop_max);
+
+/*
+ * Whether the partial window of the first frames of a window is classified, warmup being
+ * SCHEDULER_WARMUP_FRAMES for the firmware
+ */
+static inline bool scheduler_warmup(int frames, int warmup)
+{
+	return warmup && frames >= warmup && frames < PREPROCESS_WINDOW
+			&& (frames - warmup) % SCHEDULER_HOP_STEP == 0;
+}
+
+/* Account for the logits of a window, returns the hop in frames to the next window */
+int scheduler_next(scheduler_t *sch, const int8_t *logits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SCHEDULER_H__
@@ -0,0 +1,92 @@
+/**
+ * @file        sensor_config.h
+ * @brief       Compile-time configuration of the sensors and axes that make up the CNN input
+ * @details     The input is an image with one row per sensor and one column per axis, with the
+ *              PREPROCESS_WINDOW frames as its channels. The sensor count and the axes only
+ *              change the image size: the input buffers, the packing and the status message
+ *              follow from here, and since the channels are the frames the processor mapping in
+ *              imu.yaml stays the same. The network has to be trained for the same sensors and
+ *              axes (IMU_SENSORS and IMU_AXES for training/imu.py) and cnn.c, weights.h and
+ *              sampledata.h regenerated from it.
+ *
+ *              SENSOR_KIT selects one of the kits below, build with e.g. -DSENSOR_KIT=3. Kits
+ *              with more sensors need a select pin for each, list them as SENSOR_LIST with
+ *              SENSOR_COUNT and build with SENSOR_KIT=0.
+ *
+ *              Plain C without SDK dependencies, the pins only expand where the table is built.
+ */
+
+#ifndef __SENSOR_CONFIG_H__
+#define __SENSOR_CONFIG_H__
+
+#ifndef SENSOR_KIT
+#define SENSOR_KIT 6
+#endif
+
+/*
+ * SENSOR(name, id, port, pin) for every sensor in the order of the input rows. The id is the
+ * sensor's position in the six sensor kit, which is also its IMU number in the logs, so the
+ * calibration stored for a sensor and the training data of it stay the same across kits.
+ */
+#if SENSOR_KIT == 6
+#define SENSOR_COUNT 6
+#define SENSOR_LIST \
+	SENSOR("RL", 0, MXC_GPIO0, MXC_GPIO_PIN_5) \
+	SENSOR("LL", 1, MXC_GPIO0, MXC_GPIO_PIN_6) \
+	SENSOR("W", 2, MXC_GPIO0, MXC_GPIO_PIN_7) \
+	SENSOR("RA", 3, MXC_GPIO0, MXC_GPIO_PIN_8) \
+	SENSOR("LA", 4, MXC_GPIO0, MXC_GPIO_PIN_9) \
+	SENSOR("H", 5, MXC_GPIO0, MXC_GPIO_PIN_11)
+#elif SENSOR_KIT == 3
+// One leg, one arm and the head, train with IMU_SENSORS=0,2,5
+#define SENSOR_COUNT 3
+#define SENSOR_LIST \
+	SENSOR("RL", 0, MXC_GPIO0, MXC_GPIO_PIN_5) \
+	SENSOR("W", 2, MXC_GPIO0, MXC_GPIO_PIN_7) \
+	SENSOR("H", 5, MXC_GPIO0, MXC_GPIO_PIN_11)
+#elif SENSOR_KIT != 0
+#error "Unknown SENSOR_KIT, define SENSOR_LIST and SENSOR_COUNT with SENSOR_KIT=0"
+#endif
+
+#if !defined(SENSOR_LIST) || !defined(SENSOR_COUNT)
+#error "SENSOR_KIT=0 needs SENSOR_LIST and SENSOR_COUNT"
+#endif
+
+/* Axes of a sample, the bit of an axis in SENSOR_AXES_MASK is 1 << its index */
+#define SENSOR_AXIS_AX 0x01
+#define SENSOR_AXIS_AY 0x02
+#define SENSOR_AXIS_AZ 0x04
+#define SENSOR_AXIS_GX 0x08
+#define SENSOR_AXIS_GY 0x10
+#define SENSOR_AXIS_GZ 0x20
+#define SENSOR_AXIS_ACCEL (SENSOR_AXIS_AX | SENSOR_AXIS_AY | SENSOR_AXIS_AZ)
+
+/* Axes that are read and fed to the network, the same mask as IMU_AXES for training/imu.py */
+#ifndef SENSOR_AXES_MASK
+#define SENSOR_AXES_MASK 0x3F
+#endif
+
+#define SENSOR_AXES ((SENSOR_AXES_MASK & 1) + ((SENSOR_AXES_MASK >> 1) & 1) \
+		+ ((SENSOR_AXES_MASK >> 2) & 1) + ((SENSOR_AXES_MASK >> 3) & 1) \
+		+ ((SENSOR_AXES_MASK >> 4) & 1) + ((SENSOR_AXES_MASK >> 5) & 1))
+
+#if SENSOR_AXES == 0 || (SENSOR_AXES_MASK & ~0x3F)
+#error "SENSOR_AXES_MASK must select some of the six axes"
+#endif
+
+/* Pixels of the input image, i.e. words per input group */
+#define SENSOR_CHANNELS (SENSOR_COUNT * SENSOR_AXES)
+
+/* Axis (0 = accel x ... 5 = gyro z) of column a of the input */
+static inline int sensor_axis(int a)
+{
+	for (int axis = 0; axis < 6; axis++) {
+		if ((SENSOR_AXES_MASK & (1 << axis)) && a-- == 0) {
+			return axis;
+		}
+	}
+
+	return -1;
+}
+
+#endif // __SENSOR_CONFIG_H__
@@ -0,0 +1,54 @@
+/**
+ * @file        smooth.c
+ * @brief       Temporal smoothing of the classifications and the messages they cause
+ */
+
+#include "smooth.h"
+
+void smooth_init(smooth_t *sm)
+{
+	for (int c = 0; c < CLASSIFY_CLASSES; c++) {
+		sm->score[c] = 0;
+	}
+	sm->state = -1;
+	sm->sent_ms = 0;
+}
+
+smooth_event_t smooth_update(smooth_t *sm, const int8_t *logits, uint32_t now_ms)
+{
+	int32_t best = INT32_MIN;
+	int state = sm->state;
+
+	// Stay in a class, or come from the best one at the penalty, whichever scores higher. The
+	// best previous score is 0.
+	for (int c = 0; c < CLASSIFY_CLASSES; c++) {
+		int32_t from = (sm->score[c] > -SMOOTH_SWITCH_PENALTY) ? sm->score[c]
+				: -SMOOTH_SWITCH_PENALTY;
+
+		sm->score[c] = from + logits[c];
+		best = (sm->score[c] > best) ? sm->score[c] : best;
+	}
+	for (int c = 0; c < CLASSIFY_CLASSES; c++) {
+		sm->score[c] -= best;
+	}
+
+	// The current state wins ties
+	if (state < 0 || sm->score[state] < 0) {
+		state = 0;
+		while (sm->score[state] < 0) {
+			state++;
+		}
+	}
+
+	if (state != sm->state) {
+		sm->state = state;
+		sm->sent_ms = now_ms;
+		return SMOOTH_CHANGE;
+	}
+	if (SMOOTH_HEARTBEAT_MS > 0 && now_ms - sm->sent_ms >= SMOOTH_HEARTBEAT_MS) {
+		sm->sent_ms = now_ms;
+		return SMOOTH_HEARTBEAT;
+	}
+
+	return SMOOTH_QUIET;
+}
@@ -0,0 +1,60 @@
+/**
+ * @file        smooth.h
+ * @brief       Temporal smoothing of the classifications and the messages they cause
+ * @details     A two-level HMM in the log domain, run as an online Viterbi step: every class
+ *              keeps a score that adds up its logits over the windows, and a class can take over
+ *              from the best one at the price of SMOOTH_SWITCH_PENALTY. The scores are kept
+ *              relative to the best one, so they stay within [-SMOOTH_SWITCH_PENALTY - 255, 0]
+ *              in plain integers. The smoothed state only changes when another class has led by
+ *              more than its score lag, and a tie keeps the current state, so single windows and
+ *              ties don't flip it.
+ *
+ *              A message is only due when the smoothed state changes, plus a heartbeat repeating
+ *              it every SMOOTH_HEARTBEAT_MS. 'make -C host replay' counts the messages and the
+ *              delay of activity transitions with and without it.
+ *
+ *              Plain C without SDK dependencies, shared with the host tools in ../host.
+ */
+
+#ifndef __SMOOTH_H__
+#define __SMOOTH_H__
+
+#include <stdint.h>
+#include "classify.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Score, in logits, a class gives up to take over from the best one */
+#ifndef SMOOTH_SWITCH_PENALTY
+#define SMOOTH_SWITCH_PENALTY 48
+#endif
+
+/* Interval of the message repeating an unchanged state, 0 for none */
+#ifndef SMOOTH_HEARTBEAT_MS
+#define SMOOTH_HEARTBEAT_MS 30000
+#endif
+
+typedef enum {
+	SMOOTH_QUIET,       // nothing to send
+	SMOOTH_CHANGE,      // the state changed
+	SMOOTH_HEARTBEAT,   // the state is unchanged and the heartbeat is due
+} smooth_event_t;
+
+typedef struct {
+	int32_t score[CLASSIFY_CLASSES];
+	int state;              // smoothed class, -1 before the first classification
+	uint32_t sent_ms;       // time of the last message
+} smooth_t;
+
+void smooth_init(smooth_t *sm);
+
+/* Add the logits of a window classified at now_ms, returns whether a message is due */
+smooth_event_t smooth_update(smooth_t *sm, const int8_t *logits, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SMOOTH_H__